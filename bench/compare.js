@@ -0,0 +1,49 @@
+'use strict';
+
+/**
+ * Compare two benchmark result files written by bench/run.js or hdfs-bench.
+ * Prints the change of throughput and p99 latency of every scenario and
+ * exits with 1 if one regressed more than the threshold.
+ *
+ * usage: node bench/compare.js baseline.jsonl current.jsonl [--threshold 10]
+ */
+const fs = require('fs');
+
+const PARAMS = ['concurrency', 'threads', 'ioSize', 'chunkSize', 'packetSize', 'entries'];
+
+function load(file) {
+    const results = new Map();
+    fs.readFileSync(file, 'utf8').split('\n').filter(l => l.startsWith('{')).forEach((line) => {
+        const r = JSON.parse(line);
+        const key = [r.suite, r.scenario].concat(PARAMS.filter(p => p in r).map(p => `${p}=${r[p]}`)).join(' ');
+        results.set(key, r);
+    });
+    return results;
+}
+
+function change(before, after) {
+    return before > 0 ? (after - before) * 100 / before : 0;
+}
+
+function main(argv) {
+    if (argv.length < 2) {
+        console.error('usage: node bench/compare.js baseline.jsonl current.jsonl [--threshold percent]');
+        process.exit(2);
+    }
+    const threshold = argv[2] === '--threshold' ? Number(argv[3]) : 10;
+    const baseline = load(argv[0]);
+    const current = load(argv[1]);
+    let regressed = false;
+    for (const [key, r] of current) {
+        const b = baseline.get(key);
+        if (!b) continue;
+        const throughput = change(b.opsPerSec, r.opsPerSec);
+        const p99 = change(b.latencyUs.p99, r.latencyUs.p99);
+        const bad = throughput < -threshold || p99 > threshold;
+        regressed = regressed || bad;
+        console.log(`${bad ? '!' : ' '} ${key}: ops/s ${throughput.toFixed(1)}%, p99 ${p99.toFixed(1)}%`);
+    }
+    process.exit(regressed ? 1 : 0);
+}
+
+main(process.argv.slice(2));
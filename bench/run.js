@@ -0,0 +1,293 @@
+'use strict';
+
+/**
+ * Throughput and latency benchmark of nhdfs.
+ *
+ * Every scenario prints one JSON object per line, e.g.
+ * {"suite":"nhdfs","scenario":"readAt","concurrency":4,"ioSize":65536,...}
+ * Compare two runs with bench/compare.js.
+ *
+ * usage: node bench/run.js [--service localhost] [--port 9000] [--dir /tmp/nhdfs-bench]
+ *   [--scenarios write,read,readAt,open,list] [--fileSize MB] [--ioSize bytes]
+ *   [--concurrency 1,2,4,8,16] [--chunkSizes 65536,1048576] [--files N] [--ops N] [--iterations N]
+ *   [--fakeCluster path/to/hdfs-fake-cluster] [--fakeDatanodes N]
+ *
+ * With --fakeCluster the benchmark starts the fake cluster of libhdfs3
+ * ("make hdfs-fake-cluster" in its build directory) instead of using --service.
+ */
+const childProcess = require('child_process');
+const { writeFileSync, unlinkSync } = require('fs');
+const os = require('os');
+const readline = require('readline');
+const nhdfs = require('../lib/nhdfs');
+
+const defaults = {
+    service: 'localhost',
+    port: 9000,
+    dir: '/tmp/nhdfs-bench',
+    scenarios: 'write,read,readAt,open,list',
+    fileSize: 256,
+    ioSize: 65536,
+    concurrency: '1,2,4,8,16',
+    chunkSizes: '65536,1048576',
+    files: 1000,
+    ops: 2000,
+    iterations: 20,
+    fakeCluster: '',
+    fakeDatanodes: 3
+};
+
+function parseArgs(argv) {
+    const opts = Object.assign({}, defaults);
+    for (let i = 0; i < argv.length; i += 2) {
+        const key = argv[i].replace(/^--/, '');
+        if (!(key in defaults) || i + 1 >= argv.length) {
+            console.error(`unknown or incomplete option ${argv[i]}`);
+            process.exit(2);
+        }
+        opts[key] = typeof defaults[key] === 'number' ? Number(argv[i + 1]) : argv[i + 1];
+    }
+    opts.fileSize = opts.fileSize * 1024 * 1024;
+    opts.scenarios = opts.scenarios.split(',');
+    opts.concurrency = opts.concurrency.split(',').map(Number);
+    opts.chunkSizes = opts.chunkSizes.split(',').map(Number);
+    return opts;
+}
+
+const now = () => {
+    const [s, ns] = process.hrtime();
+    return s * 1e6 + ns / 1e3;
+}
+
+function percentile(sorted, p) {
+    if (sorted.length === 0) return 0;
+    return sorted[Math.round(p * (sorted.length - 1))];
+}
+
+function report(scenario, params, latencies, bytes, start, before) {
+    const seconds = (now() - start) / 1e6;
+    const after = nhdfs.metrics();
+    const counters = {};
+    for (const name of Object.keys(after.counters)) {
+        counters[name] = after.counters[name] - before.counters[name];
+    }
+    latencies.sort((a, b) => a - b);
+    console.log(JSON.stringify(Object.assign({ suite: 'nhdfs', scenario: scenario }, params, {
+        ops: latencies.length,
+        bytes: bytes,
+        seconds: seconds,
+        opsPerSec: latencies.length / seconds,
+        mbPerSec: bytes / seconds / (1024 * 1024),
+        latencyUs: {
+            p50: Math.round(percentile(latencies, 0.5)),
+            p90: Math.round(percentile(latencies, 0.9)),
+            p99: Math.round(percentile(latencies, 0.99)),
+            max: Math.round(latencies.length ? latencies[latencies.length - 1] : 0)
+        },
+        counters: counters
+    })));
+}
+
+function writeFile(fs, path, size, chunkSize, latencies) {
+    const out = fs.createWriteStream(path);
+    const chunk = Buffer.alloc(chunkSize, 'x');
+    let done = 0;
+    return new Promise((resolve, reject) => {
+        out.on('error', reject);
+        out.on('finish', resolve);
+        const next = () => {
+            while (done < size) {
+                const len = Math.min(chunkSize, size - done);
+                const begin = now();
+                done += len;
+                const more = out.write(len === chunkSize ? chunk : chunk.slice(0, len), () => {
+                    if (latencies) latencies.push(now() - begin);
+                });
+                if (!more) return out.once('drain', next);
+            }
+            out.end();
+        }
+        next();
+    });
+}
+
+function readFile(fs, path, latencies) {
+    const ins = fs.createReadStream(path);
+    let bytes = 0;
+    let last = now();
+    return new Promise((resolve, reject) => {
+        ins.on('error', reject);
+        ins.on('data', (data) => {
+            const t = now();
+            if (latencies) latencies.push(t - last);
+            last = t;
+            bytes += data.length;
+        });
+        ins.on('end', () => resolve(bytes));
+    });
+}
+
+async function exists(fs, path, size) {
+    try {
+        const s = await fs.stats(path);
+        return size === undefined || s.size === size;
+    } catch (e) {
+        return false;
+    }
+}
+
+async function benchWrite(fs, opts) {
+    for (const chunkSize of opts.chunkSizes) {
+        const latencies = [];
+        const before = nhdfs.metrics();
+        const start = now();
+        await writeFile(fs, `${opts.dir}/data`, opts.fileSize, chunkSize, latencies);
+        report('write', { chunkSize: chunkSize }, latencies, opts.fileSize, start, before);
+    }
+}
+
+async function benchRead(fs, opts) {
+    const latencies = [];
+    const before = nhdfs.metrics();
+    const start = now();
+    const bytes = await readFile(fs, `${opts.dir}/data`, latencies);
+    report('read', {}, latencies, bytes, start, before);
+}
+
+/**
+ * Random positioned reads, every worker reads through its own stream.
+ */
+async function benchReadAt(fs, opts) {
+    const range = Math.max(opts.fileSize - opts.ioSize, 1);
+    for (const concurrency of opts.concurrency) {
+        const latencies = [];
+        let bytes = 0;
+        const worker = async () => {
+            const ins = fs.createReadStream(`${opts.dir}/data`);
+            for (let i = 0; i < opts.ops; i++) {
+                const begin = now();
+                const buf = await ins.readAt(Math.floor(Math.random() * range), opts.ioSize);
+                latencies.push(now() - begin);
+                bytes += buf.length;
+            }
+            await new Promise((resolve) => ins.close(resolve));
+        }
+        const before = nhdfs.metrics();
+        const start = now();
+        await Promise.all(Array.from({ length: concurrency }, worker));
+        report('readAt', { concurrency: concurrency, ioSize: opts.ioSize }, latencies, bytes, start, before);
+    }
+}
+
+async function setupSmallFiles(fs, opts) {
+    const dir = `${opts.dir}/small`;
+    if (await exists(fs, dir)) {
+        const list = await fs.list(dir);
+        if (list.length === opts.files) return;
+        await fs.delete(dir, true);
+    }
+    await fs.mkdir(dir);
+    for (let i = 0; i < opts.files; i++) {
+        await writeFile(fs, `${dir}/${i}`, 1024, 1024);
+    }
+}
+
+/**
+ * Open and read small files, the workers share the files.
+ */
+async function benchOpen(fs, opts) {
+    for (const concurrency of opts.concurrency) {
+        const latencies = [];
+        let bytes = 0;
+        let next = 0;
+        const worker = async () => {
+            while (next < opts.files) {
+                const i = next++;
+                const begin = now();
+                bytes += await readFile(fs, `${opts.dir}/small/${i}`);
+                latencies.push(now() - begin);
+            }
+        }
+        const before = nhdfs.metrics();
+        const start = now();
+        await Promise.all(Array.from({ length: concurrency }, worker));
+        report('open', { concurrency: concurrency }, latencies, bytes, start, before);
+    }
+}
+
+async function benchList(fs, opts) {
+    const latencies = [];
+    const before = nhdfs.metrics();
+    const start = now();
+    for (let i = 0; i < opts.iterations; i++) {
+        const begin = now();
+        await fs.list(`${opts.dir}/small`);
+        latencies.push(now() - begin);
+    }
+    report('list', { entries: opts.files }, latencies, 0, start, before);
+}
+
+/**
+ * Start the fake cluster binary and resolve with the process and its ports.
+ */
+function startFakeCluster(opts) {
+    return new Promise((resolve, reject) => {
+        const proc = childProcess.spawn(opts.fakeCluster, ['--datanodes', String(opts.fakeDatanodes)],
+            { stdio: ['pipe', 'pipe', 'inherit'] });
+        proc.on('error', reject);
+        readline.createInterface({ input: proc.stdout }).once('line', (line) => {
+            resolve({ proc: proc, ports: JSON.parse(line) });
+        });
+    });
+}
+
+/**
+ * The fake datanodes are local but do not serve short circuit reads.
+ */
+function fakeClusterConf() {
+    const file = `${os.tmpdir()}/nhdfs-bench-${process.pid}.xml`;
+    writeFileSync(file, '<configuration><property><name>dfs.client.read.shortcircuit</name>' +
+        '<value>false</value></property></configuration>');
+    return file;
+}
+
+async function main() {
+    const opts = parseArgs(process.argv.slice(2));
+    let cluster = null;
+    let configurationPath = '';
+    if (opts.fakeCluster) {
+        cluster = await startFakeCluster(opts);
+        opts.service = 'localhost';
+        opts.port = cluster.ports.namenodes[0];
+        configurationPath = fakeClusterConf();
+    }
+    try {
+        await run(opts, configurationPath);
+    } finally {
+        if (cluster) {
+            cluster.proc.kill();
+            unlinkSync(configurationPath);
+        }
+    }
+}
+
+async function run(opts, configurationPath) {
+    const fs = nhdfs.createFS({ service: opts.service, port: opts.port, configurationPath: configurationPath, useHadoopConfEnv: false });
+    const enabled = (s) => opts.scenarios.includes(s);
+    if (!(await exists(fs, opts.dir))) await fs.mkdir(opts.dir);
+    if (enabled('write')) {
+        await benchWrite(fs, opts);
+    } else if ((enabled('read') || enabled('readAt')) && !(await exists(fs, `${opts.dir}/data`, opts.fileSize))) {
+        await writeFile(fs, `${opts.dir}/data`, opts.fileSize, opts.ioSize);
+    }
+    if (enabled('read')) await benchRead(fs, opts);
+    if (enabled('readAt')) await benchReadAt(fs, opts);
+    if (enabled('open') || enabled('list')) await setupSmallFiles(fs, opts);
+    if (enabled('open')) await benchOpen(fs, opts);
+    if (enabled('list')) await benchList(fs, opts);
+}
+
+main().catch((err) => {
+    console.error(err);
+    process.exit(1);
+});
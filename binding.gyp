@@ -1,4 +1,9 @@
 {
+  "variables": {
+    "have_zstd": "<!(pkg-config --exists libzstd && echo 1 || echo 0)",
+    "have_lz4": "<!(pkg-config --exists liblz4 && echo 1 || echo 0)",
+    "have_snappy": "<!(test -f /usr/include/snappy-c.h -o -f /usr/local/include/snappy-c.h && echo 1 || echo 0)"
+  },
   "targets": [
     {
       "target_name": "nhdfs",
@@ -7,7 +12,13 @@
         "src/filereader.cc", 
         "src/filewriter.cc", 
         "src/filesystem.cc",
-        "src/clusterinfo.cc"  
+        "src/clusterinfo.cc",
+        "src/bufferpool.cc",
+        "src/completion.cc",
+        "src/metrics.cc",
+        "src/codec.cc",
+        "src/splitter.cc",
+        "src/fsregistry.cc"
       ],
       "dependencies": ["<!(node -p \"require('node-addon-api').gyp\")"],
       "cflags!": [ "-fno-exceptions" ],
@@ -27,6 +38,7 @@
         "libraries": [
           "-lhdfs3",
           "-L<(module_root_dir)/build_deps/libhdfs3/dist/lib",
+          "-lz",
         ],
         'ldflags': [
           '-Wl,-rpath,<(module_root_dir)/build_deps/libhdfs3/dist/lib',
@@ -34,5 +46,10 @@
       },
       'cflags!': [ '-fno-exceptions' ],
 	    'cflags_cc!': [ '-fno-exceptions' ],
+      "conditions": [
+        ["have_zstd==1", { "defines": [ "HAVE_ZSTD" ], "link_settings": { "libraries": [ "-lzstd" ] } }],
+        ["have_lz4==1", { "defines": [ "HAVE_LZ4" ], "link_settings": { "libraries": [ "-llz4" ] } }],
+        ["have_snappy==1", { "defines": [ "HAVE_SNAPPY" ], "link_settings": { "libraries": [ "-lsnappy" ] } }]
+      ],
     }	],
 }
@@ -9,6 +9,17 @@ INCLUDE (CheckFunctionExists)
 CHECK_FUNCTION_EXISTS(dladdr HAVE_DLADDR)
 CHECK_FUNCTION_EXISTS(nanosleep HAVE_NANOSLEEP)
 
+INCLUDE (CheckCXXSourceCompiles)
+CHECK_CXX_SOURCE_COMPILES("
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+int main() {
+    struct io_uring_probe p;
+    struct __kernel_timespec ts;
+    return IORING_OP_RECV + IORING_OP_SEND + IORING_OP_LINK_TIMEOUT
+           + IORING_REGISTER_PROBE + __NR_io_uring_setup;
+}" HAVE_IO_URING)
+
 IF(ENABLE_DEBUG STREQUAL ON)
     SET(CMAKE_BUILD_TYPE Debug CACHE 
         STRING "Choose the type of build, options are: None Debug Release RelWithDebInfo MinSizeRel." FORCE)
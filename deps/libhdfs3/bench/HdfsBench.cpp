@@ -0,0 +1,791 @@
+/********************************************************************
+ * 2014 -
+ * open source under Apache License Version 2.0
+ ********************************************************************/
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * hdfs-bench: throughput and latency benchmark of the libhdfs3 C API.
+ *
+ * Every scenario prints one JSON object per line on stdout, e.g.
+ * {"suite":"libhdfs3","scenario":"pread","threads":4,"ioSize":65536,...}
+ * so results of two runs can be compared by a script.
+ */
+#include "hdfs.h"
+#include "Exception.h"
+#include "FakeCluster.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <getopt.h>
+#include <new>
+#include <pthread.h>
+#include <sstream>
+#include <stdint.h>
+#include <string>
+#include <time.h>
+#include <vector>
+
+/*
+ * Count the heap allocations of the whole process, reported per operation
+ * so changes to the allocation behaviour of the open and read paths show up.
+ */
+static volatile int64_t Allocations = 0;
+
+void * operator new(size_t size) {
+    __sync_fetch_and_add(&Allocations, 1);
+    void * p = malloc(size ? size : 1);
+
+    if (!p) {
+        throw std::bad_alloc();
+    }
+
+    return p;
+}
+
+void operator delete(void * p) throw() {
+    free(p);
+}
+
+namespace {
+
+struct Options {
+    Options() :
+        namenode("localhost"), port(9000), dir("/tmp/hdfs-bench"),
+        fileSize(256LL << 20), ioSize(64 << 10), files(1000), ops(2000),
+        iterations(20), scenarios("write,read,pread,open,list"), listers(2),
+        rpcConnections(0), bulkConnections(0), fakeDatanodes(0),
+        fakeLatency(0), fakeBandwidth(0) {
+        threads.push_back(1);
+        threads.push_back(2);
+        threads.push_back(4);
+        threads.push_back(8);
+        threads.push_back(16);
+        packetSizes.push_back(64 << 10);
+        packetSizes.push_back(256 << 10);
+        packetSizes.push_back(1 << 20);
+    }
+
+    std::string namenode;
+    int port;
+    std::string dir;
+    int64_t fileSize;
+    int32_t ioSize;
+    int files; //small files for open and list.
+    int ops; //random preads per thread.
+    int iterations; //listings.
+    std::string scenarios;
+    std::vector<int> threads;
+    std::vector<int> packetSizes;
+    int listers; //threads listing the small files during stat.
+    int rpcConnections; //rpc.client.connections.per.server if positive.
+    int bulkConnections; //rpc.client.bulk.connections.per.server if positive.
+    int fakeDatanodes; //run against an in-process fake cluster if positive.
+    int fakeLatency; //milliseconds added by every fake datanode.
+    int64_t fakeBandwidth; //bytes per second of every fake datanode.
+};
+
+/*
+ * The measurements of one scenario run.
+ */
+struct Result {
+    Result() :
+        ops(0), bytes(0), seconds(0), allocations(0) {
+    }
+
+    std::string scenario;
+    std::vector<std::pair<std::string, int64_t> > params;
+    std::vector<int64_t> latencies; //microseconds.
+    int64_t ops;
+    int64_t bytes;
+    double seconds;
+    int64_t allocations;
+    hdfsMetrics before;
+    hdfsMetrics after;
+};
+
+int64_t NowMicros() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+void Die(const char * what) {
+    fprintf(stderr, "hdfs-bench: %s: %s\n", what, hdfsGetLastError());
+    exit(1);
+}
+
+std::vector<int> ParseList(const char * str) {
+    std::vector<int> retval;
+    std::stringstream ss(str);
+    std::string item;
+
+    while (std::getline(ss, item, ',')) {
+        retval.push_back(atoi(item.c_str()));
+    }
+
+    return retval;
+}
+
+bool Enabled(const Options & opts, const char * scenario) {
+    std::string list = "," + opts.scenarios + ",";
+    return list.find(std::string(",") + scenario + ",") != std::string::npos;
+}
+
+hdfsFS Connect(const Options & opts, int packetSize) {
+    hdfsBuilder * builder = hdfsNewBuilder();
+
+    if (!builder) {
+        Die("hdfsNewBuilder");
+    }
+
+    hdfsBuilderSetNameNode(builder, opts.namenode.c_str());
+    hdfsBuilderSetNameNodePort(builder, opts.port);
+    hdfsBuilderSetForceNewInstance(builder);
+
+    if (packetSize > 0) {
+        char value[32];
+        snprintf(value, sizeof(value), "%d", packetSize);
+        hdfsBuilderConfSetStr(builder, "dfs.client-write-packet-size", value);
+    }
+
+    if (opts.rpcConnections > 0) {
+        char value[32];
+        snprintf(value, sizeof(value), "%d", opts.rpcConnections);
+        hdfsBuilderConfSetStr(builder, "rpc.client.connections.per.server", value);
+    }
+
+    if (opts.bulkConnections > 0) {
+        char value[32];
+        snprintf(value, sizeof(value), "%d", opts.bulkConnections);
+        hdfsBuilderConfSetStr(builder, "rpc.client.bulk.connections.per.server", value);
+    }
+
+    if (opts.fakeDatanodes > 0) {
+        /*
+         * the fake datanodes are local but do not serve short circuit reads.
+         */
+        hdfsBuilderConfSetStr(builder, "dfs.client.read.shortcircuit", "false");
+    }
+
+    hdfsFS fs = hdfsBuilderConnect(builder);
+    hdfsFreeBuilder(builder);
+
+    if (!fs) {
+        Die("connect");
+    }
+
+    return fs;
+}
+
+int64_t Percentile(const std::vector<int64_t> & sorted, double p) {
+    if (sorted.empty()) {
+        return 0;
+    }
+
+    size_t index = static_cast<size_t>(p * (sorted.size() - 1) + 0.5);
+    return sorted[index];
+}
+
+int64_t Counter(const hdfsMetrics & metrics, const char * name) {
+    for (int i = 0; i < metrics.numCounters; ++i) {
+        if (!strcmp(metrics.counters[i].name, name)) {
+            return metrics.counters[i].value;
+        }
+    }
+
+    return 0;
+}
+
+void Print(Result & result) {
+    std::sort(result.latencies.begin(), result.latencies.end());
+    std::stringstream ss;
+    ss << "{\"suite\":\"libhdfs3\",\"scenario\":\"" << result.scenario << "\"";
+
+    for (size_t i = 0; i < result.params.size(); ++i) {
+        ss << ",\"" << result.params[i].first << "\":" << result.params[i].second;
+    }
+
+    double seconds = result.seconds > 0 ? result.seconds : 1e-9;
+    ss << ",\"ops\":" << result.ops << ",\"bytes\":" << result.bytes
+       << ",\"seconds\":" << result.seconds
+       << ",\"opsPerSec\":" << result.ops / seconds
+       << ",\"mbPerSec\":" << result.bytes / seconds / (1 << 20)
+       << ",\"allocsPerOp\":" << (result.ops ? result.allocations / result.ops : 0)
+       << ",\"latencyUs\":{\"p50\":" << Percentile(result.latencies, 0.5)
+       << ",\"p90\":" << Percentile(result.latencies, 0.9)
+       << ",\"p99\":" << Percentile(result.latencies, 0.99)
+       << ",\"max\":" << (result.latencies.empty() ? 0 : result.latencies.back())
+       << "},\"counters\":{";
+
+    for (int i = 0; i < result.after.numCounters; ++i) {
+        const char * name = result.after.counters[i].name;
+        ss << (i ? "," : "") << "\"" << name << "\":"
+           << Counter(result.after, name) - Counter(result.before, name);
+    }
+
+    ss << "}}";
+    printf("%s\n", ss.str().c_str());
+    fflush(stdout);
+}
+
+void Begin(Result & result, const char * scenario) {
+    result.scenario = scenario;
+    hdfsGetMetrics(&result.before);
+    result.allocations = Allocations;
+}
+
+void End(Result & result, int64_t start) {
+    result.seconds = (NowMicros() - start) / 1e6;
+    result.allocations = Allocations - result.allocations;
+    hdfsGetMetrics(&result.after);
+    Print(result);
+}
+
+std::string DataFile(const Options & opts) {
+    return opts.dir + "/data";
+}
+
+std::string SmallFile(const Options & opts, int i) {
+    char name[32];
+    snprintf(name, sizeof(name), "/small/%06d", i);
+    return opts.dir + name;
+}
+
+void WriteFile(hdfsFS fs, const std::string & path, int64_t size,
+               int32_t ioSize, std::vector<int64_t> * latencies) {
+    hdfsFile file = hdfsOpenFile(fs, path.c_str(), O_WRONLY, 0, 0, 0);
+
+    if (!file) {
+        Die(path.c_str());
+    }
+
+    std::vector<char> buffer(ioSize, 'x');
+
+    for (int64_t done = 0; done < size;) {
+        tSize todo = static_cast<tSize>(std::min<int64_t>(ioSize, size - done));
+        int64_t start = NowMicros();
+
+        if (hdfsWrite(fs, file, &buffer[0], todo) != todo) {
+            Die("write");
+        }
+
+        if (latencies) {
+            latencies->push_back(NowMicros() - start);
+        }
+
+        done += todo;
+    }
+
+    if (hdfsCloseFile(fs, file)) {
+        Die("close");
+    }
+}
+
+/*
+ * Sequential writes of the data file, one run per packet size.
+ */
+void BenchWrite(const Options & opts) {
+    for (size_t i = 0; i < opts.packetSizes.size(); ++i) {
+        hdfsFS fs = Connect(opts, opts.packetSizes[i]);
+        Result result;
+        result.params.push_back(std::make_pair("packetSize", opts.packetSizes[i]));
+        result.params.push_back(std::make_pair("ioSize", opts.ioSize));
+        Begin(result, "write");
+        int64_t start = NowMicros();
+        WriteFile(fs, DataFile(opts), opts.fileSize, opts.ioSize, &result.latencies);
+        result.ops = result.latencies.size();
+        result.bytes = opts.fileSize;
+        End(result, start);
+        hdfsDisconnect(fs);
+    }
+}
+
+/*
+ * One sequential pass over the data file.
+ */
+void BenchRead(const Options & opts, hdfsFS fs) {
+    Result result;
+    result.params.push_back(std::make_pair("ioSize", opts.ioSize));
+    Begin(result, "read");
+    int64_t start = NowMicros();
+    hdfsFile file = hdfsOpenFile(fs, DataFile(opts).c_str(), O_RDONLY, 0, 0, 0);
+
+    if (!file) {
+        Die("open");
+    }
+
+    std::vector<char> buffer(opts.ioSize);
+
+    while (true) {
+        int64_t begin = NowMicros();
+        tSize n = hdfsRead(fs, file, &buffer[0], opts.ioSize);
+
+        if (n < 0) {
+            Die("read");
+        } else if (n == 0) {
+            break;
+        }
+
+        result.latencies.push_back(NowMicros() - begin);
+        result.bytes += n;
+    }
+
+    hdfsCloseFile(fs, file);
+    result.ops = result.latencies.size();
+    End(result, start);
+}
+
+struct Worker {
+    const Options * opts;
+    hdfsFS fs;
+    int id;
+    int threads;
+    std::vector<int64_t> latencies;
+    int64_t bytes;
+    void (*run)(Worker *);
+};
+
+void * RunWorker(void * arg) {
+    Worker * worker = static_cast<Worker *>(arg);
+    worker->run(worker);
+    return NULL;
+}
+
+/*
+ * Run the workers on their own threads and merge their measurements.
+ */
+void RunConcurrently(const Options & opts, hdfsFS fs, const char * scenario,
+                     void (*run)(Worker *)) {
+    for (size_t t = 0; t < opts.threads.size(); ++t) {
+        int threads = opts.threads[t];
+        std::vector<Worker> workers(threads);
+        std::vector<pthread_t> tids(threads);
+        Result result;
+        result.params.push_back(std::make_pair("threads", threads));
+        result.params.push_back(std::make_pair("ioSize", opts.ioSize));
+        Begin(result, scenario);
+        int64_t start = NowMicros();
+
+        for (int i = 0; i < threads; ++i) {
+            workers[i].opts = &opts;
+            workers[i].fs = fs;
+            workers[i].id = i;
+            workers[i].threads = threads;
+            workers[i].bytes = 0;
+            workers[i].run = run;
+
+            if (pthread_create(&tids[i], NULL, RunWorker, &workers[i])) {
+                fprintf(stderr, "hdfs-bench: cannot create thread\n");
+                exit(1);
+            }
+        }
+
+        for (int i = 0; i < threads; ++i) {
+            pthread_join(tids[i], NULL);
+            result.latencies.insert(result.latencies.end(),
+                                    workers[i].latencies.begin(),
+                                    workers[i].latencies.end());
+            result.bytes += workers[i].bytes;
+        }
+
+        result.ops = result.latencies.size();
+        End(result, start);
+    }
+}
+
+/*
+ * Random positioned reads, every thread has its own handle of the data file.
+ */
+void PreadWorker(Worker * worker) {
+    const Options & opts = *worker->opts;
+    hdfsFile file = hdfsOpenFile(worker->fs, DataFile(opts).c_str(), O_RDONLY, 0, 0, 0);
+
+    if (!file) {
+        Die("open");
+    }
+
+    std::vector<char> buffer(opts.ioSize);
+    unsigned int seed = worker->id + 1;
+    int64_t range = std::max<int64_t>(opts.fileSize - opts.ioSize, 1);
+
+    for (int i = 0; i < opts.ops; ++i) {
+        int64_t position = ((static_cast<int64_t>(rand_r(&seed)) << 31)
+                            ^ rand_r(&seed)) % range;
+        int64_t start = NowMicros();
+
+        if (hdfsSeek(worker->fs, file, position)) {
+            Die("seek");
+        }
+
+        tSize n = hdfsRead(worker->fs, file, &buffer[0], opts.ioSize);
+
+        if (n < 0) {
+            Die("pread");
+        }
+
+        worker->latencies.push_back(NowMicros() - start);
+        worker->bytes += n;
+    }
+
+    hdfsCloseFile(worker->fs, file);
+}
+
+/*
+ * Open, read and close small files, the threads share the files.
+ */
+void OpenWorker(Worker * worker) {
+    const Options & opts = *worker->opts;
+    std::vector<char> buffer(opts.ioSize);
+
+    for (int i = worker->id; i < opts.files; i += worker->threads) {
+        int64_t start = NowMicros();
+        hdfsFile file = hdfsOpenFile(worker->fs, SmallFile(opts, i).c_str(), O_RDONLY, 0, 0, 0);
+
+        if (!file) {
+            Die("open");
+        }
+
+        tSize n = hdfsRead(worker->fs, file, &buffer[0], opts.ioSize);
+
+        if (n < 0) {
+            Die("read");
+        }
+
+        hdfsCloseFile(worker->fs, file);
+        worker->latencies.push_back(NowMicros() - start);
+        worker->bytes += n;
+    }
+}
+
+void SetupSmallFiles(const Options & opts, hdfsFS fs) {
+    std::string dir = opts.dir + "/small";
+    int entries = 0;
+    hdfsFileInfo * infos = hdfsListDirectory(fs, dir.c_str(), &entries);
+
+    if (infos) {
+        hdfsFreeFileInfo(infos, entries);
+    }
+
+    if (entries == opts.files) {
+        return;
+    }
+
+    hdfsDelete(fs, dir.c_str(), 1);
+    hdfsCreateDirectory(fs, dir.c_str());
+
+    for (int i = 0; i < opts.files; ++i) {
+        WriteFile(fs, SmallFile(opts, i), 1024, 1024, NULL);
+    }
+}
+
+void BenchList(const Options & opts, hdfsFS fs) {
+    std::string dir = opts.dir + "/small";
+    Result result;
+    result.params.push_back(std::make_pair("entries", opts.files));
+    Begin(result, "list");
+    int64_t start = NowMicros();
+
+    for (int i = 0; i < opts.iterations; ++i) {
+        int entries = 0;
+        int64_t begin = NowMicros();
+        hdfsFileInfo * infos = hdfsListDirectory(fs, dir.c_str(), &entries);
+
+        if (!infos) {
+            Die("list");
+        }
+
+        hdfsFreeFileInfo(infos, entries);
+        result.latencies.push_back(NowMicros() - begin);
+    }
+
+    result.ops = result.latencies.size();
+    End(result, start);
+}
+
+/*
+ * Stat the small files while other threads list their directory, the
+ * listings are the large responses a bulk connection keeps off the
+ * connection of the small calls.
+ */
+volatile bool Listing = false;
+
+void StatWorker(Worker * worker) {
+    const Options & opts = *worker->opts;
+
+    for (int i = 0; i < opts.ops; ++i) {
+        std::string path = SmallFile(opts, (worker->id + i * worker->threads) % opts.files);
+        int64_t start = NowMicros();
+        hdfsFileInfo * info = hdfsGetPathInfo(worker->fs, path.c_str());
+
+        if (!info) {
+            Die("stat");
+        }
+
+        hdfsFreeFileInfo(info, 1);
+        worker->latencies.push_back(NowMicros() - start);
+    }
+}
+
+void * RunLister(void * arg) {
+    const Options & opts = *static_cast<Options *>(arg);
+    hdfsFS fs = Connect(opts, 0);
+    std::string dir = opts.dir + "/small";
+
+    while (Listing) {
+        int entries = 0;
+        hdfsFileInfo * infos = hdfsListDirectory(fs, dir.c_str(), &entries);
+
+        if (!infos) {
+            Die("list");
+        }
+
+        hdfsFreeFileInfo(infos, entries);
+    }
+
+    hdfsDisconnect(fs);
+    return NULL;
+}
+
+void BenchStat(Options & opts, hdfsFS fs) {
+    std::vector<pthread_t> tids(opts.listers);
+    Listing = true;
+
+    for (int i = 0; i < opts.listers; ++i) {
+        if (pthread_create(&tids[i], NULL, RunLister, &opts)) {
+            fprintf(stderr, "hdfs-bench: cannot create thread\n");
+            exit(1);
+        }
+    }
+
+    RunConcurrently(opts, fs, "stat", StatWorker);
+    Listing = false;
+
+    for (int i = 0; i < opts.listers; ++i) {
+        pthread_join(tids[i], NULL);
+    }
+}
+
+Hdfs::Internal::shared_ptr<Hdfs::Internal::FakeCluster> StartFakeCluster(Options & opts) {
+    using namespace Hdfs::Internal;
+    FakeClusterConfig conf;
+    conf.datanodes = opts.fakeDatanodes;
+    shared_ptr<FakeCluster> cluster(new FakeCluster(conf));
+
+    try {
+        cluster->start();
+    } catch (const Hdfs::HdfsException & e) {
+        fprintf(stderr, "hdfs-bench: cannot start the fake cluster: %s\n", e.what());
+        exit(1);
+    }
+
+    DatanodeFaults faults;
+    faults.latency = opts.fakeLatency;
+    faults.bandwidth = opts.fakeBandwidth;
+
+    for (int i = 0; i < cluster->getNumDatanodes(); ++i) {
+        cluster->setDatanodeFaults(i, faults);
+    }
+
+    opts.namenode = "localhost";
+    opts.port = cluster->getNamenodePort(0);
+    return cluster;
+}
+
+void Usage() {
+    fprintf(stderr,
+            "usage: hdfs-bench [options]\n"
+            "  --namenode HOST      namenode host (localhost)\n"
+            "  --port PORT          namenode port (9000)\n"
+            "  --dir PATH           working directory (/tmp/hdfs-bench)\n"
+            "  --scenarios LIST     write,read,pread,open,list (or stat)\n"
+            "  --file-size MB       size of the data file (256)\n"
+            "  --io-size BYTES      size of each read or write (65536)\n"
+            "  --threads LIST       concurrency sweep (1,2,4,8,16)\n"
+            "  --packet-sizes LIST  write packet sizes (65536,262144,1048576)\n"
+            "  --files N            small files for open and list (1000)\n"
+            "  --ops N              random reads per thread (2000)\n"
+            "  --iterations N       listings (20)\n"
+            "  --listers N          threads listing the small files during stat (2)\n"
+            "  --rpc-connections N  namenode connections of each client (1)\n"
+            "  --bulk-connections N namenode connections for listings (0)\n"
+            "  --fake-cluster N     start a fake cluster with N datanodes instead\n"
+            "                       of connecting to --namenode\n"
+            "  --fake-latency MS    latency of every fake datanode (0)\n"
+            "  --fake-bandwidth MB  bandwidth of every fake datanode in MB/s (0)\n");
+    exit(2);
+}
+
+}
+
+int main(int argc, char ** argv) {
+    static struct option longOptions[] = {
+        {"namenode", required_argument, NULL, 'n'},
+        {"port", required_argument, NULL, 'p'},
+        {"dir", required_argument, NULL, 'd'},
+        {"scenarios", required_argument, NULL, 's'},
+        {"file-size", required_argument, NULL, 'f'},
+        {"io-size", required_argument, NULL, 'b'},
+        {"threads", required_argument, NULL, 't'},
+        {"packet-sizes", required_argument, NULL, 'k'},
+        {"files", required_argument, NULL, 'm'},
+        {"ops", required_argument, NULL, 'o'},
+        {"iterations", required_argument, NULL, 'i'},
+        {"listers", required_argument, NULL, 'L'},
+        {"rpc-connections", required_argument, NULL, 'r'},
+        {"bulk-connections", required_argument, NULL, 'B'},
+        {"fake-cluster", required_argument, NULL, 'c'},
+        {"fake-latency", required_argument, NULL, 'l'},
+        {"fake-bandwidth", required_argument, NULL, 'w'},
+        {NULL, 0, NULL, 0}
+    };
+    Options opts;
+    int c;
+
+    while ((c = getopt_long(argc, argv, "", longOptions, NULL)) != -1) {
+        switch (c) {
+        case 'n':
+            opts.namenode = optarg;
+            break;
+
+        case 'p':
+            opts.port = atoi(optarg);
+            break;
+
+        case 'd':
+            opts.dir = optarg;
+            break;
+
+        case 's':
+            opts.scenarios = optarg;
+            break;
+
+        case 'f':
+            opts.fileSize = atoll(optarg) << 20;
+            break;
+
+        case 'b':
+            opts.ioSize = atoi(optarg);
+            break;
+
+        case 't':
+            opts.threads = ParseList(optarg);
+            break;
+
+        case 'k':
+            opts.packetSizes = ParseList(optarg);
+            break;
+
+        case 'm':
+            opts.files = atoi(optarg);
+            break;
+
+        case 'o':
+            opts.ops = atoi(optarg);
+            break;
+
+        case 'i':
+            opts.iterations = atoi(optarg);
+            break;
+
+        case 'L':
+            opts.listers = atoi(optarg);
+            break;
+
+        case 'r':
+            opts.rpcConnections = atoi(optarg);
+            break;
+
+        case 'B':
+            opts.bulkConnections = atoi(optarg);
+            break;
+
+        case 'c':
+            opts.fakeDatanodes = atoi(optarg);
+            break;
+
+        case 'l':
+            opts.fakeLatency = atoi(optarg);
+            break;
+
+        case 'w':
+            opts.fakeBandwidth = atoll(optarg) << 20;
+            break;
+
+        default:
+            Usage();
+        }
+    }
+
+    if (opts.ioSize <= 0 || opts.fileSize <= 0 || opts.threads.empty()) {
+        Usage();
+    }
+
+    Hdfs::Internal::shared_ptr<Hdfs::Internal::FakeCluster> cluster;
+
+    if (opts.fakeDatanodes > 0) {
+        cluster = StartFakeCluster(opts);
+    }
+
+    hdfsFS fs = Connect(opts, 0);
+    hdfsCreateDirectory(fs, opts.dir.c_str());
+
+    if (Enabled(opts, "write")) {
+        BenchWrite(opts);
+    } else if (Enabled(opts, "read") || Enabled(opts, "pread")) {
+        hdfsFileInfo * info = hdfsGetPathInfo(fs, DataFile(opts).c_str());
+
+        if (!info || info->mSize != opts.fileSize) {
+            WriteFile(fs, DataFile(opts), opts.fileSize, opts.ioSize, NULL);
+        }
+
+        if (info) {
+            hdfsFreeFileInfo(info, 1);
+        }
+    }
+
+    if (Enabled(opts, "read")) {
+        BenchRead(opts, fs);
+    }
+
+    if (Enabled(opts, "pread")) {
+        RunConcurrently(opts, fs, "pread", PreadWorker);
+    }
+
+    if (Enabled(opts, "open") || Enabled(opts, "list") || Enabled(opts, "stat")) {
+        SetupSmallFiles(opts, fs);
+    }
+
+    if (Enabled(opts, "open")) {
+        RunConcurrently(opts, fs, "open", OpenWorker);
+    }
+
+    if (Enabled(opts, "list")) {
+        BenchList(opts, fs);
+    }
+
+    if (Enabled(opts, "stat")) {
+        BenchStat(opts, fs);
+    }
+
+    hdfsDisconnect(fs);
+    return 0;
+}
@@ -0,0 +1,154 @@
+/********************************************************************
+ * 2014 -
+ * open source under Apache License Version 2.0
+ ********************************************************************/
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "Exception.h"
+#include "ExceptionInternal.h"
+#include "FakeCluster.h"
+#include "FakeDatanode.h"
+#include "FakeNamenode.h"
+#include "FakeNamespace.h"
+
+#include <sstream>
+#include <sys/stat.h>
+
+namespace Hdfs {
+namespace Internal {
+
+FakeCluster::FakeCluster(const FakeClusterConfig & conf) :
+    conf(conf) {
+    if (conf.namenodes <= 0 || conf.datanodes <= 0 || conf.bytesPerChecksum <= 0
+            || conf.packetSize <= 0) {
+        THROW(InvalidParameter, "FakeCluster: invalid configuration.");
+    }
+}
+
+FakeCluster::~FakeCluster() {
+    stop();
+}
+
+void FakeCluster::start() {
+    if (!namenodes.empty()) {
+        return;
+    }
+
+    fsns = shared_ptr<FakeNamespace>(new FakeNamespace);
+    fsns->setBlockRemovedCallback(bind(&FakeCluster::removeBlocks, this, _1));
+
+    try {
+        for (int i = 0; i < conf.datanodes; ++i) {
+            std::string dir;
+
+            if (!conf.storageDir.empty()) {
+                std::stringstream ss;
+                ss << conf.storageDir << "/dn" << i;
+                dir = ss.str();
+                ::mkdir(conf.storageDir.c_str(), 0755);
+
+                if (::mkdir(dir.c_str(), 0755) < 0 && errno != EEXIST) {
+                    THROW(HdfsIOException, "FakeCluster: cannot create %s: %s", dir.c_str(),
+                          GetSystemErrorInfo(errno));
+                }
+            }
+
+            datanodes.push_back(shared_ptr<FakeDatanode>(new FakeDatanode(*this, i, dir)));
+            datanodes.back()->start(0);
+            fsns->addDatanode(datanodes.back()->getDatanodeId());
+        }
+
+        for (int i = 0; i < conf.namenodes; ++i) {
+            namenodes.push_back(shared_ptr<FakeNamenode>(new FakeNamenode(*fsns)));
+            namenodes.back()->start(i == 0 ? conf.namenodePort : 0);
+        }
+    } catch (...) {
+        stop();
+        throw;
+    }
+}
+
+void FakeCluster::stop() {
+    for (size_t i = 0; i < namenodes.size(); ++i) {
+        namenodes[i]->stop();
+    }
+
+    for (size_t i = 0; i < datanodes.size(); ++i) {
+        datanodes[i]->stop();
+    }
+
+    namenodes.clear();
+    datanodes.clear();
+    fsns.reset();
+}
+
+int FakeCluster::getNamenodePort(int index) const {
+    return namenodes.at(index)->getPort();
+}
+
+int FakeCluster::getDatanodePort(int index) const {
+    return datanodes.at(index)->getPort();
+}
+
+FakeDatanode & FakeCluster::getDatanode(int index) {
+    return *datanodes.at(index);
+}
+
+FakeNamenode & FakeCluster::getNamenode(int index) {
+    return *namenodes.at(index);
+}
+
+FakeDatanode * FakeCluster::findDatanode(int port) {
+    for (size_t i = 0; i < datanodes.size(); ++i) {
+        if (datanodes[i]->getPort() == port) {
+            return datanodes[i].get();
+        }
+    }
+
+    return NULL;
+}
+
+void FakeCluster::setDatanodeFaults(int index, const DatanodeFaults & faults) {
+    datanodes.at(index)->setFaults(faults);
+}
+
+void FakeCluster::setNamenodeFaults(int index, const NamenodeFaults & faults) {
+    FakeNamenode & namenode = *namenodes.at(index);
+    bool down = namenode.getFaults().down;
+    namenode.setFaults(faults);
+
+    /*
+     * a restarted namenode listens on its old port again.
+     */
+    if (faults.down && !down) {
+        namenode.stop();
+    } else if (!faults.down && down) {
+        namenode.start(namenode.getPort());
+    }
+}
+
+void FakeCluster::removeBlocks(const std::vector<int64_t> & blocks) {
+    for (size_t i = 0; i < datanodes.size(); ++i) {
+        for (size_t j = 0; j < blocks.size(); ++j) {
+            datanodes[i]->removeReplica(blocks[j]);
+        }
+    }
+}
+
+}
+}
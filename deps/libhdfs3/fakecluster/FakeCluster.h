@@ -0,0 +1,162 @@
+/********************************************************************
+ * 2014 -
+ * open source under Apache License Version 2.0
+ ********************************************************************/
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _HDFS_LIBHDFS3_FAKECLUSTER_FAKECLUSTER_H_
+#define _HDFS_LIBHDFS3_FAKECLUSTER_FAKECLUSTER_H_
+
+#include "Memory.h"
+#include "Thread.h"
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace Hdfs {
+namespace Internal {
+
+class FakeDatanode;
+class FakeNamenode;
+class FakeNamespace;
+
+/**
+ * Faults injected into one datanode, they can be changed while it runs.
+ */
+struct DatanodeFaults {
+    DatanodeFaults() :
+        latency(0), bandwidth(0), refuseConnections(false), failReads(false),
+        failWrites(false), corruptReads(false), splitHeaders(false), rejectTokens(0) {
+    }
+
+    int latency; //milliseconds before answering an operation.
+    int64_t bandwidth; //bytes per second of block data, 0 for unlimited.
+    bool refuseConnections; //close connections as soon as they are accepted.
+    bool failReads; //answer read requests with an error.
+    bool failWrites; //fail pipeline setup, or the next ack while streaming.
+    bool corruptReads; //send wrong checksums.
+    bool splitHeaders; //send the start of every packet header right after the previous packet, the rest later.
+    int rejectTokens; //answer the next reads and block checksums with an invalid block token error.
+};
+
+/**
+ * Faults injected into one namenode.
+ */
+struct NamenodeFaults {
+    NamenodeFaults() :
+        latency(0), standby(false), observer(false), stale(false), dropCalls(false), down(false) {
+    }
+
+    int latency; //milliseconds before answering a call.
+    bool standby; //answer every call with a StandbyException.
+    bool observer; //serve reads only, answer writes with a StandbyException.
+    bool stale; //an observer stops applying edits when the fault is set.
+    bool dropCalls; //close the connection when a call arrives instead of answering.
+    bool down; //stop listening, connections are refused until the fault is cleared.
+};
+
+struct FakeClusterConfig {
+    FakeClusterConfig() :
+        namenodes(1), datanodes(3), namenodePort(0), bytesPerChecksum(512),
+        packetSize(64 * 1024) {
+    }
+
+    int namenodes; //namenodes sharing one namespace, for failover.
+    int datanodes;
+    int namenodePort; //port of the first namenode, 0 to pick free ports.
+    int bytesPerChecksum;
+    int packetSize; //block data per packet sent to readers.
+    std::string storageDir; //keep replicas in files here, empty for memory.
+};
+
+/**
+ * An in-process stand-in for a HDFS cluster.
+ *
+ * The namenodes speak the Hadoop RPC protocol and the datanodes the data
+ * transfer protocol, so an unmodified client can use it. Write pipelines are
+ * simulated by the first datanode, which stores the replicas of all nodes of
+ * the pipeline and applies their faults. Security is not supported and files
+ * under construction cannot be read.
+ */
+class FakeCluster {
+public:
+    explicit FakeCluster(const FakeClusterConfig & conf);
+
+    ~FakeCluster();
+
+    /**
+     * Bind all servers to 127.0.0.1 and start serving.
+     */
+    void start();
+
+    void stop();
+
+    int getNamenodePort(int index) const;
+
+    int getDatanodePort(int index) const;
+
+    int getNumNamenodes() const {
+        return static_cast<int>(namenodes.size());
+    }
+
+    int getNumDatanodes() const {
+        return static_cast<int>(datanodes.size());
+    }
+
+    FakeDatanode & getDatanode(int index);
+
+    FakeNamenode & getNamenode(int index);
+
+    /**
+     * Find a datanode by its data transfer port.
+     * @return NULL if no datanode listens on the port.
+     */
+    FakeDatanode * findDatanode(int port);
+
+    FakeNamespace & getNamespace() {
+        return *fsns;
+    }
+
+    const FakeClusterConfig & getConf() const {
+        return conf;
+    }
+
+    void setDatanodeFaults(int index, const DatanodeFaults & faults);
+
+    void setNamenodeFaults(int index, const NamenodeFaults & faults);
+
+    /**
+     * Drop the replicas of deleted blocks.
+     */
+    void removeBlocks(const std::vector<int64_t> & blocks);
+
+private:
+    FakeCluster(const FakeCluster & other);
+    FakeCluster & operator =(const FakeCluster & other);
+
+    FakeClusterConfig conf;
+    shared_ptr<FakeNamespace> fsns;
+    std::vector<shared_ptr<FakeNamenode> > namenodes;
+    std::vector<shared_ptr<FakeDatanode> > datanodes;
+};
+
+}
+}
+
+#endif /* _HDFS_LIBHDFS3_FAKECLUSTER_FAKECLUSTER_H_ */
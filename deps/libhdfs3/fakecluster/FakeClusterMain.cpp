@@ -0,0 +1,307 @@
+/********************************************************************
+ * 2014 -
+ * open source under Apache License Version 2.0
+ ********************************************************************/
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Run a fake cluster in its own process.
+ *
+ * The ports are printed as one JSON line on stdout once the cluster is up,
+ * e.g. {"namenodes":[40123],"datanodes":[40124,40125,40126]}. Faults are
+ * changed with commands on stdin, one per line:
+ *
+ *   dn <index> latency=<ms> bandwidth=<bytes/s> refuse=<0|1> failReads=<0|1>
+ *      failWrites=<0|1> corruptReads=<0|1> splitHeaders=<0|1> rejectTokens=<count>
+ *   nn <index> latency=<ms> standby=<0|1> observer=<0|1> stale=<0|1>
+ *      drop=<0|1> down=<0|1>
+ *   ez <dir> <keyName>
+ *   stats
+ *
+ * Omitted settings keep their value. The cluster stops on SIGINT or SIGTERM.
+ */
+#include "Exception.h"
+#include "FakeCluster.h"
+#include "FakeDatanode.h"
+#include "FakeNamenode.h"
+#include "FakeNamespace.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <getopt.h>
+#include <iostream>
+#include <pthread.h>
+#include <signal.h>
+#include <sstream>
+#include <string>
+
+using namespace Hdfs::Internal;
+
+namespace {
+
+FakeCluster * Cluster = NULL;
+
+bool ParseSetting(const std::string & word, std::string & key, int64_t & value) {
+    size_t pos = word.find('=');
+
+    if (pos == std::string::npos) {
+        return false;
+    }
+
+    key = word.substr(0, pos);
+    value = atoll(word.c_str() + pos + 1);
+    return true;
+}
+
+std::string Execute(const std::string & line) {
+    std::stringstream in(line);
+    std::stringstream out;
+    std::string command, word, key;
+    int index = 0;
+    int64_t value;
+    in >> command;
+
+    if (command == "stats") {
+        out << "{\"blocks\":" << Cluster->getNamespace().getBlockCount() << ",\"datanodes\":[";
+
+        for (int i = 0; i < Cluster->getNumDatanodes(); ++i) {
+            FakeDatanode & dn = Cluster->getDatanode(i);
+            out << (i ? "," : "") << "{\"bytesRead\":" << dn.getBytesRead()
+                << ",\"bytesWritten\":" << dn.getBytesWritten()
+                << ",\"dropBehindOps\":" << dn.getDropBehindOps()
+                << ",\"lastReadahead\":" << dn.getLastReadahead() << "}";
+        }
+
+        out << "],\"namenodes\":[";
+
+        for (int i = 0; i < Cluster->getNumNamenodes(); ++i) {
+            std::vector<NamenodeConnection> connections = Cluster->getNamenode(i).getConnections();
+            out << (i ? "," : "") << "{\"connections\":[";
+
+            for (size_t j = 0; j < connections.size(); ++j) {
+                out << (j ? "," : "") << "{\"id\":" << connections[j].id
+                    << ",\"open\":" << (connections[j].open ? "true" : "false") << ",\"methods\":[";
+
+                for (std::set<std::string>::const_iterator it = connections[j].methods.begin();
+                        it != connections[j].methods.end(); ++it) {
+                    out << (it != connections[j].methods.begin() ? "," : "") << "\"" << *it << "\"";
+                }
+
+                out << "]}";
+            }
+
+            out << "]}";
+        }
+
+        out << "]}";
+        return out.str();
+    }
+
+    if (command == "ez") {
+        std::string path, keyName;
+
+        if (!(in >> path >> keyName)) {
+            return "error: usage ez <dir> <keyName>";
+        }
+
+        try {
+            Cluster->getNamespace().createEncryptionZone(path, keyName);
+        } catch (const Hdfs::HdfsException & e) {
+            return std::string("error: ") + e.what();
+        }
+
+        return "ok";
+    }
+
+    if (!(in >> index)) {
+        return "error: missing node index";
+    }
+
+    if (command == "dn" && index >= 0 && index < Cluster->getNumDatanodes()) {
+        DatanodeFaults faults = Cluster->getDatanode(index).getFaults();
+
+        while (in >> word) {
+            if (!ParseSetting(word, key, value)) {
+                return "error: bad setting " + word;
+            } else if (key == "latency") {
+                faults.latency = value;
+            } else if (key == "bandwidth") {
+                faults.bandwidth = value;
+            } else if (key == "refuse") {
+                faults.refuseConnections = value != 0;
+            } else if (key == "failReads") {
+                faults.failReads = value != 0;
+            } else if (key == "failWrites") {
+                faults.failWrites = value != 0;
+            } else if (key == "splitHeaders") {
+                faults.splitHeaders = value != 0;
+            } else if (key == "corruptReads") {
+                faults.corruptReads = value != 0;
+            } else if (key == "rejectTokens") {
+                faults.rejectTokens = value;
+            } else {
+                return "error: unknown setting " + key;
+            }
+        }
+
+        Cluster->setDatanodeFaults(index, faults);
+        return "ok";
+    }
+
+    if (command == "nn" && index >= 0 && index < Cluster->getNumNamenodes()) {
+        NamenodeFaults faults = Cluster->getNamenode(index).getFaults();
+
+        while (in >> word) {
+            if (!ParseSetting(word, key, value)) {
+                return "error: bad setting " + word;
+            } else if (key == "latency") {
+                faults.latency = value;
+            } else if (key == "standby") {
+                faults.standby = value != 0;
+            } else if (key == "observer") {
+                faults.observer = value != 0;
+            } else if (key == "stale") {
+                faults.stale = value != 0;
+            } else if (key == "drop") {
+                faults.dropCalls = value != 0;
+            } else if (key == "down") {
+                faults.down = value != 0;
+            } else {
+                return "error: unknown setting " + key;
+            }
+        }
+
+        Cluster->setNamenodeFaults(index, faults);
+        return "ok";
+    }
+
+    return "error: unknown command " + line;
+}
+
+void * CommandLoop(void *) {
+    std::string line;
+
+    while (std::getline(std::cin, line)) {
+        if (line.empty()) {
+            continue;
+        }
+
+        std::string result = Execute(line);
+        fprintf(stdout, "%s\n", result.c_str());
+        fflush(stdout);
+    }
+
+    return NULL;
+}
+
+void Usage() {
+    fprintf(stderr,
+            "usage: hdfs-fake-cluster [options]\n"
+            "  --namenodes N        namenodes sharing the namespace (1)\n"
+            "  --datanodes N        datanodes (3)\n"
+            "  --port PORT          port of the first namenode, 0 for any (0)\n"
+            "  --storage-dir PATH   keep replicas in files instead of memory\n"
+            "  --bytes-per-checksum N  (512)\n");
+    exit(2);
+}
+
+}
+
+int main(int argc, char ** argv) {
+    static struct option longOptions[] = {
+        {"namenodes", required_argument, NULL, 'n'},
+        {"datanodes", required_argument, NULL, 'd'},
+        {"port", required_argument, NULL, 'p'},
+        {"storage-dir", required_argument, NULL, 's'},
+        {"bytes-per-checksum", required_argument, NULL, 'c'},
+        {NULL, 0, NULL, 0}
+    };
+    FakeClusterConfig conf;
+    int c;
+
+    while ((c = getopt_long(argc, argv, "", longOptions, NULL)) != -1) {
+        switch (c) {
+        case 'n':
+            conf.namenodes = atoi(optarg);
+            break;
+
+        case 'd':
+            conf.datanodes = atoi(optarg);
+            break;
+
+        case 'p':
+            conf.namenodePort = atoi(optarg);
+            break;
+
+        case 's':
+            conf.storageDir = optarg;
+            break;
+
+        case 'c':
+            conf.bytesPerChecksum = atoi(optarg);
+            break;
+
+        default:
+            Usage();
+        }
+    }
+
+    sigset_t sigs;
+    sigemptyset(&sigs);
+    sigaddset(&sigs, SIGINT);
+    sigaddset(&sigs, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &sigs, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    try {
+        FakeCluster cluster(conf);
+        cluster.start();
+        Cluster = &cluster;
+        std::stringstream ports;
+        ports << "{\"namenodes\":[";
+
+        for (int i = 0; i < cluster.getNumNamenodes(); ++i) {
+            ports << (i ? "," : "") << cluster.getNamenodePort(i);
+        }
+
+        ports << "],\"datanodes\":[";
+
+        for (int i = 0; i < cluster.getNumDatanodes(); ++i) {
+            ports << (i ? "," : "") << cluster.getDatanodePort(i);
+        }
+
+        ports << "]}";
+        fprintf(stdout, "%s\n", ports.str().c_str());
+        fflush(stdout);
+        pthread_t commands;
+
+        if (pthread_create(&commands, NULL, CommandLoop, NULL) == 0) {
+            pthread_detach(commands);
+        }
+
+        int sig = 0;
+        sigwait(&sigs, &sig);
+        cluster.stop();
+    } catch (const Hdfs::HdfsException & e) {
+        fprintf(stderr, "hdfs-fake-cluster: %s\n", e.what());
+        return 1;
+    }
+
+    return 0;
+}
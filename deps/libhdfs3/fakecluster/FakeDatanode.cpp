@@ -0,0 +1,662 @@
+/********************************************************************
+ * 2014 -
+ * open source under Apache License Version 2.0
+ ********************************************************************/
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "BigEndian.h"
+#include "Exception.h"
+#include "ExceptionInternal.h"
+#include "FakeDatanode.h"
+#include "HWCrc32c.h"
+#include "SWCrc32c.h"
+#include "WriteBuffer.h"
+#include "client/DataTransferProtocolSender.h"
+#include "client/PacketHeader.h"
+#include "network/BufferedSocketReader.h"
+
+#include <algorithm>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <openssl/evp.h>
+#include <sstream>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace Hdfs {
+namespace Internal {
+
+static const int64_t HEART_BEAT_SEQNO = -1;
+
+template<typename T>
+static void ReadDelimited(BufferedSocketReader & in, T & proto) {
+    int size = in.readVarint32(-1);
+    std::vector<char> buffer(size > 0 ? size : 1);
+
+    if (size > 0) {
+        in.readFully(&buffer[0], size, -1);
+    }
+
+    if (!proto.ParseFromArray(&buffer[0], size)) {
+        THROW(HdfsIOException, "FakeDatanode: cannot parse %s.", proto.GetTypeName().c_str());
+    }
+}
+
+template<typename T>
+static void WriteDelimited(Socket & sock, const T & proto) {
+    WriteBuffer buffer;
+    int size = proto.ByteSize();
+    buffer.writeVarint32(size);
+    proto.SerializeToArray(buffer.alloc(size), size);
+    sock.writeFully(buffer.getBuffer(0), buffer.getDataSize(0), -1);
+}
+
+/*
+ * The header of the packet sent at pos, the trailing empty packet at the end.
+ */
+static PacketHeader NextPacketHeader(int64_t pos, int64_t end, int64_t seqno, int packetData,
+                                     int bytesPerChecksum, int checksumSize) {
+    if (pos >= end) {
+        return PacketHeader(sizeof(int32_t), end, seqno, true, 0);
+    }
+
+    int dataLen = static_cast<int>(std::min<int64_t>(packetData, end - pos));
+    int chunks = (dataLen + bytesPerChecksum - 1) / bytesPerChecksum;
+    return PacketHeader(sizeof(int32_t) + chunks * checksumSize + dataLen, pos, seqno, false, dataLen);
+}
+
+static std::string XferAddr(const DatanodeIDProto & id) {
+    std::stringstream ss;
+    ss << id.ipaddr() << ":" << id.xferport();
+    return ss.str();
+}
+
+FakeDatanode::FakeDatanode(FakeCluster & cluster, int index, const std::string & storageDir) :
+    cluster(cluster), index(index), storageDir(storageDir), bytesRead(0), bytesWritten(0),
+    dropBehindOps(0), lastReadahead(-1), checksumOps(0) {
+}
+
+FakeDatanode::~FakeDatanode() {
+    stop();
+}
+
+void FakeDatanode::setFaults(const DatanodeFaults & faults) {
+    lock_guard<mutex> lock(mut);
+    this->faults = faults;
+}
+
+DatanodeFaults FakeDatanode::getFaults() {
+    lock_guard<mutex> lock(mut);
+    return faults;
+}
+
+/*
+ * use up one of the block tokens to reject.
+ */
+bool FakeDatanode::rejectToken() {
+    lock_guard<mutex> lock(mut);
+
+    if (faults.rejectTokens <= 0) {
+        return false;
+    }
+
+    --faults.rejectTokens;
+    return true;
+}
+
+DatanodeIDProto FakeDatanode::getDatanodeId() {
+    std::stringstream uuid;
+    uuid << "fake-dn-" << index;
+    DatanodeIDProto id;
+    id.set_ipaddr("127.0.0.1");
+    id.set_hostname("localhost");
+    id.set_datanodeuuid(uuid.str());
+    id.set_xferport(getPort());
+    id.set_infoport(0);
+    id.set_ipcport(0);
+    return id;
+}
+
+int64_t FakeDatanode::getDropBehindOps() {
+    lock_guard<mutex> lock(mut);
+    return dropBehindOps;
+}
+
+int64_t FakeDatanode::getLastReadahead() {
+    lock_guard<mutex> lock(mut);
+    return lastReadahead;
+}
+
+int64_t FakeDatanode::getChecksumOps() {
+    lock_guard<mutex> lock(mut);
+    return checksumOps;
+}
+
+void FakeDatanode::recordCachingStrategy(const CachingStrategyProto & strategy) {
+    lock_guard<mutex> lock(mut);
+
+    if (strategy.dropbehind()) {
+        ++dropBehindOps;
+    }
+
+    if (strategy.has_readahead()) {
+        lastReadahead = strategy.readahead();
+    }
+}
+
+int64_t FakeDatanode::getBytesRead() {
+    lock_guard<mutex> lock(mut);
+    return bytesRead;
+}
+
+int64_t FakeDatanode::getBytesWritten() {
+    lock_guard<mutex> lock(mut);
+    return bytesWritten;
+}
+
+std::string FakeDatanode::replicaPath(int64_t blockId) {
+    std::stringstream ss;
+    ss << storageDir << "/blk_" << blockId;
+    return ss.str();
+}
+
+int64_t FakeDatanode::getReplicaLength(int64_t blockId) {
+    lock_guard<mutex> lock(mut);
+
+    if (storageDir.empty()) {
+        std::map<int64_t, std::vector<char> >::iterator it = replicas.find(blockId);
+        return it == replicas.end() ? -1 : static_cast<int64_t>(it->second.size());
+    }
+
+    struct stat st;
+    return ::stat(replicaPath(blockId).c_str(), &st) < 0 ? -1 : st.st_size;
+}
+
+int64_t FakeDatanode::readReplica(int64_t blockId, int64_t offset, char * buffer, int64_t length) {
+    lock_guard<mutex> lock(mut);
+
+    if (storageDir.empty()) {
+        std::map<int64_t, std::vector<char> >::iterator it = replicas.find(blockId);
+
+        if (it == replicas.end() || offset >= static_cast<int64_t>(it->second.size())) {
+            return 0;
+        }
+
+        length = std::min<int64_t>(length, it->second.size() - offset);
+        memcpy(buffer, &it->second[offset], length);
+        return length;
+    }
+
+    int fd = ::open(replicaPath(blockId).c_str(), O_RDONLY);
+
+    if (fd < 0) {
+        return 0;
+    }
+
+    ssize_t rc = ::pread(fd, buffer, length, offset);
+    ::close(fd);
+    return rc < 0 ? 0 : rc;
+}
+
+void FakeDatanode::writeReplica(int64_t blockId, int64_t offset, const char * data, int64_t length) {
+    lock_guard<mutex> lock(mut);
+    bytesWritten += length;
+
+    if (storageDir.empty()) {
+        std::vector<char> & replica = replicas[blockId];
+
+        if (static_cast<int64_t>(replica.size()) < offset + length) {
+            replica.resize(offset + length);
+        }
+
+        memcpy(&replica[offset], data, length);
+        return;
+    }
+
+    int fd = ::open(replicaPath(blockId).c_str(), O_WRONLY | O_CREAT, 0644);
+
+    if (fd < 0 || ::pwrite(fd, data, length, offset) != length) {
+        int err = errno;
+
+        if (fd >= 0) {
+            ::close(fd);
+        }
+
+        THROW(HdfsIOException, "FakeDatanode: cannot write replica blk_%" PRId64 ": %s", blockId,
+              GetSystemErrorInfo(err));
+    }
+
+    ::close(fd);
+}
+
+void FakeDatanode::truncateReplica(int64_t blockId, int64_t length) {
+    lock_guard<mutex> lock(mut);
+
+    if (storageDir.empty()) {
+        replicas[blockId].resize(length);
+        return;
+    }
+
+    int fd = ::open(replicaPath(blockId).c_str(), O_WRONLY | O_CREAT, 0644);
+
+    if (fd < 0 || ::ftruncate(fd, length) < 0) {
+        int err = errno;
+
+        if (fd >= 0) {
+            ::close(fd);
+        }
+
+        THROW(HdfsIOException, "FakeDatanode: cannot truncate replica blk_%" PRId64 ": %s", blockId,
+              GetSystemErrorInfo(err));
+    }
+
+    ::close(fd);
+}
+
+void FakeDatanode::removeReplica(int64_t blockId) {
+    lock_guard<mutex> lock(mut);
+
+    if (storageDir.empty()) {
+        replicas.erase(blockId);
+    } else {
+        ::unlink(replicaPath(blockId).c_str());
+    }
+}
+
+void FakeDatanode::sendResponse(Socket & sock, const BlockOpResponseProto & resp) {
+    WriteDelimited(sock, resp);
+}
+
+void FakeDatanode::sendError(Socket & sock, Status status, const std::string & message) {
+    BlockOpResponseProto resp;
+    resp.set_status(status);
+    resp.set_message(message);
+    sendResponse(sock, resp);
+}
+
+void FakeDatanode::serve(Socket & sock) {
+    BufferedSocketReaderImpl in(sock);
+
+    if (getFaults().refuseConnections) {
+        return;
+    }
+
+    while (!isStopped()) {
+        char header[3];
+        in.readFully(header, sizeof(header), -1);
+        int16_t version = ReadBigEndian16FromArray(header);
+
+        if (version != DATA_TRANSFER_VERSION) {
+            THROW(HdfsIOException, "FakeDatanode: unsupported data transfer version %d.",
+                  static_cast<int>(version));
+        }
+
+        delay(getFaults().latency);
+        bool keepAlive = false;
+
+        switch (static_cast<unsigned char>(header[2])) {
+        case READ_BLOCK:
+            keepAlive = readBlock(sock, in);
+            break;
+
+        case WRITE_BLOCK:
+            keepAlive = writeBlock(sock, in);
+            break;
+
+        case TRANSFER_BLOCK:
+            keepAlive = transferBlock(sock, in);
+            break;
+
+        case BLOCK_CHECKSUM:
+            keepAlive = blockChecksum(sock, in);
+            break;
+
+        default:
+            sendError(sock, DT_PROTO_ERROR_UNSUPPORTED, "operation is not supported by the fake datanode");
+            break;
+        }
+
+        if (!keepAlive) {
+            return;
+        }
+    }
+}
+
+bool FakeDatanode::readBlock(Socket & sock, BufferedSocketReader & in) {
+    OpReadBlockProto op;
+    ReadDelimited(in, op);
+    recordCachingStrategy(op.cachingstrategy());
+    const ExtendedBlockProto & block = op.header().baseheader().block();
+    DatanodeFaults current = getFaults();
+    int64_t length = getReplicaLength(block.blockid());
+    int64_t offset = op.offset(), end = op.offset() + op.len();
+
+    if (current.failReads) {
+        sendError(sock, DT_PROTO_ERROR, "injected read failure");
+        return false;
+    }
+
+    if (rejectToken()) {
+        sendError(sock, DT_PROTO_ERROR_ACCESS_TOKEN, "injected invalid block token");
+        return false;
+    }
+
+    if (length < 0) {
+        sendError(sock, DT_PROTO_ERROR, "replica not found");
+        return false;
+    }
+
+    if (end > length || end > static_cast<int64_t>(block.numbytes())) {
+        sendError(sock, DT_PROTO_ERROR_INVALID, "read range is beyond the replica");
+        return false;
+    }
+
+    int bytesPerChecksum = cluster.getConf().bytesPerChecksum;
+    int checksumSize = op.sendchecksums() ? sizeof(int32_t) : 0;
+    int64_t chunkOffset = offset - offset % bytesPerChecksum;
+    end = std::min(length, (end + bytesPerChecksum - 1) / bytesPerChecksum * bytesPerChecksum);
+    BlockOpResponseProto resp;
+    resp.set_status(DT_PROTO_SUCCESS);
+    ReadOpChecksumInfoProto * info = resp.mutable_readopchecksuminfo();
+    info->mutable_checksum()->set_type(op.sendchecksums() ? CHECKSUM_CRC32C : CHECKSUM_NULL);
+    info->mutable_checksum()->set_bytesperchecksum(bytesPerChecksum);
+    info->set_chunkoffset(chunkOffset);
+    sendResponse(sock, resp);
+    shared_ptr<Checksum> checksum;
+
+    if (HWCrc32c::available()) {
+        checksum = shared_ptr<Checksum>(new HWCrc32c());
+    } else {
+        checksum = shared_ptr<Checksum>(new SWCrc32c());
+    }
+
+    int headerSize = PacketHeader::GetPkgHeaderSize();
+    int packetData = std::max(bytesPerChecksum,
+                              cluster.getConf().packetSize / bytesPerChecksum * bytesPerChecksum);
+    int maxChunks = packetData / bytesPerChecksum;
+    /*
+     * room for the start of the next header sent along with a packet.
+     */
+    std::vector<char> packet(headerSize + maxChunks * checksumSize + packetData + headerSize);
+    int split = current.splitHeaders ? headerSize / 2 : 0;
+    int ahead = 0; //bytes of the header in packet already sent.
+    int64_t seqno = 0;
+
+    for (int64_t pos = chunkOffset; pos < end; ++seqno) {
+        int dataLen = static_cast<int>(std::min<int64_t>(packetData, end - pos));
+        int chunks = (dataLen + bytesPerChecksum - 1) / bytesPerChecksum;
+        char * sums = &packet[headerSize];
+        char * data = sums + chunks * checksumSize;
+
+        if (readReplica(block.blockid(), pos, data, dataLen) != dataLen) {
+            THROW(HdfsIOException, "FakeDatanode: replica blk_%" PRId64 " is shorter than expected.",
+                  static_cast<int64_t>(block.blockid()));
+        }
+
+        for (int i = 0; i < chunks && checksumSize > 0; ++i) {
+            int chunkLen = std::min(bytesPerChecksum, dataLen - i * bytesPerChecksum);
+            checksum->reset();
+            checksum->update(data + i * bytesPerChecksum, chunkLen);
+            uint32_t value = checksum->getValue();
+            WriteBigEndian32ToArray(current.corruptReads ? ~value : value, sums + i * checksumSize);
+        }
+
+        int packetLen = sizeof(int32_t) + chunks * checksumSize + dataLen;
+        int size = headerSize + packetLen - sizeof(int32_t);
+        PacketHeader(packetLen, pos, seqno, false, dataLen).writeInBuffer(&packet[0], headerSize);
+        throttle.consume(dataLen, current.bandwidth);
+        pos += dataLen;
+
+        if (split > 0) {
+            /*
+             * the reader finds only a part of the next header
+             * behind the packet, the rest arrives after a pause.
+             */
+            NextPacketHeader(pos, end, seqno + 1, packetData, bytesPerChecksum, checksumSize)
+                .writeInBuffer(&packet[size], headerSize);
+            sock.writeFully(&packet[ahead], size + split - ahead, -1);
+            ahead = split;
+            delay(1);
+        } else {
+            sock.writeFully(&packet[0], size, -1);
+        }
+
+        lock_guard<mutex> lock(mut);
+        bytesRead += dataLen;
+    }
+
+    PacketHeader(sizeof(int32_t), end, seqno, true, 0).writeInBuffer(&packet[0], headerSize);
+    sock.writeFully(&packet[ahead], headerSize - ahead, -1);
+    /*
+     * the client reports the status after reading the whole range,
+     * and then may send another operation on this connection.
+     */
+    ClientReadStatusProto status;
+    ReadDelimited(in, status);
+    return true;
+}
+
+bool FakeDatanode::writeBlock(Socket & sock, BufferedSocketReader & in) {
+    OpWriteBlockProto op;
+    ReadDelimited(in, op);
+    recordCachingStrategy(op.cachingstrategy());
+    int64_t blockId = op.header().baseheader().block().blockid();
+    std::vector<FakeDatanode *> pipeline;
+    BlockOpResponseProto resp;
+    pipeline.push_back(this);
+
+    if (getFaults().failWrites) {
+        sendError(sock, DT_PROTO_ERROR, "injected write failure");
+        return false;
+    }
+
+    /*
+     * the replicas of the downstream nodes are written by this node,
+     * they fail the setup with their address like a real pipeline does.
+     */
+    for (int i = 0; i < op.targets_size(); ++i) {
+        const DatanodeIDProto & id = op.targets(i).id();
+        FakeDatanode * target = cluster.findDatanode(id.xferport());
+
+        if (target == NULL || target->getFaults().refuseConnections || target->getFaults().failWrites) {
+            resp.set_status(DT_PROTO_ERROR);
+            resp.set_firstbadlink(XferAddr(id));
+            sendResponse(sock, resp);
+            return false;
+        }
+
+        target->delay(target->getFaults().latency);
+        pipeline.push_back(target);
+    }
+
+    if (op.stage() == OpWriteBlockProto::PIPELINE_SETUP_CREATE) {
+        for (size_t i = 0; i < pipeline.size(); ++i) {
+            pipeline[i]->truncateReplica(blockId, 0);
+        }
+    } else if (op.stage() != OpWriteBlockProto::PIPELINE_SETUP_APPEND) {
+        /*
+         * recovery, the client resends everything that was not acknowledged.
+         */
+        for (size_t i = 0; i < pipeline.size(); ++i) {
+            pipeline[i]->truncateReplica(blockId, op.minbytesrcvd());
+        }
+    }
+
+    resp.set_status(DT_PROTO_SUCCESS);
+    sendResponse(sock, resp);
+    std::vector<char> buffer;
+    bool broken = false;
+
+    while (true) {
+        char prefix[sizeof(int32_t) + sizeof(int16_t)];
+        in.readFully(prefix, sizeof(prefix), -1);
+        int32_t packetLen = ReadBigEndian32FromArray(prefix);
+        int16_t headerLen = ReadBigEndian16FromArray(prefix + sizeof(int32_t));
+
+        if (packetLen < static_cast<int32_t>(sizeof(int32_t)) || headerLen <= 0) {
+            THROW(HdfsIOException, "FakeDatanode: invalid packet, packetLen is %d, headerLen is %d.",
+                  packetLen, static_cast<int>(headerLen));
+        }
+
+        buffer.resize(headerLen + packetLen - sizeof(int32_t));
+        in.readFully(&buffer[0], buffer.size(), -1);
+        PacketHeaderProto header;
+
+        if (!header.ParseFromArray(&buffer[0], headerLen)) {
+            THROW(HdfsIOException, "FakeDatanode: cannot parse packet header.");
+        }
+
+        if (broken) {
+            /*
+             * keep draining until the client resets the connection, so that
+             * it reads the error ack instead of failing on its next write.
+             */
+            continue;
+        }
+
+        PipelineAckProto ack;
+        ack.set_seqno(header.seqno());
+        const char * data = &buffer[buffer.size() - header.datalen()];
+        int64_t done = Throttle::Now();
+        int failed = -1;
+
+        for (size_t i = 0; i < pipeline.size(); ++i) {
+            DatanodeFaults current = pipeline[i]->getFaults();
+
+            if (header.seqno() != HEART_BEAT_SEQNO && failed < 0) {
+                if (current.failWrites) {
+                    failed = i;
+                } else if (header.datalen() > 0) {
+                    pipeline[i]->writeReplica(blockId, header.offsetinblock(), data, header.datalen());
+                    done = std::max(done, pipeline[i]->throttle.reserve(header.datalen(), current.bandwidth));
+                }
+            }
+
+            /*
+             * only the failed node is reported, the client removes the
+             * last node with an error status from the pipeline.
+             */
+            ack.add_status(failed == static_cast<int>(i) ? DT_PROTO_ERROR : DT_PROTO_SUCCESS);
+        }
+
+        Throttle::WaitUntil(done);
+        WriteDelimited(sock, ack);
+
+        if (header.lastpacketinblock()) {
+            return false;
+        }
+
+        broken = failed >= 0;
+    }
+}
+
+bool FakeDatanode::transferBlock(Socket & sock, BufferedSocketReader & in) {
+    OpTransferBlockProto op;
+    ReadDelimited(in, op);
+    const ExtendedBlockProto & block = op.header().baseheader().block();
+    int64_t length = std::min<int64_t>(block.numbytes(), getReplicaLength(block.blockid()));
+    std::vector<char> data(std::max<int64_t>(length, 1));
+
+    if (length < 0 || readReplica(block.blockid(), 0, &data[0], length) != length) {
+        sendError(sock, DT_PROTO_ERROR, "replica not found");
+        return false;
+    }
+
+    for (int i = 0; i < op.targets_size(); ++i) {
+        FakeDatanode * target = cluster.findDatanode(op.targets(i).id().xferport());
+
+        if (target == NULL || target->getFaults().failWrites || target->getFaults().refuseConnections) {
+            sendError(sock, DT_PROTO_ERROR, "failed to transfer to " + XferAddr(op.targets(i).id()));
+            return false;
+        }
+
+        target->truncateReplica(block.blockid(), 0);
+        target->writeReplica(block.blockid(), 0, &data[0], length);
+        target->throttle.consume(length, target->getFaults().bandwidth);
+    }
+
+    BlockOpResponseProto resp;
+    resp.set_status(DT_PROTO_SUCCESS);
+    sendResponse(sock, resp);
+    return true;
+}
+
+/*
+ * the MD5 of the CRCs of the chunks of the replica, which a real
+ * datanode reads from the meta file of the block.
+ */
+bool FakeDatanode::blockChecksum(Socket & sock, BufferedSocketReader & in) {
+    OpBlockChecksumProto op;
+    ReadDelimited(in, op);
+    const ExtendedBlockProto & block = op.header().block();
+    int64_t length = std::min<int64_t>(block.numbytes(), getReplicaLength(block.blockid()));
+    std::vector<char> data(std::max<int64_t>(length, 1));
+
+    if (getFaults().failReads) {
+        sendError(sock, DT_PROTO_ERROR, "injected checksum failure");
+        return false;
+    }
+
+    if (rejectToken()) {
+        sendError(sock, DT_PROTO_ERROR_ACCESS_TOKEN, "injected invalid block token");
+        return false;
+    }
+
+    if (length < 0 || readReplica(block.blockid(), 0, &data[0], length) != length) {
+        sendError(sock, DT_PROTO_ERROR, "replica not found");
+        return false;
+    }
+
+    int bytesPerChecksum = cluster.getConf().bytesPerChecksum;
+    int64_t chunks = (length + bytesPerChecksum - 1) / bytesPerChecksum;
+    std::vector<char> sums(std::max<int64_t>(chunks, 1) * sizeof(int32_t));
+    shared_ptr<Checksum> checksum;
+
+    if (HWCrc32c::available()) {
+        checksum = shared_ptr<Checksum>(new HWCrc32c());
+    } else {
+        checksum = shared_ptr<Checksum>(new SWCrc32c());
+    }
+
+    for (int64_t i = 0; i < chunks; ++i) {
+        checksum->reset();
+        checksum->update(&data[i * bytesPerChecksum],
+                         std::min<int64_t>(bytesPerChecksum, length - i * bytesPerChecksum));
+        WriteBigEndian32ToArray(checksum->getValue(), &sums[i * sizeof(int32_t)]);
+    }
+
+    unsigned char md5[EVP_MAX_MD_SIZE];
+    unsigned int md5Length = 0;
+    EVP_Digest(&sums[0], chunks * sizeof(int32_t), md5, &md5Length, EVP_md5(), NULL);
+    BlockOpResponseProto resp;
+    resp.set_status(DT_PROTO_SUCCESS);
+    OpBlockChecksumResponseProto * info = resp.mutable_checksumresponse();
+    info->set_bytespercrc(bytesPerChecksum);
+    info->set_crcperblock(chunks);
+    info->set_md5(reinterpret_cast<char *>(md5), md5Length);
+    info->set_crctype(CHECKSUM_CRC32C);
+    sendResponse(sock, resp);
+    {
+        lock_guard<mutex> lock(mut);
+        ++checksumOps;
+    }
+    return true;
+}
+
+}
+}
@@ -0,0 +1,132 @@
+/********************************************************************
+ * 2014 -
+ * open source under Apache License Version 2.0
+ ********************************************************************/
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _HDFS_LIBHDFS3_FAKECLUSTER_FAKEDATANODE_H_
+#define _HDFS_LIBHDFS3_FAKECLUSTER_FAKEDATANODE_H_
+
+#include "FakeCluster.h"
+#include "FakeServer.h"
+#include "datatransfer.pb.h"
+#include "hdfs.pb.h"
+
+#include <map>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace Hdfs {
+namespace Internal {
+
+class BufferedSocketReader;
+
+/**
+ * A datanode speaking the data transfer protocol.
+ *
+ * Replicas are kept in memory, or in files named blk_<id> when a storage
+ * directory is given. Connections are reused for several operations like
+ * the client peer cache expects.
+ */
+class FakeDatanode: public FakeServer {
+public:
+    FakeDatanode(FakeCluster & cluster, int index, const std::string & storageDir);
+
+    ~FakeDatanode();
+
+    void setFaults(const DatanodeFaults & faults);
+
+    DatanodeFaults getFaults();
+
+    DatanodeIDProto getDatanodeId();
+
+    /**
+     * @return the length of the replica, -1 if it does not exist.
+     */
+    int64_t getReplicaLength(int64_t blockId);
+
+    /**
+     * Read the replica into buffer.
+     * @return the number of bytes read.
+     */
+    int64_t readReplica(int64_t blockId, int64_t offset, char * buffer, int64_t length);
+
+    /**
+     * Write data at offset, growing the replica as needed.
+     */
+    void writeReplica(int64_t blockId, int64_t offset, const char * data, int64_t length);
+
+    /**
+     * Create an empty replica or cut an existing one to length.
+     */
+    void truncateReplica(int64_t blockId, int64_t length);
+
+    void removeReplica(int64_t blockId);
+
+    /**
+     * Bytes of block data sent and received so far.
+     */
+    int64_t getBytesRead();
+    int64_t getBytesWritten();
+
+    /**
+     * Read and write operations asking to drop the block data from the
+     * page cache, and the last readahead asked for, -1 if none.
+     */
+    int64_t getDropBehindOps();
+    int64_t getLastReadahead();
+
+    /**
+     * Block checksum operations served so far.
+     */
+    int64_t getChecksumOps();
+
+protected:
+    void serve(Socket & sock);
+
+private:
+    bool readBlock(Socket & sock, BufferedSocketReader & in);
+    bool writeBlock(Socket & sock, BufferedSocketReader & in);
+    bool transferBlock(Socket & sock, BufferedSocketReader & in);
+    bool blockChecksum(Socket & sock, BufferedSocketReader & in);
+    void sendResponse(Socket & sock, const BlockOpResponseProto & resp);
+    void sendError(Socket & sock, Status status, const std::string & message);
+    void recordCachingStrategy(const CachingStrategyProto & strategy);
+    bool rejectToken();
+    std::string replicaPath(int64_t blockId);
+
+private:
+    FakeCluster & cluster;
+    int index;
+    std::string storageDir;
+    mutex mut;
+    DatanodeFaults faults;
+    int64_t bytesRead;
+    int64_t bytesWritten;
+    int64_t dropBehindOps;
+    int64_t lastReadahead;
+    int64_t checksumOps;
+    std::map<int64_t, std::vector<char> > replicas;
+    Throttle throttle;
+};
+
+}
+}
+
+#endif /* _HDFS_LIBHDFS3_FAKECLUSTER_FAKEDATANODE_H_ */
@@ -0,0 +1,270 @@
+/********************************************************************
+ * 2014 -
+ * open source under Apache License Version 2.0
+ ********************************************************************/
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "BigEndian.h"
+#include "Exception.h"
+#include "ExceptionInternal.h"
+#include "FakeNamenode.h"
+#include "FakeNamespace.h"
+#include "IpcConnectionContext.pb.h"
+#include "ProtobufRpcEngine.pb.h"
+#include "RpcHeader.pb.h"
+#include "WriteBuffer.h"
+#include "network/BufferedSocketReader.h"
+
+#include <google/protobuf/io/coded_stream.h>
+
+using google::protobuf::io::CodedInputStream;
+using google::protobuf::io::CodedOutputStream;
+
+namespace Hdfs {
+namespace Internal {
+
+static const char RPC_MAGIC[] = "hrpc";
+static const int RPC_VERSION = 9;
+static const int CONNECTION_CONTEXT_CALL_ID = -3;
+static const int PING_CALL_ID = -4;
+
+template<typename T>
+static void ReadDelimited(CodedInputStream & in, T & proto) {
+    uint32_t size;
+
+    if (!in.ReadVarint32(&size)) {
+        THROW(HdfsIOException, "FakeNamenode: truncated %s.", proto.GetTypeName().c_str());
+    }
+
+    CodedInputStream::Limit limit = in.PushLimit(size);
+
+    if (!proto.ParseFromCodedStream(&in) || !in.ConsumedEntireMessage()) {
+        THROW(HdfsIOException, "FakeNamenode: cannot parse %s.", proto.GetTypeName().c_str());
+    }
+
+    in.PopLimit(limit);
+}
+
+static void ReadDelimited(CodedInputStream & in, std::string & bytes) {
+    uint32_t size;
+
+    if (!in.ReadVarint32(&size) || !in.ReadString(&bytes, size)) {
+        THROW(HdfsIOException, "FakeNamenode: truncated request.");
+    }
+}
+
+/*
+ * map the exceptions of the namespace to the Java class names
+ * the client unwraps.
+ */
+static const char * ExceptionClassName(const HdfsException & e) {
+    if (dynamic_cast<const FileNotFoundException *>(&e)) {
+        return FileNotFoundException::ReflexName;
+    } else if (dynamic_cast<const FileAlreadyExistsException *>(&e)) {
+        return FileAlreadyExistsException::ReflexName;
+    } else if (dynamic_cast<const ParentNotDirectoryException *>(&e)) {
+        return ParentNotDirectoryException::ReflexName;
+    } else if (dynamic_cast<const RpcNoSuchMethodException *>(&e)) {
+        return RpcNoSuchMethodException::ReflexName;
+    } else if (dynamic_cast<const NameNodeRetriableException *>(&e)) {
+        return NameNodeRetriableException::ReflexName;
+    } else if (dynamic_cast<const ObserverRetryOnActiveException *>(&e)) {
+        return ObserverRetryOnActiveException::ReflexName;
+    } else if (dynamic_cast<const NameNodeStandbyException *>(&e)) {
+        return NameNodeStandbyException::ReflexName;
+    }
+
+    return HdfsIOException::ReflexName;
+}
+
+FakeNamenode::FakeNamenode(FakeNamespace & fsns) :
+    fsns(fsns), staleStateId(0) {
+}
+
+FakeNamenode::~FakeNamenode() {
+    stop();
+}
+
+void FakeNamenode::setFaults(const NamenodeFaults & faults) {
+    lock_guard<mutex> lock(faultsMut);
+
+    if (faults.stale && !this->faults.stale) {
+        staleStateId = fsns.getStateId();
+    }
+
+    this->faults = faults;
+}
+
+NamenodeFaults FakeNamenode::getFaults() {
+    lock_guard<mutex> lock(faultsMut);
+    return faults;
+}
+
+std::vector<NamenodeConnection> FakeNamenode::getConnections() {
+    lock_guard<mutex> lock(connectionsMut);
+    return connections;
+}
+
+void FakeNamenode::sendResponse(Socket & sock, const RpcResponseHeaderProto & header, const std::string & body) {
+    WriteBuffer buffer;
+    /*
+     * a failed call has no response body.
+     */
+    bool success = header.status() == RpcResponseHeaderProto::SUCCESS;
+    int headerSize = header.ByteSize();
+    int32_t total = CodedOutputStream::VarintSize32(headerSize) + headerSize;
+
+    if (success) {
+        total += CodedOutputStream::VarintSize32(body.size()) + body.size();
+    }
+
+    buffer.writeBigEndian(total);
+    buffer.writeVarint32(headerSize);
+    header.SerializeToArray(buffer.alloc(headerSize), headerSize);
+
+    if (success) {
+        buffer.writeVarint32(body.size());
+        buffer.write(body.data(), body.size());
+    }
+
+    sock.writeFully(buffer.getBuffer(0), buffer.getDataSize(0), -1);
+}
+
+void FakeNamenode::serve(Socket & sock) {
+    int id;
+    {
+        lock_guard<mutex> lock(connectionsMut);
+        connections.push_back(NamenodeConnection());
+        id = connections.back().id = static_cast<int>(connections.size());
+    }
+
+    try {
+        serveCalls(sock, id);
+    } catch (...) {
+        lock_guard<mutex> lock(connectionsMut);
+        connections[id - 1].open = false;
+        throw;
+    }
+
+    lock_guard<mutex> lock(connectionsMut);
+    connections[id - 1].open = false;
+}
+
+void FakeNamenode::serveCalls(Socket & sock, int id) {
+    BufferedSocketReaderImpl in(sock);
+    char magic[7];
+    std::string user;
+    std::vector<char> frame;
+    in.readFully(magic, sizeof(magic), -1);
+
+    if (memcmp(magic, RPC_MAGIC, strlen(RPC_MAGIC)) || magic[4] != RPC_VERSION) {
+        THROW(HdfsIOException, "FakeNamenode: unsupported connection header.");
+    }
+
+    if (magic[6] != 0) {
+        THROW(HdfsIOException, "FakeNamenode: only simple authentication is supported.");
+    }
+
+    while (!isStopped()) {
+        int32_t size = in.readBigEndianInt32(-1);
+
+        if (size <= 0) {
+            THROW(HdfsIOException, "FakeNamenode: invalid frame length %d.", size);
+        }
+
+        frame.resize(size);
+        in.readFully(&frame[0], size, -1);
+        CodedInputStream stream(reinterpret_cast<const uint8_t *>(&frame[0]), size);
+        RpcRequestHeaderProto rpcHeader;
+        ReadDelimited(stream, rpcHeader);
+
+        if (rpcHeader.callid() == CONNECTION_CONTEXT_CALL_ID) {
+            IpcConnectionContextProto context;
+            ReadDelimited(stream, context);
+            user = context.userinfo().effectiveuser();
+            continue;
+        }
+
+        if (rpcHeader.callid() == PING_CALL_ID) {
+            continue;
+        }
+
+        RequestHeaderProto requestHeader;
+        std::string request, body;
+        ReadDelimited(stream, requestHeader);
+        ReadDelimited(stream, request);
+        {
+            lock_guard<mutex> lock(connectionsMut);
+            connections[id - 1].methods.insert(requestHeader.methodname());
+        }
+        NamenodeFaults current;
+        int64_t applied;
+        {
+            lock_guard<mutex> lock(faultsMut);
+            current = faults;
+            applied = faults.stale ? staleStateId : fsns.getStateId();
+        }
+        delay(current.latency);
+
+        if (current.dropCalls) {
+            THROW(HdfsNetworkException, "FakeNamenode: dropped the connection at call %d.",
+                  static_cast<int>(rpcHeader.callid()));
+        }
+
+        RpcResponseHeaderProto response;
+        response.set_callid(rpcHeader.callid());
+        response.set_serveripcversionnum(RPC_VERSION);
+        response.set_clientid(rpcHeader.clientid());
+
+        try {
+            if (current.standby) {
+                THROW(NameNodeStandbyException, "Operation category is not supported in state standby");
+            }
+
+            if (current.observer) {
+                const std::string & method = requestHeader.methodname();
+
+                if (!FakeNamespace::IsReadOnly(method) || method == "msync") {
+                    THROW(NameNodeStandbyException, "Operation category WRITE is not supported in state observer");
+                }
+
+                if (rpcHeader.has_stateid() && rpcHeader.stateid() > applied) {
+                    THROW(NameNodeRetriableException, "Observer has not caught up with state id %lld, applied %lld",
+                          static_cast<long long>(rpcHeader.stateid()), static_cast<long long>(applied));
+                }
+            }
+
+            fsns.invoke(requestHeader.methodname(), user, request, body);
+            response.set_status(RpcResponseHeaderProto::SUCCESS);
+        } catch (const HdfsException & e) {
+            body.clear();
+            response.set_status(RpcResponseHeaderProto::ERROR);
+            response.set_exceptionclassname(ExceptionClassName(e));
+            response.set_errormsg(e.what());
+            response.set_errordetail(dynamic_cast<const RpcNoSuchMethodException *>(&e) ?
+                                     RpcResponseHeaderProto::ERROR_NO_SUCH_METHOD :
+                                     RpcResponseHeaderProto::ERROR_APPLICATION);
+        }
+
+        response.set_stateid(current.observer ? applied : fsns.getStateId());
+        sendResponse(sock, response, body);
+    }
+}
+
+}
+}
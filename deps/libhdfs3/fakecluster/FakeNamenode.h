@@ -0,0 +1,89 @@
+/********************************************************************
+ * 2014 -
+ * open source under Apache License Version 2.0
+ ********************************************************************/
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _HDFS_LIBHDFS3_FAKECLUSTER_FAKENAMENODE_H_
+#define _HDFS_LIBHDFS3_FAKECLUSTER_FAKENAMENODE_H_
+
+#include "FakeCluster.h"
+#include "FakeServer.h"
+#include "RpcHeader.pb.h"
+
+#include <set>
+#include <string>
+#include <vector>
+
+namespace Hdfs {
+namespace Internal {
+
+class FakeNamespace;
+
+/**
+ * What a namenode saw of one client connection.
+ */
+struct NamenodeConnection {
+    NamenodeConnection() :
+        id(0), open(true) {
+    }
+
+    int id; //1 for the first connection accepted, then counting up.
+    bool open;
+    std::set<std::string> methods; //the methods called on it.
+};
+
+/**
+ * A namenode speaking the Hadoop RPC protocol with simple authentication.
+ * Calls on one connection are answered in order.
+ */
+class FakeNamenode: public FakeServer {
+public:
+    explicit FakeNamenode(FakeNamespace & fsns);
+
+    ~FakeNamenode();
+
+    void setFaults(const NamenodeFaults & faults);
+
+    NamenodeFaults getFaults();
+
+    /**
+     * The connections accepted so far, in order.
+     */
+    std::vector<NamenodeConnection> getConnections();
+
+protected:
+    void serve(Socket & sock);
+
+private:
+    void serveCalls(Socket & sock, int id);
+    void sendResponse(Socket & sock, const RpcResponseHeaderProto & header, const std::string & body);
+
+private:
+    FakeNamespace & fsns;
+    mutex faultsMut;
+    NamenodeFaults faults;
+    int64_t staleStateId; //the state id a stale observer stopped at.
+    mutex connectionsMut;
+    std::vector<NamenodeConnection> connections;
+};
+
+}
+}
+
+#endif /* _HDFS_LIBHDFS3_FAKECLUSTER_FAKENAMENODE_H_ */
@@ -0,0 +1,914 @@
+/********************************************************************
+ * 2014 -
+ * open source under Apache License Version 2.0
+ ********************************************************************/
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "DateTime.h"
+#include "Exception.h"
+#include "ExceptionInternal.h"
+#include "FakeNamespace.h"
+
+#include <algorithm>
+#include <inttypes.h>
+#include <string.h>
+#include <sstream>
+
+using google::protobuf::RepeatedPtrField;
+
+namespace Hdfs {
+namespace Internal {
+
+static const char * BLOCK_POOL_ID = "BP-fake";
+static const int LISTING_LIMIT = 1000;
+static const uint32_t CREATE_FLAG_CREATE = 0x01;
+static const uint32_t CREATE_FLAG_OVERWRITE = 0x02;
+
+static int64_t NowMillis() {
+    return duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
+}
+
+static std::string ParentOf(const std::string & path) {
+    size_t pos = path.find_last_of('/');
+    return pos == 0 || pos == std::string::npos ? "/" : path.substr(0, pos);
+}
+
+/*
+ * Files below /.reserved/raw are read as they are stored, without their
+ * encryption info, the client gets the encrypted data.
+ */
+static bool StripRaw(std::string & path) {
+    static const std::string prefix = "/.reserved/raw";
+
+    if (path.compare(0, prefix.size(), prefix) != 0
+            || (path.size() > prefix.size() && path[prefix.size()] != '/')) {
+        return false;
+    }
+
+    path = path.size() == prefix.size() ? "/" : path.substr(prefix.size());
+    return true;
+}
+
+static std::string NameOf(const std::string & path) {
+    return path == "/" ? "" : path.substr(path.find_last_of('/') + 1);
+}
+
+template<typename T>
+static void Parse(T & proto, const std::string & request) {
+    if (!proto.ParseFromString(request)) {
+        THROW(HdfsIOException, "FakeNamespace: cannot parse %s.", proto.GetTypeName().c_str());
+    }
+}
+
+template<typename T>
+static void Serialize(const T & proto, std::string & response) {
+    proto.SerializeToString(&response);
+}
+
+FakeNamespace::FakeNamespace() :
+    nextInodeId(16386), nextBlockId(1073741825), nextGenerationStamp(1001), stateId(0), nextTarget(0) {
+    FakeInode & root = inodes["/"];
+    root.dir = true;
+    root.id = nextInodeId++;
+    root.mtime = root.atime = NowMillis();
+    root.owner = "hdfs";
+    root.group = "supergroup";
+    handlers["getBlockLocations"] = &FakeNamespace::getBlockLocations;
+    handlers["getFileInfo"] = &FakeNamespace::getFileInfo;
+    handlers["getListing"] = &FakeNamespace::getListing;
+    handlers["create"] = &FakeNamespace::create;
+    handlers["addBlock"] = &FakeNamespace::addBlock;
+    handlers["complete"] = &FakeNamespace::complete;
+    handlers["abandonBlock"] = &FakeNamespace::abandonBlock;
+    handlers["fsync"] = &FakeNamespace::fsync;
+    handlers["mkdirs"] = &FakeNamespace::mkdirs;
+    handlers["delete"] = &FakeNamespace::deleteFile;
+    handlers["rename"] = &FakeNamespace::rename;
+    handlers["concat"] = &FakeNamespace::concat;
+    handlers["setReplication"] = &FakeNamespace::setReplication;
+    handlers["setPermission"] = &FakeNamespace::setPermission;
+    handlers["setOwner"] = &FakeNamespace::setOwner;
+    handlers["setTimes"] = &FakeNamespace::setTimes;
+    handlers["renewLease"] = &FakeNamespace::renewLease;
+    handlers["getFsStats"] = &FakeNamespace::getFsStats;
+    handlers["updateBlockForPipeline"] = &FakeNamespace::updateBlockForPipeline;
+    handlers["updatePipeline"] = &FakeNamespace::updatePipeline;
+    handlers["getAdditionalDatanode"] = &FakeNamespace::getAdditionalDatanode;
+    handlers["msync"] = &FakeNamespace::msync;
+    handlers["createEncryptionZone"] = &FakeNamespace::createEncryptionZone;
+}
+
+int FakeNamespace::addDatanode(const DatanodeIDProto & id) {
+    lock_guard<mutex> lock(mut);
+    datanodes.push_back(id);
+    return static_cast<int>(datanodes.size()) - 1;
+}
+
+void FakeNamespace::invoke(const std::string & method, const std::string & user,
+                           const std::string & request, std::string & response) {
+    std::map<std::string, Handler>::iterator it = handlers.find(method);
+
+    if (it == handlers.end()) {
+        THROW(RpcNoSuchMethodException, "Unknown method %s called on the fake namenode.", method.c_str());
+    }
+
+    std::vector<int64_t> removed;
+    {
+        lock_guard<mutex> lock(mut);
+        pendingRemoved.clear();
+        (this->*(it->second))(user, request, response);
+        removed.swap(pendingRemoved);
+
+        if (!IsReadOnly(method)) {
+            ++stateId;
+        }
+    }
+
+    if (!removed.empty() && blockRemoved) {
+        blockRemoved(removed);
+    }
+}
+
+int64_t FakeNamespace::getStateId() {
+    lock_guard<mutex> lock(mut);
+    return stateId;
+}
+
+bool FakeNamespace::IsReadOnly(const std::string & method) {
+    return method == "getBlockLocations" || method == "getFileInfo" || method == "getListing"
+           || method == "getFsStats" || method == "msync";
+}
+
+bool FakeNamespace::lookup(const std::string & path, FakeInode & inode) {
+    lock_guard<mutex> lock(mut);
+    InodeMap::iterator it = inodes.find(path);
+
+    if (it == inodes.end()) {
+        return false;
+    }
+
+    inode = it->second;
+    return true;
+}
+
+int64_t FakeNamespace::getBlockCount() {
+    lock_guard<mutex> lock(mut);
+    int64_t count = 0;
+
+    for (InodeMap::iterator it = inodes.begin(); it != inodes.end(); ++it) {
+        count += it->second.blocks.size();
+    }
+
+    return count;
+}
+
+FakeInode & FakeNamespace::getInode(const std::string & path) {
+    InodeMap::iterator it = inodes.find(path);
+
+    if (it == inodes.end()) {
+        THROW(FileNotFoundException, "File does not exist: %s", path.c_str());
+    }
+
+    return it->second;
+}
+
+FakeInode & FakeNamespace::getFile(const std::string & path) {
+    FakeInode & inode = getInode(path);
+
+    if (inode.dir) {
+        THROW(FileNotFoundException, "Path is not a file: %s", path.c_str());
+    }
+
+    return inode;
+}
+
+FakeBlock & FakeNamespace::getBlock(FakeInode & file, int64_t id, const std::string & path) {
+    for (size_t i = 0; i < file.blocks.size(); ++i) {
+        if (file.blocks[i].id == id) {
+            return file.blocks[i];
+        }
+    }
+
+    THROW(HdfsIOException, "Block blk_%" PRId64 " does not belong to %s.", id, path.c_str());
+}
+
+bool FakeNamespace::makeParents(const std::string & path, const std::string & user, bool createParent) {
+    std::string parent = ParentOf(path);
+    InodeMap::iterator it = inodes.find(parent);
+
+    if (it != inodes.end()) {
+        if (!it->second.dir) {
+            THROW(ParentNotDirectoryException, "Parent path is not a directory: %s", parent.c_str());
+        }
+
+        return false;
+    }
+
+    if (!createParent) {
+        THROW(FileNotFoundException, "Parent directory doesn't exist: %s", parent.c_str());
+    }
+
+    makeParents(parent, user, true);
+    FakeInode & dir = inodes[parent];
+    dir.dir = true;
+    dir.id = nextInodeId++;
+    dir.mtime = dir.atime = NowMillis();
+    dir.owner = user;
+    dir.group = "supergroup";
+    return true;
+}
+
+void FakeNamespace::createEncryptionZone(const std::string & path, const std::string & keyName) {
+    lock_guard<mutex> lock(mut);
+    makeEncryptionZone(path, keyName);
+    ++stateId;
+}
+
+void FakeNamespace::makeEncryptionZone(const std::string & path, const std::string & keyName) {
+    FakeInode & dir = getInode(path);
+
+    if (!dir.dir) {
+        THROW(HdfsIOException, "Attempt to create an encryption zone for a file: %s", path.c_str());
+    }
+
+    dir.keyName = keyName;
+}
+
+std::string FakeNamespace::childPrefix(const std::string & dir) {
+    return dir == "/" ? dir : dir + "/";
+}
+
+void FakeNamespace::removeTree(const std::string & path, std::vector<int64_t> & blocks) {
+    std::string prefix = childPrefix(path);
+    InodeMap::iterator it = inodes.find(path);
+
+    while (it != inodes.end() && (it->first == path || it->first.compare(0, prefix.size(), prefix) == 0)) {
+        for (size_t i = 0; i < it->second.blocks.size(); ++i) {
+            blocks.push_back(it->second.blocks[i].id);
+        }
+
+        inodes.erase(it++);
+    }
+}
+
+int FakeNamespace::findDatanode(const DatanodeIDProto & id) {
+    for (size_t i = 0; i < datanodes.size(); ++i) {
+        if (datanodes[i].datanodeuuid() == id.datanodeuuid()) {
+            return static_cast<int>(i);
+        }
+    }
+
+    return -1;
+}
+
+std::vector<int> FakeNamespace::chooseTargets(size_t count, const std::vector<int> & existing,
+        const RepeatedPtrField<DatanodeInfoProto> & excludes,
+        const RepeatedPtrField<std::string> & favored) {
+    std::vector<int> retval;
+    std::vector<bool> skip(datanodes.size(), false);
+
+    for (size_t i = 0; i < existing.size(); ++i) {
+        skip[existing[i]] = true;
+    }
+
+    for (int i = 0; i < excludes.size(); ++i) {
+        int index = findDatanode(excludes.Get(i).id());
+
+        if (index >= 0) {
+            skip[index] = true;
+        }
+    }
+
+    /*
+     * favored nodes are given as host:port of the data transfer address.
+     */
+    for (int i = 0; i < favored.size() && retval.size() < count; ++i) {
+        const std::string & node = favored.Get(i);
+
+        for (size_t j = 0; j < datanodes.size(); ++j) {
+            std::stringstream port;
+            port << ":" << datanodes[j].xferport();
+
+            if (!skip[j] && (node == datanodes[j].ipaddr() + port.str()
+                             || node == datanodes[j].hostname() + port.str())) {
+                skip[j] = true;
+                retval.push_back(j);
+                break;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < datanodes.size() && retval.size() < count; ++i) {
+        size_t index = (nextTarget + i) % datanodes.size();
+
+        if (!skip[index]) {
+            skip[index] = true;
+            retval.push_back(index);
+        }
+    }
+
+    ++nextTarget;
+    return retval;
+}
+
+int64_t FakeNamespace::fileLength(const FakeInode & inode) {
+    int64_t length = 0;
+
+    for (size_t i = 0; i < inode.blocks.size(); ++i) {
+        length += inode.blocks[i].numBytes;
+    }
+
+    return length;
+}
+
+void FakeNamespace::buildStatus(const std::string & name, const FakeInode & inode, HdfsFileStatusProto & proto) {
+    proto.set_filetype(inode.dir ? HdfsFileStatusProto::IS_DIR : HdfsFileStatusProto::IS_FILE);
+    proto.set_path(name);
+    proto.set_length(inode.dir ? 0 : fileLength(inode));
+    proto.mutable_permission()->set_perm(inode.perm);
+    proto.set_owner(inode.owner);
+    proto.set_group(inode.group);
+    proto.set_modification_time(inode.mtime);
+    proto.set_access_time(inode.atime);
+    proto.set_block_replication(inode.replication);
+    proto.set_blocksize(inode.blockSize);
+    proto.set_fileid(inode.id);
+    proto.set_childrennum(0);
+
+    if (!inode.edek.empty()) {
+        FileEncryptionInfoProto & info = *proto.mutable_fileencryptioninfo();
+        info.set_suite(AES_CTR_NOPADDING);
+        info.set_cryptoprotocolversion(ENCRYPTION_ZONES);
+        info.set_key(inode.edek);
+        info.set_iv(inode.iv);
+        info.set_keyname(inode.keyName);
+        info.set_ezkeyversionname(inode.keyName + "@0");
+    }
+}
+
+void FakeNamespace::buildExtendedBlock(const FakeBlock & block, ExtendedBlockProto & proto) {
+    proto.set_poolid(BLOCK_POOL_ID);
+    proto.set_blockid(block.id);
+    proto.set_generationstamp(block.gs);
+    proto.set_numbytes(block.numBytes);
+}
+
+void FakeNamespace::buildLocatedBlock(const FakeBlock & block, int64_t offset,
+                                      const std::vector<int> & locations, LocatedBlockProto & proto) {
+    buildExtendedBlock(block, *proto.mutable_b());
+    proto.set_offset(offset);
+    proto.set_corrupt(false);
+    TokenProto * token = proto.mutable_blocktoken();
+    token->set_identifier("");
+    token->set_password("");
+    token->set_kind("");
+    token->set_service("");
+
+    for (size_t i = 0; i < locations.size(); ++i) {
+        const DatanodeIDProto & id = datanodes[locations[i]];
+        DatanodeInfoProto * info = proto.add_locs();
+        info->mutable_id()->CopyFrom(id);
+        info->set_lastupdate(NowMillis());
+        proto.add_storagetypes(DISK);
+        proto.add_storageids("DS-" + id.datanodeuuid());
+    }
+}
+
+void FakeNamespace::getBlockLocations(const std::string & user, const std::string & request,
+                                      std::string & response) {
+    GetBlockLocationsRequestProto req;
+    GetBlockLocationsResponseProto resp;
+    Parse(req, request);
+    std::string src = req.src();
+    StripRaw(src);
+    FakeInode & file = getFile(src);
+    LocatedBlocksProto * lbs = resp.mutable_locations();
+    int64_t start = req.offset(), end = req.offset() + req.length();
+    int64_t offset = 0;
+
+    for (size_t i = 0; i < file.blocks.size(); ++i) {
+        const FakeBlock & block = file.blocks[i];
+
+        if (offset + block.numBytes > start && offset < end && block.numBytes > 0) {
+            buildLocatedBlock(block, offset, block.locations, *lbs->add_blocks());
+        }
+
+        offset += block.numBytes;
+    }
+
+    lbs->set_filelength(offset);
+    lbs->set_underconstruction(false);
+    lbs->set_islastblockcomplete(true);
+    file.atime = NowMillis();
+    Serialize(resp, response);
+}
+
+void FakeNamespace::getFileInfo(const std::string & user, const std::string & request,
+                                std::string & response) {
+    GetFileInfoRequestProto req;
+    GetFileInfoResponseProto resp;
+    Parse(req, request);
+    std::string src = req.src();
+    bool raw = StripRaw(src);
+    InodeMap::iterator it = inodes.find(src);
+
+    if (it != inodes.end()) {
+        buildStatus("", it->second, *resp.mutable_fs());
+
+        if (raw) {
+            resp.mutable_fs()->clear_fileencryptioninfo();
+        }
+    }
+
+    Serialize(resp, response);
+}
+
+void FakeNamespace::getListing(const std::string & user, const std::string & request,
+                               std::string & response) {
+    GetListingRequestProto req;
+    GetListingResponseProto resp;
+    Parse(req, request);
+    InodeMap::iterator it = inodes.find(req.src());
+
+    if (it == inodes.end()) {
+        Serialize(resp, response);
+        return;
+    }
+
+    DirectoryListingProto * list = resp.mutable_dirlist();
+
+    if (!it->second.dir) {
+        buildStatus("", it->second, *list->add_partiallisting());
+        list->set_remainingentries(0);
+        Serialize(resp, response);
+        return;
+    }
+
+    std::string prefix = childPrefix(req.src());
+    int remaining = 0;
+
+    for (it = inodes.upper_bound(prefix + req.startafter());
+            it != inodes.end() && it->first.compare(0, prefix.size(), prefix) == 0; ++it) {
+        if (it->first.find('/', prefix.size()) != std::string::npos) {
+            continue;
+        }
+
+        if (list->partiallisting_size() < LISTING_LIMIT) {
+            buildStatus(it->first.substr(prefix.size()), it->second, *list->add_partiallisting());
+        } else {
+            ++remaining;
+        }
+    }
+
+    list->set_remainingentries(remaining);
+    Serialize(resp, response);
+}
+
+void FakeNamespace::create(const std::string & user, const std::string & request,
+                           std::string & response) {
+    CreateRequestProto req;
+    CreateResponseProto resp;
+    Parse(req, request);
+    InodeMap::iterator it = inodes.find(req.src());
+
+    if (it != inodes.end()) {
+        if (it->second.dir) {
+            THROW(FileAlreadyExistsException, "%s already exists as a directory", req.src().c_str());
+        }
+
+        if (!(req.createflag() & CREATE_FLAG_OVERWRITE)) {
+            THROW(FileAlreadyExistsException, "%s for client %s already exists", req.src().c_str(),
+                  req.clientname().c_str());
+        }
+
+        removeTree(req.src(), pendingRemoved);
+    } else if (!(req.createflag() & CREATE_FLAG_CREATE)) {
+        THROW(FileNotFoundException, "File does not exist: %s", req.src().c_str());
+    }
+
+    makeParents(req.src(), user, req.createparent());
+    FakeInode & file = inodes[req.src()];
+    file.id = nextInodeId++;
+    file.mtime = file.atime = NowMillis();
+    file.perm = req.masked().perm();
+    file.owner = user;
+    file.group = "supergroup";
+    file.replication = req.replication();
+    file.blockSize = req.blocksize();
+    file.underConstruction = true;
+
+    for (std::string dir = ParentOf(req.src()); ; dir = ParentOf(dir)) {
+        const FakeInode & parent = inodes[dir];
+
+        if (!parent.keyName.empty()) {
+            /*
+             * 16 bytes unique to the file, the stub KMS "decrypts" them to an AES-128 key.
+             */
+            file.keyName = parent.keyName;
+            file.edek.assign(16, 'k');
+            file.iv.assign(16, 'i');
+            memcpy(&file.edek[0], &file.id, sizeof(file.id));
+            memcpy(&file.iv[0], &file.id, sizeof(file.id));
+            break;
+        }
+
+        if (dir == "/") {
+            break;
+        }
+    }
+
+    buildStatus("", file, *resp.mutable_fs());
+    Serialize(resp, response);
+}
+
+void FakeNamespace::addBlock(const std::string & user, const std::string & request,
+                             std::string & response) {
+    AddBlockRequestProto req;
+    AddBlockResponseProto resp;
+    Parse(req, request);
+    FakeInode & file = getFile(req.src());
+
+    if (!file.underConstruction) {
+        THROW(HdfsIOException, "No lease on %s: File is not open for writing.", req.src().c_str());
+    }
+
+    if (req.has_previous()) {
+        getBlock(file, req.previous().blockid(), req.src()).numBytes = req.previous().numbytes();
+    }
+
+    std::vector<int> targets = chooseTargets(std::max<uint32_t>(file.replication, 1), std::vector<int>(),
+                               req.excludenodes(), req.favorednodes());
+
+    if (targets.empty()) {
+        THROW(HdfsIOException, "File %s could only be replicated to 0 nodes.", req.src().c_str());
+    }
+
+    FakeBlock block;
+    block.id = nextBlockId++;
+    block.gs = nextGenerationStamp++;
+    block.locations = targets;
+    buildLocatedBlock(block, fileLength(file), targets, *resp.mutable_block());
+    file.blocks.push_back(block);
+    Serialize(resp, response);
+}
+
+void FakeNamespace::complete(const std::string & user, const std::string & request,
+                             std::string & response) {
+    CompleteRequestProto req;
+    CompleteResponseProto resp;
+    Parse(req, request);
+    FakeInode & file = getFile(req.src());
+
+    if (req.has_last()) {
+        getBlock(file, req.last().blockid(), req.src()).numBytes = req.last().numbytes();
+    }
+
+    file.underConstruction = false;
+    file.mtime = NowMillis();
+    resp.set_result(true);
+    Serialize(resp, response);
+}
+
+void FakeNamespace::abandonBlock(const std::string & user, const std::string & request,
+                                 std::string & response) {
+    AbandonBlockRequestProto req;
+    AbandonBlockResponseProto resp;
+    Parse(req, request);
+    FakeInode & file = getFile(req.src());
+
+    if (!file.blocks.empty() && file.blocks.back().id == static_cast<int64_t>(req.b().blockid())) {
+        pendingRemoved.push_back(file.blocks.back().id);
+        file.blocks.pop_back();
+    }
+
+    Serialize(resp, response);
+}
+
+void FakeNamespace::fsync(const std::string & user, const std::string & request,
+                          std::string & response) {
+    FsyncRequestProto req;
+    FsyncResponseProto resp;
+    Parse(req, request);
+    FakeInode & file = getFile(req.src());
+
+    if (req.lastblocklength() >= 0 && !file.blocks.empty()) {
+        file.blocks.back().numBytes = req.lastblocklength();
+    }
+
+    Serialize(resp, response);
+}
+
+void FakeNamespace::mkdirs(const std::string & user, const std::string & request,
+                           std::string & response) {
+    MkdirsRequestProto req;
+    MkdirsResponseProto resp;
+    Parse(req, request);
+    InodeMap::iterator it = inodes.find(req.src());
+
+    if (it != inodes.end()) {
+        if (!it->second.dir) {
+            THROW(FileAlreadyExistsException, "Path is not a directory: %s", req.src().c_str());
+        }
+    } else {
+        makeParents(req.src(), user, req.createparent());
+        FakeInode & dir = inodes[req.src()];
+        dir.dir = true;
+        dir.id = nextInodeId++;
+        dir.mtime = dir.atime = NowMillis();
+        dir.perm = req.masked().perm();
+        dir.owner = user;
+        dir.group = "supergroup";
+    }
+
+    resp.set_result(true);
+    Serialize(resp, response);
+}
+
+void FakeNamespace::deleteFile(const std::string & user, const std::string & request,
+                               std::string & response) {
+    DeleteRequestProto req;
+    DeleteResponseProto resp;
+    Parse(req, request);
+    InodeMap::iterator it = inodes.find(req.src());
+    resp.set_result(false);
+
+    if (it != inodes.end() && req.src() != "/") {
+        std::string prefix = childPrefix(req.src());
+
+        if (it->second.dir && !req.recursive()) {
+            InodeMap::iterator child = inodes.lower_bound(prefix);
+
+            if (child != inodes.end() && child->first.compare(0, prefix.size(), prefix) == 0) {
+                THROW(HdfsIOException, "%s is non empty", req.src().c_str());
+            }
+        }
+
+        removeTree(req.src(), pendingRemoved);
+        resp.set_result(true);
+    }
+
+    Serialize(resp, response);
+}
+
+void FakeNamespace::rename(const std::string & user, const std::string & request,
+                           std::string & response) {
+    RenameRequestProto req;
+    RenameResponseProto resp;
+    Parse(req, request);
+    std::string src = req.src(), dst = req.dst();
+    resp.set_result(false);
+
+    if (inodes.count(dst) && inodes[dst].dir) {
+        dst = childPrefix(dst) + NameOf(src);
+    }
+
+    InodeMap::iterator parent = inodes.find(ParentOf(dst));
+
+    if (src != "/" && inodes.count(src) && !inodes.count(dst) && parent != inodes.end() && parent->second.dir
+            && dst.compare(0, src.size() + 1, childPrefix(src)) != 0) {
+        std::string prefix = childPrefix(src);
+        InodeMap::iterator it = inodes.find(src);
+        InodeMap moved;
+
+        while (it != inodes.end() && (it->first == src || it->first.compare(0, prefix.size(), prefix) == 0)) {
+            moved[dst + it->first.substr(src.size())] = it->second;
+            inodes.erase(it++);
+        }
+
+        inodes.insert(moved.begin(), moved.end());
+        resp.set_result(true);
+    }
+
+    Serialize(resp, response);
+}
+
+/*
+ * checks the preconditions of the namenode, the blocks of trg must be full
+ * as the fake namenode does not support blocks of variable length.
+ */
+void FakeNamespace::concat(const std::string & user, const std::string & request,
+                           std::string & response) {
+    ConcatRequestProto req;
+    ConcatResponseProto resp;
+    Parse(req, request);
+    FakeInode & trg = getFile(req.trg());
+
+    if (trg.underConstruction) {
+        THROW(HdfsIOException, "concat: target file %s is under construction", req.trg().c_str());
+    }
+
+    for (int i = 0; i < req.srcs_size(); ++i) {
+        const std::string & src = req.srcs(i);
+        FakeInode & file = getFile(src);
+        const FakeInode & previous = i == 0 ? trg : getFile(req.srcs(i - 1));
+
+        if (src == req.trg() || ParentOf(src) != ParentOf(req.trg())) {
+            THROW(HdfsIOException, "concat: %s is not a different file in the directory of %s",
+                  src.c_str(), req.trg().c_str());
+        }
+
+        if (file.underConstruction || file.blocks.empty() || file.blockSize != trg.blockSize) {
+            THROW(HdfsIOException, "concat: source file %s is under construction, empty or has another block size",
+                  src.c_str());
+        }
+
+        for (size_t j = 0; j < previous.blocks.size(); ++j) {
+            if (previous.blocks[j].numBytes != previous.blockSize) {
+                THROW(HdfsIOException, "concat: block blk_%" PRId64 " before %s is not full",
+                      previous.blocks[j].id, src.c_str());
+            }
+        }
+    }
+
+    for (int i = 0; i < req.srcs_size(); ++i) {
+        FakeInode & file = getFile(req.srcs(i));
+        trg.blocks.insert(trg.blocks.end(), file.blocks.begin(), file.blocks.end());
+        inodes.erase(req.srcs(i));
+    }
+
+    trg.mtime = NowMillis();
+    Serialize(resp, response);
+}
+
+void FakeNamespace::setReplication(const std::string & user, const std::string & request,
+                                   std::string & response) {
+    SetReplicationRequestProto req;
+    SetReplicationResponseProto resp;
+    Parse(req, request);
+    FakeInode & file = getFile(req.src());
+    file.replication = req.replication();
+    resp.set_result(true);
+    Serialize(resp, response);
+}
+
+void FakeNamespace::setPermission(const std::string & user, const std::string & request,
+                                  std::string & response) {
+    SetPermissionRequestProto req;
+    SetPermissionResponseProto resp;
+    Parse(req, request);
+    getInode(req.src()).perm = req.permission().perm();
+    Serialize(resp, response);
+}
+
+void FakeNamespace::setOwner(const std::string & user, const std::string & request,
+                             std::string & response) {
+    SetOwnerRequestProto req;
+    SetOwnerResponseProto resp;
+    Parse(req, request);
+    FakeInode & inode = getInode(req.src());
+
+    if (req.has_username()) {
+        inode.owner = req.username();
+    }
+
+    if (req.has_groupname()) {
+        inode.group = req.groupname();
+    }
+
+    Serialize(resp, response);
+}
+
+void FakeNamespace::setTimes(const std::string & user, const std::string & request,
+                             std::string & response) {
+    SetTimesRequestProto req;
+    SetTimesResponseProto resp;
+    Parse(req, request);
+    FakeInode & inode = getInode(req.src());
+    inode.mtime = req.mtime();
+    inode.atime = req.atime();
+    Serialize(resp, response);
+}
+
+void FakeNamespace::renewLease(const std::string & user, const std::string & request,
+                               std::string & response) {
+    RenewLeaseResponseProto resp;
+    Serialize(resp, response);
+}
+
+void FakeNamespace::getFsStats(const std::string & user, const std::string & request,
+                               std::string & response) {
+    GetFsStatsResponseProto resp;
+    int64_t used = 0;
+
+    for (InodeMap::iterator it = inodes.begin(); it != inodes.end(); ++it) {
+        for (size_t i = 0; i < it->second.blocks.size(); ++i) {
+            used += it->second.blocks[i].numBytes * it->second.blocks[i].locations.size();
+        }
+    }
+
+    int64_t capacity = std::max<int64_t>(used, 1024LL * 1024 * 1024 * 1024);
+    resp.set_capacity(capacity);
+    resp.set_used(used);
+    resp.set_remaining(capacity - used);
+    resp.set_under_replicated(0);
+    resp.set_corrupt_blocks(0);
+    resp.set_missing_blocks(0);
+    Serialize(resp, response);
+}
+
+void FakeNamespace::updateBlockForPipeline(const std::string & user, const std::string & request,
+        std::string & response) {
+    UpdateBlockForPipelineRequestProto req;
+    UpdateBlockForPipelineResponseProto resp;
+    Parse(req, request);
+    FakeBlock block;
+    block.id = req.block().blockid();
+    block.gs = nextGenerationStamp++;
+    block.numBytes = req.block().numbytes();
+    buildLocatedBlock(block, 0, std::vector<int>(), *resp.mutable_block());
+    Serialize(resp, response);
+}
+
+void FakeNamespace::updatePipeline(const std::string & user, const std::string & request,
+                                   std::string & response) {
+    UpdatePipelineRequestProto req;
+    UpdatePipelineResponseProto resp;
+    Parse(req, request);
+
+    for (InodeMap::iterator it = inodes.begin(); it != inodes.end(); ++it) {
+        for (size_t i = 0; i < it->second.blocks.size(); ++i) {
+            FakeBlock & block = it->second.blocks[i];
+
+            if (block.id != static_cast<int64_t>(req.oldblock().blockid())) {
+                continue;
+            }
+
+            block.gs = req.newblock().generationstamp();
+            block.numBytes = req.newblock().numbytes();
+            block.locations.clear();
+
+            for (int j = 0; j < req.newnodes_size(); ++j) {
+                int index = findDatanode(req.newnodes(j));
+
+                if (index >= 0) {
+                    block.locations.push_back(index);
+                }
+            }
+
+            Serialize(resp, response);
+            return;
+        }
+    }
+
+    THROW(HdfsIOException, "Block blk_%" PRId64 " does not exist.",
+          static_cast<int64_t>(req.oldblock().blockid()));
+}
+
+void FakeNamespace::getAdditionalDatanode(const std::string & user, const std::string & request,
+        std::string & response) {
+    GetAdditionalDatanodeRequestProto req;
+    GetAdditionalDatanodeResponseProto resp;
+    Parse(req, request);
+    getFile(req.src());
+    std::vector<int> existing;
+
+    for (int i = 0; i < req.existings_size(); ++i) {
+        int index = findDatanode(req.existings(i).id());
+
+        if (index >= 0) {
+            existing.push_back(index);
+        }
+    }
+
+    std::vector<int> added = chooseTargets(req.numadditionalnodes(), existing, req.excludes(),
+                                           RepeatedPtrField<std::string>());
+    existing.insert(existing.end(), added.begin(), added.end());
+    FakeBlock block;
+    block.id = req.blk().blockid();
+    block.gs = req.blk().generationstamp();
+    block.numBytes = req.blk().numbytes();
+    buildLocatedBlock(block, 0, existing, *resp.mutable_block());
+    Serialize(resp, response);
+}
+
+void FakeNamespace::createEncryptionZone(const std::string & user, const std::string & request,
+                                         std::string & response) {
+    CreateEncryptionZoneRequestProto req;
+    CreateEncryptionZoneResponseProto resp;
+    Parse(req, request);
+    makeEncryptionZone(req.src(), req.keyname());
+    Serialize(resp, response);
+}
+
+void FakeNamespace::msync(const std::string & user, const std::string & request, std::string & response) {
+    MsyncResponseProto resp;
+    Serialize(resp, response);
+}
+
+}
+}
@@ -0,0 +1,194 @@
+/********************************************************************
+ * 2014 -
+ * open source under Apache License Version 2.0
+ ********************************************************************/
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _HDFS_LIBHDFS3_FAKECLUSTER_FAKENAMESPACE_H_
+#define _HDFS_LIBHDFS3_FAKECLUSTER_FAKENAMESPACE_H_
+
+#include "Function.h"
+#include "Thread.h"
+#include "ClientNamenodeProtocol.pb.h"
+#include "hdfs.pb.h"
+
+#include <map>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace Hdfs {
+namespace Internal {
+
+struct FakeBlock {
+    FakeBlock() :
+        id(0), gs(0), numBytes(0) {
+    }
+
+    int64_t id;
+    int64_t gs;
+    int64_t numBytes;
+    std::vector<int> locations; //indexes of the datanodes holding a replica.
+};
+
+struct FakeInode {
+    FakeInode() :
+        dir(false), underConstruction(false), id(0), mtime(0), atime(0),
+        perm(0755), replication(0), blockSize(0) {
+    }
+
+    bool dir;
+    bool underConstruction;
+    int64_t id;
+    int64_t mtime;
+    int64_t atime;
+    uint32_t perm;
+    uint32_t replication;
+    int64_t blockSize;
+    std::string owner;
+    std::string group;
+    std::string keyName; //the key of an encryption zone root, or of an encrypted file.
+    std::string edek; //encrypted data encryption key of a file in an encryption zone.
+    std::string iv;
+    std::vector<FakeBlock> blocks;
+};
+
+/**
+ * The namespace and block map of the fake namenodes.
+ *
+ * Requests are the ClientNamenodeProtocol messages, failures are reported by
+ * throwing the exceptions the client maps the Java exceptions to. Files being
+ * written are reported with the bytes the client has acknowledged so far, as
+ * the fake datanodes do not serve replica visible lengths.
+ */
+class FakeNamespace {
+public:
+    FakeNamespace();
+
+    /**
+     * Add a datanode that new blocks may be placed on.
+     * @return the index of the datanode.
+     */
+    int addDatanode(const DatanodeIDProto & id);
+
+    /**
+     * Called with the ids of the blocks removed by delete or overwrite.
+     */
+    void setBlockRemovedCallback(function<void(const std::vector<int64_t> &)> callback) {
+        blockRemoved = callback;
+    }
+
+    /**
+     * Handle one call.
+     * @param method the name of the ClientNamenodeProtocol method.
+     * @param user the effective user of the connection.
+     * @param request the serialized request.
+     * @param response the serialized response.
+     */
+    void invoke(const std::string & method, const std::string & user,
+                const std::string & request, std::string & response);
+
+    /**
+     * @return the inode of the path, false if it does not exist.
+     */
+    bool lookup(const std::string & path, FakeInode & inode);
+
+    int64_t getBlockCount();
+
+    /**
+     * Make the directory the root of an encryption zone, files created
+     * below it get an encrypted key which the KMS decrypts to the same bytes.
+     */
+    void createEncryptionZone(const std::string & path, const std::string & keyName);
+
+    /**
+     * @return the state id, advanced by every successful write.
+     */
+    int64_t getStateId();
+
+    /**
+     * @return true if the method does not modify the namespace.
+     */
+    static bool IsReadOnly(const std::string & method);
+
+private:
+    typedef std::map<std::string, FakeInode> InodeMap;
+    typedef void (FakeNamespace::*Handler)(const std::string &, const std::string &, std::string &);
+
+    void getBlockLocations(const std::string & user, const std::string & request, std::string & response);
+    void getFileInfo(const std::string & user, const std::string & request, std::string & response);
+    void getListing(const std::string & user, const std::string & request, std::string & response);
+    void create(const std::string & user, const std::string & request, std::string & response);
+    void addBlock(const std::string & user, const std::string & request, std::string & response);
+    void complete(const std::string & user, const std::string & request, std::string & response);
+    void abandonBlock(const std::string & user, const std::string & request, std::string & response);
+    void fsync(const std::string & user, const std::string & request, std::string & response);
+    void mkdirs(const std::string & user, const std::string & request, std::string & response);
+    void deleteFile(const std::string & user, const std::string & request, std::string & response);
+    void rename(const std::string & user, const std::string & request, std::string & response);
+    void concat(const std::string & user, const std::string & request, std::string & response);
+    void setReplication(const std::string & user, const std::string & request, std::string & response);
+    void setPermission(const std::string & user, const std::string & request, std::string & response);
+    void setOwner(const std::string & user, const std::string & request, std::string & response);
+    void setTimes(const std::string & user, const std::string & request, std::string & response);
+    void renewLease(const std::string & user, const std::string & request, std::string & response);
+    void getFsStats(const std::string & user, const std::string & request, std::string & response);
+    void updateBlockForPipeline(const std::string & user, const std::string & request, std::string & response);
+    void updatePipeline(const std::string & user, const std::string & request, std::string & response);
+    void getAdditionalDatanode(const std::string & user, const std::string & request, std::string & response);
+    void msync(const std::string & user, const std::string & request, std::string & response);
+    void createEncryptionZone(const std::string & user, const std::string & request, std::string & response);
+
+    FakeInode & getInode(const std::string & path);
+    FakeInode & getFile(const std::string & path);
+    FakeBlock & getBlock(FakeInode & file, int64_t id, const std::string & path);
+    bool makeParents(const std::string & path, const std::string & user, bool createParent);
+    std::string childPrefix(const std::string & dir);
+    void makeEncryptionZone(const std::string & path, const std::string & keyName);
+    void removeTree(const std::string & path, std::vector<int64_t> & blocks);
+    std::vector<int> chooseTargets(size_t count, const std::vector<int> & existing,
+                                   const google::protobuf::RepeatedPtrField<DatanodeInfoProto> & excludes,
+                                   const google::protobuf::RepeatedPtrField<std::string> & favored);
+    int findDatanode(const DatanodeIDProto & id);
+    int64_t fileLength(const FakeInode & inode);
+    void buildStatus(const std::string & name, const FakeInode & inode, HdfsFileStatusProto & proto);
+    void buildLocatedBlock(const FakeBlock & block, int64_t offset, const std::vector<int> & locations,
+                           LocatedBlockProto & proto);
+    void buildExtendedBlock(const FakeBlock & block, ExtendedBlockProto & proto);
+
+private:
+    FakeNamespace(const FakeNamespace & other);
+    FakeNamespace & operator =(const FakeNamespace & other);
+
+    function<void(const std::vector<int64_t> &)> blockRemoved;
+    int64_t nextInodeId;
+    int64_t nextBlockId;
+    int64_t nextGenerationStamp;
+    int64_t stateId;
+    size_t nextTarget;
+    InodeMap inodes;
+    mutex mut;
+    std::vector<int64_t> pendingRemoved; //blocks removed by the current call.
+    std::map<std::string, Handler> handlers;
+    std::vector<DatanodeIDProto> datanodes;
+};
+
+}
+}
+
+#endif /* _HDFS_LIBHDFS3_FAKECLUSTER_FAKENAMESPACE_H_ */
@@ -0,0 +1,241 @@
+/********************************************************************
+ * 2014 -
+ * open source under Apache License Version 2.0
+ ********************************************************************/
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "DateTime.h"
+#include "Exception.h"
+#include "ExceptionInternal.h"
+#include "FakeServer.h"
+#include "Logger.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace Hdfs {
+namespace Internal {
+
+FakeServer::FakeServer() :
+    stopped(true), listenFd(-1), port(0) {
+}
+
+FakeServer::~FakeServer() {
+    stop();
+}
+
+void FakeServer::start(int port) {
+    struct sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    int flag = 1;
+
+    if (fd < 0) {
+        THROW(HdfsNetworkException, "FakeServer: cannot create socket: %s", GetSystemErrorInfo(errno));
+    }
+
+    ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &flag, sizeof(flag));
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    if (::bind(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) < 0
+            || ::listen(fd, 128) < 0
+            || ::getsockname(fd, reinterpret_cast<struct sockaddr *>(&addr), &len) < 0) {
+        int err = errno;
+        ::close(fd);
+        THROW(HdfsNetworkException, "FakeServer: cannot listen on port %d: %s", port, GetSystemErrorInfo(err));
+    }
+
+    listenFd = fd;
+    this->port = ntohs(addr.sin_port);
+    stopped = false;
+    CREATE_THREAD(acceptor, bind(&FakeServer::acceptLoop, this));
+}
+
+void FakeServer::stop() {
+    std::list<thread> pending;
+
+    {
+        lock_guard<mutex> lock(mut);
+
+        if (stopped) {
+            return;
+        }
+
+        stopped = true;
+        cond.notify_all();
+        /*
+         * shutdown wakes up the threads blocked on the sockets,
+         * they close the descriptors themselves.
+         */
+        ::shutdown(listenFd, SHUT_RDWR);
+
+        for (std::set<int>::iterator it = connections.begin(); it != connections.end(); ++it) {
+            ::shutdown(*it, SHUT_RDWR);
+        }
+    }
+
+    acceptor.join();
+    ::close(listenFd);
+    listenFd = -1;
+
+    {
+        lock_guard<mutex> lock(mut);
+        pending.swap(workers);
+        finished.clear();
+    }
+
+    for (std::list<thread>::iterator it = pending.begin(); it != pending.end(); ++it) {
+        it->join();
+    }
+}
+
+void FakeServer::delay(int ms) {
+    if (ms <= 0) {
+        return;
+    }
+
+    unique_lock<mutex> lock(mut);
+    steady_clock::time_point deadline = steady_clock::now() + milliseconds(ms);
+
+    while (!stopped) {
+        steady_clock::time_point now = steady_clock::now();
+
+        if (now >= deadline) {
+            break;
+        }
+
+        cond.wait_for(lock, duration_cast<milliseconds>(deadline - now));
+    }
+}
+
+void FakeServer::acceptLoop() {
+    while (true) {
+        struct sockaddr_in addr;
+        socklen_t len = sizeof(addr);
+        int fd = ::accept(listenFd, reinterpret_cast<struct sockaddr *>(&addr), &len);
+
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+
+            break;
+        }
+
+        int flag = 1;
+        char ip[INET_ADDRSTRLEN] = { 0 };
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+        inet_ntop(AF_INET, &addr.sin_addr, ip, sizeof(ip));
+        std::string peer = ip;
+        lock_guard<mutex> lock(mut);
+
+        if (stopped) {
+            ::close(fd);
+            break;
+        }
+
+        reap();
+        connections.insert(fd);
+
+        try {
+            workers.push_back(thread());
+            CREATE_THREAD(workers.back(), bind(&FakeServer::connection, this, fd, peer));
+        } catch (...) {
+            workers.pop_back();
+            connections.erase(fd);
+            ::close(fd);
+        }
+    }
+}
+
+void FakeServer::connection(int fd, std::string peer) {
+    try {
+        AcceptedSocket sock(fd, peer);
+
+        try {
+            serve(sock);
+        } catch (const HdfsEndOfStream & e) {
+            /*
+             * the peer closed the connection.
+             */
+        } catch (const HdfsException & e) {
+            if (!stopped) {
+                std::string buffer;
+                LOG(DEBUG1, "FakeServer: connection from %s closed: %s", peer.c_str(),
+                    GetExceptionDetail(e, buffer));
+            }
+        }
+
+        lock_guard<mutex> lock(mut);
+        /*
+         * close under the lock so that stop() never shuts down a reused descriptor.
+         */
+        sock.close();
+        connections.erase(fd);
+        finished.push_back(get_id());
+    } catch (...) {
+    }
+}
+
+void FakeServer::reap() {
+    while (!finished.empty()) {
+        thread::id id = finished.front();
+        finished.pop_front();
+
+        for (std::list<thread>::iterator it = workers.begin(); it != workers.end(); ++it) {
+            if (it->get_id() == id) {
+                it->join();
+                workers.erase(it);
+                break;
+            }
+        }
+    }
+}
+
+int64_t Throttle::Now() {
+    return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+void Throttle::WaitUntil(int64_t until) {
+    int64_t now = Now();
+
+    if (until > now) {
+        sleep_for(microseconds(until - now));
+    }
+}
+
+int64_t Throttle::reserve(int64_t bytes, int64_t bandwidth) {
+    int64_t now = Now();
+
+    if (bandwidth <= 0 || bytes <= 0) {
+        return now;
+    }
+
+    lock_guard<mutex> lock(mut);
+    busyUntil = std::max(busyUntil, now) + bytes * 1000000 / bandwidth;
+    return busyUntil;
+}
+
+}
+}
@@ -0,0 +1,143 @@
+/********************************************************************
+ * 2014 -
+ * open source under Apache License Version 2.0
+ ********************************************************************/
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _HDFS_LIBHDFS3_FAKECLUSTER_FAKESERVER_H_
+#define _HDFS_LIBHDFS3_FAKECLUSTER_FAKESERVER_H_
+
+#include "Thread.h"
+#include "network/TcpSocket.h"
+
+#include <list>
+#include <set>
+#include <stdint.h>
+#include <string>
+
+namespace Hdfs {
+namespace Internal {
+
+/**
+ * A socket accepted by a FakeServer.
+ */
+class AcceptedSocket: public TcpSocketImpl {
+public:
+    AcceptedSocket(int fd, const std::string & peer) {
+        sock = fd;
+        remoteAddr = peer;
+    }
+};
+
+/**
+ * Accept connections on 127.0.0.1 and serve each of them in its own thread.
+ */
+class FakeServer {
+public:
+    FakeServer();
+
+    virtual ~FakeServer();
+
+    /**
+     * Bind to the given port, 0 to pick a free one, and start accepting.
+     */
+    void start(int port);
+
+    /**
+     * Close the listening socket and all connections, then wait for
+     * the serving threads.
+     */
+    void stop();
+
+    int getPort() const {
+        return port;
+    }
+
+protected:
+    /**
+     * Serve one connection until the peer closes it.
+     * Exceptions thrown by it close the connection.
+     */
+    virtual void serve(Socket & sock) = 0;
+
+    /**
+     * Sleep for the given milliseconds unless the server is stopped.
+     */
+    void delay(int ms);
+
+    bool isStopped() const {
+        return stopped;
+    }
+
+private:
+    void acceptLoop();
+    void connection(int fd, std::string peer);
+    void reap();
+
+private:
+    FakeServer(const FakeServer & other);
+    FakeServer & operator =(const FakeServer & other);
+
+    bool stopped;
+    int listenFd;
+    int port;
+    mutex mut;
+    condition_variable cond;
+    thread acceptor;
+    std::set<int> connections;
+    std::list<thread> workers;
+    std::list<thread::id> finished;
+};
+
+/**
+ * Bandwidth cap shared by all transfers of a node.
+ */
+class Throttle {
+public:
+    Throttle() :
+        busyUntil(0) {
+    }
+
+    /**
+     * Account bytes sent at the given rate.
+     * @param bandwidth bytes per second, 0 for unlimited.
+     * @return the time in microseconds on the steady clock
+     *  when the transfer completes.
+     */
+    int64_t reserve(int64_t bytes, int64_t bandwidth);
+
+    /**
+     * Block until bytes could have been sent at the given rate.
+     */
+    void consume(int64_t bytes, int64_t bandwidth) {
+        WaitUntil(reserve(bytes, bandwidth));
+    }
+
+    static int64_t Now();
+
+    static void WaitUntil(int64_t until);
+
+private:
+    mutex mut;
+    int64_t busyUntil; //microseconds on the steady clock.
+};
+
+}
+}
+
+#endif /* _HDFS_LIBHDFS3_FAKECLUSTER_FAKESERVER_H_ */
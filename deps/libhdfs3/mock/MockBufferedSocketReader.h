@@ -32,6 +32,7 @@ class MockBufferedSocketReader: public Hdfs::Internal::BufferedSocketReader {
 public:
 	MOCK_METHOD2(read, int32_t(char * b, int32_t s));
 	MOCK_METHOD3(readFully, void(char * b, int32_t s, int timeout));
+	MOCK_METHOD2(readAvailable, int32_t(char * b, int32_t s));
 	MOCK_METHOD1(readBigEndianInt32, int32_t(int timeout));
 	MOCK_METHOD1(readVarint32, int32_t(int timeout));
 	MOCK_METHOD1(poll, bool(int timeout));
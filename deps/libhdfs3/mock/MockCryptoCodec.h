@@ -33,6 +33,7 @@ public:
 
   MOCK_METHOD2(init, int(CryptoMethod crypto_method, int64_t stream_offset));
   MOCK_METHOD2(cipher_wrap, std::string(const char * buffer,int64_t size));
+  MOCK_METHOD3(crypt, void(const char * in, char * out, int64_t size));
 };
 
 #endif /* _HDFS_LIBHDFS3_MOCK_CRYPTOCODEC_H_ */
@@ -55,11 +55,14 @@ public:
   MOCK_METHOD2(mkdir, bool(const char * path, const Hdfs::Permission & permission));
   MOCK_METHOD2(mkdirs, bool(const char * path, const Hdfs::Permission & permission));
   MOCK_METHOD1(getFileStatus, Hdfs::FileStatus(const char * path));
+  MOCK_METHOD2(getFileStatusBatch, std::vector<Hdfs::FileStatus>(const std::vector<std::string> & paths,
+                                   std::vector<bool> & exist));
   MOCK_METHOD3(setOwner, void(const char * path, const char * username, const char * groupname));
   MOCK_METHOD3(setTimes, void(const char * path, int64_t mtime, int64_t atime));
   MOCK_METHOD2(setPermission, void(const char * path, const Hdfs::Permission &));
   MOCK_METHOD2(setReplication, bool(const char * path, short replication));
   MOCK_METHOD2(rename, bool(const char * src, const char * dst));
+  MOCK_METHOD2(concat, void(const char * trg, const std::vector<std::string> & srcs));
   MOCK_METHOD1(setWorkingDirectory, void(const char * path));
   MOCK_CONST_METHOD0(getWorkingDirectory, std::string());
   MOCK_METHOD1(exist, bool(const char * path));
@@ -73,9 +76,10 @@ public:
   MOCK_METHOD1(append, std::pair<Hdfs::Internal::shared_ptr<Hdfs::Internal::LocatedBlock>,
                Hdfs::Internal::shared_ptr<Hdfs::FileStatus> >(const std::string & src));
   MOCK_METHOD2(abandonBlock, void(const Hdfs::Internal::ExtendedBlock & b, const std::string & srcr));
-  MOCK_METHOD3(addBlock, Hdfs::Internal::shared_ptr<Hdfs::Internal::LocatedBlock>(const std::string & src,
+  MOCK_METHOD4(addBlock, Hdfs::Internal::shared_ptr<Hdfs::Internal::LocatedBlock>(const std::string & src,
           const Hdfs::Internal::ExtendedBlock * previous,
-          const std::vector<Hdfs::Internal::DatanodeInfo> & excludeNodes));
+          const std::vector<Hdfs::Internal::DatanodeInfo> & excludeNodes,
+          const std::vector<std::string> & favoredNodes));
   MOCK_METHOD6(getAdditionalDatanode, Hdfs::Internal::shared_ptr<Hdfs::Internal::LocatedBlock> (const std::string & src,
           const Hdfs::Internal::ExtendedBlock & blk,
           const std::vector<Hdfs::Internal::DatanodeInfo> & existings,
@@ -91,7 +95,9 @@ public:
           const std::vector<Hdfs::Internal::DatanodeInfo> & newNodes,
           const std::vector<std::string> & storageIDs));
   MOCK_CONST_METHOD0(getConf, const Hdfs::Internal::SessionConfig &());
+  MOCK_CONST_METHOD0(getSharedConf, Hdfs::Internal::shared_ptr<const Hdfs::Internal::SessionConfig>());
   MOCK_CONST_METHOD0(getUserInfo, const Hdfs::Internal::UserInfo &());
+  MOCK_CONST_METHOD0(getUri, std::string());
   MOCK_METHOD4(getBlockLocations, void(const std::string & src, int64_t offset, int64_t length, Hdfs::Internal::LocatedBlocks & lbs));
   MOCK_METHOD4(getListing, bool(const std::string & src, const std::string & , bool needLocation, std::vector<Hdfs::FileStatus> &));
   MOCK_METHOD2(listDirectory, Hdfs::DirectoryIterator(const char *, bool));
@@ -99,8 +105,10 @@ public:
   MOCK_METHOD0(registerOpenedOutputStream, void());
   MOCK_METHOD0(unregisterOpenedOutputStream, bool());
   MOCK_METHOD3(getFileBlockLocations, std::vector<Hdfs::BlockLocation> (const char * path, int64_t start, int64_t len));
+  MOCK_METHOD1(getFileChecksum, Hdfs::FileChecksum (const char * path));
   MOCK_METHOD2(listAllDirectoryItems, std::vector<Hdfs::FileStatus> (const char * path, bool needLocation));
   MOCK_METHOD0(getPeerCache, Hdfs::Internal::PeerCache &());
+  MOCK_METHOD0(getDekCache, Hdfs::Internal::DekCache &());
   MOCK_METHOD2(createEncryptionZone, bool(const char * path, const char * keyName));
   MOCK_METHOD1(getEZForPath, Hdfs::EncryptionZoneInfo(const char * path));
   MOCK_METHOD2(listEncryptionZones, bool(const int64_t id, std::vector<Hdfs::EncryptionZoneInfo> &));
@@ -30,7 +30,7 @@ using namespace Hdfs::Internal;
 
 class MockKmsClientProvider: public Hdfs::KmsClientProvider {
 public:
-    MockKmsClientProvider(shared_ptr<RpcAuth> auth, shared_ptr<SessionConfig> conf) : KmsClientProvider(auth, conf) {}
+    MockKmsClientProvider(shared_ptr<RpcAuth> auth, shared_ptr<const SessionConfig> conf) : KmsClientProvider(auth, conf) {}
     MOCK_METHOD1(setHttpClient, void(shared_ptr<HttpClient> hc));
     MOCK_METHOD1(getKeyMetadata, ptree(const FileEncryptionInfo &encryptionInfo));
     MOCK_METHOD1(deleteKey, void(const FileEncryptionInfo &encryptionInfo));
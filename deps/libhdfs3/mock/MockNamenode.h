@@ -50,9 +50,10 @@ public:
     MOCK_METHOD3(setOwner, void(const std::string & src, const std::string & username, const std::string & groupname));
     MOCK_METHOD3(abandonBlock, void(const ExtendedBlock & b, const std::string & src,
           const std::string & holder));
-    MOCK_METHOD4(addBlock, shared_ptr<LocatedBlock>(const std::string & src,
+    MOCK_METHOD5(addBlock, shared_ptr<LocatedBlock>(const std::string & src,
           const std::string & clientName, const ExtendedBlock * previous,
-          const std::vector<DatanodeInfo> & excludeNodes));
+          const std::vector<DatanodeInfo> & excludeNodes,
+          const std::vector<std::string> & favoredNodes));
     MOCK_METHOD7(getAdditionalDatanode, shared_ptr<LocatedBlock>(const std::string & src,
              const ExtendedBlock & blk,
              const std::vector<DatanodeInfo> & existings,
@@ -80,6 +81,7 @@ public:
     MOCK_METHOD1(metaSave, void(
           const std::string & filename));
     MOCK_METHOD2(getFileInfo, FileStatus(const std::string & src, bool *exist));
+    MOCK_METHOD1(getFileInfoAsync, shared_ptr<FileInfoFuture>(const std::string & src));
     MOCK_METHOD1(getFileLinkInfo, FileStatus(const std::string & src));
     MOCK_METHOD3(setQuota, void(const std::string & path, int64_t namespaceQuota,
                         int64_t diskspaceQuota));
@@ -98,10 +100,13 @@ public:
     MOCK_METHOD4(getListing, bool(const std::string & src,
                            const std::string & startAfter, bool needLocation,
                            std::vector<FileStatus> & dl));
+    MOCK_METHOD3(getListingAsync, shared_ptr<ListingFuture>(const std::string & src,
+                           const std::string & startAfter, bool needLocation));
     MOCK_METHOD2(rename, bool(const std::string & src, const std::string & dst));
     MOCK_METHOD1(getDelegationToken, Token(const std::string & renewer) );
     MOCK_METHOD1(renewDelegationToken, int64_t(const Token & token));
     MOCK_METHOD1(cancelDelegationToken, void(const Token & token));
+    MOCK_METHOD0(msync, void());
 };
 
 }
@@ -32,9 +32,12 @@ class MockRpcChannel: public Hdfs::Internal::RpcChannel {
 public:
 	MOCK_METHOD0(close, void());
 	MOCK_METHOD1(invoke, void(const Hdfs::Internal::RpcCall &));
+	MOCK_METHOD1(invokeAsync, Hdfs::Internal::RpcRemoteCallPtr(const Hdfs::Internal::RpcCall &));
+	MOCK_METHOD1(wait, void(Hdfs::Internal::RpcRemoteCallPtr));
 	MOCK_METHOD0(checkIdle, bool());
 	MOCK_METHOD0(waitForExit, void());
 	MOCK_METHOD0(addRef, void());
+	MOCK_METHOD0(getRefCount, int());
 };
 
 }
@@ -33,9 +33,9 @@ class MockRpcClient: public RpcClient {
 public:
 	MOCK_METHOD0(isRunning, bool());
 
-	MOCK_METHOD4(getChannel, RpcChannel & (const RpcAuth &,
+	MOCK_METHOD5(getChannel, RpcChannel & (const RpcAuth &,
 					const RpcProtocolInfo &, const RpcServerInfo &,
-					const RpcConfig &));
+					const RpcConfig &, bool));
 
 	MOCK_CONST_METHOD0(getClientId, std::string());
 
@@ -33,6 +33,8 @@ public:
 
 	MOCK_METHOD3(readFully, void(char * buffer, int32_t size, int timeout));
 
+	MOCK_METHOD2(readAvailable, int32_t(char * buffer, int32_t size));
+
 	MOCK_METHOD2(write, int32_t(const char * buffer, int32_t size));
 
 	MOCK_METHOD3(writeFully, void(const char * buffer, int32_t size, int timeout));
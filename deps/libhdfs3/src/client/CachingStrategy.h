@@ -0,0 +1,97 @@
+/********************************************************************
+ * 2014 -
+ * open source under Apache License Version 2.0
+ ********************************************************************/
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _HDFS_LIBHDFS3_CLIENT_CACHINGSTRATEGY_H_
+#define _HDFS_LIBHDFS3_CLIENT_CACHINGSTRATEGY_H_
+
+#include <stdint.h>
+
+namespace Hdfs {
+
+/**
+ * Page cache hints sent to the datanodes serving a stream.
+ * A hint which is not set leaves the choice to the datanode.
+ */
+class CachingStrategy {
+public:
+    /**
+     * To construct a CachingStrategy without any hint.
+     */
+    CachingStrategy() :
+        dropBehind(-1), readahead(-1) {
+    }
+
+    /**
+     * To construct a CachingStrategy with given hints.
+     * @param dropBehind 1 to drop the block data from the page cache
+     *  once it is transferred, 0 to keep it, -1 for no hint.
+     * @param readahead the bytes the datanode reads ahead, -1 for no hint.
+     */
+    CachingStrategy(int dropBehind, int64_t readahead) :
+        dropBehind(dropBehind < 0 ? -1 : dropBehind > 0), readahead(readahead < 0 ? -1 : readahead) {
+    }
+
+    bool hasDropBehind() const {
+        return dropBehind >= 0;
+    }
+
+    bool getDropBehind() const {
+        return dropBehind > 0;
+    }
+
+    void setDropBehind(bool dropBehind) {
+        this->dropBehind = dropBehind;
+    }
+
+    bool hasReadahead() const {
+        return readahead >= 0;
+    }
+
+    int64_t getReadahead() const {
+        return readahead;
+    }
+
+    void setReadahead(int64_t readahead) {
+        this->readahead = readahead < 0 ? -1 : readahead;
+    }
+
+    /**
+     * Override the hints of this strategy with the ones set in other.
+     * @param other the hints to apply.
+     */
+    void merge(const CachingStrategy & other) {
+        if (other.hasDropBehind()) {
+            dropBehind = other.dropBehind;
+        }
+
+        if (other.hasReadahead()) {
+            readahead = other.readahead;
+        }
+    }
+
+private:
+    int dropBehind;
+    int64_t readahead;
+};
+
+}
+
+#endif /* _HDFS_LIBHDFS3_CLIENT_CACHINGSTRATEGY_H_ */
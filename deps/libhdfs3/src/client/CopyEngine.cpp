@@ -0,0 +1,562 @@
+/********************************************************************
+ * 2014 -
+ * open source under Apache License Version 2.0
+ ********************************************************************/
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "CopyEngine.h"
+#include "DirectoryIterator.h"
+#include "Exception.h"
+#include "ExceptionInternal.h"
+#include "InputStreamImpl.h"
+#include "Logger.h"
+#include "OutputStream.h"
+#include "OutputStreamImpl.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <sstream>
+
+namespace Hdfs {
+namespace Internal {
+
+static const char * const CopyingSuffix = "._COPYING_";
+static const char * const ReplacedSuffix = "._REPLACED_";
+
+static std::string ChildOf(const std::string & dir, const std::string & name) {
+    return dir == "/" ? dir + name : dir + "/" + name;
+}
+
+static std::string NameOf(const std::string & path) {
+    return path.substr(path.find_last_of('/') + 1);
+}
+
+/*
+ * A file being copied, as parts of whole blocks written to temporary
+ * files in the destination directory which are concatenated into the first.
+ */
+struct CopyEngine::CopyFile {
+    CopyFile(const std::string & src, const FileStatus & status, const std::string & dst) :
+        failed(false), parts(1), remaining(1), replication(0), blockSize(0), partSize(0),
+        src(src), dst(dst), tmp(dst + CopyingSuffix), status(status) {
+    }
+
+    std::string partPath(int part) const {
+        if (part == 0) {
+            return tmp;
+        }
+
+        std::ostringstream ss;
+        ss << tmp << ".part" << part;
+        return ss.str();
+    }
+
+    bool failed; //a part was not written.
+    int parts;
+    int remaining; //parts not done yet.
+    int replication;
+    int64_t blockSize;
+    int64_t partSize;
+    std::string src;
+    std::string dst;
+    std::string tmp;
+    FileStatus status;
+};
+
+CopyEngine::CopyEngine(shared_ptr<FileSystemInter> src, shared_ptr<FileSystemInter> dst,
+                       const CopyOptions & options) :
+    failed(false), pending(0), maxPending(0), options(options), srcFs(src), dstFs(dst),
+    executor(std::max(1, options.getParallelism())) {
+    if (options.getParallelism() <= 0) {
+        THROW(InvalidParameter, "Invalid input: parallelism should be positive.");
+    }
+
+    if (options.getBufferSize() <= 0 || options.getBufferSize() > std::numeric_limits<int32_t>::max()) {
+        THROW(InvalidParameter, "Invalid input: buffer size should be positive and less than 2GB.");
+    }
+
+    if (options.getBlocksPerPart() < 0) {
+        THROW(InvalidParameter, "Invalid input: blocks per part should not be negative.");
+    }
+
+    /*
+     * list ahead of the copies only so far, a tree may have millions of files.
+     */
+    maxPending = 4 * options.getParallelism();
+}
+
+CopyProgress CopyEngine::copyTree(const char * src, const char * dst) {
+    if (NULL == src || !strlen(src)) {
+        THROW(InvalidParameter, "Invalid input: src should not be empty");
+    }
+
+    if (NULL == dst || !strlen(dst)) {
+        THROW(InvalidParameter, "Invalid input: dst should not be empty");
+    }
+
+    std::string srcPath = srcFs->getStandardPath(src);
+    std::string dstPath = dstFs->getStandardPath(dst);
+
+    /*
+     * two handles of the same cluster are the same filesystem as well.
+     */
+    bool sameCluster = srcFs == dstFs || srcFs->getUri() == dstFs->getUri();
+
+    if (sameCluster && (srcPath == dstPath || dstPath.compare(0, srcPath.size() + 1, ChildOf(srcPath, "")) == 0)) {
+        THROW(InvalidParameter, "Invalid input: cannot copy %s into itself at %s.", srcPath.c_str(), dstPath.c_str());
+    }
+
+    try {
+        FileStatus status = srcFs->getFileStatus(srcPath.c_str());
+
+        if (status.isDirectory()) {
+            walk(srcPath, status, dstPath);
+        } else {
+            try {
+                if (dstFs->getFileStatus(dstPath.c_str()).isDirectory()) {
+                    dstPath = ChildOf(dstPath, NameOf(srcPath));
+                }
+            } catch (const FileNotFoundException & e) {
+            }
+
+            schedule(srcPath, status, dstPath);
+        }
+    } catch (...) {
+        lock_guard<mutex> lock(mut);
+        failed = true;
+
+        if (!error) {
+            error = current_exception();
+        }
+    }
+
+    {
+        /*
+         * the tasks use this object, wait for them even if listing failed.
+         */
+        unique_lock<mutex> lock(mut);
+
+        while (pending > 0) {
+            cond.wait(lock);
+        }
+    }
+
+    if (error) {
+        rethrow_exception(error);
+    }
+
+    /*
+     * writing the files changed the times of the directories, set the
+     * attributes of the deepest ones first.
+     */
+    for (size_t i = dirs.size(); i > 0; --i) {
+        preserveAttributes(dirs[i - 1].first, dirs[i - 1].second);
+    }
+
+    lock_guard<mutex> lock(mut);
+    return progress;
+}
+
+void CopyEngine::walk(const std::string & src, const FileStatus & status, const std::string & dst) {
+    try {
+        if (!dstFs->getFileStatus(dst.c_str()).isDirectory()) {
+            THROW(HdfsIOException, "CopyEngine: cannot copy directory %s to %s, it is a file.",
+                  src.c_str(), dst.c_str());
+        }
+    } catch (const FileNotFoundException & e) {
+        dstFs->mkdirs(dst.c_str(), Permission(0755));
+    }
+
+    dirs.push_back(std::make_pair(status, dst));
+    DirectoryIterator it = srcFs->listDirectory(src.c_str(), false);
+
+    while (!isFailed() && it.hasNext()) {
+        FileStatus child = it.getNext();
+        std::string name = NameOf(child.getPath());
+
+        if (child.isSymlink()) {
+            LOG(INFO, "CopyEngine: skip symlink %s.", ChildOf(src, name).c_str());
+        } else if (child.isDirectory()) {
+            walk(ChildOf(src, name), child, ChildOf(dst, name));
+        } else {
+            schedule(ChildOf(src, name), child, ChildOf(dst, name));
+        }
+    }
+}
+
+void CopyEngine::schedule(const std::string & src, const FileStatus & status, const std::string & dst) {
+    shared_ptr<CopyFile> file(new CopyFile(src, status, dst));
+    file->replication = options.getPreserve() & CopyOptions::PreserveReplication ? status.getReplication() : 0;
+    file->blockSize = options.getPreserve() & CopyOptions::PreserveBlockSize ?
+                      status.getBlockSize() : dstFs->getDefaultBlockSize();
+    file->partSize = file->blockSize * options.getBlocksPerPart();
+
+    if (file->partSize > 0 && status.getLength() > file->partSize) {
+        file->parts = static_cast<int>((status.getLength() + file->partSize - 1) / file->partSize);
+        file->remaining = file->parts;
+    }
+
+    {
+        unique_lock<mutex> lock(mut);
+
+        while (!failed && pending >= maxPending) {
+            cond.wait(lock);
+        }
+
+        if (failed) {
+            return;
+        }
+
+        ++pending;
+        progress.setFiles(progress.getFiles() + 1);
+        progress.setBytes(progress.getBytes() + status.getLength());
+    }
+
+    executor.submit(NULL, bind(&CopyEngine::copyFile, this, file));
+}
+
+void CopyEngine::copyFile(shared_ptr<CopyFile> file) {
+    try {
+        if (isFailed()) {
+            taskDone();
+            return;
+        }
+
+        if (options.isSkipIfChecksumMatches() && sameChecksum(*file)) {
+            LOG(DEBUG1, "CopyEngine: skip %s, %s has the same checksum.", file->src.c_str(), file->dst.c_str());
+            addProgress(0, 1, 0, file->status.getLength());
+            taskDone();
+            return;
+        }
+
+        if (file->parts > 1) {
+            {
+                lock_guard<mutex> lock(mut);
+                pending += file->parts - 1;
+            }
+
+            for (int i = 1; i < file->parts; ++i) {
+                executor.submit(NULL, bind(&CopyEngine::copyPart, this, file, i));
+            }
+        }
+    } catch (...) {
+        fail(file->src, file->dst);
+        taskDone();
+        return;
+    }
+
+    copyPart(file, 0);
+}
+
+void CopyEngine::copyPart(shared_ptr<CopyFile> file, int part) {
+    bool written = false;
+
+    try {
+        written = !isFailed() && copyRange(*file, part);
+    } catch (...) {
+        fail(file->src, file->dst);
+    }
+
+    finishPart(file, !written);
+    taskDone();
+}
+
+bool CopyEngine::copyRange(CopyFile & file, int part) {
+    int64_t offset = file.partSize * part;
+    int64_t todo = file.parts > 1 ? std::min(file.partSize, file.status.getLength() - offset) :
+                   file.status.getLength();
+    Permission permission = options.getPreserve() & CopyOptions::PreservePermission ?
+                            file.status.getPermission() : Permission(0644);
+    shared_ptr<std::vector<char> > buffer = acquireBuffer();
+
+    try {
+        InputStreamImpl in;
+        OutputStreamImpl out;
+        in.open(srcFs, file.src.c_str(), true);
+
+        if (offset > 0) {
+            in.seek(offset);
+        }
+
+        out.open(dstFs, file.partPath(part).c_str(), Create | Overwrite, permission, true,
+                 file.replication, file.blockSize);
+
+        while (todo > 0 && !isFailed()) {
+            int64_t size = std::min(todo, static_cast<int64_t>(buffer->size()));
+            in.readFully(&(*buffer)[0], size);
+            out.append(&(*buffer)[0], size);
+            todo -= size;
+            addProgress(0, 0, size, 0);
+        }
+
+        out.close();
+        in.close();
+    } catch (...) {
+        releaseBuffer(buffer);
+        throw;
+    }
+
+    releaseBuffer(buffer);
+    return todo == 0;
+}
+
+/*
+ * the last part of a file to finish commits it, or cleans up.
+ */
+void CopyEngine::finishPart(shared_ptr<CopyFile> file, bool aborted) {
+    {
+        lock_guard<mutex> lock(mut);
+        file->failed = file->failed || aborted;
+
+        if (--file->remaining > 0) {
+            return;
+        }
+    }
+
+    if (file->failed) {
+        removeTemporaries(*file);
+        return;
+    }
+
+    try {
+        commit(*file);
+        addProgress(1, 0, 0, 0);
+    } catch (...) {
+        fail(file->src, file->dst);
+        removeTemporaries(*file);
+    }
+}
+
+void CopyEngine::commit(const CopyFile & file) {
+    if (file.parts > 1) {
+        std::vector<std::string> parts;
+
+        for (int i = 1; i < file.parts; ++i) {
+            parts.push_back(file.partPath(i));
+        }
+
+        dstFs->concat(file.tmp.c_str(), parts);
+    }
+
+    /*
+     * an existing file is moved aside and only deleted once the copy took
+     * its place, so a failure never loses both.
+     */
+    std::string aside = file.dst + ReplacedSuffix;
+    bool replaced = false;
+
+    try {
+        if (dstFs->getFileStatus(file.dst.c_str()).isDirectory()) {
+            THROW(HdfsIOException, "CopyEngine: cannot copy file %s to %s, it is a directory.",
+                  file.src.c_str(), file.dst.c_str());
+        }
+
+        try {
+            /*
+             * left behind by a copy which failed after replacing the file.
+             */
+            dstFs->deletePath(aside.c_str(), false);
+        } catch (const FileNotFoundException & e) {
+        }
+
+        if (!dstFs->rename(file.dst.c_str(), aside.c_str())) {
+            THROW(HdfsIOException, "CopyEngine: cannot move %s aside to %s.", file.dst.c_str(), aside.c_str());
+        }
+
+        replaced = true;
+    } catch (const FileNotFoundException & e) {
+    }
+
+    try {
+        if (!dstFs->rename(file.tmp.c_str(), file.dst.c_str())) {
+            THROW(HdfsIOException, "CopyEngine: cannot rename %s to %s.", file.tmp.c_str(), file.dst.c_str());
+        }
+    } catch (...) {
+        if (replaced) {
+            restoreReplaced(aside, file.dst);
+        }
+
+        throw;
+    }
+
+    if (replaced) {
+        try {
+            dstFs->deletePath(aside.c_str(), false);
+        } catch (const HdfsException & e) {
+            std::string buffer;
+            LOG(WARNING, "CopyEngine: cannot remove the replaced file %s.\n%s", aside.c_str(),
+                GetExceptionDetail(e, buffer));
+        }
+    }
+
+    preserveAttributes(file.status, file.dst);
+}
+
+/*
+ * move the file replaced by a failed copy back, called in a catch block.
+ */
+void CopyEngine::restoreReplaced(const std::string & aside, const std::string & dst) {
+    try {
+        if (dstFs->rename(aside.c_str(), dst.c_str())) {
+            return;
+        }
+    } catch (const HdfsException & e) {
+        std::string buffer;
+        LOG(WARNING, "CopyEngine: cannot move %s back to %s.\n%s", aside.c_str(), dst.c_str(),
+            GetExceptionDetail(e, buffer));
+        return;
+    }
+
+    LOG(WARNING, "CopyEngine: cannot move %s back to %s, the file is kept there.", aside.c_str(), dst.c_str());
+}
+
+void CopyEngine::preserveAttributes(const FileStatus & status, const std::string & dst) {
+    int preserve = options.getPreserve();
+
+    if (preserve & CopyOptions::PreservePermission) {
+        dstFs->setPermission(dst.c_str(), status.getPermission());
+    }
+
+    if (preserve & CopyOptions::PreserveOwner) {
+        dstFs->setOwner(dst.c_str(), status.getOwner(), status.getGroup());
+    }
+
+    if (preserve & CopyOptions::PreserveTimes) {
+        dstFs->setTimes(dst.c_str(), status.getModificationTime(), status.getAccessTime());
+    }
+}
+
+bool CopyEngine::sameChecksum(const CopyFile & file) {
+    try {
+        FileStatus status = dstFs->getFileStatus(file.dst.c_str());
+
+        if (status.isDirectory() || status.getLength() != file.status.getLength()) {
+            return false;
+        }
+    } catch (const FileNotFoundException & e) {
+        return false;
+    }
+
+    FileChecksum srcChecksum = srcFs->getFileChecksum(file.src.c_str());
+    FileChecksum dstChecksum = dstFs->getFileChecksum(file.dst.c_str());
+    return srcChecksum.getAlgorithmName() == dstChecksum.getAlgorithmName()
+           && srcChecksum.getBytes() == dstChecksum.getBytes();
+}
+
+void CopyEngine::removeTemporaries(const CopyFile & file) {
+    for (int i = 0; i < file.parts; ++i) {
+        try {
+            dstFs->deletePath(file.partPath(i).c_str(), false);
+        } catch (const HdfsException & e) {
+            std::string buffer;
+            LOG(INFO, "CopyEngine: cannot remove temporary file %s.\n%s", file.partPath(i).c_str(),
+                GetExceptionDetail(e, buffer));
+        }
+    }
+}
+
+/*
+ * record the first failure, called in a catch block.
+ */
+void CopyEngine::fail(const std::string & src, const std::string & dst) {
+    exception_ptr e;
+
+    try {
+        NESTED_THROW(HdfsIOException, "CopyEngine: cannot copy %s to %s.", src.c_str(), dst.c_str());
+    } catch (...) {
+        e = current_exception();
+    }
+
+    std::string buffer;
+    LOG(LOG_ERROR, "%s", GetExceptionDetail(e, buffer));
+    lock_guard<mutex> lock(mut);
+    failed = true;
+
+    if (!error) {
+        error = e;
+    }
+
+    cond.notify_all();
+}
+
+bool CopyEngine::isFailed() {
+    lock_guard<mutex> lock(mut);
+    return failed;
+}
+
+void CopyEngine::taskDone() {
+    lock_guard<mutex> lock(mut);
+    --pending;
+    cond.notify_all();
+}
+
+void CopyEngine::addProgress(int64_t filesCopied, int64_t filesSkipped, int64_t bytesCopied,
+                             int64_t bytesSkipped) {
+    {
+        lock_guard<mutex> lock(mut);
+        progress.setFilesCopied(progress.getFilesCopied() + filesCopied);
+        progress.setFilesSkipped(progress.getFilesSkipped() + filesSkipped);
+        progress.setBytesCopied(progress.getBytesCopied() + bytesCopied);
+        progress.setBytesSkipped(progress.getBytesSkipped() + bytesSkipped);
+    }
+
+    report();
+}
+
+void CopyEngine::report() {
+    CopyProgressCallback callback = options.getProgressCallback();
+
+    if (!callback) {
+        return;
+    }
+
+    /*
+     * take the snapshot under reportMut so the callback never sees the
+     * counters go back.
+     */
+    lock_guard<mutex> reportLock(reportMut);
+    CopyProgress snapshot;
+    {
+        lock_guard<mutex> lock(mut);
+        snapshot = progress;
+    }
+    callback(snapshot, options.getProgressData());
+}
+
+shared_ptr<std::vector<char> > CopyEngine::acquireBuffer() {
+    {
+        lock_guard<mutex> lock(mut);
+
+        if (!buffers.empty()) {
+            shared_ptr<std::vector<char> > buffer = buffers.back();
+            buffers.pop_back();
+            return buffer;
+        }
+    }
+
+    return shared_ptr<std::vector<char> >(new std::vector<char>(options.getBufferSize()));
+}
+
+void CopyEngine::releaseBuffer(shared_ptr<std::vector<char> > buffer) {
+    lock_guard<mutex> lock(mut);
+    buffers.push_back(buffer);
+}
+
+}
+}
@@ -0,0 +1,118 @@
+/********************************************************************
+ * 2014 -
+ * open source under Apache License Version 2.0
+ ********************************************************************/
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _HDFS_LIBHDFS3_CLIENT_COPYENGINE_H_
+#define _HDFS_LIBHDFS3_CLIENT_COPYENGINE_H_
+
+#include "AsyncExecutor.h"
+#include "CopyOptions.h"
+#include "ExceptionInternal.h"
+#include "FileStatus.h"
+#include "FileSystemInter.h"
+#include "Memory.h"
+#include "Thread.h"
+
+#include <string>
+#include <vector>
+
+namespace Hdfs {
+namespace Internal {
+
+/**
+ * Copy a tree from one file system to another, or within one.
+ *
+ * The source tree is listed on the calling thread while the files are
+ * copied by a pool of CopyOptions::getParallelism() threads, straight from
+ * an InputStreamImpl into an OutputStreamImpl through buffers the threads
+ * reuse. A file is written to a temporary file next to the destination and
+ * renamed over it when complete. Files of more than
+ * CopyOptions::getBlocksPerPart() blocks are split into parts of whole
+ * blocks which are copied in parallel and concatenated.
+ */
+class CopyEngine {
+public:
+    /**
+     * Construct a CopyEngine.
+     * @param src the file system to copy from.
+     * @param dst the file system to copy to, may be src.
+     * @param options how to copy.
+     */
+    CopyEngine(shared_ptr<FileSystemInter> src, shared_ptr<FileSystemInter> dst,
+               const CopyOptions & options);
+
+    /**
+     * Copy a file or a directory tree. A directory is mirrored, src/x is
+     * copied to dst/x, and existing destination files are replaced.
+     * A file copied to an existing directory goes into it.
+     * @param src the file or directory to copy.
+     * @param dst the path of the copy.
+     * @return the counters of the copy.
+     * @throw HdfsIOException the first file which failed, the files being
+     *  copied at that time are finished first and no more are started.
+     */
+    CopyProgress copyTree(const char * src, const char * dst);
+
+private:
+    struct CopyFile;
+
+    void walk(const std::string & src, const FileStatus & status, const std::string & dst);
+    void schedule(const std::string & src, const FileStatus & status, const std::string & dst);
+    void copyFile(shared_ptr<CopyFile> file);
+    void copyPart(shared_ptr<CopyFile> file, int part);
+    bool copyRange(CopyFile & file, int part);
+    void finishPart(shared_ptr<CopyFile> file, bool aborted);
+    void commit(const CopyFile & file);
+    bool isFailed();
+    void preserveAttributes(const FileStatus & status, const std::string & dst);
+    bool sameChecksum(const CopyFile & file);
+    void removeTemporaries(const CopyFile & file);
+    void restoreReplaced(const std::string & aside, const std::string & dst);
+    void fail(const std::string & src, const std::string & dst);
+    void taskDone();
+    void addProgress(int64_t filesCopied, int64_t filesSkipped, int64_t bytesCopied, int64_t bytesSkipped);
+    void report();
+    shared_ptr<std::vector<char> > acquireBuffer();
+    void releaseBuffer(shared_ptr<std::vector<char> > buffer);
+
+private:
+    CopyEngine(const CopyEngine & other);
+    CopyEngine & operator =(const CopyEngine & other);
+
+    bool failed;
+    size_t pending; //tasks submitted and not done yet.
+    size_t maxPending;
+    condition_variable cond;
+    exception_ptr error;
+    mutex mut;
+    mutex reportMut;
+    CopyOptions options;
+    CopyProgress progress;
+    shared_ptr<FileSystemInter> srcFs;
+    shared_ptr<FileSystemInter> dstFs;
+    std::vector<shared_ptr<std::vector<char> > > buffers;
+    std::vector<std::pair<FileStatus, std::string> > dirs; //directories to preserve the attributes of.
+    AsyncExecutor executor;
+};
+
+}
+}
+
+#endif /* _HDFS_LIBHDFS3_CLIENT_COPYENGINE_H_ */
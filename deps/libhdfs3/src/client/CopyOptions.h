@@ -0,0 +1,236 @@
+/********************************************************************
+ * 2014 -
+ * open source under Apache License Version 2.0
+ ********************************************************************/
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _HDFS_LIBHDFS3_CLIENT_COPYOPTIONS_H_
+#define _HDFS_LIBHDFS3_CLIENT_COPYOPTIONS_H_
+
+#include <stdint.h>
+
+namespace Hdfs {
+
+/**
+ * The counters of a FileSystem::copyTree, files and bytes grow as the
+ * source tree is listed.
+ */
+class CopyProgress {
+public:
+    CopyProgress() :
+        files(0), filesCopied(0), filesSkipped(0), bytes(0), bytesCopied(0), bytesSkipped(0) {
+    }
+
+    /**
+     * The number of files found so far.
+     */
+    int64_t getFiles() const {
+        return files;
+    }
+
+    void setFiles(int64_t files) {
+        this->files = files;
+    }
+
+    /**
+     * The number of files written to the destination.
+     */
+    int64_t getFilesCopied() const {
+        return filesCopied;
+    }
+
+    void setFilesCopied(int64_t filesCopied) {
+        this->filesCopied = filesCopied;
+    }
+
+    /**
+     * The number of files left alone because the destination has the same checksum.
+     */
+    int64_t getFilesSkipped() const {
+        return filesSkipped;
+    }
+
+    void setFilesSkipped(int64_t filesSkipped) {
+        this->filesSkipped = filesSkipped;
+    }
+
+    /**
+     * The length of the files found so far.
+     */
+    int64_t getBytes() const {
+        return bytes;
+    }
+
+    void setBytes(int64_t bytes) {
+        this->bytes = bytes;
+    }
+
+    /**
+     * The bytes written to the destination, including the parts of files
+     * still being copied.
+     */
+    int64_t getBytesCopied() const {
+        return bytesCopied;
+    }
+
+    void setBytesCopied(int64_t bytesCopied) {
+        this->bytesCopied = bytesCopied;
+    }
+
+    /**
+     * The length of the skipped files.
+     */
+    int64_t getBytesSkipped() const {
+        return bytesSkipped;
+    }
+
+    void setBytesSkipped(int64_t bytesSkipped) {
+        this->bytesSkipped = bytesSkipped;
+    }
+
+private:
+    int64_t files;
+    int64_t filesCopied;
+    int64_t filesSkipped;
+    int64_t bytes;
+    int64_t bytesCopied;
+    int64_t bytesSkipped;
+};
+
+/**
+ * Called with the counters of a copy as it advances, from the threads
+ * doing the copy but one call at a time. It should return quickly.
+ */
+typedef void (*CopyProgressCallback)(const CopyProgress & progress, void * data);
+
+/**
+ * How FileSystem::copyTree copies a tree.
+ */
+class CopyOptions {
+public:
+    /**
+     * The attributes of the source files the copies get.
+     */
+    enum Preserve {
+        PreserveReplication = 0x01,
+        PreserveBlockSize = 0x02,
+        PreservePermission = 0x04,
+        PreserveOwner = 0x08,
+        PreserveTimes = 0x10,
+        PreserveAll = 0x1F
+    };
+
+    /**
+     * To construct the default options, 8 files or parts at once with
+     * 8MB buffers, files of more than 8 blocks are split, the block size
+     * is preserved.
+     */
+    CopyOptions() :
+        skipIfChecksumMatches(false), parallelism(8), preserve(PreserveBlockSize), bufferSize(8 * 1024 * 1024),
+        blocksPerPart(8), progress(0), progressData(0) {
+    }
+
+    /**
+     * The number of files or parts of files copied at once.
+     */
+    int getParallelism() const {
+        return parallelism;
+    }
+
+    void setParallelism(int parallelism) {
+        this->parallelism = parallelism;
+    }
+
+    /**
+     * Leave destination files alone which have the length and the checksum
+     * of the source. The checksums only match with the same block size,
+     * see PreserveBlockSize.
+     */
+    bool isSkipIfChecksumMatches() const {
+        return skipIfChecksumMatches;
+    }
+
+    void setSkipIfChecksumMatches(bool skipIfChecksumMatches) {
+        this->skipIfChecksumMatches = skipIfChecksumMatches;
+    }
+
+    /**
+     * The Preserve flags.
+     */
+    int getPreserve() const {
+        return preserve;
+    }
+
+    void setPreserve(int preserve) {
+        this->preserve = preserve;
+    }
+
+    /**
+     * The size of the buffers data is moved through, one per thread.
+     */
+    int64_t getBufferSize() const {
+        return bufferSize;
+    }
+
+    void setBufferSize(int64_t bufferSize) {
+        this->bufferSize = bufferSize;
+    }
+
+    /**
+     * Files of more blocks are copied as parts of this many blocks at once,
+     * which are concatenated when all are written. 0 copies every file as a whole.
+     */
+    int getBlocksPerPart() const {
+        return blocksPerPart;
+    }
+
+    void setBlocksPerPart(int blocksPerPart) {
+        this->blocksPerPart = blocksPerPart;
+    }
+
+    CopyProgressCallback getProgressCallback() const {
+        return progress;
+    }
+
+    void * getProgressData() const {
+        return progressData;
+    }
+
+    /**
+     * To report the counters after every buffer written and file done.
+     * @param progress the callback, NULL for none.
+     * @param data passed to the callback.
+     */
+    void setProgressCallback(CopyProgressCallback progress, void * data) {
+        this->progress = progress;
+        this->progressData = data;
+    }
+
+private:
+    bool skipIfChecksumMatches;
+    int parallelism;
+    int preserve;
+    int64_t bufferSize;
+    int blocksPerPart;
+    CopyProgressCallback progress;
+    void * progressData;
+};
+
+}
+
+#endif /* _HDFS_LIBHDFS3_CLIENT_COPYOPTIONS_H_ */
@@ -21,13 +21,35 @@
  */
 
 #include "CryptoCodec.h"
+#include "AsyncExecutor.h"
 #include "Logger.h"
 
+#include <algorithm>
+#include <inttypes.h>
+#include <unistd.h>
+
 using namespace Hdfs::Internal;
 
 
 namespace Hdfs {
 
+	/*
+	 * Segments of a parallel encrypt/decrypt are never smaller than this.
+	 */
+	static const int64_t MinSegmentSize = 64 * 1024;
+
+	/*
+	 * Threads running the segments of large buffers, the calling thread
+	 * always runs the first segment itself. Never destroyed.
+	 */
+	static AsyncExecutor & CryptoExecutor(int threads) {
+		static AsyncExecutor * executor = new AsyncExecutor(0);
+		if (executor->getThreads() < threads) {
+			executor->setThreads(threads);
+		}
+		return *executor;
+	}
+
 	//copy from java HDFS code
 	std::string CryptoCodec::calculateIV(const std::string& initIV, unsigned long counter) {
 		char IV[initIV.length()];
@@ -48,8 +70,10 @@ namespace Hdfs {
 		return std::string(IV, initIV.length());
 	}
 
-	CryptoCodec::CryptoCodec(FileEncryptionInfo *encryptionInfo, shared_ptr<KmsClientProvider> kcp, int32_t bufSize) :
-		encryptionInfo(encryptionInfo), kcp(kcp), bufSize(bufSize)
+	CryptoCodec::CryptoCodec(FileEncryptionInfo *encryptionInfo, shared_ptr<KmsClientProvider> kcp, int32_t bufSize,
+			DekCache *dekCache) :
+		encryptionInfo(encryptionInfo), kcp(kcp), dekCache(dekCache), bufSize(bufSize),
+		parallelThreads(1), parallelMinSize(0)
 	{
 
 		// Init global status
@@ -61,8 +85,8 @@ namespace Hdfs {
 		cipherCtx = EVP_CIPHER_CTX_new();
 		cipher = NULL;
 
-		padding = 0;
-		counter = 0;
+		streamOffset = 0;
+		method = CryptoMethod::DECRYPT;
 		is_init = false;
 	}
 
@@ -74,6 +98,11 @@ namespace Hdfs {
 
 	std::string CryptoCodec::getDecryptedKeyFromKms()
 	{
+		std::string cached;
+		if (dekCache && dekCache->get(*encryptionInfo, &cached)) {
+			return cached;
+		}
+
 		ptree map = kcp->decryptEncryptedKey(*encryptionInfo);
 		std::string key;
 		try {
@@ -97,6 +126,9 @@ namespace Hdfs {
 		LOG(DEBUG3, "CryptoCodec : getDecryptedKeyFromKms material is :%s", key.c_str());
 
 		key = KmsClientProvider::base64Decode(key);
+		if (dekCache) {
+			dekCache->put(*encryptionInfo, key);
+		}
 		return key;
 	}
 
@@ -135,82 +167,191 @@ namespace Hdfs {
 		// Check CryptoCodec init or not.
 		if (is_init == false)
 			return -1;
-		// Calculate new IV when appending an existed file.
+
+		method = crypto_method;
+		if (!initContext(cipherCtx, stream_offset)) {
+			return -1;
+		}
+
+		streamOffset = stream_offset;
+		return 1;
+	}
+
+	bool CryptoCodec::initContext(EVP_CIPHER_CTX * ctx, int64_t stream_offset) {
+		// Calculate new IV when the stream does not start at offset 0.
 		std::string iv = encryptionInfo->getIv();
+		int64_t padding = stream_offset % AES_CTR_BLOCK_SIZE;
 		if (stream_offset > 0) {
-			counter = stream_offset / AlgorithmBlockSize;
-			padding = stream_offset % AlgorithmBlockSize;
-			iv = this->calculateIV(iv, counter);
+			iv = this->calculateIV(iv, stream_offset / AES_CTR_BLOCK_SIZE);
 		}
 
 		// Judge the crypto method is encrypt or decrypt.
 		int enc = (method == CryptoMethod::ENCRYPT) ? 1 : 0;
 
 		// Init cipher context with cipher method.
-		if (!EVP_CipherInit_ex(cipherCtx, cipher, NULL,
+		if (!EVP_CipherInit_ex(ctx, cipher, NULL,
 				(const unsigned char *) decryptedKey.c_str(), (const unsigned char *) iv.c_str(),
 				enc)) {
 			LOG(WARNING, "EVP_CipherInit_ex failed");
-			return -1;
+			return false;
 		}
 
 		// AES/CTR/NoPadding, set padding to 0.
-		EVP_CIPHER_CTX_set_padding(cipherCtx, 0);
+		EVP_CIPHER_CTX_set_padding(ctx, 0);
 
-		return 1;
+		// Skip the key stream of the bytes before the offset in its block.
+		if (padding > 0) {
+			unsigned char skip[AES_CTR_BLOCK_SIZE] = { 0 };
+			int len = 0;
+			if (!EVP_CipherUpdate(ctx, skip, &len, skip, padding)) {
+				LOG(WARNING, "EVP_CipherUpdate failed");
+				return false;
+			}
+		}
+
+		return true;
 	}
 
-	std::string CryptoCodec::cipher_wrap(const char * buffer, int64_t size) {
-		if (!is_init)
-			THROW(InvalidParameter, "CryptoCodec isn't init");
+	void CryptoCodec::setParallel(int32_t threads, int32_t minSize) {
+		// More threads than processors only adds hand off cost.
+		long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		if (cpus > 0 && threads > cpus) {
+			threads = static_cast<int32_t>(cpus);
+		}
+		parallelThreads = threads < 1 ? 1 : threads;
+		parallelMinSize = minSize;
+	}
 
-		int offset = 0;
-		int remaining = size;
+	void CryptoCodec::update(EVP_CIPHER_CTX * ctx, const char * in, char * out, int64_t size) {
+		int64_t offset = 0;
 		int len = 0;
-		int ret = 0;
-
-		std::string in_buf(buffer,size);
-		std::string out_buf(size, 0);
-		//set necessary padding when appending a existed file
-		if (padding > 0) {
-			in_buf.insert(0, padding, 0);
-			out_buf.resize(padding+size);
-			remaining += padding;
-		}
 
 		// If the encode/decode buffer size larger than crypto buffer size, encode/decode buffer one by one
-		while (remaining > bufSize) {
-			ret = EVP_CipherUpdate(cipherCtx, (unsigned char *) &out_buf[offset], &len, 
-				(const unsigned char *)in_buf.data() + offset, bufSize);
+		while (offset < size) {
+			int batch = static_cast<int>(std::min<int64_t>(size - offset, bufSize > 0 ? bufSize : size));
 
-			if (!ret) {
+			if (!EVP_CipherUpdate(ctx, (unsigned char *) out + offset, &len,
+					(const unsigned char *) in + offset, batch)) {
 				std::string err = ERR_lib_error_string(ERR_get_error());
-				THROW(HdfsIOException, "CryptoCodec : cipher_wrap AES data failed:%s, crypto_method:%d", err.c_str(), method);
+				THROW(HdfsIOException, "CryptoCodec : cipher AES data failed:%s, crypto_method:%d", err.c_str(), method);
 			}
+
 			offset += len;
-			remaining -= len;
-			LOG(DEBUG3, "CryptoCodec : EVP_CipherUpdate successfully, len:%d", len);
 		}
+	}
 
-		if (remaining) {
-			ret = EVP_CipherUpdate(cipherCtx, (unsigned char *) &out_buf[offset], &len,
-				(const unsigned char *) in_buf.data() + offset, remaining);
+	void CryptoCodec::crypt(const char * in, char * out, int64_t size) {
+		if (!is_init)
+			THROW(InvalidParameter, "CryptoCodec isn't init");
 
-			if (!ret) {
-				std::string err = ERR_lib_error_string(ERR_get_error());
-				THROW(HdfsIOException, "CryptoCodec : cipher_wrap AES data failed:%s, crypto_method:%d", err.c_str(), method);
+		if (parallelThreads > 1 && parallelMinSize > 0 && size >= parallelMinSize
+				&& size >= 2 * MinSegmentSize) {
+			cipherParallel(in, out, size);
+		} else {
+			update(cipherCtx, in, out, size);
+			streamOffset += size;
+		}
+	}
+
+	struct CryptoCodec::SegmentsDone {
+		SegmentsDone(int pending) : pending(pending), failed(false) {
+		}
+
+		int pending;
+		bool failed;
+		std::string error;
+		mutex mut;
+		condition_variable cond;
+	};
+
+	void CryptoCodec::cipherSegment(const char * in, char * out, int64_t start, int64_t length,
+			SegmentsDone * done) {
+		std::string error;
+		EVP_CIPHER_CTX * ctx = EVP_CIPHER_CTX_new();
+
+		try {
+			if (!ctx || !initContext(ctx, streamOffset + start)) {
+				THROW(HdfsIOException, "CryptoCodec : cannot init the cipher context of a segment");
 			}
 
+			update(ctx, in + start, out + start, length);
+		} catch (const std::exception & e) {
+			error = e.what();
 		}
 
-		//cut off padding when necessary
-		if (padding > 0) {
-			out_buf.erase(0, padding);
-			padding = 0;
+		if (ctx) {
+			EVP_CIPHER_CTX_free(ctx);
 		}
 
+		lock_guard<mutex> lock(done->mut);
+		if (!error.empty()) {
+			done->failed = true;
+			done->error = error;
+		}
+		if (--done->pending == 0) {
+			done->cond.notify_one();
+		}
+	}
+
+	void CryptoCodec::cipherParallel(const char * in, char * out, int64_t size) {
+		/*
+		 * In CTR mode every segment can start from its own offset, the
+		 * counter block is derived from the offset in the stream.
+		 */
+		int64_t segments = std::min<int64_t>(parallelThreads, size / MinSegmentSize);
+		int64_t segmentSize = (size + segments - 1) / segments;
+		segmentSize = (segmentSize + AES_CTR_BLOCK_SIZE - 1) / AES_CTR_BLOCK_SIZE * AES_CTR_BLOCK_SIZE;
+		segments = (size + segmentSize - 1) / segmentSize;
+		SegmentsDone done(segments - 1);
+		AsyncExecutor & executor = CryptoExecutor(parallelThreads - 1);
+
+		for (int64_t i = 1; i < segments; ++i) {
+			int64_t start = i * segmentSize;
+			int64_t length = std::min(segmentSize, size - start);
+			function<void()> task = bind(&CryptoCodec::cipherSegment, this, in, out, start, length, &done);
+
+			try {
+				executor.submit(NULL, task);
+			} catch (...) {
+				task();
+			}
+		}
+
+		exception_ptr first;
+
+		try {
+			update(cipherCtx, in, out, std::min(segmentSize, size));
+		} catch (...) {
+			first = current_exception();
+		}
+
+		{
+			unique_lock<mutex> lock(done.mut);
+			while (done.pending > 0) {
+				done.cond.wait(lock);
+			}
+		}
+
+		if (first) {
+			rethrow_exception(first);
+		}
+
+		if (done.failed) {
+			THROW(HdfsIOException, "CryptoCodec : cipher AES data failed:%s, crypto_method:%d", done.error.c_str(), method);
+		}
+
+		// Move the cipher context of the stream past the whole buffer.
+		if (resetStreamOffset(method, streamOffset + size) < 0) {
+			THROW(HdfsIOException, "CryptoCodec : cannot reset the cipher context to offset %" PRId64, streamOffset + size);
+		}
+	}
+
+	std::string CryptoCodec::cipher_wrap(const char * buffer, int64_t size) {
+		std::string out_buf(size, 0);
+		if (size > 0) {
+			crypt(buffer, &out_buf[0], size);
+		}
 		return out_buf;
 	}
 
 }
-
@@ -27,11 +27,13 @@
 #include "openssl/conf.h"
 #include "openssl/evp.h"
 #include "openssl/err.h"
+#include "DekCache.h"
 #include "FileEncryptionInfo.h"
 #include "KmsClientProvider.h"
 
 #define KEY_LENGTH_256 32
 #define KEY_LENGTH_128 16
+#define AES_CTR_BLOCK_SIZE 16
 
 namespace Hdfs {
 
@@ -47,8 +49,10 @@ namespace Hdfs {
 		 * @param encryptionInfo the encryption info of file.
 		 * @param kcp a KmsClientProvider instance to get key from kms server.
 		 * @param bufSize crypto buffer size.
+		 * @param dekCache decrypted keys of the filesystem, may be NULL.
 		 */
-		CryptoCodec(FileEncryptionInfo *encryptionInfo, shared_ptr<KmsClientProvider> kcp, int32_t bufSize);
+		CryptoCodec(FileEncryptionInfo *encryptionInfo, shared_ptr<KmsClientProvider> kcp, int32_t bufSize,
+				Internal::DekCache *dekCache = NULL);
 
 		/**
 		 * Destroy a CryptoCodec instance.
@@ -63,6 +67,22 @@ namespace Hdfs {
 		 */
 		virtual std::string cipher_wrap(const char * buffer, int64_t size);
 
+		/**
+		 * encrypt/decrypt(depends on init()) size bytes of in into out
+		 * @param in the data
+		 * @param out the result, may be the same buffer as in
+		 * @param size the number of bytes
+		 */
+		virtual void crypt(const char * in, char * out, int64_t size);
+
+		/**
+		 * Split buffers of at least minSize bytes into segments which
+		 * are encrypted/decrypted on up to threads threads.
+		 * @param threads the number of threads, 1 disables it
+		 * @param minSize the smallest buffer to split
+		 */
+		void setParallel(int32_t threads, int32_t minSize);
+
 		/**
 		 * init CryptoCodec
 		 * @param method CryptoMethod
@@ -86,6 +106,29 @@ namespace Hdfs {
 		 */
 		std::string getDecryptedKeyFromKms();
 
+		/**
+		 * Init the cipher context ctx at the given stream offset.
+		 * @return true on success.
+		 */
+		bool initContext(EVP_CIPHER_CTX * ctx, int64_t stream_offset);
+
+		/**
+		 * Run the cipher of ctx over size bytes, bufSize bytes at a time.
+		 */
+		void update(EVP_CIPHER_CTX * ctx, const char * in, char * out, int64_t size);
+
+		/**
+		 * Encrypt/decrypt a large buffer as segments on several threads.
+		 */
+		void cipherParallel(const char * in, char * out, int64_t size);
+
+		/**
+		 * Encrypt/decrypt one segment of cipherParallel with its own context.
+		 */
+		struct SegmentsDone;
+		void cipherSegment(const char * in, char * out, int64_t start, int64_t length,
+				SegmentsDone * done);
+
 		/**
 		 * calculate new IV for appending a existed file
 		 * @param initIV
@@ -95,6 +138,7 @@ namespace Hdfs {
 		std::string calculateIV(const std::string& initIV, unsigned long counter);
 
 		shared_ptr<KmsClientProvider>	kcp;
+		Internal::DekCache*	dekCache;
 		FileEncryptionInfo*	encryptionInfo;
 		EVP_CIPHER_CTX*	cipherCtx;
 		const EVP_CIPHER*	cipher;
@@ -102,8 +146,9 @@ namespace Hdfs {
 
 		bool	is_init;
 		int32_t	bufSize;
-		int64_t	padding;
-		int64_t	counter;
+		int32_t	parallelThreads;
+		int32_t	parallelMinSize;
+		int64_t	streamOffset;
 		std::string decryptedKey;
 		uint64_t AlgorithmBlockSize;
 	};
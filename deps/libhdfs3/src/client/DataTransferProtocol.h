@@ -22,6 +22,7 @@
 #ifndef _HDFS_LIBHDFS_3_CLIENT_DATATRANSFERPROTOCOL_H_
 #define _HDFS_LIBHDFS_3_CLIENT_DATATRANSFERPROTOCOL_H_
 
+#include "client/CachingStrategy.h"
 #include "client/Token.h"
 #include "server/DatanodeInfo.h"
 #include "server/ExtendedBlock.h"
@@ -46,10 +47,12 @@ public:
      * @param clientName client's name.
      * @param blockOffset offset of the block.
      * @param length maximum number of bytes for this read.
+     * @param strategy page cache hints for the datanode.
      */
     virtual void readBlock(const ExtendedBlock & blk,
                            const Token & blockToken, const char * clientName,
-                           int64_t blockOffset, int64_t length) = 0;
+                           int64_t blockOffset, int64_t length,
+                           const CachingStrategy & strategy) = 0;
 
     /**
      * Write a block to a datanode pipeline.
@@ -64,13 +67,14 @@ public:
      * @param minBytesRcvd minimum number of bytes received.
      * @param maxBytesRcvd maximum number of bytes received.
      * @param latestGenerationStamp the latest generation stamp of the block.
+     * @param strategy page cache hints for the datanodes.
      */
     virtual void writeBlock(const ExtendedBlock & blk,
                             const Token & blockToken, const char * clientName,
                             const std::vector<DatanodeInfo> & targets, int stage,
                             int pipelineSize, int64_t minBytesRcvd, int64_t maxBytesRcvd,
                             int64_t latestGenerationStamp, int checksumType,
-                            int bytesPerChecksum) = 0;
+                            int bytesPerChecksum, const CachingStrategy & strategy) = 0;
 
     /**
      * Transfer a block to another datanode.
@@ -90,6 +90,26 @@ static inline void BuildNodesInfo(const std::vector<DatanodeInfo> & nodes,
     }
 }
 
+/*
+ * the field is left out without any hint.
+ */
+template<typename T>
+static inline void BuildCachingStrategy(const CachingStrategy & strategy, T * op) {
+    if (!strategy.hasDropBehind() && !strategy.hasReadahead()) {
+        return;
+    }
+
+    CachingStrategyProto * proto = op->mutable_cachingstrategy();
+
+    if (strategy.hasDropBehind()) {
+        proto->set_dropbehind(strategy.getDropBehind());
+    }
+
+    if (strategy.hasReadahead()) {
+        proto->set_readahead(strategy.getReadahead());
+    }
+}
+
 DataTransferProtocolSender::DataTransferProtocolSender(Socket & sock,
         int writeTimeout, const std::string & datanodeAddr) :
     sock(sock), writeTimeout(writeTimeout), datanode(datanodeAddr) {
@@ -100,12 +120,13 @@ DataTransferProtocolSender::~DataTransferProtocolSender() {
 
 void DataTransferProtocolSender::readBlock(const ExtendedBlock & blk,
         const Token & blockToken, const char * clientName,
-        int64_t blockOffset, int64_t length) {
+        int64_t blockOffset, int64_t length, const CachingStrategy & strategy) {
     try {
         OpReadBlockProto op;
         op.set_len(length);
         op.set_offset(blockOffset);
         BuildClientHeader(blk, blockToken, clientName, op.mutable_header());
+        BuildCachingStrategy(strategy, &op);
         Send(sock, READ_BLOCK, &op, writeTimeout);
     } catch (const HdfsCanceled & e) {
         throw;
@@ -120,7 +141,8 @@ void DataTransferProtocolSender::writeBlock(const ExtendedBlock & blk,
         const Token & blockToken, const char * clientName,
         const std::vector<DatanodeInfo> & targets, int stage, int pipelineSize,
         int64_t minBytesRcvd, int64_t maxBytesRcvd,
-        int64_t latestGenerationStamp, int checksumType, int bytesPerChecksum) {
+        int64_t latestGenerationStamp, int checksumType, int bytesPerChecksum,
+        const CachingStrategy & strategy) {
     try {
         OpWriteBlockProto op;
         op.set_latestgenerationstamp(latestGenerationStamp);
@@ -133,6 +155,7 @@ void DataTransferProtocolSender::writeBlock(const ExtendedBlock & blk,
         ck->set_bytesperchecksum(bytesPerChecksum);
         ck->set_type((ChecksumTypeProto) checksumType);
         BuildNodesInfo(targets, op.mutable_targets());
+        BuildCachingStrategy(strategy, &op);
         Send(sock, WRITE_BLOCK, &op, writeTimeout);
     } catch (const HdfsCanceled & e) {
         throw;
@@ -163,7 +186,9 @@ void DataTransferProtocolSender::transferBlock(const ExtendedBlock & blk,
 void DataTransferProtocolSender::blockChecksum(const ExtendedBlock & blk,
         const Token & blockToken) {
     try {
-        //TODO
+        OpBlockChecksumProto op;
+        BuildBaseHeader(blk, blockToken, op.mutable_header());
+        Send(sock, BLOCK_CHECKSUM, &op, writeTimeout);
     } catch (const HdfsCanceled & e) {
         throw;
     } catch (const HdfsException & e) {
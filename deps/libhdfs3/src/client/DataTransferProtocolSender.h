@@ -64,9 +64,11 @@ public:
      * @param clientName client's name.
      * @param blockOffset offset of the block.
      * @param length maximum number of bytes for this read.
+     * @param strategy page cache hints for the datanode.
      */
     virtual void readBlock(const ExtendedBlock & blk, const Token & blockToken,
-                           const char * clientName, int64_t blockOffset, int64_t length);
+                           const char * clientName, int64_t blockOffset, int64_t length,
+                           const CachingStrategy & strategy);
 
     /**
      * Write a block to a datanode pipeline.
@@ -81,12 +83,14 @@ public:
      * @param minBytesRcvd minimum number of bytes received.
      * @param maxBytesRcvd maximum number of bytes received.
      * @param latestGenerationStamp the latest generation stamp of the block.
+     * @param strategy page cache hints for the datanodes.
      */
     virtual void writeBlock(const ExtendedBlock & blk, const Token & blockToken,
                             const char * clientName, const std::vector<DatanodeInfo> & targets,
                             int stage, int pipelineSize, int64_t minBytesRcvd,
                             int64_t maxBytesRcvd, int64_t latestGenerationStamp,
-                            int checksumType, int bytesPerChecksum);
+                            int checksumType, int bytesPerChecksum,
+                            const CachingStrategy & strategy);
 
     /**
      * Transfer a block to another datanode.
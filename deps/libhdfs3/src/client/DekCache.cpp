@@ -0,0 +1,78 @@
+/********************************************************************
+ * 2014 -
+ * open source under Apache License Version 2.0
+ ********************************************************************/
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "client/DekCache.h"
+#include "Logger.h"
+#include "Metrics.h"
+
+namespace Hdfs {
+namespace Internal {
+
+DekCache::DekCache(const SessionConfig& conf)
+    : cacheSize(conf.getDekCacheSize()),
+      expireTimeInterval(conf.getDekCacheExpiry()),
+      map(cacheSize) {
+}
+
+std::string DekCache::buildKey(const FileEncryptionInfo& info) {
+  std::string key = info.getEzKeyVersionName();
+  key.append(1, '\0').append(info.getIv());
+  key.append(1, '\0').append(info.getKey());
+  return key;
+}
+
+bool DekCache::get(const FileEncryptionInfo& info, std::string* key) {
+  value_type value;
+
+  if (cacheSize <= 0) {
+    return false;
+  }
+
+  std::string k = buildKey(info);
+
+  if (!map.find(k, &value)) {
+    Metrics::Add(METRIC_DEK_CACHE_MISSES);
+    LOG(DEBUG1, "DekCache miss for key version %s.",
+        info.getEzKeyVersionName().c_str());
+    return false;
+  } else if (ToMilliSeconds(value.second, steady_clock::now()) >
+             expireTimeInterval) {
+    map.erase(k);
+    Metrics::Add(METRIC_DEK_CACHE_MISSES);
+    LOG(DEBUG1, "DekCache expire for key version %s.",
+        info.getEzKeyVersionName().c_str());
+    return false;
+  }
+
+  Metrics::Add(METRIC_DEK_CACHE_HITS);
+  *key = value.first;
+  return true;
+}
+
+void DekCache::put(const FileEncryptionInfo& info, const std::string& key) {
+  if (cacheSize <= 0) {
+    return;
+  }
+
+  map.insert(buildKey(info), value_type(key, steady_clock::now()));
+}
+}
+}
@@ -0,0 +1,62 @@
+/********************************************************************
+ * 2014 -
+ * open source under Apache License Version 2.0
+ ********************************************************************/
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _HDFS_LIBHDFS3_CLIENT_DEKCACHE_H_
+#define _HDFS_LIBHDFS3_CLIENT_DEKCACHE_H_
+
+#include <string>
+#include <utility>
+
+#include "client/FileEncryptionInfo.h"
+#include "common/DateTime.h"
+#include "common/LruMap.h"
+#include "common/SessionConfig.h"
+
+namespace Hdfs {
+namespace Internal {
+
+/*
+ * Decrypted data encryption keys of one filesystem, keyed by the key
+ * version and the encrypted key of the file, so opening an encrypted
+ * file again does not need a KMS round trip.
+ */
+class DekCache {
+ public:
+  explicit DekCache(const SessionConfig& conf);
+
+  bool get(const FileEncryptionInfo& info, std::string* key);
+
+  void put(const FileEncryptionInfo& info, const std::string& key);
+
+  typedef std::pair<std::string, steady_clock::time_point> value_type;
+
+ private:
+  std::string buildKey(const FileEncryptionInfo& info);
+
+ private:
+  const int cacheSize;
+  int64_t expireTimeInterval;  // milliseconds
+  LruMap<std::string, value_type> map;
+};
+}
+}
+
+#endif /* _HDFS_LIBHDFS3_CLIENT_DEKCACHE_H_ */
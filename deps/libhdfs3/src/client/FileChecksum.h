@@ -0,0 +1,120 @@
+/********************************************************************
+ * 2014 -
+ * open source under Apache License Version 2.0
+ ********************************************************************/
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _HDFS_LIBHDFS3_CLIENT_FILECHECKSUM_H_
+#define _HDFS_LIBHDFS3_CLIENT_FILECHECKSUM_H_
+
+#include <sstream>
+#include <stdint.h>
+#include <string>
+
+namespace Hdfs {
+
+/**
+ * The MD5 of the MD5s of the CRCs of the blocks of a file, the checksum
+ * HDFS reports for a file. Files with the same content, block size and
+ * bytes per checksum have the same checksum on every cluster.
+ */
+class FileChecksum {
+public:
+    /**
+     * The CRC the datanodes store for every chunk of the blocks.
+     */
+    enum CrcType {
+        CRC32 = 1, CRC32C = 2
+    };
+
+    /**
+     * To construct a FileChecksum.
+     */
+    FileChecksum() :
+        crcType(CRC32), bytesPerCrc(0), crcPerBlock(0) {
+    }
+
+    /**
+     * To construct a FileChecksum with given values.
+     * @param bytesPerCrc the number of data bytes covered by a CRC.
+     * @param crcPerBlock the number of CRCs of a block, 0 for files of one block.
+     * @param crcType the type of the CRCs.
+     * @param md5 the 16 byte MD5 of the MD5s of the blocks.
+     */
+    FileChecksum(int bytesPerCrc, int64_t crcPerBlock, CrcType crcType, const std::string & md5) :
+        crcType(crcType), bytesPerCrc(bytesPerCrc), crcPerBlock(crcPerBlock), md5(md5) {
+    }
+
+    /**
+     * @return the algorithm name, e.g. MD5-of-262144MD5-of-512CRC32C.
+     */
+    std::string getAlgorithmName() const {
+        std::ostringstream name;
+        name << "MD5-of-" << crcPerBlock << "MD5-of-" << bytesPerCrc
+             << (crcType == CRC32C ? "CRC32C" : "CRC32");
+        return name.str();
+    }
+
+    /**
+     * The checksum as Hadoop serializes it for comparison: bytesPerCrc as
+     * 4 bytes and crcPerBlock as 8 bytes big endian, then the MD5.
+     * @return the 28 byte checksum.
+     */
+    std::string getBytes() const {
+        std::string bytes;
+
+        for (int i = 3; i >= 0; --i) {
+            bytes.push_back(static_cast<char>((static_cast<uint32_t>(bytesPerCrc) >> (i * 8)) & 0xff));
+        }
+
+        for (int i = 7; i >= 0; --i) {
+            bytes.push_back(static_cast<char>((static_cast<uint64_t>(crcPerBlock) >> (i * 8)) & 0xff));
+        }
+
+        return bytes + md5;
+    }
+
+    CrcType getCrcType() const {
+        return crcType;
+    }
+
+    int getBytesPerCrc() const {
+        return bytesPerCrc;
+    }
+
+    int64_t getCrcPerBlock() const {
+        return crcPerBlock;
+    }
+
+    /**
+     * @return the 16 byte MD5 of the MD5s of the blocks.
+     */
+    const std::string & getMd5() const {
+        return md5;
+    }
+
+private:
+    CrcType crcType;
+    int bytesPerCrc;
+    int64_t crcPerBlock;
+    std::string md5;
+};
+
+}
+
+#endif /* _HDFS_LIBHDFS3_CLIENT_FILECHECKSUM_H_ */
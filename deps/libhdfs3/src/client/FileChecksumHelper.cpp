@@ -0,0 +1,296 @@
+/********************************************************************
+ * 2014 -
+ * open source under Apache License Version 2.0
+ ********************************************************************/
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "AsyncExecutor.h"
+#include "DataTransferProtocolSender.h"
+#include "datatransfer.pb.h"
+#include "Exception.h"
+#include "ExceptionInternal.h"
+#include "FileChecksumHelper.h"
+#include "Logger.h"
+#include "network/BufferedSocketReader.h"
+#include "network/UringSocket.h"
+#include "server/LocatedBlocks.h"
+#include "Thread.h"
+
+#include <limits>
+#include <openssl/evp.h>
+
+namespace Hdfs {
+namespace Internal {
+
+static const int ChecksumThreads = 8;
+static const int MD5Length = 16;
+
+static AsyncExecutor & ChecksumExecutor() {
+    static AsyncExecutor * executor = new AsyncExecutor(ChecksumThreads);
+    return *executor;
+}
+
+/*
+ * The checksum of one block, filled in on a worker of ChecksumExecutor.
+ */
+struct BlockChecksum {
+    BlockChecksum(const LocatedBlock & block) :
+        done(false), invalidToken(false), bytesPerCrc(0), crcType(CHECKSUM_CRC32), crcPerBlock(0),
+        block(block) {
+    }
+
+    bool done;
+    bool invalidToken; //a datanode rejected the block token.
+    int bytesPerCrc;
+    int crcType;
+    int64_t crcPerBlock;
+    LocatedBlock block;
+    std::string md5;
+};
+
+/*
+ * The blocks asked for at once, the caller waits until all are answered.
+ */
+struct BlockChecksumRound {
+    BlockChecksumRound() :
+        pending(0), connTimeout(0), readTimeout(0), writeTimeout(0), useIoUring(false) {
+    }
+
+    size_t pending;
+    int connTimeout;
+    int readTimeout;
+    int writeTimeout;
+    bool useIoUring;
+    condition_variable cond;
+    mutex mut;
+    std::string path;
+};
+
+static void ReadBlockChecksum(const BlockChecksumRound & round, BlockChecksum & checksum,
+                              const DatanodeInfo & node) {
+    shared_ptr<Socket> sock(UringSocketImpl::Create(round.useIoUring));
+    BufferedSocketReaderImpl in(*sock);
+    sock->connect(node.getIpAddr().c_str(), node.getXferPort(), round.connTimeout);
+    DataTransferProtocolSender sender(*sock, round.writeTimeout, node.formatAddress());
+    sender.blockChecksum(checksum.block, checksum.block.getToken());
+    int size = in.readVarint32(round.readTimeout);
+
+    if (size <= 0 || size > 1024 * 1024) {
+        THROW(HdfsIOException, "FileChecksumHelper: invalid response size %d from Datanode %s for Block: %s.",
+              size, node.formatAddress().c_str(), checksum.block.toString().c_str());
+    }
+
+    std::vector<char> buffer(size);
+    in.readFully(&buffer[0], size, round.readTimeout);
+    sock->close();
+    BlockOpResponseProto resp;
+
+    if (!resp.ParseFromArray(&buffer[0], size)) {
+        THROW(HdfsIOException, "FileChecksumHelper: cannot parse the response of Datanode %s for Block: %s.",
+              node.formatAddress().c_str(), checksum.block.toString().c_str());
+    }
+
+    if (resp.status() == Status::DT_PROTO_ERROR_ACCESS_TOKEN) {
+        THROW(HdfsInvalidBlockToken, "FileChecksumHelper: block's token is invalid. Datanode: %s, Block: %s",
+              node.formatAddress().c_str(), checksum.block.toString().c_str());
+    }
+
+    if (resp.status() != Status::DT_PROTO_SUCCESS || !resp.has_checksumresponse()) {
+        THROW(HdfsIOException, "FileChecksumHelper: Datanode %s cannot compute the checksum of Block: %s, %s.",
+              node.formatAddress().c_str(), checksum.block.toString().c_str(),
+              resp.has_message() ? resp.message().c_str() : "check Datanode's log for more information");
+    }
+
+    const OpBlockChecksumResponseProto & cs = resp.checksumresponse();
+
+    if (cs.md5().size() != MD5Length) {
+        THROW(HdfsIOException, "FileChecksumHelper: Datanode %s returned a MD5 of %d bytes for Block: %s.",
+              node.formatAddress().c_str(), static_cast<int>(cs.md5().size()),
+              checksum.block.toString().c_str());
+    }
+
+    checksum.bytesPerCrc = cs.bytespercrc();
+    checksum.crcPerBlock = cs.crcperblock();
+    checksum.crcType = cs.has_crctype() ? cs.crctype() : CHECKSUM_CRC32;
+    checksum.md5 = cs.md5();
+}
+
+/*
+ * try the replicas in the order of the namenode until one answers.
+ */
+static void ComputeBlockChecksum(shared_ptr<BlockChecksumRound> round,
+                                 shared_ptr<BlockChecksum> checksum) {
+    const std::vector<DatanodeInfo> & nodes = checksum->block.getLocations();
+
+    for (size_t i = 0; i < nodes.size() && !checksum->done; ++i) {
+        try {
+            ReadBlockChecksum(*round, *checksum, nodes[i]);
+            checksum->done = true;
+        } catch (const HdfsInvalidBlockToken & e) {
+            checksum->invalidToken = true;
+            std::string buffer;
+            LOG(INFO, "FileChecksumHelper: cannot get the checksum of Block: %s file %s from Datanode: %s.\n%s",
+                checksum->block.toString().c_str(), round->path.c_str(),
+                nodes[i].formatAddress().c_str(), GetExceptionDetail(e, buffer));
+        } catch (const HdfsException & e) {
+            std::string buffer;
+            LOG(INFO, "FileChecksumHelper: cannot get the checksum of Block: %s file %s from Datanode: %s.\n%s",
+                checksum->block.toString().c_str(), round->path.c_str(),
+                nodes[i].formatAddress().c_str(), GetExceptionDetail(e, buffer));
+        } catch (const std::exception & e) {
+            LOG(LOG_ERROR, "FileChecksumHelper: cannot get the checksum of Block: %s file %s from Datanode: %s: %s",
+                checksum->block.toString().c_str(), round->path.c_str(),
+                nodes[i].formatAddress().c_str(), e.what());
+        }
+    }
+
+    lock_guard<mutex> lock(round->mut);
+
+    if (--round->pending == 0) {
+        round->cond.notify_all();
+    }
+}
+
+FileChecksumHelper::FileChecksumHelper(FileSystemInter & filesystem, const std::string & path) :
+    filesystem(filesystem), path(path) {
+}
+
+FileChecksum FileChecksumHelper::compute() {
+    const SessionConfig & conf = filesystem.getConf();
+    shared_ptr<BlockChecksumRound> round(new BlockChecksumRound);
+    round->connTimeout = conf.getInputConnTimeout();
+    round->readTimeout = conf.getInputReadTimeout();
+    round->writeTimeout = conf.getInputWriteTimeout();
+    round->useIoUring = conf.isUseIoUring();
+    round->path = path;
+    LocatedBlocksImpl lbs;
+    filesystem.getBlockLocations(path, 0, std::numeric_limits<int64_t>::max(), lbs);
+    std::vector<shared_ptr<BlockChecksum> > blocks;
+
+    for (size_t i = 0; i < lbs.getBlocks().size(); ++i) {
+        blocks.push_back(shared_ptr<BlockChecksum>(new BlockChecksum(lbs.getBlocks()[i])));
+    }
+
+    /*
+     * the block tokens may expire before the last blocks are asked for,
+     * refetch the locations once like a reader does.
+     */
+    for (bool refetched = false;;) {
+        std::vector<shared_ptr<BlockChecksum> > missing;
+
+        for (size_t i = 0; i < blocks.size(); ++i) {
+            if (!blocks[i]->done) {
+                missing.push_back(blocks[i]);
+            }
+        }
+
+        if (!missing.empty()) {
+            round->pending = missing.size();
+
+            for (size_t i = 0; i < missing.size(); ++i) {
+                ChecksumExecutor().submit(NULL, bind(ComputeBlockChecksum, round, missing[i]));
+            }
+
+            unique_lock<mutex> lock(round->mut);
+
+            while (round->pending > 0) {
+                round->cond.wait(lock);
+            }
+        }
+
+        bool invalidToken = false;
+        shared_ptr<BlockChecksum> failed;
+
+        for (size_t i = 0; i < missing.size(); ++i) {
+            if (!missing[i]->done) {
+                failed = missing[i];
+                invalidToken = invalidToken || missing[i]->invalidToken;
+            }
+        }
+
+        if (!failed) {
+            break;
+        }
+
+        if (!invalidToken || refetched) {
+            THROW(HdfsIOException, "FileChecksumHelper: cannot get the checksum of Block: %s file %s from any Datanode.",
+                  failed->block.toString().c_str(), path.c_str());
+        }
+
+        LocatedBlocksImpl refreshed;
+        filesystem.getBlockLocations(path, 0, std::numeric_limits<int64_t>::max(), refreshed);
+        refetched = true;
+
+        for (size_t i = 0; i < blocks.size(); ++i) {
+            if (!blocks[i]->done && i < refreshed.getBlocks().size()
+                    && refreshed.getBlocks()[i].getBlockId() == blocks[i]->block.getBlockId()) {
+                blocks[i]->block = refreshed.getBlocks()[i];
+                blocks[i]->invalidToken = false;
+            }
+        }
+    }
+
+    /*
+     * the MD5 of the block MD5s, crcPerBlock is only set for files of
+     * more than one block, like HDFS does.
+     */
+    std::string md5s;
+    int bytesPerCrc = 0;
+    int crcType = CHECKSUM_CRC32;
+    int64_t crcPerBlock = 0;
+
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        if (i == 0) {
+            bytesPerCrc = blocks[i]->bytesPerCrc;
+            crcType = blocks[i]->crcType;
+            crcPerBlock = blocks.size() > 1 ? blocks[i]->crcPerBlock : 0;
+        } else if (blocks[i]->bytesPerCrc != bytesPerCrc || blocks[i]->crcType != crcType) {
+            THROW(HdfsIOException, "FileChecksumHelper: Block: %s of file %s has %d bytes per checksum of type %d, "
+                  "the first block has %d of type %d.", blocks[i]->block.toString().c_str(), path.c_str(),
+                  blocks[i]->bytesPerCrc, blocks[i]->crcType, bytesPerCrc, crcType);
+        }
+
+        md5s += blocks[i]->md5;
+    }
+
+    /*
+     * HDFS digests the whole buffer the block MD5s are collected in, which
+     * starts with 32 bytes and doubles, the bytes after the MD5s are zero.
+     * An empty file has the MD5 of 32 zero bytes.
+     */
+    size_t capacity = 32;
+
+    while (capacity < md5s.size()) {
+        capacity *= 2;
+    }
+
+    md5s.resize(capacity, '\0');
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned int length = 0;
+
+    if (!EVP_Digest(md5s.data(), md5s.size(), digest, &length, EVP_md5(), NULL)) {
+        THROW(HdfsIOException, "FileChecksumHelper: cannot compute the MD5 of file %s.", path.c_str());
+    }
+
+    return FileChecksum(bytesPerCrc, crcPerBlock,
+                        crcType == CHECKSUM_CRC32C ? FileChecksum::CRC32C : FileChecksum::CRC32,
+                        std::string(reinterpret_cast<char *>(digest), length));
+}
+
+}
+}
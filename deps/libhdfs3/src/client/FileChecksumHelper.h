@@ -0,0 +1,64 @@
+/********************************************************************
+ * 2014 -
+ * open source under Apache License Version 2.0
+ ********************************************************************/
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _HDFS_LIBHDFS3_CLIENT_FILECHECKSUMHELPER_H_
+#define _HDFS_LIBHDFS3_CLIENT_FILECHECKSUMHELPER_H_
+
+#include "FileChecksum.h"
+#include "FileSystemInter.h"
+
+#include <string>
+
+namespace Hdfs {
+namespace Internal {
+
+/**
+ * Compute the checksum of a file from the checksums of its blocks.
+ * The datanodes compute the MD5 of the CRCs they store for a block,
+ * so no block data is transferred. The blocks are asked for in parallel.
+ */
+class FileChecksumHelper {
+public:
+    /**
+     * Construct a FileChecksumHelper.
+     * @param filesystem the file system the file belongs to.
+     * @param path the standard path of the file.
+     */
+    FileChecksumHelper(FileSystemInter & filesystem, const std::string & path);
+
+    /**
+     * Ask the datanodes for the checksums of all blocks of the file and
+     * compose them.
+     * @return the checksum of the file.
+     * @throw HdfsIOException if a block has no replica answering, or the
+     *  blocks have different bytes per checksum or checksum types.
+     */
+    FileChecksum compute();
+
+private:
+    FileSystemInter & filesystem;
+    std::string path;
+};
+
+}
+}
+
+#endif /* _HDFS_LIBHDFS3_CLIENT_FILECHECKSUMHELPER_H_ */
@@ -0,0 +1,180 @@
+/********************************************************************
+ * 2014 -
+ * open source under Apache License Version 2.0
+ ********************************************************************/
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <algorithm>
+
+#include "client/FileStatusCache.h"
+#include "Logger.h"
+#include "Metrics.h"
+
+namespace Hdfs {
+namespace Internal {
+
+namespace {
+
+/*
+ * Invalidations remembered for put, a few times the entries of a cache.
+ */
+const size_t MIN_REMEMBERED_CHANGES = 1024;
+
+/*
+ * Matches path itself and everything below it.
+ */
+class InSubtree {
+ public:
+  explicit InSubtree(const std::string& path) : path(path) {}
+
+  bool operator()(const std::string& key) const {
+    if (key.compare(0, path.size(), path) != 0) {
+      return false;
+    }
+
+    return key.size() == path.size() || path == "/" || key[path.size()] == '/';
+  }
+
+ private:
+  const std::string& path;
+};
+}
+
+FileStatusCache::FileStatusCache(const SessionConfig& conf)
+    : cacheSize(conf.getFileStatusCacheSize()),
+      expireTimeInterval(conf.getFileStatusCacheExpiry()),
+      negativeExpireTimeInterval(conf.getFileStatusCacheNegativeExpiry()),
+      map(cacheSize),
+      generation(0),
+      forgotten(0) {
+}
+
+int64_t FileStatusCache::getGeneration() {
+  lock_guard<mutex> lock(mut);
+  return generation;
+}
+
+bool FileStatusCache::invalidatedSince(const std::string& path,
+                                       int64_t generation) const {
+  if (generation < forgotten) {
+    return true;
+  }
+
+  unordered_map<std::string, int64_t>::const_iterator it = changed.find(path);
+
+  if (it != changed.end() && it->second > generation) {
+    return true;
+  }
+
+  /*
+   * path itself and its ancestors may have had their subtree invalidated.
+   */
+  for (size_t end = path.size(); end != std::string::npos && end > 0;
+       end = path.rfind('/', end - 1)) {
+    it = changedBelow.find(path.substr(0, end));
+
+    if (it != changedBelow.end() && it->second > generation) {
+      return true;
+    }
+  }
+
+  it = changedBelow.find("/");
+  return it != changedBelow.end() && it->second > generation;
+}
+
+bool FileStatusCache::get(const std::string& path, FileStatus* status,
+                          bool* exist) {
+  Entry entry;
+
+  if (cacheSize <= 0) {
+    return false;
+  }
+
+  if (!map.find(path, &entry)) {
+    Metrics::Add(METRIC_FILE_STATUS_CACHE_MISSES);
+    return false;
+  } else if (ToMilliSeconds(entry.time, steady_clock::now()) >
+             (entry.exist ? expireTimeInterval : negativeExpireTimeInterval)) {
+    map.erase(path);
+    Metrics::Add(METRIC_FILE_STATUS_CACHE_MISSES);
+    LOG(DEBUG3, "FileStatusCache expire for path %s.", path.c_str());
+    return false;
+  }
+
+  Metrics::Add(METRIC_FILE_STATUS_CACHE_HITS);
+  *status = entry.status;
+  *exist = entry.exist;
+  return true;
+}
+
+void FileStatusCache::put(const std::string& path, const FileStatus& status,
+                          bool exist, int64_t generation) {
+  if (cacheSize <= 0 ||
+      (exist ? expireTimeInterval : negativeExpireTimeInterval) <= 0) {
+    return;
+  }
+
+  Entry entry;
+  entry.status = status;
+  entry.exist = exist;
+  entry.time = steady_clock::now();
+  lock_guard<mutex> lock(mut);
+
+  /*
+   * an invalidation raced with the lookup, the result may predate it.
+   */
+  if (!invalidatedSince(path, generation)) {
+    map.insert(path, entry);
+  }
+}
+
+void FileStatusCache::invalidate(const std::string& path, bool subtree) {
+  if (cacheSize <= 0) {
+    return;
+  }
+
+  lock_guard<mutex> lock(mut);
+  ++generation;
+
+  if (changed.size() + changedBelow.size() >
+      std::max(MIN_REMEMBERED_CHANGES, static_cast<size_t>(cacheSize))) {
+    changed.clear();
+    changedBelow.clear();
+    forgotten = generation;
+  }
+
+  changed[path] = generation;
+
+  if (subtree) {
+    changedBelow[path] = generation;
+    map.eraseIf(InSubtree(path));
+  } else {
+    map.erase(path);
+  }
+
+  for (size_t pos = path.rfind('/'); pos != std::string::npos && pos > 0;
+       pos = path.rfind('/', pos - 1)) {
+    changed[path.substr(0, pos)] = generation;
+    map.erase(path.substr(0, pos));
+  }
+
+  changed["/"] = generation;
+  map.erase("/");
+}
+}
+}
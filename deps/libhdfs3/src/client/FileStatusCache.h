@@ -0,0 +1,127 @@
+/********************************************************************
+ * 2014 -
+ * open source under Apache License Version 2.0
+ ********************************************************************/
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _HDFS_LIBHDFS3_CLIENT_FILESTATUSCACHE_H_
+#define _HDFS_LIBHDFS3_CLIENT_FILESTATUSCACHE_H_
+
+#include <string>
+#include <vector>
+
+#include "client/FileStatus.h"
+#include "common/DateTime.h"
+#include "common/LruMap.h"
+#include "common/SessionConfig.h"
+#include "common/Thread.h"
+#include "common/Unordered.h"
+
+namespace Hdfs {
+namespace Internal {
+
+/*
+ * Results of getFileInfo of one filesystem, keyed by the absolute path.
+ * Paths which do not exist are cached too, with their own expiry.
+ * Changes made through the filesystem drop the affected entries, changes
+ * made by anyone else are seen once the entries expire.
+ */
+class FileStatusCache {
+ public:
+  explicit FileStatusCache(const SessionConfig& conf);
+
+  bool isEnabled() const { return cacheSize > 0; }
+
+  /*
+   * The generation to pass to put for a lookup which starts now.
+   */
+  int64_t getGeneration();
+
+  bool get(const std::string& path, FileStatus* status, bool* exist);
+
+  /*
+   * Cache the result of a lookup, unless path was invalidated since the
+   * lookup started, the result may be stale then. Invalidations of other
+   * paths do not matter.
+   */
+  void put(const std::string& path, const FileStatus& status, bool exist,
+           int64_t generation);
+
+  /*
+   * Drop path and its ancestors, whose modification time changes with it,
+   * and everything below path if subtree is true.
+   */
+  void invalidate(const std::string& path, bool subtree);
+
+  struct Entry {
+    FileStatus status;
+    bool exist;
+    steady_clock::time_point time;
+  };
+
+ private:
+  bool invalidatedSince(const std::string& path, int64_t generation) const;
+
+ private:
+  const int cacheSize;
+  int64_t expireTimeInterval;          // milliseconds
+  int64_t negativeExpireTimeInterval;  // milliseconds
+  LruMap<std::string, Entry> map;
+
+  /*
+   * The generation of the last invalidation of each path, for the path
+   * itself and its ancestors in changed, for a subtree in changedBelow.
+   * They are forgotten once there are too many, lookups which started
+   * before that are not cached.
+   */
+  mutex mut;
+  int64_t generation;
+  int64_t forgotten;
+  unordered_map<std::string, int64_t> changed;
+  unordered_map<std::string, int64_t> changedBelow;
+};
+
+/*
+ * Invalidate paths in the cache when it goes out of scope,
+ * after the change succeeded or failed.
+ */
+class FileStatusInvalidator {
+ public:
+  FileStatusInvalidator(FileStatusCache& cache, const std::string& path,
+                        bool subtree)
+      : cache(cache), paths(1, path), subtree(subtree) {}
+
+  FileStatusInvalidator(FileStatusCache& cache,
+                        const std::vector<std::string>& paths, bool subtree)
+      : cache(cache), paths(paths), subtree(subtree) {}
+
+  ~FileStatusInvalidator() {
+    for (size_t i = 0; i < paths.size(); ++i) {
+      cache.invalidate(paths[i], subtree);
+    }
+  }
+
+ private:
+  FileStatusCache& cache;
+  const std::vector<std::string> paths;
+  bool subtree;
+};
+}
+}
+
+#endif /* _HDFS_LIBHDFS3_CLIENT_FILESTATUSCACHE_H_ */
@@ -19,6 +19,7 @@
  * See the License for the specific language governing permissions and
  * limitations under the License.
  */
+#include "CopyEngine.h"
 #include "DirectoryIterator.h"
 #include "EncryptionZoneIterator.h"
 #include "Exception.h"
@@ -346,6 +347,22 @@ FileStatus FileSystem::getFileStatus(const char * path) const {
     return impl->filesystem->getFileStatus(path);
 }
 
+/**
+ * To get the information of many paths. The NameNode calls are
+ * pipelined, up to rpc.client.max.inflight of them at a time.
+ * @param paths the paths which information is to be returned.
+ * @param exist set to false for the paths which do not exist.
+ * @return the path information, in the order of paths.
+ */
+std::vector<FileStatus> FileSystem::getFileStatusBatch(const std::vector<std::string> & paths,
+        std::vector<bool> & exist) const {
+    if (!impl) {
+        THROW(HdfsIOException, "FileSystem: not connected.");
+    }
+
+    return impl->filesystem->getFileStatusBatch(paths, exist);
+}
+
 /**
  * Return an array containing hostnames, offset and size of
  * portions of the given file.
@@ -369,6 +386,14 @@ std::vector<BlockLocation> FileSystem::getFileBlockLocations(const char * path,
     return impl->filesystem->getFileBlockLocations(path, start, len);
 }
 
+FileChecksum FileSystem::getFileChecksum(const char * path) {
+    if (!impl) {
+        THROW(HdfsIOException, "FileSystem: not connected.");
+    }
+
+    return impl->filesystem->getFileChecksum(path);
+}
+
 /**
  * list the contents of a directory.
  * @param path the directory path.
@@ -467,6 +492,23 @@ bool FileSystem::rename(const char * src, const char * dst) {
     return impl->filesystem->rename(src, dst);
 }
 
+void FileSystem::concat(const char * trg, const std::vector<std::string> & srcs) {
+    if (!impl) {
+        THROW(HdfsIOException, "FileSystem: not connected.");
+    }
+
+    impl->filesystem->concat(trg, srcs);
+}
+
+CopyProgress FileSystem::copyTree(const char * src, FileSystem & dstFs, const char * dst,
+                                  const CopyOptions & options) {
+    if (!impl || !dstFs.impl) {
+        THROW(HdfsIOException, "FileSystem: not connected.");
+    }
+
+    return CopyEngine(impl->filesystem, dstFs.impl->filesystem, options).copyTree(src, dst);
+}
+
 /**
  * To set working directory.
  * @param path new working directory.
@@ -23,8 +23,10 @@
 #define _HDFS_LIBHDFS3_CLIENT_FILESYSTEM_H_
 
 #include "BlockLocation.h"
+#include "CopyOptions.h"
 #include "DirectoryIterator.h"
 #include "EncryptionZoneIterator.h"
+#include "FileChecksum.h"
 #include "FileStatus.h"
 #include "FileSystemStats.h"
 #include "EncryptionZoneInfo.h"
@@ -137,6 +139,16 @@ public:
      */
     FileStatus getFileStatus(const char * path) const;
 
+    /**
+     * To get the information of many paths. The NameNode calls are
+     * pipelined, up to rpc.client.max.inflight of them at a time.
+     * @param paths the paths which information is to be returned.
+     * @param exist set to false for the paths which do not exist.
+     * @return the path information, in the order of paths.
+     */
+    std::vector<FileStatus> getFileStatusBatch(const std::vector<std::string> & paths,
+                                               std::vector<bool> & exist) const;
+
     /**
      * Return an array containing hostnames, offset and size of
      * portions of the given file.
@@ -154,6 +166,16 @@ public:
     std::vector<BlockLocation> getFileBlockLocations(const char * path,
             int64_t start, int64_t len);
 
+    /**
+     * Get the checksum of a file, the MD5 of the MD5s of the CRCs of its
+     * blocks computed by the datanodes, so no block data is read.
+     * Files with the same content, block size and bytes per checksum
+     * have the same checksum.
+     * @param path the file path.
+     * @return the checksum of the file.
+     */
+    FileChecksum getFileChecksum(const char * path);
+
     /**
      * list the contents of a directory.
      * @param path The directory path.
@@ -209,6 +231,28 @@ public:
      */
     bool rename(const char * src, const char * dst);
 
+    /**
+     * To move the blocks of files to the end of an existing file and delete them.
+     * @param trg the existing file to append the blocks to.
+     * @param srcs the files to move the blocks of, in the directory of trg,
+     *  with the same block size and full blocks except the last one.
+     */
+    void concat(const char * trg, const std::vector<std::string> & srcs);
+
+    /**
+     * Copy a file or mirror a directory tree to a file system, which may
+     * be this one. The files are copied in parallel, large files in parts
+     * of whole blocks, see CopyOptions.
+     * @param src the file or directory to copy.
+     * @param dstFs the file system to copy to.
+     * @param dst the path of the copy, a file copied to an existing
+     *  directory goes into it.
+     * @param options how to copy.
+     * @return the counters of the copy.
+     */
+    CopyProgress copyTree(const char * src, FileSystem & dstFs, const char * dst,
+                          const CopyOptions & options = CopyOptions());
+
     /**
      * To set working directory.
      * @param path new working directory.
@@ -25,6 +25,7 @@
 #include "EncryptionZoneIterator.h"
 #include "Exception.h"
 #include "ExceptionInternal.h"
+#include "FileChecksumHelper.h"
 #include "FileStatus.h"
 #include "FileSystemImpl.h"
 #include "FileSystemStats.h"
@@ -40,6 +41,7 @@
 #include "StringUtil.h"
 
 #include <cstring>
+#include <deque>
 #include <inttypes.h>
 #include <libxml/uri.h>
 #include <strings.h>
@@ -101,7 +103,7 @@ FileSystemImpl::FileSystemImpl(const FileSystemKey& key, const Config& c)
       key(key),
       openedOutputStream(0),
       nn(NULL),
-      sconf(c),
+      sconf(new SessionConfig(c)),
       user(key.getUser()) {
     static atomic<uint32_t> count(0);
     std::stringstream ss;
@@ -111,12 +113,15 @@ FileSystemImpl::FileSystemImpl(const FileSystemKey& key, const Config& c)
        << getpid() << "_tid_" << pthread_self();
     clientName = ss.str();
     workingDir = std::string("/user/") + user.getEffectiveUser();
-    peerCache = shared_ptr<PeerCache>(new PeerCache(sconf));
+    peerCache = shared_ptr<PeerCache>(new PeerCache(*sconf));
+    dekCache = shared_ptr<DekCache>(new DekCache(*sconf));
+    statusCache = shared_ptr<FileStatusCache>(new FileStatusCache(*sconf));
 #ifdef MOCK
     stub = NULL;
 #endif
     //set log level
-    RootLogger.setLogSeverity(sconf.getLogSeverity());
+    RootLogger.setLogSeverity(sconf->getLogSeverity());
+    RootLogger.configure(sconf->isLogAsync(), sconf->getLogRateLimit());
 }
 
 /**
@@ -138,13 +143,23 @@ const std::string FileSystemImpl::getStandardPath(const char * path) {
     return CanonicalizePath(GetAbsPath(base, path));
 }
 
+std::string FileSystemImpl::getUri() const {
+    std::string uri = key.getScheme() + "://" + key.getHost();
+
+    if (!key.getPort().empty()) {
+        uri += ":" + key.getPort();
+    }
+
+    return uri;
+}
+
 const char * FileSystemImpl::getClientName() {
     return clientName.c_str();
 }
 
 void FileSystemImpl::connect() {
     std::string host, port, uri;
-    std::vector<NamenodeInfo> namenodeInfos;
+    std::vector<NamenodeInfo> namenodeInfos, observerInfos;
 
     if (nn) {
         THROW(HdfsIOException, "FileSystemImpl: already connected.");
@@ -157,6 +172,7 @@ void FileSystemImpl::connect() {
     if (port.empty()) {
         try {
             namenodeInfos = NamenodeInfo::GetHANamenodeInfo(key.getHost(), conf);
+            observerInfos = NamenodeInfo::GetObserverNamenodeInfo(key.getHost(), conf);
         } catch (const HdfsConfigNotFound & e) {
             NESTED_THROW(InvalidParameter, "Cannot parse URI: %s, missing port or invalid HA configuration", uri.c_str());
         }
@@ -175,7 +191,8 @@ void FileSystemImpl::connect() {
 #ifdef MOCK
     nn = stub->getNamenode();
 #else
-    nn = new NamenodeProxy(namenodeInfos, tokenService, sconf, RpcAuth(user, RpcAuth::ParseMethod(sconf.getRpcAuthMethod())));
+    nn = new NamenodeProxy(namenodeInfos, observerInfos, tokenService, *sconf,
+                           RpcAuth(user, RpcAuth::ParseMethod(sconf->getRpcAuthMethod())));
 #endif
     /*
      * To test if the connection is ok
@@ -200,7 +217,7 @@ void FileSystemImpl::disconnect() {
  * @return the default number of replication.
  */
 int FileSystemImpl::getDefaultReplication() const {
-    return sconf.getDefaultReplica();
+    return sconf->getDefaultReplica();
 }
 
 /**
@@ -208,7 +225,7 @@ int FileSystemImpl::getDefaultReplication() const {
  * @return the default block size.
  */
 int64_t FileSystemImpl::getDefaultBlockSize() const {
-    return sconf.getDefaultBlockSize();
+    return sconf->getDefaultBlockSize();
 }
 
 /**
@@ -235,7 +252,9 @@ bool FileSystemImpl::deletePath(const char * path, bool recursive) {
         THROW(InvalidParameter, "Invalid input: path should not be empty");
     }
 
-    return nn->deleteFile(getStandardPath(path), recursive);
+    std::string absPath = getStandardPath(path);
+    FileStatusInvalidator invalidator(*statusCache, absPath, true);
+    return nn->deleteFile(absPath, recursive);
 }
 
 /**
@@ -254,7 +273,9 @@ bool FileSystemImpl::mkdir(const char * path, const Permission & permission) {
         THROW(InvalidParameter, "Invalid input: path should not be empty");
     }
 
-    return nn->mkdirs(getStandardPath(path), permission, false);
+    std::string absPath = getStandardPath(path);
+    FileStatusInvalidator invalidator(*statusCache, absPath, false);
+    return nn->mkdirs(absPath, permission, false);
 }
 
 /**
@@ -274,7 +295,9 @@ bool FileSystemImpl::mkdirs(const char * path, const Permission & permission) {
         THROW(InvalidParameter, "Invalid input: path should not be empty");
     }
 
-    return nn->mkdirs(getStandardPath(path), permission, true);
+    std::string absPath = getStandardPath(path);
+    FileStatusInvalidator invalidator(*statusCache, absPath, false);
+    return nn->mkdirs(absPath, permission, true);
 }
 
 /**
@@ -291,7 +314,82 @@ FileStatus FileSystemImpl::getFileStatus(const char * path) {
         THROW(InvalidParameter, "Invalid input: path should not be empty");
     }
 
-    return nn->getFileInfo(getStandardPath(path), NULL);
+    std::string absPath = getStandardPath(path);
+    bool exist = false;
+    FileStatus retval = lookupFileStatus(absPath, &exist);
+
+    if (!exist) {
+        THROW(FileNotFoundException, "Path %s does not exist.", absPath.c_str());
+    }
+
+    return retval;
+}
+
+FileStatus FileSystemImpl::lookupFileStatus(const std::string & src, bool * exist) {
+    FileStatus retval;
+
+    if (!statusCache->isEnabled()) {
+        return nn->getFileInfo(src, exist);
+    }
+
+    if (statusCache->get(src, &retval, exist)) {
+        return retval;
+    }
+
+    int64_t generation = statusCache->getGeneration();
+    retval = nn->getFileInfo(src, exist);
+    statusCache->put(src, retval, *exist, generation);
+    return retval;
+}
+
+std::vector<FileStatus> FileSystemImpl::getFileStatusBatch(const std::vector<std::string> & paths,
+        std::vector<bool> & exist) {
+    if (!nn) {
+        THROW(HdfsIOException, "FileSystemImpl: not connected.");
+    }
+
+    for (size_t i = 0; i < paths.size(); ++i) {
+        if (paths[i].empty()) {
+            THROW(InvalidParameter, "Invalid input: path should not be empty");
+        }
+    }
+
+    size_t window = sconf->getRpcMaxInflight();
+    size_t sent = 0;
+    std::deque<shared_ptr<FileInfoFuture> > pending;
+    std::vector<FileStatus> retval(paths.size());
+    std::vector<std::string> absPaths;
+    std::vector<size_t> misses;
+    exist.assign(paths.size(), false);
+
+    for (size_t i = 0; i < paths.size(); ++i) {
+        bool found = false;
+        absPaths.push_back(getStandardPath(paths[i].c_str()));
+
+        if (statusCache->get(absPaths[i], &retval[i], &found)) {
+            exist[i] = found;
+        } else {
+            misses.push_back(i);
+        }
+    }
+
+    int64_t generation = statusCache->getGeneration();
+
+    for (size_t i = 0; i < misses.size(); ++i) {
+        while (sent < misses.size() && sent - i < window) {
+            pending.push_back(nn->getFileInfoAsync(absPaths[misses[sent]]));
+            ++sent;
+        }
+
+        bool found = false;
+        size_t index = misses[i];
+        retval[index] = pending.front()->get(&found);
+        exist[index] = found;
+        pending.pop_front();
+        statusCache->put(absPaths[index], retval[index], found, generation);
+    }
+
+    return retval;
 }
 
 static void Convert(BlockLocation & bl, const LocatedBlock & lb) {
@@ -344,6 +442,18 @@ std::vector<BlockLocation> FileSystemImpl::getFileBlockLocations(
     return retval;
 }
 
+FileChecksum FileSystemImpl::getFileChecksum(const char * path) {
+    if (!nn) {
+        THROW(HdfsIOException, "FileSystemImpl: not connected.");
+    }
+
+    if (NULL == path || !strlen(path)) {
+        THROW(InvalidParameter, "Invalid input: path should not be empty");
+    }
+
+    return FileChecksumHelper(*this, getStandardPath(path)).compute();
+}
+
 /**
  * list the contents of a directory.
  * @param path the directory path.
@@ -411,7 +521,9 @@ void FileSystemImpl::setOwner(const char * path, const char * username,
               "Invalid input: username and groupname should not be empty");
     }
 
-    nn->setOwner(getStandardPath(path), username != NULL ? username : "",
+    std::string absPath = getStandardPath(path);
+    FileStatusInvalidator invalidator(*statusCache, absPath, false);
+    nn->setOwner(absPath, username != NULL ? username : "",
                  groupname != NULL ? groupname : "");
 }
 
@@ -430,7 +542,9 @@ void FileSystemImpl::setTimes(const char * path, int64_t mtime, int64_t atime) {
         THROW(InvalidParameter, "Invalid input: path should not be empty");
     }
 
-    nn->setTimes(getStandardPath(path), mtime, atime);
+    std::string absPath = getStandardPath(path);
+    FileStatusInvalidator invalidator(*statusCache, absPath, false);
+    nn->setTimes(absPath, mtime, atime);
 }
 
 /**
@@ -448,7 +562,9 @@ void FileSystemImpl::setPermission(const char * path,
         THROW(InvalidParameter, "Invalid input: path should not be empty");
     }
 
-    nn->setPermission(getStandardPath(path), permission);
+    std::string absPath = getStandardPath(path);
+    FileStatusInvalidator invalidator(*statusCache, absPath, false);
+    nn->setPermission(absPath, permission);
 }
 
 /**
@@ -467,7 +583,9 @@ bool FileSystemImpl::setReplication(const char * path, short replication) {
         THROW(InvalidParameter, "Invalid input: path should not be empty");
     }
 
-    return nn->setReplication(getStandardPath(path), replication);
+    std::string absPath = getStandardPath(path);
+    FileStatusInvalidator invalidator(*statusCache, absPath, false);
+    return nn->setReplication(absPath, replication);
 }
 
 /**
@@ -490,7 +608,37 @@ bool FileSystemImpl::rename(const char * src, const char * dst) {
         THROW(InvalidParameter, "Invalid input: dst should not be empty");
     }
 
-    return nn->rename(getStandardPath(src), getStandardPath(dst));
+    std::string absSrc = getStandardPath(src);
+    std::string absDst = getStandardPath(dst);
+    FileStatusInvalidator srcInvalidator(*statusCache, absSrc, true);
+    FileStatusInvalidator dstInvalidator(*statusCache, absDst, true);
+    return nn->rename(absSrc, absDst);
+}
+
+void FileSystemImpl::concat(const char * trg, const std::vector<std::string> & srcs) {
+    if (!nn) {
+        THROW(HdfsIOException, "FileSystemImpl: not connected.");
+    }
+
+    if (NULL == trg || !strlen(trg)) {
+        THROW(InvalidParameter, "Invalid input: trg should not be empty");
+    }
+
+    if (srcs.empty()) {
+        THROW(InvalidParameter, "Invalid input: srcs should not be empty");
+    }
+
+    std::string absTrg = getStandardPath(trg);
+    std::vector<std::string> absSrcs;
+    FileStatusInvalidator trgInvalidator(*statusCache, absTrg, false);
+
+    for (size_t i = 0; i < srcs.size(); ++i) {
+        absSrcs.push_back(getStandardPath(srcs[i].c_str()));
+    }
+
+    // a failed concat may have removed some of the sources already
+    FileStatusInvalidator srcInvalidator(*statusCache, absSrcs, false);
+    nn->concat(absTrg, absSrcs);
 }
 
 /**
@@ -536,7 +684,7 @@ bool FileSystemImpl::exist(const char * path) {
 
     try {
         bool retval = true;
-        nn->getFileInfo(getStandardPath(path), &retval);
+        lookupFileStatus(getStandardPath(path), &retval);
         return retval;
     } catch (const FileNotFoundException & e) {
         return false;
@@ -579,7 +727,7 @@ bool FileSystemImpl::truncate(const char * path, int64_t size) {
     }
 
     std::string absPath = getStandardPath(path);
-
+    FileStatusInvalidator invalidator(*statusCache, absPath, false);
     return nn->truncate(absPath, size, clientName);
 }
 
@@ -636,6 +784,7 @@ void FileSystemImpl::create(const std::string & src, const Permission & masked,
         THROW(HdfsIOException, "FileSystemImpl: not connected.");
     }
 
+    FileStatusInvalidator invalidator(*statusCache, src, false);
     nn->create(src, masked, clientName, flag, createParent, replication,
                blockSize);
 }
@@ -646,6 +795,7 @@ FileSystemImpl::append(const std::string& src) {
         THROW(HdfsIOException, "FileSystemImpl: not connected.");
     }
 
+    FileStatusInvalidator invalidator(*statusCache, src, false);
     return nn->append(src, clientName);
 }
 
@@ -660,12 +810,13 @@ void FileSystemImpl::abandonBlock(const ExtendedBlock & b,
 
 shared_ptr<LocatedBlock> FileSystemImpl::addBlock(const std::string & src,
         const ExtendedBlock * previous,
-        const std::vector<DatanodeInfo> & excludeNodes) {
+        const std::vector<DatanodeInfo> & excludeNodes,
+        const std::vector<std::string> & favoredNodes) {
     if (!nn) {
         THROW(HdfsIOException, "FileSystemImpl: not connected.");
     }
 
-    return nn->addBlock(src, clientName, previous, excludeNodes);
+    return nn->addBlock(src, clientName, previous, excludeNodes, favoredNodes);
 }
 
 shared_ptr<LocatedBlock> FileSystemImpl::getAdditionalDatanode(
@@ -687,6 +838,7 @@ bool FileSystemImpl::complete(const std::string & src,
         THROW(HdfsIOException, "FileSystemImpl: not connected.");
     }
 
+    FileStatusInvalidator invalidator(*statusCache, src, false);
     return nn->complete(src, clientName, last);
 }
 
@@ -703,6 +855,7 @@ void FileSystemImpl::fsync(const std::string & src) {
         THROW(HdfsIOException, "FileSystemImpl: not connected.");
     }
 
+    FileStatusInvalidator invalidator(*statusCache, src, false);
     nn->fsync(src, clientName);
 }
 
@@ -797,7 +950,9 @@ bool FileSystemImpl::createEncryptionZone(const char * path, const char * keyNam
         THROW(InvalidParameter, "Invalid input: key name should not be empty");
     }
 
-    return nn->createEncryptionZone(getStandardPath(path), keyName);
+    std::string absPath = getStandardPath(path);
+    FileStatusInvalidator invalidator(*statusCache, absPath, false);
+    return nn->createEncryptionZone(absPath, keyName);
 }
 
 
@@ -26,6 +26,7 @@
 #include "DirectoryIterator.h"
 #include "EncryptionZoneIterator.h"
 #include "FileStatus.h"
+#include "FileStatusCache.h"
 #include "FileSystemInter.h"
 #include "FileSystemKey.h"
 #include "FileSystemStats.h"
@@ -136,6 +137,16 @@ public:
      */
     FileStatus getFileStatus(const char * path);
 
+    /**
+     * To get the information of many paths. The NameNode calls are
+     * pipelined, up to rpc.client.max.inflight of them at a time.
+     * @param paths the paths which information is to be returned.
+     * @param exist set to false for the paths which do not exist.
+     * @return the path information, in the order of paths.
+     */
+    std::vector<FileStatus> getFileStatusBatch(const std::vector<std::string> & paths,
+                                               std::vector<bool> & exist);
+
     /**
      * Return an array containing hostnames, offset and size of
      * portions of the given file.
@@ -153,6 +164,11 @@ public:
     std::vector<BlockLocation> getFileBlockLocations(
         const char * path, int64_t start, int64_t len);
 
+    /**
+     * @ref FileSystem::getFileChecksum
+     */
+    FileChecksum getFileChecksum(const char * path);
+
     /**
      * list the contents of a directory.
      * @param path the directory path.
@@ -209,6 +225,14 @@ public:
      */
     bool rename(const char * src, const char * dst);
 
+    /**
+     * To move the blocks of files to the end of an existing file and delete them.
+     * @param trg the existing file to append the blocks to.
+     * @param srcs the files to move the blocks of, in the directory of trg,
+     *  with the same block size and full blocks except the last one.
+     */
+    void concat(const char * trg, const std::vector<std::string> & srcs);
+
     /**
      * To set working directory.
      * @param path new working directory.
@@ -342,11 +366,13 @@ public:
      * @param src the file being created
      * @param previous  previous block
      * @param excludeNodes a list of nodes that should not be allocated for the current block.
+     * @param favoredNodes host:port of the datanodes to place the replicas on if possible.
      * @return return the new block.
      */
     shared_ptr<LocatedBlock> addBlock(const std::string & src,
                                       const ExtendedBlock * previous,
-                                      const std::vector<DatanodeInfo> & excludeNodes);
+                                      const std::vector<DatanodeInfo> & excludeNodes,
+                                      const std::vector<std::string> & favoredNodes);
 
     /**
      * Get a datanode for an existing pipeline.
@@ -440,6 +466,14 @@ public:
      * @return return the configuration instance.
      */
     const SessionConfig & getConf() const {
+        return *sconf;
+    }
+
+    /**
+     * Get the configuration snapshot shared by all streams.
+     * @return return the shared configuration instance.
+     */
+    shared_ptr<const SessionConfig> getSharedConf() const {
         return sconf;
     }
 
@@ -451,6 +485,12 @@ public:
         return user;
     }
 
+    /**
+     * Get the URI of the cluster.
+     * @return return the scheme and authority the filesystem was connected with.
+     */
+    std::string getUri() const;
+
     /**
      * Get a partial listing of the indicated directory
      *
@@ -479,6 +519,10 @@ public:
         return *peerCache;
     }
 
+    DekCache& getDekCache() {
+        return *dekCache;
+    }
+
     /**
      * Create encryption zone for the directory with specific key name
      * @param path the directory path which is to be created.
@@ -517,14 +561,25 @@ public:
      */
     std::vector<EncryptionZoneInfo> listAllEncryptionZoneItems();
 
+private:
+    /**
+     * Get the status of a path from the cache or the namenode.
+     * @param src the absolute canonicalized path.
+     * @param exist set to whether the path exists.
+     * @return the path information if it exists.
+     */
+    FileStatus lookupFileStatus(const std::string & src, bool * exist);
+
 private:
     Config conf;
     FileSystemKey key;
     int openedOutputStream;
     mutex mutWorkingDir;
     Namenode * nn;
-    SessionConfig sconf;
+    shared_ptr<const SessionConfig> sconf;
     shared_ptr<PeerCache> peerCache;
+    shared_ptr<DekCache> dekCache;
+    shared_ptr<FileStatusCache> statusCache;
     std::string clientName;
     std::string tokenService;
     std::string workingDir;
@@ -28,10 +28,12 @@
 #include "BlockLocation.h"
 #include "DirectoryIterator.h"
 #include "EncryptionZoneIterator.h"
+#include "FileChecksum.h"
 #include "FileStatus.h"
 #include "FileSystemKey.h"
 #include "FileSystemStats.h"
 #include "EncryptionZoneInfo.h"
+#include "DekCache.h"
 #include "PeerCache.h"
 #include "Permission.h"
 #include "server/LocatedBlocks.h"
@@ -140,6 +142,16 @@ public:
      */
     virtual FileStatus getFileStatus(const char * path) = 0;
 
+    /**
+     * To get the information of many paths. The NameNode calls are
+     * pipelined, up to rpc.client.max.inflight of them at a time.
+     * @param paths the paths which information is to be returned.
+     * @param exist set to false for the paths which do not exist.
+     * @return the path information, in the order of paths.
+     */
+    virtual std::vector<FileStatus> getFileStatusBatch(const std::vector<std::string> & paths,
+            std::vector<bool> & exist) = 0;
+
     /**
      * Return an array containing hostnames, offset and size of
      * portions of the given file.
@@ -157,6 +169,11 @@ public:
     virtual std::vector<BlockLocation> getFileBlockLocations(
         const char * path, int64_t start, int64_t len) = 0;
 
+    /**
+     * @ref FileSystem::getFileChecksum
+     */
+    virtual FileChecksum getFileChecksum(const char * path) = 0;
+
     /**
      * list the contents of a directory.
      * @param path the directory path.
@@ -215,6 +232,14 @@ public:
      */
     virtual bool rename(const char * src, const char * dst) = 0;
 
+    /**
+     * To move the blocks of files to the end of an existing file and delete them.
+     * @param trg the existing file to append the blocks to.
+     * @param srcs the files to move the blocks of, in the directory of trg,
+     *  with the same block size and full blocks except the last one.
+     */
+    virtual void concat(const char * trg, const std::vector<std::string> & srcs) = 0;
+
     /**
      * To set working directory.
      * @param path new working directory.
@@ -349,11 +374,13 @@ public:
      * @param src the file being created
      * @param previous  previous block
      * @param excludeNodes a list of nodes that should not be allocated for the current block.
+     * @param favoredNodes host:port of the datanodes to place the replicas on if possible.
      * @return return the new block.
      */
     virtual shared_ptr<LocatedBlock> addBlock(const std::string & src,
             const ExtendedBlock * previous,
-            const std::vector<DatanodeInfo> & excludeNodes) = 0;
+            const std::vector<DatanodeInfo> & excludeNodes,
+            const std::vector<std::string> & favoredNodes) = 0;
 
     /**
      * Get a datanode for an existing pipeline.
@@ -452,12 +479,25 @@ public:
      */
     virtual const SessionConfig & getConf() const = 0;
 
+    /**
+     * Get the immutable configuration snapshot shared by all streams
+     * opened on this filesystem.
+     * @return return the shared configuration instance.
+     */
+    virtual shared_ptr<const SessionConfig> getSharedConf() const = 0;
+
     /**
      * Get the user used in filesystem.
      * @return return the user information.
      */
     virtual const UserInfo & getUserInfo() const = 0;
 
+    /**
+     * Get the URI of the cluster, e.g. hdfs://host:port or hdfs://nameservice.
+     * @return return the scheme and authority the filesystem was connected with.
+     */
+    virtual std::string getUri() const = 0;
+
     /**
      * Get a partial listing of the indicated directory
      *
@@ -484,6 +524,11 @@ public:
      */
     virtual PeerCache& getPeerCache() = 0;
 
+    /**
+     * Get the decrypted encryption keys cache of this filesystem.
+     */
+    virtual DekCache& getDekCache() = 0;
+
     /**
      * Create encryption zone for the directory with specific key name
      * @param path the directory path which is to be created.
@@ -21,6 +21,7 @@
  */
 #include "platform.h"
 
+#include "AsyncExecutor.h"
 #include "Exception.h"
 #include "ExceptionInternal.h"
 #include "FileSystem.h"
@@ -33,8 +34,11 @@
 #include "server/NamenodeInfo.h"
 #include "SessionConfig.h"
 #include "Thread.h"
+#include "Metrics.h"
+#include "Trace.h"
 #include "XmlConfig.h"
 
+#include <algorithm>
 #include <vector>
 #include <string>
 #include <libxml/uri.h>
@@ -91,6 +95,16 @@ using Hdfs::Config;
 using Hdfs::Internal::shared_ptr;
 using Hdfs::NamenodeInfo;
 using Hdfs::FileNotFoundException;
+using Hdfs::Internal::AsyncExecutor;
+using Hdfs::Internal::HistogramSnapshot;
+using Hdfs::Internal::MetricCounter;
+using Hdfs::Internal::MetricHistogram;
+using Hdfs::Internal::Metrics;
+using Hdfs::Internal::MetricsSnapshot;
+using Hdfs::Internal::METRIC_COUNTER_COUNT;
+using Hdfs::Internal::METRIC_HISTOGRAM_COUNT;
+using Hdfs::Internal::TraceRecord;
+using Hdfs::Internal::Tracer;
 
 struct HdfsFileInternalWrapper {
 public:
@@ -193,6 +207,10 @@ public:
         init(path, true);
     }
 
+    DefaultConfig(const char * path, bool reportError) : conf(new Hdfs::Config) {
+        init(path, reportError);
+    }
+
     shared_ptr<Config> getConfig() {
         return conf;
     }
@@ -202,7 +220,7 @@ private:
         if (access(confPath.c_str(), R_OK)) {
             if (reportError) {
                 LOG(Hdfs::Internal::LOG_ERROR,
-                    "Environment variable LIBHDFS3_CONF is set but %s cannot be read",
+                    "Configuration file %s cannot be read",
                     confPath.c_str());
             } else {
                 return;
@@ -221,6 +239,11 @@ public:
         conf(DefaultConfig().getConfig()), port(0) {
     }
 
+    hdfsBuilder(const char * confPath) :
+        conf(confPath && strlen(confPath) > 0 ? DefaultConfig(confPath).getConfig()
+             : DefaultConfig("hdfs-client.xml", false).getConfig()), port(0) {
+    }
+
     ~hdfsBuilder() {
     }
 
@@ -511,6 +534,20 @@ struct hdfsBuilder * hdfsNewBuilder(void) {
     return NULL;
 }
 
+struct hdfsBuilder * hdfsNewBuilderWithConf(const char * conf) {
+    try {
+        return new struct hdfsBuilder(conf);
+    } catch (const std::bad_alloc & e) {
+        SetErrorMessage("Out of memory");
+        errno = ENOMEM;
+    } catch (...) {
+        SetLastException(Hdfs::current_exception());
+        handleException(Hdfs::current_exception());
+    }
+
+    return NULL;
+}
+
 void hdfsFreeBuilder(struct hdfsBuilder * bld) {
     delete bld;
 }
@@ -870,12 +907,123 @@ int hdfsAvailable(hdfsFS fs, hdfsFile file) {
     return -1;
 }
 
+int hdfsFileSetCachingStrategy(hdfsFS fs, hdfsFile file, int dropBehind, tOffset readahead) {
+    PARAMETER_ASSERT(fs && file, -1, EINVAL);
+
+    try {
+        Hdfs::CachingStrategy strategy(dropBehind, readahead);
+
+        if (file->isInput()) {
+            file->getInputStream().setCachingStrategy(strategy);
+        } else {
+            file->getOutputStream().setCachingStrategy(strategy);
+        }
+
+        return 0;
+    } catch (const std::bad_alloc & e) {
+        SetErrorMessage("Out of memory");
+        errno = ENOMEM;
+    } catch (...) {
+        SetLastException(Hdfs::current_exception());
+        handleException(Hdfs::current_exception());
+    }
+
+    return -1;
+}
+
+int hdfsFileSetFavoredNodes(hdfsFS fs, hdfsFile file, const char * const * nodes, int numNodes) {
+    PARAMETER_ASSERT(fs && file && !file->isInput(), -1, EINVAL);
+    PARAMETER_ASSERT(numNodes >= 0 && (nodes || numNodes == 0), -1, EINVAL);
+
+    try {
+        std::vector<std::string> favored;
+
+        for (int i = 0; i < numNodes; ++i) {
+            PARAMETER_ASSERT(nodes[i] && strlen(nodes[i]) > 0, -1, EINVAL);
+            favored.push_back(nodes[i]);
+        }
+
+        file->getOutputStream().setFavoredNodes(favored);
+        return 0;
+    } catch (const std::bad_alloc & e) {
+        SetErrorMessage("Out of memory");
+        errno = ENOMEM;
+    } catch (...) {
+        SetLastException(Hdfs::current_exception());
+        handleException(Hdfs::current_exception());
+    }
+
+    return -1;
+}
+
 int hdfsCopy(hdfsFS srcFS, const char *src, hdfsFS dstFS, const char *dst) {
+    return hdfsCopyTree(srcFS, src, dstFS, dst, NULL, NULL);
+}
+
+static void ConvertCopyProgress(const Hdfs::CopyProgress & progress, hdfsCopyProgress * result) {
+    result->files = progress.getFiles();
+    result->filesCopied = progress.getFilesCopied();
+    result->filesSkipped = progress.getFilesSkipped();
+    result->bytes = progress.getBytes();
+    result->bytesCopied = progress.getBytesCopied();
+    result->bytesSkipped = progress.getBytesSkipped();
+}
+
+static void CopyProgressCallback(const Hdfs::CopyProgress & progress, void * data) {
+    const hdfsCopyOptions * options = static_cast<const hdfsCopyOptions *>(data);
+    hdfsCopyProgress result;
+    ConvertCopyProgress(progress, &result);
+    options->progress(&result, options->data);
+}
+
+int hdfsCopyTree(hdfsFS srcFS, const char * src, hdfsFS dstFS, const char * dst,
+                 const hdfsCopyOptions * options, hdfsCopyProgress * progress) {
     PARAMETER_ASSERT(srcFS && dstFS, -1, EINVAL);
     PARAMETER_ASSERT(src && strlen(src) > 0, -1, EINVAL);
     PARAMETER_ASSERT(dst && strlen(dst) > 0, -1, EINVAL);
+    PARAMETER_ASSERT(!options || (options->parallelism >= 0 && options->bufferSize >= 0
+                                  && options->blocksPerPart >= -1), -1, EINVAL);
+
+    try {
+        Hdfs::CopyOptions copyOptions;
+
+        if (options) {
+            if (options->parallelism > 0) {
+                copyOptions.setParallelism(options->parallelism);
+            }
+
+            if (options->bufferSize > 0) {
+                copyOptions.setBufferSize(options->bufferSize);
+            }
+
+            if (options->blocksPerPart != 0) {
+                copyOptions.setBlocksPerPart(options->blocksPerPart < 0 ? 0 : options->blocksPerPart);
+            }
+
+            if (options->progress) {
+                copyOptions.setProgressCallback(CopyProgressCallback, const_cast<hdfsCopyOptions *>(options));
+            }
+
+            copyOptions.setSkipIfChecksumMatches(options->skipIfChecksumMatches);
+            copyOptions.setPreserve(options->preserve & Hdfs::CopyOptions::PreserveAll);
+        }
+
+        Hdfs::CopyProgress result = srcFS->getFilesystem().copyTree(src, dstFS->getFilesystem(), dst,
+                                    copyOptions);
+
+        if (progress) {
+            ConvertCopyProgress(result, progress);
+        }
+
+        return 0;
+    } catch (const std::bad_alloc & e) {
+        SetErrorMessage("Out of memory");
+        errno = ENOMEM;
+    } catch (...) {
+        SetLastException(Hdfs::current_exception());
+        handleException(Hdfs::current_exception());
+    }
 
-    errno = ENOTSUP;
     return -1;
 }
 
@@ -921,6 +1069,31 @@ int hdfsRename(hdfsFS fs, const char * oldPath, const char * newPath) {
     return -1;
 }
 
+int hdfsConcat(hdfsFS fs, const char * trg, const char * const * srcs, int numSrcs) {
+    PARAMETER_ASSERT(fs && trg && strlen(trg) > 0, -1, EINVAL);
+    PARAMETER_ASSERT(srcs && numSrcs > 0, -1, EINVAL);
+
+    try {
+        std::vector<std::string> paths;
+
+        for (int i = 0; i < numSrcs; ++i) {
+            PARAMETER_ASSERT(srcs[i] && strlen(srcs[i]) > 0, -1, EINVAL);
+            paths.push_back(srcs[i]);
+        }
+
+        fs->getFilesystem().concat(trg, paths);
+        return 0;
+    } catch (const std::bad_alloc & e) {
+        SetErrorMessage("Out of memory");
+        errno = ENOMEM;
+    } catch (...) {
+        SetLastException(Hdfs::current_exception());
+        handleException(Hdfs::current_exception());
+    }
+
+    return -1;
+}
+
 char * hdfsGetWorkingDirectory(hdfsFS fs, char * buffer, size_t bufferSize) {
     PARAMETER_ASSERT(fs && buffer && bufferSize > 0, NULL, EINVAL);
 
@@ -1091,6 +1264,48 @@ hdfsFileInfo * hdfsGetPathInfo(hdfsFS fs, const char * path) {
     return NULL;
 }
 
+hdfsFileInfo * hdfsGetPathInfoBatch(hdfsFS fs, const char ** paths, int numPaths) {
+    PARAMETER_ASSERT(fs && paths && numPaths > 0, NULL, EINVAL);
+    hdfsFileInfo * retval = NULL;
+
+    try {
+        std::vector<std::string> p(numPaths);
+
+        for (int i = 0; i < numPaths; ++i) {
+            PARAMETER_ASSERT(paths[i] && strlen(paths[i]) > 0, NULL, EINVAL);
+            p[i] = paths[i];
+        }
+
+        std::vector<bool> exist;
+        std::vector<Hdfs::FileStatus> status =
+            fs->getFilesystem().getFileStatusBatch(p, exist);
+        retval = new hdfsFileInfo[numPaths];
+        memset(retval, 0, sizeof(hdfsFileInfo) * numPaths);
+        ConstructHdfsFileInfo(retval, status);
+
+        for (int i = 0; i < numPaths; ++i) {
+            if (!exist[i]) {
+                delete [] retval[i].mGroup;
+                delete [] retval[i].mName;
+                delete [] retval[i].mOwner;
+                memset(&retval[i], 0, sizeof(hdfsFileInfo));
+            }
+        }
+
+        return retval;
+    } catch (const std::bad_alloc & e) {
+        SetErrorMessage("Out of memory");
+        hdfsFreeFileInfo(retval, numPaths);
+        errno = ENOMEM;
+    } catch (...) {
+        SetLastException(Hdfs::current_exception());
+        hdfsFreeFileInfo(retval, numPaths);
+        handleException(Hdfs::current_exception());
+    }
+
+    return NULL;
+}
+
 void hdfsFreeEncryptionZoneInfo(hdfsEncryptionZoneInfo * infos, int numEntries) {
     for (int i = 0; infos != NULL && i < numEntries; ++i) {
         delete [] infos[i].mPath;
@@ -1471,6 +1686,31 @@ BlockLocation * hdfsGetFileBlockLocations(hdfsFS fs, const char * path,
     return NULL;
 }
 
+int hdfsGetFileChecksum(hdfsFS fs, const char * path, hdfsFileChecksum * checksum) {
+    PARAMETER_ASSERT(fs && checksum && path && strlen(path), -1, EINVAL);
+
+    try {
+        Hdfs::FileChecksum result = fs->getFilesystem().getFileChecksum(path);
+        std::string algorithm = result.getAlgorithmName();
+        std::string bytes = result.getBytes();
+        memset(checksum, 0, sizeof(hdfsFileChecksum));
+        strncpy(checksum->algorithm, algorithm.c_str(), sizeof(checksum->algorithm) - 1);
+        checksum->bytesPerCrc = result.getBytesPerCrc();
+        checksum->crcPerBlock = result.getCrcPerBlock();
+        checksum->length = std::min<int>(bytes.size(), HDFS_FILE_CHECKSUM_MAX_BYTES);
+        memcpy(checksum->bytes, bytes.data(), checksum->length);
+        return 0;
+    } catch (const std::bad_alloc & e) {
+        SetErrorMessage("Out of memory");
+        errno = ENOMEM;
+    } catch (...) {
+        SetLastException(Hdfs::current_exception());
+        handleException(Hdfs::current_exception());
+    }
+
+    return -1;
+}
+
 void hdfsFreeFileBlockLocations(BlockLocation * locations, int numOfBlock) {
     if (!locations) {
         return;
@@ -1560,6 +1800,330 @@ hdfsEncryptionZoneInfo * hdfsListEncryptionZones(hdfsFS fs, int * numEntries) {
     }
     return NULL;
 }
+
+static void ConvertTrace(const TraceRecord & record, hdfsTrace * trace) {
+    memcpy(trace->operation, record.operation, sizeof(trace->operation));
+    trace->start = record.start;
+    trace->duration = record.duration;
+    trace->numSpans = record.numSpans;
+
+    for (int i = 0; i < record.numSpans; ++i) {
+        trace->spans[i].phase = Tracer::PhaseName(record.spans[i].phase);
+        trace->spans[i].count = record.spans[i].count;
+        trace->spans[i].start = record.spans[i].start;
+        trace->spans[i].duration = record.spans[i].duration;
+    }
+}
+
+static THREAD_LOCAL TraceRecord ThreadTrace;
+
+void hdfsTraceBegin(const char * operation) {
+    Tracer::Begin(&ThreadTrace, operation ? operation : "");
+}
+
+int hdfsTraceEnd(hdfsTrace * trace) {
+    PARAMETER_ASSERT(Tracer::Active(), -1, EINVAL);
+    Tracer::End();
+
+    if (trace) {
+        ConvertTrace(ThreadTrace, trace);
+    }
+
+    return 0;
+}
+
+void hdfsTraceSetSampleRate(int n) {
+    Tracer::SetSampleRate(n);
+}
+
+int hdfsTraceTakeSamples(hdfsTrace * traces, int max) {
+    PARAMETER_ASSERT(traces && max >= 0, -1, EINVAL);
+
+    try {
+        std::vector<TraceRecord> records(max);
+        int count = max > 0 ? Tracer::TakeSamples(&records[0], max) : 0;
+
+        for (int i = 0; i < count; ++i) {
+            ConvertTrace(records[i], &traces[i]);
+        }
+
+        return count;
+    } catch (const std::bad_alloc & e) {
+        SetErrorMessage("Out of memory");
+        errno = ENOMEM;
+    }
+
+    return -1;
+}
+
+int hdfsGetMetrics(hdfsMetrics * metrics) {
+    PARAMETER_ASSERT(metrics, -1, EINVAL);
+
+    try {
+        std::vector<MetricsSnapshot> snapshot(1);
+        Metrics::Snapshot(&snapshot[0]);
+        metrics->numCounters = METRIC_COUNTER_COUNT;
+
+        for (int i = 0; i < METRIC_COUNTER_COUNT; ++i) {
+            metrics->counters[i].name = Metrics::CounterName(static_cast<MetricCounter>(i));
+            metrics->counters[i].value = snapshot[0].counters[i];
+        }
+
+        metrics->numHistograms = METRIC_HISTOGRAM_COUNT;
+
+        for (int i = 0; i < METRIC_HISTOGRAM_COUNT; ++i) {
+            const HistogramSnapshot & from = snapshot[0].histograms[i];
+            hdfsMetricHistogram & to = metrics->histograms[i];
+            to.name = Metrics::HistogramName(static_cast<MetricHistogram>(i));
+            to.count = from.count;
+            to.sum = from.sum;
+            to.min = from.min;
+            to.max = from.max;
+            to.p50 = from.p50;
+            to.p90 = from.p90;
+            to.p99 = from.p99;
+            to.p999 = from.p999;
+        }
+
+        return 0;
+    } catch (const std::bad_alloc & e) {
+        SetErrorMessage("Out of memory");
+        errno = ENOMEM;
+    }
+
+    return -1;
+}
+
+static void CompleteAsync(hdfsAsyncResult * result, TraceRecord * record,
+                          hdfsAsyncCallback callback, void * data) {
+    hdfsTrace trace;
+
+    if (result->ret < 0) {
+        result->errnum = errno;
+        result->error = hdfsGetLastError();
+    }
+
+    Tracer::End();
+    ConvertTrace(*record, &trace);
+    result->trace = &trace;
+    callback(result, data);
+}
+
+static int SubmitAsync(const void * key, const Hdfs::function<void()> & task) {
+    try {
+        AsyncExecutor::Default().submit(key, task);
+        return 0;
+    } catch (const std::bad_alloc & e) {
+        SetErrorMessage("Out of memory");
+        errno = ENOMEM;
+    } catch (...) {
+        SetLastException(Hdfs::current_exception());
+        handleException(Hdfs::current_exception());
+    }
+
+    return -1;
+}
+
+static void AsyncOpenFile(hdfsFS fs, const std::string & path, int flags,
+                          int bufferSize, short replication, tOffset blocksize,
+                          hdfsAsyncCallback callback, void * data) {
+    hdfsAsyncResult result;
+    memset(&result, 0, sizeof(result));
+    TraceRecord record;
+    Tracer::Begin(&record, "open");
+    result.file = hdfsOpenFile(fs, path.c_str(), flags, bufferSize, replication, blocksize);
+    result.ret = result.file ? 0 : -1;
+    CompleteAsync(&result, &record, callback, data);
+}
+
+static void AsyncRead(hdfsFS fs, hdfsFile file, tOffset position, void * buffer,
+                      tSize length, hdfsAsyncCallback callback, void * data) {
+    hdfsAsyncResult result;
+    memset(&result, 0, sizeof(result));
+    TraceRecord record;
+    Tracer::Begin(&record, position >= 0 ? "readFrom" : "read");
+    result.ret = position >= 0 ? hdfsSeek(fs, file, position) : 0;
+
+    if (0 == result.ret) {
+        result.ret = hdfsRead(fs, file, buffer, length);
+    }
+
+    CompleteAsync(&result, &record, callback, data);
+}
+
+/*
+ * runs on the key of the file, no other operation moves the cursor meanwhile.
+ */
+static void AsyncPread(hdfsFS fs, hdfsFile file, tOffset position, void * buffer,
+                       tSize length, hdfsAsyncCallback callback, void * data) {
+    hdfsAsyncResult result;
+    memset(&result, 0, sizeof(result));
+    TraceRecord record;
+    Tracer::Begin(&record, "pread");
+    tOffset saved = hdfsTell(fs, file);
+    result.ret = saved < 0 || hdfsSeek(fs, file, position) < 0 ? -1 : 0;
+
+    /*
+     * hdfsRead stops at the end of a block.
+     */
+    while (result.ret >= 0 && result.ret < length) {
+        tSize n = hdfsRead(fs, file, static_cast<char *>(buffer) + result.ret, length - result.ret);
+
+        if (n <= 0) {
+            result.ret = n < 0 ? -1 : result.ret;
+            break;
+        }
+
+        result.ret += n;
+    }
+
+    if (saved >= 0) {
+        int err = errno;
+        std::string msg = hdfsGetLastError();
+
+        if (hdfsSeek(fs, file, saved) < 0 && result.ret >= 0) {
+            result.ret = -1;
+        } else if (result.ret < 0) {
+            errno = err;
+            SetErrorMessage(msg.c_str());
+        }
+    }
+
+    CompleteAsync(&result, &record, callback, data);
+}
+
+static void AsyncWrite(hdfsFS fs, hdfsFile file, const void * buffer,
+                       tSize length, hdfsAsyncCallback callback, void * data) {
+    hdfsAsyncResult result;
+    memset(&result, 0, sizeof(result));
+    TraceRecord record;
+    Tracer::Begin(&record, "write");
+    result.ret = hdfsWrite(fs, file, buffer, length);
+    CompleteAsync(&result, &record, callback, data);
+}
+
+static void AsyncFlush(hdfsFS fs, hdfsFile file, hdfsAsyncCallback callback,
+                       void * data) {
+    hdfsAsyncResult result;
+    memset(&result, 0, sizeof(result));
+    TraceRecord record;
+    Tracer::Begin(&record, "flush");
+    result.ret = hdfsFlush(fs, file);
+    CompleteAsync(&result, &record, callback, data);
+}
+
+static void AsyncCloseFile(hdfsFS fs, hdfsFile file, hdfsAsyncCallback callback,
+                           void * data) {
+    hdfsAsyncResult result;
+    memset(&result, 0, sizeof(result));
+    TraceRecord record;
+    Tracer::Begin(&record, "close");
+    result.ret = hdfsCloseFile(fs, file);
+    CompleteAsync(&result, &record, callback, data);
+}
+
+static void AsyncListDirectory(hdfsFS fs, const std::string & path,
+                               hdfsAsyncCallback callback, void * data) {
+    hdfsAsyncResult result;
+    memset(&result, 0, sizeof(result));
+    TraceRecord record;
+    Tracer::Begin(&record, "listDirectory");
+    result.info = hdfsListDirectory(fs, path.c_str(), &result.numEntries);
+    result.ret = result.info ? 0 : -1;
+    CompleteAsync(&result, &record, callback, data);
+}
+
+static void AsyncGetPathInfo(hdfsFS fs, const std::string & path,
+                             hdfsAsyncCallback callback, void * data) {
+    hdfsAsyncResult result;
+    memset(&result, 0, sizeof(result));
+    TraceRecord record;
+    Tracer::Begin(&record, "getPathInfo");
+    result.info = hdfsGetPathInfo(fs, path.c_str());
+    result.ret = result.info ? 0 : -1;
+    result.numEntries = result.info ? 1 : 0;
+    CompleteAsync(&result, &record, callback, data);
+}
+
+int hdfsAsyncSetThreads(int threads) {
+    PARAMETER_ASSERT(threads > 0, -1, EINVAL);
+
+    try {
+        AsyncExecutor::Default().setThreads(threads);
+        return 0;
+    } catch (const std::bad_alloc & e) {
+        SetErrorMessage("Out of memory");
+        errno = ENOMEM;
+    } catch (...) {
+        SetLastException(Hdfs::current_exception());
+        handleException(Hdfs::current_exception());
+    }
+
+    return -1;
+}
+
+int hdfsAsyncOpenFile(hdfsFS fs, const char * path, int flags, int bufferSize,
+                      short replication, tOffset blocksize,
+                      hdfsAsyncCallback callback, void * data) {
+    PARAMETER_ASSERT(fs && path && strlen(path) > 0 && callback, -1, EINVAL);
+    return SubmitAsync(NULL, Hdfs::bind(AsyncOpenFile, fs, std::string(path), flags,
+                                        bufferSize, replication, blocksize, callback, data));
+}
+
+int hdfsAsyncRead(hdfsFS fs, hdfsFile file, void * buffer, tSize length,
+                  hdfsAsyncCallback callback, void * data) {
+    PARAMETER_ASSERT(fs && file && buffer && length > 0 && callback, -1, EINVAL);
+    return SubmitAsync(file, Hdfs::bind(AsyncRead, fs, file, -1, buffer, length,
+                                        callback, data));
+}
+
+int hdfsAsyncReadFrom(hdfsFS fs, hdfsFile file, tOffset position, void * buffer,
+                      tSize length, hdfsAsyncCallback callback, void * data) {
+    PARAMETER_ASSERT(fs && file && position >= 0 && buffer && length > 0 && callback, -1, EINVAL);
+    return SubmitAsync(file, Hdfs::bind(AsyncRead, fs, file, position, buffer, length,
+                                        callback, data));
+}
+
+int hdfsAsyncPread(hdfsFS fs, hdfsFile file, tOffset position, void * buffer,
+                   tSize length, hdfsAsyncCallback callback, void * data) {
+    PARAMETER_ASSERT(fs && file && position >= 0 && buffer && length > 0 && callback, -1, EINVAL);
+    return SubmitAsync(file, Hdfs::bind(AsyncPread, fs, file, position, buffer, length,
+                                        callback, data));
+}
+
+int hdfsAsyncWrite(hdfsFS fs, hdfsFile file, const void * buffer, tSize length,
+                   hdfsAsyncCallback callback, void * data) {
+    PARAMETER_ASSERT(fs && file && buffer && length > 0 && callback, -1, EINVAL);
+    return SubmitAsync(file, Hdfs::bind(AsyncWrite, fs, file, buffer, length,
+                                        callback, data));
+}
+
+int hdfsAsyncFlush(hdfsFS fs, hdfsFile file, hdfsAsyncCallback callback,
+                   void * data) {
+    PARAMETER_ASSERT(fs && file && callback, -1, EINVAL);
+    return SubmitAsync(file, Hdfs::bind(AsyncFlush, fs, file, callback, data));
+}
+
+int hdfsAsyncCloseFile(hdfsFS fs, hdfsFile file, hdfsAsyncCallback callback,
+                       void * data) {
+    PARAMETER_ASSERT(fs && file && callback, -1, EINVAL);
+    return SubmitAsync(file, Hdfs::bind(AsyncCloseFile, fs, file, callback, data));
+}
+
+int hdfsAsyncListDirectory(hdfsFS fs, const char * path,
+                           hdfsAsyncCallback callback, void * data) {
+    PARAMETER_ASSERT(fs && path && strlen(path) > 0 && callback, -1, EINVAL);
+    return SubmitAsync(NULL, Hdfs::bind(AsyncListDirectory, fs, std::string(path),
+                                        callback, data));
+}
+
+int hdfsAsyncGetPathInfo(hdfsFS fs, const char * path,
+                         hdfsAsyncCallback callback, void * data) {
+    PARAMETER_ASSERT(fs && path && strlen(path) > 0 && callback, -1, EINVAL);
+    return SubmitAsync(NULL, Hdfs::bind(AsyncGetPathInfo, fs, std::string(path),
+                                        callback, data));
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -22,6 +22,7 @@
 
 #include "HttpClient.h"
 #include "Logger.h"
+#include "Thread.h"
 
 using namespace Hdfs::Internal;
 
@@ -55,6 +56,51 @@ namespace Hdfs {
 #define CURL_GET_RESPONSE(handle, code, fmt) \
     CURL_GETOPT_ERROR2(handle, CURLINFO_RESPONSE_CODE, code, fmt);
 
+/*
+ * Idle curl handles kept for reuse. A handle keeps its connection cache
+ * across curl_easy_reset, so requests to the KMS reuse the TCP and TLS
+ * connection of an earlier request instead of connecting again.
+ *
+ * The cookie store survives curl_easy_reset as well, and holds the
+ * hadoop.auth cookie of the user the handle was authenticated for. It is
+ * erased before a handle goes back to the pool, the next HttpClient may
+ * run for another user.
+ */
+static const size_t MaxIdleHandles = 16;
+static mutex HandlesMutex;
+static std::vector<CURL *> IdleHandles;
+
+static CURL * AcquireHandle() {
+    {
+        lock_guard<mutex> lock(HandlesMutex);
+
+        if (!IdleHandles.empty()) {
+            CURL * handle = IdleHandles.back();
+            IdleHandles.pop_back();
+            return handle;
+        }
+    }
+
+    return curl_easy_init();
+}
+
+static void ReleaseHandle(CURL * handle) {
+    if (curl_easy_setopt(handle, CURLOPT_COOKIELIST, "ALL") != CURLE_OK) {
+        curl_easy_cleanup(handle);
+        return;
+    }
+
+    curl_easy_reset(handle);
+    lock_guard<mutex> lock(HandlesMutex);
+
+    if (IdleHandles.size() < MaxIdleHandles) {
+        IdleHandles.push_back(handle);
+        return;
+    }
+
+    curl_easy_cleanup(handle);
+}
+
 HttpClient::HttpClient() : curl(NULL), list(NULL) {
 }
 
@@ -112,7 +158,17 @@ void HttpClient::init() {
         }
     }
 
-	curl = curl_easy_init();
+    if (curl) {
+        curl_easy_reset(curl);
+    } else {
+        curl = AcquireHandle();
+    }
+
+    if (list) {
+        curl_slist_free_all(list);
+        list = NULL;
+    }
+
 	if (!curl) {
 		THROW(HdfsIOException, "Cannot initialize curl handle for KMS");
 	}
@@ -154,7 +210,7 @@ void HttpClient::init() {
  */
 void HttpClient::destroy() {
     if (curl) {
-        curl_easy_cleanup(curl);
+        ReleaseHandle(curl);
         curl = NULL;
     }
     if (list) {
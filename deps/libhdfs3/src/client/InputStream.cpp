@@ -91,6 +91,10 @@ int64_t InputStream::tell() {
     return impl->tell();
 }
 
+void InputStream::setCachingStrategy(const CachingStrategy & strategy) {
+    impl->setCachingStrategy(strategy);
+}
+
 /**
  * Close the sthream.
  */
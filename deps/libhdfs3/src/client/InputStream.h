@@ -22,6 +22,7 @@
 #ifndef _HDFS_LIBHDFS3_CLIENT_INPUTSTREAM_H_
 #define _HDFS_LIBHDFS3_CLIENT_INPUTSTREAM_H_
 
+#include "CachingStrategy.h"
 #include "FileSystem.h"
 
 namespace Hdfs {
@@ -79,6 +80,13 @@ public:
      */
     int64_t tell();
 
+    /**
+     * Set the page cache hints sent to the datanodes by the following
+     * block reads. Hints not set in strategy keep their current value.
+     * @param strategy the hints to set.
+     */
+    void setCachingStrategy(const CachingStrategy & strategy);
+
     /**
      * Close the stream.
      */
@@ -19,6 +19,7 @@
  * See the License for the specific language governing permissions and
  * limitations under the License.
  */
+#include "AsyncExecutor.h"
 #include "Exception.h"
 #include "ExceptionInternal.h"
 #include "FileSystemInter.h"
@@ -26,9 +27,11 @@
 #include "InputStreamInter.h"
 #include "LocalBlockReader.h"
 #include "Logger.h"
+#include "Metrics.h"
 #include "RemoteBlockReader.h"
 #include "server/Datanode.h"
 #include "Thread.h"
+#include "Trace.h"
 
 #include <algorithm>
 #include <ifaddrs.h>
@@ -118,10 +121,137 @@ unordered_set<std::string> BuildLocalAddrSet() {
     return set;
 }
 
+static bool IsLocalAddr(const std::string & addr) {
+    static const unordered_set<std::string> LocalAddrSet = BuildLocalAddrSet();
+    return LocalAddrSet.find(addr) != LocalAddrSet.end();
+}
+
+/*
+ * The threads setting up the readers of the next blocks, a stream
+ * sets up the reader itself if the prefetch is not done yet.
+ * Never destroyed.
+ */
+static const int PrefetchThreads = 8;
+
+static AsyncExecutor & PrefetchExecutor() {
+    static AsyncExecutor * executor = new AsyncExecutor(PrefetchThreads);
+    return *executor;
+}
+
+/*
+ * The reader of the next block set up in the background. It owns
+ * everything the reader refers to, so an abandoned prefetch can
+ * finish after the stream has moved on or been closed.
+ */
+struct NextBlockPrefetch {
+    NextBlockPrefetch() :
+        canceled(false), done(false), started(false), verify(true), offset(0), prefetchSize(0) {
+    }
+
+    CachingStrategy strategy;
+    bool canceled;
+    bool done;
+    bool started;
+    bool verify;
+    int64_t offset; //the offset of the next block in file.
+    int64_t prefetchSize;
+    mutex mut;
+    shared_ptr<FileSystemInter> filesystem;
+    shared_ptr<const SessionConfig> conf;
+    shared_ptr<LocatedBlock> block; //NULL until the block locations are fetched.
+    shared_ptr<LocatedBlocksImpl> lbs; //the refreshed block locations if fetched.
+    std::string path;
+    DatanodeInfo node;
+    std::vector<DatanodeInfo> failedNodes; //sorted, the nodes the stream or the prefetch failed to read from.
+    shared_ptr<BlockReader> reader; //destroyed before the block and node.
+};
+
+static void PrefetchNextBlock(shared_ptr<NextBlockPrefetch> prefetch) {
+    {
+        lock_guard<mutex> lock(prefetch->mut);
+        prefetch->started = !prefetch->canceled;
+    }
+
+    try {
+        if (prefetch->started && !prefetch->block) {
+            shared_ptr<LocatedBlocksImpl> lbs(new LocatedBlocksImpl);
+            prefetch->filesystem->getBlockLocations(prefetch->path, prefetch->offset,
+                                                    prefetch->prefetchSize, *lbs);
+            const LocatedBlock * lb = lbs->findBlock(prefetch->offset);
+
+            /*
+             * the stream has to ask the datanodes for the length of
+             * a block being written, leave that to the stream.
+             */
+            if (lb && lb->getOffset() == prefetch->offset && lbs->isLastBlockComplete()) {
+                prefetch->lbs = lbs;
+                prefetch->block = shared_ptr<LocatedBlock>(new LocatedBlock(*lb));
+            }
+        }
+
+        std::vector<DatanodeInfo> nodes;
+
+        if (prefetch->started && prefetch->block) {
+            nodes = prefetch->block->getLocations();
+        }
+
+        for (size_t i = 0; i < nodes.size(); ++i) {
+            /*
+             * the stream reads the local replica with short circuit read.
+             */
+            if (prefetch->conf->isReadFromLocal() && IsLocalAddr(nodes[i].getIpAddr())
+                    && (prefetch->conf->isLegacyLocalBlockReader()
+                        || !prefetch->conf->getDomainSocketPath().empty())) {
+                break;
+            }
+
+            if (std::binary_search(prefetch->failedNodes.begin(), prefetch->failedNodes.end(), nodes[i])) {
+                continue;
+            }
+
+            {
+                lock_guard<mutex> lock(prefetch->mut);
+
+                if (prefetch->canceled) {
+                    break;
+                }
+            }
+
+            try {
+                prefetch->node = nodes[i];
+                prefetch->reader = shared_ptr<BlockReader>(new RemoteBlockReader(
+                    *prefetch->block, prefetch->node, prefetch->filesystem->getPeerCache(), 0,
+                    prefetch->block->getNumBytes(), prefetch->block->getToken(),
+                    prefetch->filesystem->getClientName(), prefetch->verify, *prefetch->conf,
+                    prefetch->strategy));
+                break;
+            } catch (const HdfsIOException & e) {
+                std::string buffer;
+                LOG(INFO, "InputStreamImpl: cannot prefetch Block: %s file %s on Datanode: %s.\n%s",
+                    prefetch->block->toString().c_str(), prefetch->path.c_str(),
+                    nodes[i].formatAddress().c_str(), GetExceptionDetail(e, buffer));
+                prefetch->failedNodes.push_back(nodes[i]);
+                std::sort(prefetch->failedNodes.begin(), prefetch->failedNodes.end());
+            }
+        }
+    } catch (const HdfsException & e) {
+        std::string buffer;
+        LOG(INFO, "InputStreamImpl: cannot prefetch the block at %" PRId64 " of file %s.\n%s",
+            prefetch->offset, prefetch->path.c_str(), GetExceptionDetail(e, buffer));
+    } catch (const std::exception & e) {
+        LOG(LOG_ERROR, "InputStreamImpl: cannot prefetch the block at %" PRId64 " of file %s: %s",
+            prefetch->offset, prefetch->path.c_str(), e.what());
+    }
+
+    lock_guard<mutex> lock(prefetch->mut);
+    prefetch->done = true;
+}
+
 InputStreamImpl::InputStreamImpl() :
     closed(true), localRead(true), readFromUnderConstructedBlock(false), verify(
         true), maxGetBlockInfoRetry(3), cursor(0), endOfCurBlock(0), lastBlockBeingWrittenLength(
-            0), prefetchSize(0), peerCache(NULL) {
+            0), nextBlockPrefetch(0), prefetchSize(0), sequentialStart(0),
+    readCounter(METRIC_BYTES_READ_REMOTE), peerCache(NULL) {
 #ifdef MOCK
     stub = NULL;
 #endif
@@ -212,7 +342,10 @@ void InputStreamImpl::updateBlockInfos() {
                 lbs = shared_ptr < LocatedBlocksImpl > (new LocatedBlocksImpl);
             }
 
-            filesystem->getBlockLocations(path, cursor, prefetchSize, *lbs);
+            {
+                TraceScope trace(TRACE_GET_BLOCK_LOCATIONS);
+                filesystem->getBlockLocations(path, cursor, prefetchSize, *lbs);
+            }
 
             if (lbs->isLastBlockComplete()) {
                 lastBlockBeingWrittenLength = 0;
@@ -310,9 +443,7 @@ bool InputStreamImpl::choseBestNode() {
 }
 
 bool InputStreamImpl::isLocalNode() {
-    static const unordered_set<std::string> LocalAddrSet = BuildLocalAddrSet();
-    bool retval = LocalAddrSet.find(curNode.getIpAddr()) != LocalAddrSet.end();
-    return retval;
+    return IsLocalAddr(curNode.getIpAddr());
 }
 
 void InputStreamImpl::setupBlockReader(bool temporaryDisableLocalRead) {
@@ -361,6 +492,7 @@ void InputStreamImpl::setupBlockReader(bool temporaryDisableLocalRead) {
                     blockReader = shared_ptr<BlockReader>(
                         new LocalBlockReader(info, *curBlock, offset, verify,
                                              *conf, localReaderBuffer));
+                    readCounter = METRIC_BYTES_READ_SHORT_CIRCUIT;
                 } catch (...) {
                     if (info) {
                         info->setValid(false);
@@ -373,7 +505,9 @@ void InputStreamImpl::setupBlockReader(bool temporaryDisableLocalRead) {
                 lastReadFromLocal = false;
                 blockReader = shared_ptr<BlockReader>(new RemoteBlockReader(
                     *curBlock, curNode, *peerCache, offset, len,
-                    curBlock->getToken(), clientName, verify, *conf));
+                    curBlock->getToken(), clientName, verify, *conf, cachingStrategy));
+                readCounter = isLocalNode() ? METRIC_BYTES_READ_LOCAL
+                              : METRIC_BYTES_READ_REMOTE;
             }
 
             break;
@@ -403,6 +537,108 @@ void InputStreamImpl::setupBlockReader(bool temporaryDisableLocalRead) {
     }
 }
 
+/**
+ * Start setting up the reader of the next block in the background
+ * when a sequential read is about to drain the current block.
+ */
+void InputStreamImpl::prefetchNextBlock() {
+    if (nextBlockPrefetch <= 0 || nextBlock || !lbs || readFromUnderConstructedBlock
+            || endOfCurBlock - cursor > nextBlockPrefetch
+            || cursor - sequentialStart < nextBlockPrefetch
+            || endOfCurBlock >= lbs->getFileLength()) {
+        return;
+    }
+
+    shared_ptr<NextBlockPrefetch> prefetch(new NextBlockPrefetch);
+    const LocatedBlock * lb = lbs->findBlock(endOfCurBlock);
+
+    if (lb) {
+        prefetch->block = shared_ptr<LocatedBlock>(new LocatedBlock(*lb));
+    }
+
+    prefetch->strategy = cachingStrategy;
+    prefetch->verify = verify;
+    prefetch->offset = endOfCurBlock;
+    prefetch->prefetchSize = prefetchSize;
+    prefetch->filesystem = filesystem;
+    prefetch->conf = conf;
+    prefetch->path = path;
+    prefetch->failedNodes = failedNodes;
+
+    try {
+        PrefetchExecutor().submit(NULL, bind(PrefetchNextBlock, prefetch));
+        nextBlock = prefetch;
+    } catch (const std::exception & e) {
+        LOG(LOG_ERROR, "InputStreamImpl: cannot prefetch the block at %" PRId64 " of file %s: %s",
+            endOfCurBlock, path.c_str(), e.what());
+    }
+}
+
+/**
+ * Get the prefetched next block, never wait for it. A prefetch which is
+ * not done yet is canceled, the stream sets up the reader itself.
+ * @return NULL if the prefetch is not done or is not for the cursor.
+ */
+shared_ptr<NextBlockPrefetch> InputStreamImpl::takePrefetch() {
+    shared_ptr<NextBlockPrefetch> prefetch;
+    prefetch.swap(nextBlock);
+    lock_guard<mutex> lock(prefetch->mut);
+
+    if (!prefetch->done) {
+        prefetch->canceled = true;
+        return shared_ptr<NextBlockPrefetch>();
+    }
+
+    if (prefetch->offset != cursor) {
+        return shared_ptr<NextBlockPrefetch>();
+    }
+
+    return prefetch;
+}
+
+void InputStreamImpl::usePrefetchedReader(shared_ptr<NextBlockPrefetch> prefetched) {
+    if (!prefetched->block || cursor != curBlock->getOffset()
+            || prefetched->block->getBlockId() != curBlock->getBlockId()
+            || prefetched->block->getGenerationStamp() != curBlock->getGenerationStamp()) {
+        return;
+    }
+
+    /*
+     * keep away from the datanodes which failed before, unless none of
+     * the replicas is left, then the stream tries them all again.
+     */
+    const std::vector<DatanodeInfo> & nodes = curBlock->getLocations();
+
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        if (!std::binary_search(prefetched->failedNodes.begin(), prefetched->failedNodes.end(), nodes[i])) {
+            failedNodes = prefetched->failedNodes;
+            break;
+        }
+    }
+
+    if (!prefetched->reader) {
+        return;
+    }
+
+    /*
+     * the reader keeps the prefetch alive, it refers to the block
+     * and datanode owned by the prefetch.
+     */
+    blockReader = shared_ptr<BlockReader>(prefetched, prefetched->reader.get());
+    curNode = prefetched->node;
+    readCounter = isLocalNode() ? METRIC_BYTES_READ_LOCAL : METRIC_BYTES_READ_REMOTE;
+    Metrics::Add(METRIC_BLOCK_READERS_PREFETCHED);
+}
+
+void InputStreamImpl::cancelPrefetch() {
+    if (nextBlock) {
+        lock_guard<mutex> lock(nextBlock->mut);
+        nextBlock->canceled = true;
+    }
+
+    nextBlock.reset();
+}
+
 void InputStreamImpl::open(shared_ptr<FileSystemInter> fs, const char * path,
                            bool verifyChecksum) {
     if (NULL == path || 0 == strlen(path)) {
@@ -424,16 +660,21 @@ void InputStreamImpl::openInternal(shared_ptr<FileSystemInter> fs, const char *
         verify = verifyChecksum;
         this->path = fs->getStandardPath(path);
         LOG(DEBUG2, "%p, open file %s for read, verfyChecksum is %s", this, this->path.c_str(), (verifyChecksum ? "true" : "false"));
-        conf = shared_ptr < SessionConfig > (new SessionConfig(fs->getConf()));
+        conf = fs->getSharedConf();
         this->auth = RpcAuth(fs->getUserInfo(), RpcAuth::ParseMethod(conf->getRpcAuthMethod()));
         prefetchSize = conf->getDefaultBlockSize() * conf->getPrefetchSize();
+        nextBlockPrefetch = conf->getNextBlockPrefetch();
+        cachingStrategy = CachingStrategy(conf->getDropBehindReads(), conf->getCacheReadahead());
         localRead = conf->isReadFromLocal();
         maxGetBlockInfoRetry = conf->getMaxGetBlockInfoRetry();
         peerCache = &fs->getPeerCache();
         updateBlockInfos();
         closed = false;
         /* If file is encrypted , then initialize CryptoCodec. */
-        fileStatus = fs->getFileStatus(this->path.c_str());
+        {
+            TraceScope trace(TRACE_GET_FILE_INFO);
+            fileStatus = fs->getFileStatus(this->path.c_str());
+        }
         FileEncryptionInfo *fileEnInfo = fileStatus.getFileEncryption();
         if (fileStatus.isFileEncrypted()) {
             if (cryptoCodec == NULL) {
@@ -442,7 +683,8 @@ void InputStreamImpl::openInternal(shared_ptr<FileSystemInter> fs, const char *
                 kcp = shared_ptr<KmsClientProvider> (
                         new KmsClientProvider(enAuth, conf));
                 cryptoCodec = shared_ptr<CryptoCodec> (
-                        new CryptoCodec(fileEnInfo, kcp, conf->getCryptoBufferSize()));
+                        new CryptoCodec(fileEnInfo, kcp, conf->getCryptoBufferSize(), &fs->getDekCache()));
+                cryptoCodec->setParallel(conf->getCryptoThreads(), conf->getCryptoParallelMinSize());
 
                 int64_t file_length = 0;
                 int ret = cryptoCodec->init(CryptoMethod::DECRYPT, file_length);
@@ -524,7 +766,11 @@ int32_t InputStreamImpl::readOneBlock(char * buf, int32_t size, bool shouldUpdat
             todo = todo < endOfCurBlock - cursor ?
                    todo : static_cast<int32_t>(endOfCurBlock - cursor);
             assert(blockReader);
-            todo = blockReader->read(buf, todo);
+            {
+                MetricsTimer timer(METRIC_BLOCK_READ_LATENCY);
+                todo = blockReader->read(buf, todo);
+            }
+            Metrics::Add(readCounter, todo);
             cursor += todo;
             /*
              * Exit the loop and function from here if success.
@@ -545,6 +791,7 @@ int32_t InputStreamImpl::readOneBlock(char * buf, int32_t size, bool shouldUpdat
                 throw;
             }
         } catch (const ChecksumException & e) {
+            Metrics::Add(METRIC_CHECKSUM_FAILURES);
             LOG(LOG_ERROR,
                 "InputStreamImpl: failed to read Block: %s file %s from Datanode: %s, \n%s, "
                 "retry read again from another Datanode.",
@@ -552,6 +799,8 @@ int32_t InputStreamImpl::readOneBlock(char * buf, int32_t size, bool shouldUpdat
                 curNode.formatAddress().c_str(), GetExceptionDetail(e, buffer));
         }
 
+        Metrics::Add(METRIC_READ_RETRIES);
+
         /*
          * Successfully create the block reader but failed to read.
          * Disable the local block reader and try the same node again.
@@ -584,6 +833,16 @@ int32_t InputStreamImpl::readInternal(char * buf, int32_t size) {
     try {
         do {
             const LocatedBlock * lb = NULL;
+            shared_ptr<NextBlockPrefetch> prefetched;
+
+            if (cursor >= endOfCurBlock && nextBlock) {
+                prefetched = takePrefetch();
+
+                if (prefetched && prefetched->lbs) {
+                    lbs = prefetched->lbs;
+                    lastBlockBeingWrittenLength = 0;
+                }
+            }
 
             /*
              * Check if we have got the block information we need.
@@ -625,6 +884,10 @@ int32_t InputStreamImpl::readInternal(char * buf, int32_t size) {
                  * but do not setup block reader, setup it latter.
                  */
                 seekToBlock(*lb);
+
+                if (prefetched) {
+                    usePrefetchedReader(prefetched);
+                }
             }
 
             int32_t retval = readOneBlock(buf, size, updateMetadataOnFailure > 0);
@@ -645,13 +908,12 @@ int32_t InputStreamImpl::readInternal(char * buf, int32_t size) {
 
                 continue;
             }
-            std::string bufDecode;
             if (fileStatus.isFileEncrypted()) {
-                /* Decrypt buffer if the file is encrypted. */
-                bufDecode = cryptoCodec->cipher_wrap(buf, retval);
-                memcpy(buf, bufDecode.c_str(), retval);
+                /* Decrypt buffer in place if the file is encrypted. */
+                cryptoCodec->crypt(buf, buf, retval);
             }
 
+            prefetchNextBlock();
             return retval;
         } while (true);
     } catch (const HdfsCanceled & e) {
@@ -737,6 +999,11 @@ void InputStreamImpl::seek(int64_t pos) {
 
     try {
         seekInternal(pos);
+    } catch (const HdfsEndOfStream & e) {
+        /*
+         * thrown before the stream is changed, it can still be used.
+         */
+        throw;
     } catch (...) {
         lastError = current_exception();
         throw;
@@ -790,7 +1057,9 @@ void InputStreamImpl::seekInternal(int64_t pos) {
      */
     endOfCurBlock = 0;
     blockReader.reset();
+    cancelPrefetch();
     cursor = pos;
+    sequentialStart = pos;
     if (cryptoCodec) {
         int ret = cryptoCodec->resetStreamOffset(CryptoMethod::DECRYPT, cursor);
         if (ret < 0) {
@@ -809,6 +1078,16 @@ int64_t InputStreamImpl::tell() {
     return cursor;
 }
 
+void InputStreamImpl::setCachingStrategy(const CachingStrategy & strategy) {
+    checkStatus();
+    cachingStrategy.merge(strategy);
+
+    /*
+     * the prefetched reader has sent the old hints.
+     */
+    cancelPrefetch();
+}
+
 /**
  * Close the stream.
  */
@@ -822,7 +1101,11 @@ void InputStreamImpl::close() {
     cursor = 0;
     endOfCurBlock = 0;
     lastBlockBeingWrittenLength = 0;
+    nextBlockPrefetch = 0;
     prefetchSize = 0;
+    sequentialStart = 0;
+    cancelPrefetch();
+    cachingStrategy = CachingStrategy();
     blockReader.reset();
     curBlock.reset();
     lbs.reset();
@@ -30,6 +30,7 @@
 #include "Hash.h"
 #include "InputStreamInter.h"
 #include "Memory.h"
+#include "Metrics.h"
 #include "PeerCache.h"
 #include "rpc/RpcAuth.h"
 #include "server/Datanode.h"
@@ -47,6 +48,8 @@
 namespace Hdfs {
 namespace Internal {
 
+struct NextBlockPrefetch;
+
 /**
  * A input stream used read data from hdfs.
  */
@@ -92,6 +95,11 @@ public:
      */
     int64_t tell();
 
+    /**
+     * @ref InputStream::setCachingStrategy
+     */
+    void setCachingStrategy(const CachingStrategy & strategy);
+
     /**
      * Close the stream.
      */
@@ -131,13 +139,17 @@ private:
     int32_t readOneBlock(char * buf, int32_t size, bool shouldUpdateMetadataOnFailure);
     int64_t getFileLength();
     int64_t readBlockLength(const LocatedBlock & b);
+    void cancelPrefetch();
     void checkStatus();
+    shared_ptr<NextBlockPrefetch> takePrefetch();
     void openInternal(shared_ptr<FileSystemInter> fs, const char * path,
                       bool verifyChecksum);
+    void prefetchNextBlock();
     void readFullyInternal(char * buf, int64_t size);
     void seekInternal(int64_t pos);
     void seekToBlock(const LocatedBlock & lb);
     void setupBlockReader(bool temporaryDisableLocalRead);
+    void usePrefetchedReader(shared_ptr<NextBlockPrefetch> prefetched);
     void updateBlockInfos();
 
 private:
@@ -145,6 +157,7 @@ private:
     bool localRead;
     bool readFromUnderConstructedBlock;
     bool verify;
+    CachingStrategy cachingStrategy;
     DatanodeInfo curNode;
     exception_ptr lastError;
     FileStatus fileInfo;
@@ -152,14 +165,18 @@ private:
     int64_t cursor;
     int64_t endOfCurBlock;
     int64_t lastBlockBeingWrittenLength;
+    int64_t nextBlockPrefetch; //the bytes left in block when the next block reader is setup.
     int64_t prefetchSize;
+    int64_t sequentialStart; //the position of the last seek.
+    MetricCounter readCounter; //the bytes read by blockReader.
     PeerCache *peerCache;
     RpcAuth auth;
     shared_ptr<BlockReader> blockReader;
     shared_ptr<FileSystemInter> filesystem;
     shared_ptr<LocatedBlock> curBlock;
     shared_ptr<LocatedBlocks> lbs;
-    shared_ptr<SessionConfig> conf;
+    shared_ptr<NextBlockPrefetch> nextBlock;
+    shared_ptr<const SessionConfig> conf;
     std::string path;
     std::vector<DatanodeInfo> failedNodes;
     std::vector<char> localReaderBuffer;
@@ -24,6 +24,8 @@
 
 #include <Memory.h>
 
+#include "CachingStrategy.h"
+
 #include <string>
 
 namespace Hdfs {
@@ -82,6 +84,11 @@ public:
      */
     virtual int64_t tell() = 0;
 
+    /**
+     * @ref InputStream::setCachingStrategy
+     */
+    virtual void setCachingStrategy(const CachingStrategy & strategy) = 0;
+
     /**
      * Close the stream.
      */
@@ -120,7 +120,7 @@ std::string KmsClientProvider::base64Decode(const std::string &data) {
  * @param auth RpcAuth to get the auth method and user info.
  * @param conf a SessionConfig to get the configuration.
  */
-KmsClientProvider::KmsClientProvider(shared_ptr<RpcAuth> rpcAuth, shared_ptr<SessionConfig> config) : auth(rpcAuth), conf(config)
+KmsClientProvider::KmsClientProvider(shared_ptr<RpcAuth> rpcAuth, shared_ptr<const SessionConfig> config) : auth(rpcAuth), conf(config)
 {
     hc.reset(new HttpClient());
     method = RpcAuth::ParseMethod(conf->getKmsMethod());
@@ -50,7 +50,7 @@ public:
      * @param auth RpcAuth to get the auth method and user info.
      * @param conf a SessionConfig to get the configuration.
      */
-    KmsClientProvider(shared_ptr<RpcAuth> auth, shared_ptr<SessionConfig> conf);
+    KmsClientProvider(shared_ptr<RpcAuth> auth, shared_ptr<const SessionConfig> conf);
 
     /**
      * Destroy a KmsClientProvider instance.
@@ -134,7 +134,7 @@ private:
 
     shared_ptr<RpcAuth> auth;
     AuthMethod method;
-    shared_ptr<SessionConfig> conf;
+    shared_ptr<const SessionConfig> conf;
 
 };
 
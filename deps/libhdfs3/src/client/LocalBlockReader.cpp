@@ -40,7 +40,7 @@ namespace Internal {
 
 LocalBlockReader::LocalBlockReader(const shared_ptr<ReadShortCircuitInfo>& info,
                                    const ExtendedBlock& block, int64_t offset,
-                                   bool verify, SessionConfig& conf,
+                                   bool verify, const SessionConfig& conf,
                                    std::vector<char>& buffer)
     : verify(verify),
       pbuffer(NULL),
@@ -38,7 +38,7 @@ class LocalBlockReader: public BlockReader {
 public:
     LocalBlockReader(const shared_ptr<ReadShortCircuitInfo>& info,
                      const ExtendedBlock & block, int64_t offset, bool verify,
-                     SessionConfig & conf, std::vector<char> & buffer);
+                     const SessionConfig & conf, std::vector<char> & buffer);
 
     ~LocalBlockReader();
 
@@ -80,6 +80,14 @@ void OutputStream::sync() {
     impl->sync();
 }
 
+void OutputStream::setCachingStrategy(const CachingStrategy & strategy) {
+    impl->setCachingStrategy(strategy);
+}
+
+void OutputStream::setFavoredNodes(const std::vector<std::string> & nodes) {
+    impl->setFavoredNodes(nodes);
+}
+
 /**
  * close the stream.
  */
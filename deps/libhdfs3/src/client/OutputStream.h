@@ -22,6 +22,7 @@
 #ifndef _HDFS_LIBHDFS3_CLIENT_OUTPUTSTREAM_H_
 #define _HDFS_LIBHDFS3_CLIENT_OUTPUTSTREAM_H_
 
+#include "CachingStrategy.h"
 #include "FileSystem.h"
 
 namespace Hdfs {
@@ -111,6 +112,21 @@ public:
      */
     void sync();
 
+    /**
+     * Set the page cache hints sent to the datanodes by the following
+     * pipelines. Hints not set in strategy keep their current value.
+     * @param strategy the hints to set.
+     */
+    void setCachingStrategy(const CachingStrategy & strategy);
+
+    /**
+     * Ask the namenode to place the replicas of the following new blocks
+     * on the given datanodes if possible, the first one gets the first replica.
+     * @param nodes host:port of the data transfer addresses of the datanodes,
+     *  empty to leave the placement to the namenode.
+     */
+    void setFavoredNodes(const std::vector<std::string> & nodes);
+
     /**
      * close the stream.
      */
@@ -27,6 +27,7 @@
 #include "HWCrc32c.h"
 #include "LeaseRenewer.h"
 #include "Logger.h"
+#include "Metrics.h"
 #include "OutputStream.h"
 #include "OutputStreamImpl.h"
 #include "Packet.h"
@@ -36,6 +37,8 @@
 #include <cassert>
 #include <inttypes.h>
 
+#define MAX_CRYPTO_BATCH (4 * 1024 * 1024)
+
 namespace Hdfs {
 namespace Internal {
 
@@ -216,7 +219,7 @@ void OutputStreamImpl::openInternal(shared_ptr<FileSystemInter> fs, const char *
     this->replication = replication;
     this->blockSize = blockSize;
     syncBlock = flag & SyncBlock;
-    conf = shared_ptr < SessionConfig > (new SessionConfig(fs->getConf()));
+    conf = fs->getSharedConf();
     LOG(DEBUG2, "open file %s for %s", this->path.c_str(), (flag & Append ? "append" : "write"));
     packets.setMaxSize(conf->getPacketPoolSize());
 
@@ -236,6 +239,7 @@ void OutputStreamImpl::openInternal(shared_ptr<FileSystemInter> fs, const char *
     packetSize = conf->getDefaultPacketSize();
     heartBeatInterval = conf->getHeartBeatInterval();
     closeTimeout = conf->getCloseFileTimeout();
+    cachingStrategy = CachingStrategy(conf->getDropBehindWrites(), -1);
 
     if (packetSize < chunkSize) {
         THROW(InvalidParameter,
@@ -260,7 +264,8 @@ void OutputStreamImpl::openInternal(shared_ptr<FileSystemInter> fs, const char *
                     kcp = shared_ptr<KmsClientProvider> (
                             new KmsClientProvider(auth, conf));
                     cryptoCodec = shared_ptr<CryptoCodec> (
-                            new CryptoCodec(fileEnInfo, kcp, conf->getCryptoBufferSize()));
+                            new CryptoCodec(fileEnInfo, kcp, conf->getCryptoBufferSize(), &fs->getDekCache()));
+                    cryptoCodec->setParallel(conf->getCryptoThreads(), conf->getCryptoParallelMinSize());
 
                     int64_t file_length = fileStatus.getLength();
                     int ret = cryptoCodec->init(CryptoMethod::ENCRYPT, file_length);
@@ -291,7 +296,8 @@ void OutputStreamImpl::openInternal(shared_ptr<FileSystemInter> fs, const char *
             kcp = shared_ptr<KmsClientProvider>(
                     new KmsClientProvider(auth, conf));
             cryptoCodec = shared_ptr<CryptoCodec>(
-                    new CryptoCodec(fileEnInfo, kcp, conf->getCryptoBufferSize()));
+                    new CryptoCodec(fileEnInfo, kcp, conf->getCryptoBufferSize(), &fs->getDekCache()));
+            cryptoCodec->setParallel(conf->getCryptoThreads(), conf->getCryptoParallelMinSize());
 
             int64_t file_length = fileStatus.getLength();
             assert(file_length == 0);
@@ -322,6 +328,7 @@ void OutputStreamImpl::append(const char * buf, int64_t size) {
 
     try {
         appendInternal(buf, size);
+        Metrics::Add(METRIC_BYTES_WRITTEN, size);
     } catch (...) {
         setError(current_exception());
         throw;
@@ -329,15 +336,32 @@ void OutputStreamImpl::append(const char * buf, int64_t size) {
 }
 
 void OutputStreamImpl::appendInternal(const char * buf, int64_t size) {
-    int64_t todo = size;
-	std::string bufEncode;
+    if (!fileStatus.isFileEncrypted()) {
+        appendData(buf, size);
+        return;
+    }
 
-    if (fileStatus.isFileEncrypted()) {
-        //encrypt buf
-        bufEncode = cryptoCodec->cipher_wrap(buf, size);
-        buf = bufEncode.c_str();
+    /*
+     * encrypt into a buffer reused across writes, large writes are
+     * encrypted a batch at a time to bound its size.
+     */
+    while (size > 0) {
+        int64_t batch = size < MAX_CRYPTO_BATCH ? size : MAX_CRYPTO_BATCH;
+
+        if (static_cast<int64_t>(cryptoBuffer.size()) < batch) {
+            cryptoBuffer.resize(batch);
+        }
 
+        cryptoCodec->crypt(buf, &cryptoBuffer[0], batch);
+        appendData(&cryptoBuffer[0], batch);
+        buf += batch;
+        size -= batch;
     }
+}
+
+void OutputStreamImpl::appendData(const char * buf, int64_t size) {
+    int64_t todo = size;
+
     while (todo > 0) {
         int batch = buffer.size() - position;
         batch = batch < todo ? batch : static_cast<int>(todo);
@@ -415,7 +439,8 @@ void OutputStreamImpl::setupPipeline() {
 #else
     pipeline = shared_ptr<Pipeline>(new PipelineImpl(isAppend, path.c_str(), *conf, filesystem,
                                     CHECKSUM_TYPE_CRC32C, conf->getDefaultChunkSize(), replication,
-                                    currentPacket->getOffsetInBlock(), packets, lastBlock));
+                                    currentPacket->getOffsetInBlock(), packets, lastBlock,
+                                    cachingStrategy, favoredNodes));
 #endif
     lastSend = steady_clock::now();
     /*
@@ -504,6 +529,22 @@ void OutputStreamImpl::sync() {
     }
 }
 
+/**
+ * @ref OutputStream::setCachingStrategy
+ */
+void OutputStreamImpl::setCachingStrategy(const CachingStrategy & strategy) {
+    checkStatus();
+    cachingStrategy.merge(strategy);
+}
+
+/**
+ * @ref OutputStream::setFavoredNodes
+ */
+void OutputStreamImpl::setFavoredNodes(const std::vector<std::string> & nodes) {
+    checkStatus();
+    favoredNodes = nodes;
+}
+
 void OutputStreamImpl::completeFile(bool throwError) {
     steady_clock::time_point start = steady_clock::now();
 
@@ -639,6 +680,8 @@ void OutputStreamImpl::reset() {
     position = 0;
     replication = 0;
     syncBlock = false;
+    cachingStrategy = CachingStrategy();
+    favoredNodes.clear();
 }
 
 std::string OutputStreamImpl::toString() {
@@ -90,6 +90,16 @@ public:
      */
     void sync();
 
+    /**
+     * @ref OutputStream::setCachingStrategy
+     */
+    void setCachingStrategy(const CachingStrategy & strategy);
+
+    /**
+     * @ref OutputStream::setFavoredNodes
+     */
+    void setFavoredNodes(const std::vector<std::string> & nodes);
+
     /**
      * close the stream.
      */
@@ -128,6 +138,7 @@ public:
 
 private:
     void appendChunkToPacket(const char * buf, int size);
+    void appendData(const char * buf, int64_t size);
     void appendInternal(const char * buf, int64_t size);
     void checkStatus();
     void closePipeline();
@@ -148,6 +159,7 @@ private:
     bool closed;
     bool isAppend;
     bool syncBlock;
+    CachingStrategy cachingStrategy;
     //condition_variable condHeartBeatSender;
     exception_ptr lastError;
     int checksumSize;
@@ -170,9 +182,11 @@ private:
     shared_ptr<LocatedBlock> lastBlock;
     shared_ptr<Packet> currentPacket;
     shared_ptr<Pipeline> pipeline;
-    shared_ptr<SessionConfig> conf;
+    shared_ptr<const SessionConfig> conf;
     std::string path;
     std::vector<char> buffer;
+    std::vector<char> cryptoBuffer; //encrypted data of encrypted files.
+    std::vector<std::string> favoredNodes;
     steady_clock::time_point lastSend;
     //thread heartBeatSender;
     FileStatus fileStatus;
@@ -22,6 +22,7 @@
 #ifndef _HDFS_LIBHDFS3_CLIENT_OUTPUTSTREAMINTER_H_
 #define _HDFS_LIBHDFS3_CLIENT_OUTPUTSTREAMINTER_H_
 
+#include "CachingStrategy.h"
 #include "ExceptionInternal.h"
 #include "FileSystemInter.h"
 #include "Memory.h"
@@ -76,6 +77,16 @@ public:
      */
     virtual void sync() = 0;
 
+    /**
+     * @ref OutputStream::setCachingStrategy
+     */
+    virtual void setCachingStrategy(const CachingStrategy & strategy) = 0;
+
+    /**
+     * @ref OutputStream::setFavoredNodes
+     */
+    virtual void setFavoredNodes(const std::vector<std::string> & nodes) = 0;
+
     /**
      * close the stream.
      */
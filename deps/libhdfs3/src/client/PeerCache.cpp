@@ -22,6 +22,7 @@
 #include <inttypes.h>
 
 #include "client/PeerCache.h"
+#include "Metrics.h"
 
 namespace Hdfs {
 namespace Internal {
@@ -48,16 +49,19 @@ shared_ptr<Socket> PeerCache::getConnection(const DatanodeInfo& datanode) {
   int64_t elipsed;
 
   if (!Map.findAndErase(key, &value)) {
+    Metrics::Add(METRIC_PEER_CACHE_MISSES);
     LOG(DEBUG1, "PeerCache miss for datanode %s uuid(%s).",
         datanode.formatAddress().c_str(), datanode.getDatanodeId().c_str());
     return shared_ptr<Socket>();
   } else if ((elipsed = ToMilliSeconds(value.second, steady_clock::now())) >
              expireTimeInterval) {
+    Metrics::Add(METRIC_PEER_CACHE_MISSES);
     LOG(DEBUG1, "PeerCache expire for datanode %s uuid(%s).",
         datanode.formatAddress().c_str(), datanode.getDatanodeId().c_str());
     return shared_ptr<Socket>();
   }
 
+  Metrics::Add(METRIC_PEER_CACHE_HITS);
   LOG(DEBUG1, "PeerCache hit for datanode %s uuid(%s), elipsed %" PRId64,
       datanode.formatAddress().c_str(), datanode.getDatanodeId().c_str(),
       elipsed);
@@ -28,6 +28,9 @@
 #include "FileSystemInter.h"
 #include "DataTransferProtocolSender.h"
 #include "datatransfer.pb.h"
+#include "network/UringSocket.h"
+#include "Metrics.h"
+#include "Trace.h"
 
 #include <inttypes.h>
 
@@ -36,11 +39,13 @@ namespace Internal {
 
 PipelineImpl::PipelineImpl(bool append, const char * path, const SessionConfig & conf,
                            shared_ptr<FileSystemInter> filesystem, int checksumType, int chunkSize,
-                           int replication, int64_t bytesSent, PacketPool & packetPool, shared_ptr<LocatedBlock> lastBlock) :
-    checksumType(checksumType), chunkSize(chunkSize), errorIndex(-1), replication(replication), bytesAcked(
+                           int replication, int64_t bytesSent, PacketPool & packetPool, shared_ptr<LocatedBlock> lastBlock,
+                           const CachingStrategy & strategy, const std::vector<std::string> & favoredNodes) :
+    strategy(strategy), checksumType(checksumType), chunkSize(chunkSize), errorIndex(-1), replication(replication), bytesAcked(
         bytesSent), bytesSent(bytesSent), packetPool(packetPool), filesystem(filesystem), lastBlock(lastBlock), path(
-            path) {
+            path), favoredNodes(favoredNodes) {
     canAddDatanode = conf.canAddDatanode();
+    useIoUring = conf.isUseIoUring();
     blockWriteRetry = conf.getBlockWriteRetry();
     connectTimeout = conf.getOutputConnTimeout();
     readTimeout = conf.getOutputReadTimeout();
@@ -86,7 +91,7 @@ int PipelineImpl::findNewDatanode(const std::vector<DatanodeInfo> & original) {
 
 void PipelineImpl::transfer(const ExtendedBlock & blk, const DatanodeInfo & src,
                             const std::vector<DatanodeInfo> & targets, const Token & token) {
-    shared_ptr<Socket> so(new TcpSocketImpl);
+    shared_ptr<Socket> so(UringSocketImpl::Create(useIoUring));
     shared_ptr<BufferedSocketReader> in(new BufferedSocketReaderImpl(*so));
     so->connect(src.getIpAddr().c_str(), src.getXferPort(), connectTimeout);
     DataTransferProtocolSender sender(*so, writeTimeout, src.formatAddress());
@@ -196,6 +201,10 @@ void PipelineImpl::buildForAppendOrRecovery(bool recovery) {
     shared_ptr<LocatedBlock> lb;
     std::string buffer;
 
+    if (recovery) {
+        Metrics::Add(METRIC_PIPELINE_RECOVERIES);
+    }
+
     do {
         /*
          * Remove bad datanode from list of datanodes.
@@ -324,7 +333,7 @@ void PipelineImpl::locateNextBlock(
     while (true) {
         try {
             lastBlock = filesystem->addBlock(path, lastBlock.get(),
-                                             excludedNodes);
+                                             excludedNodes, favoredNodes);
             assert(lastBlock);
             return;
         } catch (const NotReplicatedYetException & e) {
@@ -504,12 +513,13 @@ void PipelineImpl::checkBadLinkFormat(const std::string & n) {
 }
 
 void PipelineImpl::createBlockOutputStream(const Token & token, int64_t gs, bool recovery) {
+    TraceScope trace(TRACE_PIPELINE_SETUP);
     std::string firstBadLink;
     exception_ptr lastError;
     bool needWrapException = true;
 
     try {
-        sock = shared_ptr < Socket > (new TcpSocketImpl);
+        sock = shared_ptr < Socket > (UringSocketImpl::Create(useIoUring));
         reader = shared_ptr<BufferedSocketReader>(new BufferedSocketReaderImpl(*sock));
         sock->connect(nodes[0].getIpAddr().c_str(), nodes[0].getXferPort(),
                       connectTimeout);
@@ -523,7 +533,7 @@ void PipelineImpl::createBlockOutputStream(const Token & token, int64_t gs, bool
                                           nodes[0].formatAddress());
         sender.writeBlock(*lastBlock, token, clientName.c_str(), targets,
                           (recovery ? (stage | 0x1) : stage), nodes.size(),
-                          lastBlock->getNumBytes(), bytesSent, gs, checksumType, chunkSize);
+                          lastBlock->getNumBytes(), bytesSent, gs, checksumType, chunkSize, strategy);
         int size;
         size = reader->readVarint32(readTimeout);
         std::vector<char> buf(size);
@@ -739,7 +749,12 @@ void PipelineImpl::waitForAcks(bool force) {
                 resend();
             }
 
-            checkResponse(true);
+            {
+                TraceScope trace(TRACE_PIPELINE_ACK);
+                MetricsTimer timer(METRIC_PIPELINE_ACK_LATENCY);
+                checkResponse(true);
+            }
+
             failover = false;
         } catch (const HdfsIOException & e) {
             if (errorIndex < 0) {
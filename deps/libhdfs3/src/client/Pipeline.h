@@ -22,6 +22,7 @@
 #ifndef _HDFS_LIBHDFS3_CLIENT_PIPELINE_H_
 #define _HDFS_LIBHDFS3_CLIENT_PIPELINE_H_
 
+#include "CachingStrategy.h"
 #include "FileSystemInter.h"
 #include "Memory.h"
 #include "network/BufferedSocketReader.h"
@@ -127,7 +128,8 @@ public:
     PipelineImpl(bool append, const char * path, const SessionConfig & conf,
                  shared_ptr<FileSystemInter> filesystem, int checksumType, int chunkSize,
                  int replication, int64_t bytesSent, PacketPool & packetPool,
-                 shared_ptr<LocatedBlock> lastBlock);
+                 shared_ptr<LocatedBlock> lastBlock, const CachingStrategy & strategy,
+                 const std::vector<std::string> & favoredNodes);
 
     /**
      * send all data and wait for all ack.
@@ -168,6 +170,8 @@ private:
 private:
     BlockConstructionStage stage;
     bool canAddDatanode;
+    bool useIoUring;
+    CachingStrategy strategy;
     int blockWriteRetry;
     int checksumType;
     int chunkSize;
@@ -187,6 +191,7 @@ private:
     std::string clientName;
     std::string path;
     std::vector<DatanodeInfo> nodes;
+    std::vector<std::string> favoredNodes;
     std::vector<std::string> storageIDs;
 
 };
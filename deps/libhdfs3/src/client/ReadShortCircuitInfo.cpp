@@ -136,8 +136,8 @@ BlockLocalPathInfo ReadShortCircuitInfoBuilder::getBlockLocalPathInfo(
   try {
     if (!BlockLocalPathInfoCache.find(key, &retval)) {
       RpcAuth a = auth;
-      SessionConfig c = conf;
-      c.setRpcMaxRetryOnConnect(1);
+      RpcConfig c(conf);
+      c.setMaxRetryOnConnect(1);
 
       /*
        * only kerberos based authentication is allowed, do not add
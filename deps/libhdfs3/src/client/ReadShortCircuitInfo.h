@@ -174,7 +174,7 @@ class ReadShortCircuitInfoBuilder {
  private:
   DatanodeInfo dnInfo;
   RpcAuth auth;
-  SessionConfig conf;
+  const SessionConfig& conf;
   static const int MaxReadShortCircuitVersion = 1;
   static ReadShortCircuitFDCacheType ReadShortCircuitFDCache;
   static BlockLocalPathInfoCacheType BlockLocalPathInfoCache;
@@ -24,8 +24,11 @@
 #include "Exception.h"
 #include "ExceptionInternal.h"
 #include "HWCrc32c.h"
+#include "Metrics.h"
 #include "RemoteBlockReader.h"
 #include "SWCrc32c.h"
+#include "Trace.h"
+#include "network/UringSocket.h"
 #include "WriteBuffer.h"
 
 #include <inttypes.h>
@@ -39,13 +42,16 @@ RemoteBlockReader::RemoteBlockReader(const ExtendedBlock& eb,
                                      PeerCache& peerCache, int64_t start,
                                      int64_t len, const Token& token,
                                      const char* clientName, bool verify,
-                                     SessionConfig& conf)
+                                     const SessionConfig& conf,
+                                     const CachingStrategy& strategy)
     : sentStatus(false),
+      useIoUring(conf.isUseIoUring()),
       verify(verify),
       binfo(eb),
       datanode(datanode),
       checksumSize(0),
       chunkSize(0),
+      headerAhead(0),
       position(0),
       size(0),
       cursor(start),
@@ -61,7 +67,8 @@ RemoteBlockReader::RemoteBlockReader(const ExtendedBlock& eb,
     in = shared_ptr<BufferedSocketReader>(new BufferedSocketReaderImpl(*sock));
     sender = shared_ptr<DataTransferProtocol>(new DataTransferProtocolSender(
         *sock, writeTimeout, datanode.formatAddress()));
-    sender->readBlock(eb, token, clientName, start, len);
+    TraceScope trace(TRACE_READ_BLOCK_RESPONSE);
+    sender->readBlock(eb, token, clientName, start, len, strategy);
     checkResponse();
 }
 
@@ -79,7 +86,9 @@ shared_ptr<Socket> RemoteBlockReader::getNextPeer(const DatanodeInfo& dn) {
         sock = peerCache.getConnection(dn);
 
         if (!sock) {
-            sock = shared_ptr<Socket>(new TcpSocketImpl);
+            TraceScope trace(TRACE_DATANODE_CONNECT);
+            MetricsTimer timer(METRIC_DATANODE_CONNECT_LATENCY);
+            sock = shared_ptr<Socket>(UringSocketImpl::Create(useIoUring));
             sock->connect(dn.getIpAddr().c_str(), dn.getXferPort(),
                           connTimeout);
             sock->setNoDelay(true);
@@ -190,9 +199,24 @@ shared_ptr<PacketHeader> RemoteBlockReader::readPacketHeader() {
                   datanode.formatAddress().c_str(), binfo.toString().c_str());
         }
 
-        in->readFully(&buf[0], packetHeaderLen, readTimeout);
         retval = shared_ptr<PacketHeader>(new PacketHeader);
+
+        /*
+         * the part already read together with the previous packet.
+         */
+        int ahead = headerAhead;
+        headerAhead = 0;
+
+        if (ahead > 0) {
+            memcpy(&buf[0], &buffer[size], ahead);
+        }
+
+        if (ahead < packetHeaderLen) {
+            in->readFully(&buf[ahead], packetHeaderLen - ahead, readTimeout);
+        }
+
         retval->readFields(&buf[0], packetHeaderLen);
+
         return retval;
     } catch (const HdfsIOException & e) {
         NESTED_THROW(HdfsIOException, "RemoteBlockReader: failed to read block header for Block: %s from Datanode: %s.",
@@ -202,7 +226,14 @@ shared_ptr<PacketHeader> RemoteBlockReader::readPacketHeader() {
 
 void RemoteBlockReader::readNextPacket() {
     assert(position >= size);
-    lastHeader = readPacketHeader();
+
+    if (-1 == lastSeqNo) {
+        TraceScope trace(TRACE_FIRST_PACKET);
+        lastHeader = readPacketHeader();
+    } else {
+        lastHeader = readPacketHeader();
+    }
+
     int dataSize = lastHeader->getDataLen();
     int64_t pendingAhead = 0;
 
@@ -218,8 +249,15 @@ void RemoteBlockReader::readNextPacket() {
         int checksumLen = chunks * checksumSize;
         size = checksumLen + dataSize;
         assert(size == lastHeader->getPacketLen() - static_cast<int>(sizeof(int32_t)));
-        buffer.resize(size);
+        /*
+         * a data packet is always followed by at least the trailing empty
+         * packet, take what already arrived of its fixed size header along
+         * with this packet. Never wait for it, the data is delivered first.
+         */
+        int headerLen = lastHeader->isLastPacketInBlock() ? 0 : PacketHeader::GetPkgHeaderSize();
+        buffer.resize(size + headerLen);
         in->readFully(&buffer[0], size, readTimeout);
+        headerAhead = headerLen > 0 ? in->readAvailable(&buffer[size], headerLen) : 0;
         lastSeqNo = lastHeader->getSeqno();
 
         if (lastHeader->getPacketLen() != static_cast<int>(sizeof(int32_t)) + dataSize + checksumLen) {
@@ -281,6 +319,7 @@ void RemoteBlockReader::sendStatus() {
 }
 
 void RemoteBlockReader::verifyChecksum(int chunks) {
+    TraceScope trace(TRACE_CHECKSUM);
     int dataSize = lastHeader->getDataLen();
     char * pchecksum = &buffer[0];
     char * pdata = &buffer[0] + (chunks * checksumSize);
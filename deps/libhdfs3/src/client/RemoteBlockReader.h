@@ -42,7 +42,7 @@ public:
     RemoteBlockReader(const ExtendedBlock& eb, DatanodeInfo& datanode,
                       PeerCache& peerCache, int64_t start, int64_t len,
                       const Token& token, const char* clientName, bool verify,
-                      SessionConfig& conf);
+                      const SessionConfig& conf, const CachingStrategy& strategy);
 
     ~RemoteBlockReader();
 
@@ -78,12 +78,14 @@ private:
 
 private:
     bool sentStatus;
+    bool useIoUring;
     bool verify; //verify checksum or not.
     const ExtendedBlock & binfo;
     DatanodeInfo & datanode;
     int checksumSize;
     int chunkSize;
     int connTimeout;
+    int headerAhead; //bytes of the next packet header in buffer after the data.
     int position; //point in buffer.
     int readTimeout;
     int size;  //data size in buffer.
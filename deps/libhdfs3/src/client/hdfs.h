@@ -157,6 +157,19 @@ hdfsFS hdfsBuilderConnect(struct hdfsBuilder * bld);
  */
 struct hdfsBuilder * hdfsNewBuilder(void);
 
+/**
+ * Create an HDFS builder with the configuration read from a file instead
+ * of the one named by the environment variable LIBHDFS3_CONF, which is not
+ * read. Unlike hdfsNewBuilder it is safe while other threads change the
+ * environment.
+ *
+ * @param conf the path of the configuration file, NULL or empty for
+ *        hdfs-client.xml in the working directory if it exists.
+ *
+ * @return The HDFS builder, or NULL on error, e.g. if conf cannot be read.
+ */
+struct hdfsBuilder * hdfsNewBuilderWithConf(const char * conf);
+
 /**
  * Do nothing, we always create a new instance
  *
@@ -404,8 +417,37 @@ int hdfsSync(hdfsFS fs, hdfsFile file);
  */
 int hdfsAvailable(hdfsFS fs, hdfsFile file);
 
+/**
+ * hdfsFileSetCachingStrategy - Set the page cache hints the datanodes get
+ * for the following block reads, or pipelines of a file opened for write.
+ * The defaults come from dfs.client.cache.drop.behind.reads,
+ * dfs.client.cache.drop.behind.writes and dfs.client.cache.readahead.
+ * @param fs The configured filesystem handle.
+ * @param file The file handle.
+ * @param dropBehind 1 to drop the data from the page cache of the datanodes
+ * once it is transferred, 0 to keep it, -1 to keep the current hint.
+ * @param readahead The bytes the datanodes read ahead, -1 to keep the current
+ * hint. Ignored for writes.
+ * @return Returns 0 on success, -1 on error.
+ */
+int hdfsFileSetCachingStrategy(hdfsFS fs, hdfsFile file, int dropBehind, tOffset readahead);
+
+/**
+ * hdfsFileSetFavoredNodes - Ask the namenode to place the replicas of the
+ * following new blocks of a file opened for write on the given datanodes if
+ * possible. Call it right after hdfsOpenFile to place all the blocks.
+ * @param fs The configured filesystem handle.
+ * @param file The file handle.
+ * @param nodes The host:port of the data transfer addresses of the datanodes,
+ * the first one gets the first replica.
+ * @param numNodes The number of nodes, 0 to leave the placement to the namenode.
+ * @return Returns 0 on success, -1 on error.
+ */
+int hdfsFileSetFavoredNodes(hdfsFS fs, hdfsFile file, const char * const * nodes, int numNodes);
+
 /**
  * hdfsCopy - Copy file from one filesystem to another.
+ * It is hdfsCopyTree with the default options.
  * @param srcFS The handle to source filesystem.
  * @param src The path of source file.
  * @param dstFS The handle to destination filesystem.
@@ -414,6 +456,64 @@ int hdfsAvailable(hdfsFS fs, hdfsFile file);
  */
 int hdfsCopy(hdfsFS srcFS, const char * src, hdfsFS dstFS, const char * dst);
 
+#define HDFS_COPY_PRESERVE_REPLICATION 0x01
+#define HDFS_COPY_PRESERVE_BLOCKSIZE 0x02
+#define HDFS_COPY_PRESERVE_PERMISSION 0x04
+#define HDFS_COPY_PRESERVE_OWNER 0x08
+#define HDFS_COPY_PRESERVE_TIMES 0x10
+#define HDFS_COPY_PRESERVE_ALL 0x1F
+
+/**
+ * hdfsCopyProgress - The counters of hdfsCopyTree, files and bytes grow
+ * as the source tree is listed.
+ */
+typedef struct {
+    tOffset files;          // files found so far
+    tOffset filesCopied;    // files written to the destination
+    tOffset filesSkipped;   // files with the same checksum on both sides
+    tOffset bytes;          // length of the files found so far
+    tOffset bytesCopied;    // bytes written, including files being copied
+    tOffset bytesSkipped;   // length of the skipped files
+} hdfsCopyProgress;
+
+/**
+ * hdfsCopyProgressCallback - Called as a copy advances, from the threads
+ * doing the copy but one call at a time. It should return quickly.
+ */
+typedef void (*hdfsCopyProgressCallback)(const hdfsCopyProgress * progress, void * data);
+
+/**
+ * hdfsCopyOptions - How hdfsCopyTree copies, 0 selects the default of a field.
+ */
+typedef struct {
+    int parallelism;            // files or parts copied at once, 8 by default
+    int skipIfChecksumMatches;  // leave files alone with the same length and checksum on both sides
+    int preserve;               // HDFS_COPY_PRESERVE_* flags, 0 preserves nothing
+    int blocksPerPart;          // files of more blocks are copied in parts of this many blocks, -1 never splits, 8 by default
+    tOffset bufferSize;         // the buffer of each thread, 8MB by default
+    hdfsCopyProgressCallback progress; // NULL for none
+    void * data;                // passed to progress
+} hdfsCopyOptions;
+
+/**
+ * hdfsCopyTree - Copy a file or mirror a directory tree from one
+ * filesystem to another, or within one. src/x is copied to dst/x and
+ * existing destination files are replaced, a file copied to an existing
+ * directory goes into it. Files are copied in parallel to temporary files
+ * renamed when complete, large files in parts of whole blocks which are
+ * concatenated. On error the files being copied are finished and no more
+ * are started.
+ * @param srcFS The handle to source filesystem.
+ * @param src The path of the source file or directory.
+ * @param dstFS The handle to destination filesystem, may be srcFS.
+ * @param dst The path of the copy.
+ * @param options How to copy, NULL for the defaults which preserve the block size.
+ * @param progress Output the counters of the copy, may be NULL.
+ * @return Returns 0 on success, -1 on error.
+ */
+int hdfsCopyTree(hdfsFS srcFS, const char * src, hdfsFS dstFS, const char * dst,
+                 const hdfsCopyOptions * options, hdfsCopyProgress * progress);
+
 /**
  * hdfsMove - Move file from one filesystem to another.
  * @param srcFS The handle to source filesystem.
@@ -444,6 +544,18 @@ int hdfsDelete(hdfsFS fs, const char * path, int recursive);
  */
 int hdfsRename(hdfsFS fs, const char * oldPath, const char * newPath);
 
+/**
+ * hdfsConcat - Move the blocks of files to the end of an existing file
+ * and delete them.
+ * @param fs The configured filesystem handle.
+ * @param trg The path of the file to append the blocks to.
+ * @param srcs The paths of the files to move the blocks of, in the
+ * directory of trg with the same block size and full blocks but the last.
+ * @param numSrcs The number of paths in srcs.
+ * @return Returns 0 on success, -1 on error.
+ */
+int hdfsConcat(hdfsFS fs, const char * trg, const char * const * srcs, int numSrcs);
+
 /**
  * hdfsGetWorkingDirectory - Get the current working directory for
  * the given filesystem.
@@ -544,6 +656,18 @@ hdfsFileInfo * hdfsListDirectory(hdfsFS fs, const char * path, int * numEntries)
  */
 hdfsFileInfo * hdfsGetPathInfo(hdfsFS fs, const char * path);
 
+/**
+ * hdfsGetPathInfoBatch - Get information about many paths. The NameNode
+ * calls are pipelined on one connection instead of waiting for each reply.
+ * hdfsFreeFileInfo should be called when the array is no longer needed.
+ * @param fs The configured filesystem handle.
+ * @param paths The paths.
+ * @param numPaths The number of paths.
+ * @return Returns a dynamically-allocated array of numPaths hdfsFileInfo
+ * objects, mName is NULL for the paths which do not exist; NULL on error.
+ */
+hdfsFileInfo * hdfsGetPathInfoBatch(hdfsFS fs, const char ** paths, int numPaths);
+
 /**
  * hdfsFreeFileInfo - Free up the hdfsFileInfo array (including fields)
  * @param infos The array of dynamically-allocated hdfsFileInfo
@@ -757,6 +881,30 @@ BlockLocation * hdfsGetFileBlockLocations(hdfsFS fs, const char * path,
  */
 void hdfsFreeFileBlockLocations(BlockLocation * locations, int numOfBlock);
 
+#define HDFS_FILE_CHECKSUM_MAX_BYTES 28
+
+typedef struct {
+    char algorithm[64];     // e.g. MD5-of-262144MD5-of-512CRC32C
+    int bytesPerCrc;        // data bytes covered by a CRC
+    tOffset crcPerBlock;    // CRCs per block, 0 for files of one block
+    int length;             // the number of valid bytes in bytes
+    unsigned char bytes[HDFS_FILE_CHECKSUM_MAX_BYTES]; // the checksum as HDFS compares it
+} hdfsFileChecksum;
+
+/**
+ * Get the checksum of a file, the MD5 of the MD5s of the CRCs of its blocks.
+ * The datanodes compute the checksums of the blocks in parallel from the
+ * CRCs they store, no block data is read. Files with the same content,
+ * block size and bytes per checksum have the same checksum on every cluster.
+ *
+ * @param fs The file system
+ * @param path The path to the file
+ * @param checksum Output the checksum of the file
+ *
+ * @return Returns 0 on success, -1 on error.
+ */
+int hdfsGetFileChecksum(hdfsFS fs, const char * path, hdfsFileChecksum * checksum);
+
 /**
  * Create encryption zone for the directory with specific key name
  * @param fs The configured filesystem handle.
@@ -786,6 +934,218 @@ hdfsEncryptionZoneInfo * hdfsGetEZForPath(hdfsFS fs, const char * path);
  */
 hdfsEncryptionZoneInfo * hdfsListEncryptionZones(hdfsFS fs, int * numEntries);
 
+/**
+ * hdfsTraceSpan - The time spent in one phase of a traced operation,
+ * such as "rpc", "getBlockLocations", "datanodeConnect" or "checksum".
+ * A phase entered several times is reported as one span.
+ */
+typedef struct {
+    const char * phase; /* the name of the phase, a static string */
+    int count; /* how many times the phase was entered */
+    int64_t start; /* the first entry in nanoseconds after the operation started */
+    int64_t duration; /* the total time in the phase in nanoseconds */
+} hdfsTraceSpan;
+
+#define HDFS_TRACE_MAX_SPANS 16
+
+/**
+ * hdfsTrace - The timings of one operation, measured with a monotonic clock.
+ * Phases may nest, e.g. "rpc" inside "getBlockLocations".
+ */
+typedef struct {
+    char operation[32]; /* the name of the operation */
+    int64_t start; /* the start of the operation in nanoseconds */
+    int64_t duration; /* the duration of the operation in nanoseconds */
+    int numSpans; /* the number of valid entries in spans */
+    hdfsTraceSpan spans[HDFS_TRACE_MAX_SPANS];
+} hdfsTrace;
+
+/**
+ * hdfsTraceBegin - Start tracing the calls made by this thread
+ * until hdfsTraceEnd.
+ * @param operation The name of the operation.
+ */
+void hdfsTraceBegin(const char * operation);
+
+/**
+ * hdfsTraceEnd - Stop tracing on this thread.
+ * @param trace Filled with the timings of the operation, may be NULL.
+ * @return Returns 0 on success, -1 if hdfsTraceBegin was not called.
+ */
+int hdfsTraceEnd(hdfsTrace * trace);
+
+/**
+ * hdfsTraceSetSampleRate - Keep one of every n finished traces, including
+ * hdfsAsync* operations, in a ring of the last 256 samples.
+ * @param n The sample rate, 0 disables sampling which is the default.
+ */
+void hdfsTraceSetSampleRate(int n);
+
+/**
+ * hdfsTraceTakeSamples - Copy the sampled traces, oldest first, and
+ * empty the ring.
+ * @param traces The array to fill.
+ * @param max The size of the array.
+ * @return Returns the number of traces copied.
+ */
+int hdfsTraceTakeSamples(hdfsTrace * traces, int max);
+
+/**
+ * hdfsMetricCounter - A process wide counter, such as "bytesReadRemote",
+ * "peerCacheHits", "rpcRetries" or "pipelineRecoveries".
+ */
+typedef struct {
+    const char * name; /* the name of the counter, a static string */
+    int64_t value;
+} hdfsMetricCounter;
+
+/**
+ * hdfsMetricHistogram - A process wide latency histogram, such as
+ * "rpcLatency" or "datanodeConnectLatency". The values are in microseconds,
+ * percentiles are accurate to 12.5%.
+ */
+typedef struct {
+    const char * name; /* the name of the histogram, a static string */
+    int64_t count;
+    int64_t sum;
+    int64_t min;
+    int64_t max;
+    int64_t p50;
+    int64_t p90;
+    int64_t p99;
+    int64_t p999;
+} hdfsMetricHistogram;
+
+#define HDFS_METRICS_MAX_COUNTERS 32
+#define HDFS_METRICS_MAX_HISTOGRAMS 16
+
+/**
+ * hdfsMetrics - A snapshot of the client metrics of this process.
+ * Counters only grow, compare two snapshots to get the rate.
+ */
+typedef struct {
+    int numCounters; /* the number of valid entries in counters */
+    hdfsMetricCounter counters[HDFS_METRICS_MAX_COUNTERS];
+    int numHistograms; /* the number of valid entries in histograms */
+    hdfsMetricHistogram histograms[HDFS_METRICS_MAX_HISTOGRAMS];
+} hdfsMetrics;
+
+/**
+ * hdfsGetMetrics - Take a snapshot of the client metrics of this process.
+ * @param metrics The snapshot to fill.
+ * @return Returns 0 on success, -1 on error.
+ */
+int hdfsGetMetrics(hdfsMetrics * metrics);
+
+/**
+ * hdfsAsyncResult - The result of an hdfsAsync* operation.
+ * It is only valid during the callback.
+ */
+typedef struct {
+    int ret; /* the return value of the blocking call, -1 on error */
+    int errnum; /* the errno if ret is -1 */
+    const char * error; /* the error message if ret is -1 */
+    hdfsFile file; /* the opened file of hdfsAsyncOpenFile */
+    hdfsFileInfo * info; /* the result of hdfsAsyncListDirectory and hdfsAsyncGetPathInfo, the callback owns it */
+    int numEntries; /* the number of entries in info */
+    const hdfsTrace * trace; /* the timings of the operation */
+} hdfsAsyncResult;
+
+/**
+ * hdfsAsyncCallback - Called on a libhdfs3 worker thread when an
+ * hdfsAsync* operation completes. It should return quickly and must not
+ * call blocking libhdfs3 functions.
+ * @param result The result of the operation.
+ * @param data The data passed to the hdfsAsync* function.
+ */
+typedef void (*hdfsAsyncCallback)(hdfsAsyncResult * result, void * data);
+
+/**
+ * The hdfsAsync* functions queue the operation to a shared pool of
+ * libhdfs3 threads and return immediately, the callback is invoked when it
+ * completes. Operations on the same file run one at a time in the order
+ * they are queued, operations on different files run concurrently.
+ * Do not mix them with the blocking functions on the same file while
+ * operations are pending.
+ * All functions return 0 if the operation is queued, the callback is not
+ * invoked otherwise; -1 on error with errno set.
+ */
+
+/**
+ * hdfsAsyncSetThreads - Grow the pool of threads running hdfsAsync*
+ * operations. The pool has 8 threads by default and never shrinks.
+ * @param threads The number of threads.
+ * @return Returns 0 on success, -1 on error.
+ */
+int hdfsAsyncSetThreads(int threads);
+
+/**
+ * hdfsAsyncOpenFile - The asynchronous hdfsOpenFile, the file is returned in result->file.
+ */
+int hdfsAsyncOpenFile(hdfsFS fs, const char * path, int flags, int bufferSize,
+                      short replication, tOffset blocksize,
+                      hdfsAsyncCallback callback, void * data);
+
+/**
+ * hdfsAsyncRead - The asynchronous hdfsRead.
+ * The buffer must stay valid until the callback is invoked.
+ */
+int hdfsAsyncRead(hdfsFS fs, hdfsFile file, void * buffer, tSize length,
+                  hdfsAsyncCallback callback, void * data);
+
+/**
+ * hdfsAsyncReadFrom - hdfsSeek followed by hdfsRead, the stream goes on
+ * after the bytes read. The buffer must stay valid until the callback
+ * is invoked.
+ */
+int hdfsAsyncReadFrom(hdfsFS fs, hdfsFile file, tOffset position, void * buffer,
+                      tSize length, hdfsAsyncCallback callback, void * data);
+
+/**
+ * hdfsAsyncPread - Read length bytes at the given position of an open
+ * file, less only at the end of the file. The position of the stream is
+ * kept, but the next read opens a new block reader. The buffer must stay
+ * valid until the callback is invoked.
+ */
+int hdfsAsyncPread(hdfsFS fs, hdfsFile file, tOffset position, void * buffer,
+                   tSize length, hdfsAsyncCallback callback, void * data);
+
+/**
+ * hdfsAsyncWrite - The asynchronous hdfsWrite.
+ * The buffer must stay valid until the callback is invoked.
+ */
+int hdfsAsyncWrite(hdfsFS fs, hdfsFile file, const void * buffer, tSize length,
+                   hdfsAsyncCallback callback, void * data);
+
+/**
+ * hdfsAsyncFlush - The asynchronous hdfsFlush.
+ */
+int hdfsAsyncFlush(hdfsFS fs, hdfsFile file, hdfsAsyncCallback callback,
+                   void * data);
+
+/**
+ * hdfsAsyncCloseFile - The asynchronous hdfsCloseFile. The file is closed
+ * after the operations queued on it before and must not be used after this call.
+ */
+int hdfsAsyncCloseFile(hdfsFS fs, hdfsFile file, hdfsAsyncCallback callback,
+                       void * data);
+
+/**
+ * hdfsAsyncListDirectory - The asynchronous hdfsListDirectory.
+ * The entries are returned in result->info and result->numEntries,
+ * the callback should free them with hdfsFreeFileInfo.
+ */
+int hdfsAsyncListDirectory(hdfsFS fs, const char * path,
+                           hdfsAsyncCallback callback, void * data);
+
+/**
+ * hdfsAsyncGetPathInfo - The asynchronous hdfsGetPathInfo.
+ * The file info is returned in result->info, the callback should free
+ * it with hdfsFreeFileInfo.
+ */
+int hdfsAsyncGetPathInfo(hdfsFS fs, const char * path,
+                         hdfsAsyncCallback callback, void * data);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,142 @@
+/********************************************************************
+ * 2014 -
+ * open source under Apache License Version 2.0
+ ********************************************************************/
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "AsyncExecutor.h"
+#include "Exception.h"
+#include "ExceptionInternal.h"
+#include "Logger.h"
+
+#define DEFAULT_ASYNC_THREADS 8
+
+namespace Hdfs {
+namespace Internal {
+
+AsyncExecutor::AsyncExecutor(int threads) :
+    stopped(false) {
+    startThreads(threads);
+}
+
+AsyncExecutor::~AsyncExecutor() {
+    {
+        lock_guard<mutex> lock(mut);
+        stopped = true;
+        ready.clear();
+        waiting.clear();
+    }
+
+    cond.notify_all();
+
+    for (size_t i = 0; i < workers.size(); ++i) {
+        workers[i]->join();
+    }
+}
+
+void AsyncExecutor::startThreads(int threads) {
+    while (static_cast<int>(workers.size()) < threads) {
+        shared_ptr<thread> worker(new thread);
+        CREATE_THREAD(*worker, bind(&AsyncExecutor::run, this));
+        workers.push_back(worker);
+    }
+}
+
+void AsyncExecutor::setThreads(int threads) {
+    lock_guard<mutex> lock(mut);
+    startThreads(threads);
+}
+
+int AsyncExecutor::getThreads() {
+    lock_guard<mutex> lock(mut);
+    return workers.size();
+}
+
+void AsyncExecutor::submit(const void * key, const function<void()> & task) {
+    lock_guard<mutex> lock(mut);
+
+    if (stopped) {
+        THROW(HdfsIOException, "AsyncExecutor is stopped.");
+    }
+
+    if (key) {
+        std::map<const void *, std::deque<function<void()> > >::iterator it = waiting.find(key);
+
+        if (it != waiting.end()) {
+            /*
+             * a task with the same key is queued or running.
+             */
+            it->second.push_back(task);
+            return;
+        }
+
+        waiting[key];
+    }
+
+    ready.push_back(Task(key, task));
+    cond.notify_one();
+}
+
+void AsyncExecutor::run() {
+    unique_lock<mutex> lock(mut);
+
+    while (!stopped) {
+        if (ready.empty()) {
+            cond.wait(lock);
+            continue;
+        }
+
+        Task task = ready.front();
+        ready.pop_front();
+        lock.unlock();
+
+        try {
+            task.task();
+        } catch (const std::exception & e) {
+            LOG(LOG_ERROR, "AsyncExecutor: task failed: %s", e.what());
+        }
+
+        lock.lock();
+
+        if (task.key) {
+            std::map<const void *, std::deque<function<void()> > >::iterator it = waiting.find(task.key);
+
+            if (it == waiting.end()) {
+                continue;
+            }
+
+            if (it->second.empty()) {
+                waiting.erase(it);
+            } else {
+                ready.push_back(Task(task.key, it->second.front()));
+                it->second.pop_front();
+            }
+        }
+    }
+}
+
+AsyncExecutor & AsyncExecutor::Default() {
+    /*
+     * never destroyed, workers may still run when the process exits.
+     */
+    static AsyncExecutor * executor = new AsyncExecutor(DEFAULT_ASYNC_THREADS);
+    return *executor;
+}
+
+}
+}
@@ -0,0 +1,107 @@
+/********************************************************************
+ * 2014 -
+ * open source under Apache License Version 2.0
+ ********************************************************************/
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _HDFS_LIBHDFS3_COMMON_ASYNCEXECUTOR_H_
+#define _HDFS_LIBHDFS3_COMMON_ASYNCEXECUTOR_H_
+
+#include "Function.h"
+#include "Memory.h"
+#include "Thread.h"
+
+#include <deque>
+#include <map>
+#include <vector>
+
+namespace Hdfs {
+namespace Internal {
+
+/**
+ * A fixed pool of threads which runs the blocking client calls behind the
+ * hdfsAsync* API, so the callers do not need a thread per operation.
+ *
+ * Tasks submitted with the same key run one at a time in submission order,
+ * this is how operations on one stream are kept from running concurrently.
+ */
+class AsyncExecutor {
+public:
+    /**
+     * Construct an executor.
+     * @param threads The number of worker threads.
+     */
+    explicit AsyncExecutor(int threads);
+
+    /**
+     * Stop the workers, tasks not started yet are discarded.
+     */
+    ~AsyncExecutor();
+
+    /**
+     * Queue a task.
+     * @param key The key to serialize on, NULL means no ordering.
+     * @param task The task to run on a worker thread.
+     */
+    void submit(const void * key, const function<void()> & task);
+
+    /**
+     * Grow the pool, the pool never shrinks.
+     * @param threads The number of worker threads wanted.
+     */
+    void setThreads(int threads);
+
+    /**
+     * Get the number of worker threads.
+     */
+    int getThreads();
+
+    /**
+     * Get the process wide executor used by the C API.
+     */
+    static AsyncExecutor & Default();
+
+private:
+    struct Task {
+        Task(const void * key, const function<void()> & task) :
+            key(key), task(task) {
+        }
+
+        const void * key;
+        function<void()> task;
+    };
+
+    void run();
+    void startThreads(int threads);
+
+private:
+    AsyncExecutor(const AsyncExecutor & other);
+    AsyncExecutor & operator =(const AsyncExecutor & other);
+
+    bool stopped;
+    condition_variable cond;
+    mutex mut;
+    std::deque<Task> ready;
+    std::map<const void *, std::deque<function<void()> > > waiting;
+    std::vector<shared_ptr<thread> > workers;
+};
+
+}
+}
+
+#endif /* _HDFS_LIBHDFS3_COMMON_ASYNCEXECUTOR_H_ */
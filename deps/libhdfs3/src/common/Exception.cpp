@@ -65,6 +65,12 @@ const char * ReplicaNotFoundException::ReflexName =
 const char * NameNodeStandbyException::ReflexName =
     "org.apache.hadoop.ipc.StandbyException";
 
+const char * ObserverRetryOnActiveException::ReflexName =
+    "org.apache.hadoop.ipc.ObserverRetryOnActiveException";
+
+const char * NameNodeRetriableException::ReflexName =
+    "org.apache.hadoop.ipc.RetriableException";
+
 const char * HdfsInvalidBlockToken::ReflexName =
     "org.apache.hadoop.security.token.SecretManager$InvalidToken";
 
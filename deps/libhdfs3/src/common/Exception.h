@@ -502,6 +502,34 @@ public:
     static const char * ReflexName;
 };
 
+class ObserverRetryOnActiveException: public NameNodeStandbyException {
+public:
+    ObserverRetryOnActiveException(const std::string & arg, const char * file,
+                                   int line, const char * stack) :
+        NameNodeStandbyException(arg, file, line, stack) {
+    }
+
+    ~ObserverRetryOnActiveException() throw () {
+    }
+
+public:
+    static const char * ReflexName;
+};
+
+class NameNodeRetriableException: public HdfsIOException {
+public:
+    NameNodeRetriableException(const std::string & arg, const char * file,
+                               int line, const char * stack) :
+        HdfsIOException(arg, file, line, stack) {
+    }
+
+    ~NameNodeRetriableException() throw () {
+    }
+
+public:
+    static const char * ReflexName;
+};
+
 class RpcNoSuchMethodException: public HdfsException {
 public:
     RpcNoSuchMethodException(const std::string & arg, const char * file,
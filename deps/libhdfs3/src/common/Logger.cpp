@@ -23,26 +23,90 @@
 
 #include "Logger.h"
 
+#include <algorithm>
 #include <cassert>
+#include <cerrno>
 #include <cstdarg>
 #include <cstdio>
 #include <cstring>
+#include <inttypes.h>
+#include <pthread.h>
 #include <sstream>
+#include <string>
 #include <sys/time.h>
 #include <unistd.h>
 #include <vector>
 
+#include "Atomic.h"
 #include "DateTime.h"
 #include "Thread.h"
 
+/*
+ * Slots per thread ring and message bytes per slot used by asynchronous
+ * logging. Longer messages are written synchronously.
+ */
+#define LOG_RING_CAPACITY 256
+#define LOG_ENTRY_SIZE 512
+#define LOG_LINE_BUFFER_SIZE 4096
+#define LOG_FLUSH_INTERVAL 20
+
 namespace Hdfs {
 namespace Internal {
 
-Logger RootLogger;
+struct LogEntry {
+    struct timeval time;
+    LogSeverity severity;
+    int32_t size;
+    char message[LOG_ENTRY_SIZE];
+};
+
+/*
+ * Single producer single consumer ring, written by the owning thread and
+ * drained by the flusher thread.
+ */
+struct LogRing {
+    LogRing() :
+        head(0), tail(0), orphan(false) {
+        processId[0] = 0;
+    }
+
+    atomic<uint64_t> head;
+    atomic<uint64_t> tail;
+    atomic<bool> orphan;
+    char processId[64];
+    LogEntry entries[LOG_RING_CAPACITY];
+};
 
 static mutex LoggerMutex;
 static THREAD_LOCAL once_flag Once;
 static THREAD_LOCAL char ProcessId[64];
+static THREAD_LOCAL char LineBuffer[LOG_LINE_BUFFER_SIZE];
+static THREAD_LOCAL LogRing * LocalRing;
+static THREAD_LOCAL double Tokens;
+static THREAD_LOCAL int64_t LastRefill;
+
+static atomic<int64_t> Dropped(0);
+static atomic<int64_t> Throttled(0);
+static int64_t ReportedDropped = 0;
+static int64_t ReportedThrottled = 0;
+
+static mutex DrainMutex;
+static mutex RingsMutex;
+static condition_variable FlusherCond;
+static std::vector<LogRing *> Rings;
+static thread Flusher;
+static atomic<bool> FlusherStop(true);
+static atomic<int> FlusherFd(STDERR_FILENO);
+static pthread_key_t RingKey;
+static once_flag RingKeyOnce;
+static mutex ConfigureMutex;
+static bool Configured = false;
+
+/*
+ * Defined after the state above so that it is destroyed first and can
+ * still drain the rings.
+ */
+Logger RootLogger;
 
 const char * SeverityName[] = { "FATAL", "ERROR", "WARNING", "INFO", "DEBUG1",
                                 "DEBUG2", "DEBUG3"
@@ -55,21 +119,360 @@ static void InitProcessId() {
     snprintf(ProcessId, sizeof(ProcessId), "%s", ss.str().c_str());
 }
 
+static int FormatPrefix(char * buffer, size_t size, const struct timeval & tval,
+                        const char * processId, LogSeverity s) {
+    struct tm tm_time;
+    localtime_r(&tval.tv_sec, &tm_time);
+    return snprintf(buffer, size, "%04d-%02d-%02d %02d:%02d:%02d.%06ld, %s, %s ", tm_time.tm_year + 1900,
+                    1 + tm_time.tm_mon, tm_time.tm_mday, tm_time.tm_hour,
+                    tm_time.tm_min, tm_time.tm_sec, static_cast<long>(tval.tv_usec), processId, SeverityName[s]);
+}
+
+static void WriteAll(int fd, const char * buffer, size_t size) {
+    while (size > 0) {
+        ssize_t rc = ::write(fd, buffer, size);
+
+        if (rc < 0 && errno == EINTR) {
+            continue;
+        }
+
+        if (rc <= 0) {
+            return;
+        }
+
+        buffer += rc;
+        size -= rc;
+    }
+}
+
+/*
+ * Append a notice about lost messages, caller should hold LoggerMutex
+ * or be the flusher thread.
+ */
+static void ReportLost(std::string & out) {
+    int64_t dropped = Dropped;
+    int64_t throttled = Throttled;
+
+    if (dropped == ReportedDropped && throttled == ReportedThrottled) {
+        return;
+    }
+
+    char buffer[256];
+    struct timeval tval;
+    gettimeofday(&tval, NULL);
+    int size = FormatPrefix(buffer, sizeof(buffer), tval, "logger", WARNING);
+    snprintf(buffer + size, sizeof(buffer) - size,
+             "lost %" PRId64 " log messages since ring buffer is full and %" PRId64 " by rate limit\n",
+             dropped - ReportedDropped, throttled - ReportedThrottled);
+    out += buffer;
+    ReportedDropped = dropped;
+    ReportedThrottled = throttled;
+}
+
+static void ReleaseRing(void * ring) {
+    static_cast<LogRing *>(ring)->orphan = true;
+}
+
+static void CreateRingKey() {
+    pthread_key_create(&RingKey, ReleaseRing);
+}
+
+struct QueuedEntry {
+    const LogEntry * entry;
+    const LogRing * ring;
+
+    bool operator<(const QueuedEntry & other) const {
+        return entry->time.tv_sec < other.entry->time.tv_sec
+               || (entry->time.tv_sec == other.entry->time.tv_sec
+                   && entry->time.tv_usec < other.entry->time.tv_usec);
+    }
+};
+
+/*
+ * Write out everything queued in the rings, ordered by time.
+ * Only one thread may drain at a time.
+ */
+static void DrainRings(int fd) {
+    lock_guard<mutex> drain(DrainMutex);
+    std::vector<LogRing *> rings;
+    {
+        lock_guard<mutex> lock(RingsMutex);
+        rings = Rings;
+    }
+    std::vector<uint64_t> heads(rings.size());
+    std::vector<QueuedEntry> entries;
+
+    for (size_t i = 0; i < rings.size(); ++i) {
+        uint64_t tail = rings[i]->tail;
+        heads[i] = rings[i]->head;
+
+        for (uint64_t j = tail; j < heads[i]; ++j) {
+            QueuedEntry q = { &rings[i]->entries[j % LOG_RING_CAPACITY], rings[i] };
+            entries.push_back(q);
+        }
+    }
+
+    std::stable_sort(entries.begin(), entries.end());
+    std::string out;
+    out.reserve(entries.size() * 128);
+    char prefix[256];
+
+    for (size_t i = 0; i < entries.size(); ++i) {
+        const LogEntry * e = entries[i].entry;
+        FormatPrefix(prefix, sizeof(prefix), e->time, entries[i].ring->processId, e->severity);
+        out += prefix;
+        out.append(e->message, e->size);
+        out += '\n';
+    }
+
+    {
+        lock_guard<mutex> lock(LoggerMutex);
+        ReportLost(out);
+
+        if (!out.empty()) {
+            WriteAll(fd, out.data(), out.size());
+        }
+    }
+
+    lock_guard<mutex> lock(RingsMutex);
+
+    for (size_t i = 0; i < rings.size(); ++i) {
+        rings[i]->tail = heads[i];
+
+        if (rings[i]->orphan && rings[i]->head == heads[i]) {
+            Rings.erase(std::find(Rings.begin(), Rings.end(), rings[i]));
+            delete rings[i];
+        }
+    }
+}
+
+static void FlusherLoop() {
+    while (!FlusherStop) {
+        try {
+            {
+                unique_lock<mutex> lock(RingsMutex);
+                FlusherCond.wait_for(lock, milliseconds(LOG_FLUSH_INTERVAL));
+            }
+            DrainRings(FlusherFd);
+        } catch (...) {
+            /*
+             * keep running, nothing useful can be logged from here.
+             */
+        }
+    }
+}
+
+static void StartFlusher() {
+    lock_guard<mutex> lock(RingsMutex);
+
+    if (!FlusherStop) {
+        return;
+    }
+
+    FlusherStop = false;
+    CREATE_THREAD(Flusher, &FlusherLoop);
+}
+
+static void StopFlusher() {
+    {
+        lock_guard<mutex> lock(RingsMutex);
+
+        if (FlusherStop) {
+            return;
+        }
+
+        FlusherStop = true;
+    }
+    FlusherCond.notify_all();
+
+    if (Flusher.joinable()) {
+        Flusher.join();
+    }
+}
+
 Logger::Logger() :
-    fd(STDERR_FILENO), severity(DEFAULT_LOG_LEVEL) {
+    fd(STDERR_FILENO), severity(DEFAULT_LOG_LEVEL), async(false), rateLimit(0) {
 }
 
 Logger::~Logger() {
+    try {
+        StopFlusher();
+        DrainRings(fd);
+    } catch (...) {
+    }
 }
 
 void Logger::setOutputFd(int f) {
     fd = f;
+    FlusherFd = f;
 }
 
 void Logger::setLogSeverity(LogSeverity l) {
     severity = l;
 }
 
+void Logger::setAsync(bool a) {
+    lock_guard<mutex> lock(ConfigureMutex);
+
+    if (a == async) {
+        return;
+    }
+
+    if (a) {
+        StartFlusher();
+        async = true;
+    } else {
+        async = false;
+        StopFlusher();
+        DrainRings(fd);
+    }
+}
+
+void Logger::setRateLimit(int32_t perSecond) {
+    rateLimit = perSecond < 0 ? 0 : perSecond;
+}
+
+void Logger::configure(bool a, int32_t perSecond) {
+    {
+        lock_guard<mutex> lock(ConfigureMutex);
+
+        if (Configured) {
+            return;
+        }
+
+        Configured = true;
+    }
+    setRateLimit(perSecond);
+    setAsync(a);
+}
+
+void Logger::flush() {
+    if (FlusherStop) {
+        DrainRings(fd);
+    } else {
+        /*
+         * let the flusher do it, rings are single consumer.
+         */
+        FlusherCond.notify_all();
+    }
+}
+
+int64_t Logger::getDropped() const {
+    return Dropped;
+}
+
+int64_t Logger::getThrottled() const {
+    return Throttled;
+}
+
+/*
+ * Per thread token bucket, INFO and more verbose messages only.
+ */
+bool Logger::throttle(LogSeverity s) {
+    int32_t rateLimit = this->rateLimit;
+
+    if (rateLimit <= 0 || s < INFO) {
+        return false;
+    }
+
+    int64_t now = duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+
+    if (LastRefill == 0) {
+        Tokens = rateLimit;
+    } else {
+        Tokens = std::min<double>(rateLimit, Tokens + (now - LastRefill) * rateLimit / 1000.0);
+    }
+
+    LastRefill = now;
+
+    if (Tokens < 1) {
+        ++Throttled;
+        return true;
+    }
+
+    Tokens -= 1;
+    return false;
+}
+
+bool Logger::append(LogSeverity s, const char * fmt, va_list ap) {
+    LogRing * ring = LocalRing;
+
+    if (!ring) {
+        call_once(Once, InitProcessId);
+        call_once(RingKeyOnce, CreateRingKey);
+        ring = new LogRing;
+        snprintf(ring->processId, sizeof(ring->processId), "%s", ProcessId);
+        {
+            lock_guard<mutex> lock(RingsMutex);
+            Rings.push_back(ring);
+        }
+        pthread_setspecific(RingKey, ring);
+        LocalRing = ring;
+    }
+
+    uint64_t head = ring->head;
+
+    if (head - ring->tail >= LOG_RING_CAPACITY) {
+        ++Dropped;
+        return true;
+    }
+
+    LogEntry & e = ring->entries[head % LOG_RING_CAPACITY];
+    int size = vsnprintf(e.message, sizeof(e.message), fmt, ap);
+
+    if (size < 0 || size >= static_cast<int>(sizeof(e.message))) {
+        return false;
+    }
+
+    gettimeofday(&e.time, NULL);
+    e.severity = s;
+    e.size = size;
+    ring->head = head + 1;
+
+    if (s <= LOG_ERROR) {
+        FlusherCond.notify_all();
+    }
+
+    return true;
+}
+
+void Logger::output(LogSeverity s, const char * fmt, va_list ap) {
+    call_once(Once, InitProcessId);
+    struct timeval tval;
+    memset(&tval, 0, sizeof(tval));
+    gettimeofday(&tval, NULL);
+    char * buffer = LineBuffer;
+    std::vector<char> large;
+    int prefix = FormatPrefix(buffer, LOG_LINE_BUFFER_SIZE, tval, ProcessId, s);
+    va_list copy;
+    va_copy(copy, ap);
+    int size = vsnprintf(buffer + prefix, LOG_LINE_BUFFER_SIZE - prefix, fmt, copy);
+    va_end(copy);
+
+    if (size < 0) {
+        return;
+    }
+
+    if (prefix + size + 1 >= LOG_LINE_BUFFER_SIZE) {
+        //message does not fit in the line buffer
+        large.resize(prefix + size + 2);
+        memcpy(&large[0], buffer, prefix);
+        vsnprintf(&large[prefix], large.size() - prefix, fmt, ap);
+        buffer = &large[0];
+    }
+
+    buffer[prefix + size] = '\n';
+    std::string lost;
+    lock_guard<mutex> lock(LoggerMutex);
+    ReportLost(lost);
+
+    if (!lost.empty()) {
+        WriteAll(fd, lost.data(), lost.size());
+    }
+
+    WriteAll(fd, buffer, prefix + size + 1);
+}
+
 void Logger::printf(LogSeverity s, const char * fmt, ...) {
     va_list ap;
 
@@ -78,27 +481,30 @@ void Logger::printf(LogSeverity s, const char * fmt, ...) {
     }
 
     try {
-        call_once(Once, InitProcessId);
-        std::vector<char> buffer;
-        struct tm tm_time;
-        struct timeval tval;
-        memset(&tval, 0, sizeof(tval));
-        gettimeofday(&tval, NULL);
-        localtime_r(&tval.tv_sec, &tm_time);
-        //determine buffer size
-        va_start(ap, fmt);
-        int size = vsnprintf(&buffer[0], buffer.size(), fmt, ap);
-        va_end(ap);
-        //100 is enough for prefix
-        buffer.resize(size + 100);
-        size = snprintf(&buffer[0], buffer.size(), "%04d-%02d-%02d %02d:%02d:%02d.%06ld, %s, %s ", tm_time.tm_year + 1900,
-                        1 + tm_time.tm_mon, tm_time.tm_mday, tm_time.tm_hour,
-                        tm_time.tm_min, tm_time.tm_sec, static_cast<long>(tval.tv_usec), ProcessId, SeverityName[s]);
+        if (throttle(s)) {
+            return;
+        }
+
+        if (async) {
+            if (s != FATAL) {
+                va_start(ap, fmt);
+                bool queued = append(s, fmt, ap);
+                va_end(ap);
+
+                if (queued) {
+                    return;
+                }
+            }
+
+            /*
+             * written on this thread, keep it after what is already queued.
+             */
+            DrainRings(fd);
+        }
+
         va_start(ap, fmt);
-        size += vsnprintf(&buffer[size], buffer.size() - size, fmt, ap);
+        output(s, fmt, ap);
         va_end(ap);
-        lock_guard<mutex> lock(LoggerMutex);
-        dprintf(fd, "%s\n", &buffer[0]);
         return;
     } catch (const std::exception & e) {
         dprintf(fd, "%s:%d %s %s", __FILE__, __LINE__,
@@ -109,4 +515,3 @@ void Logger::printf(LogSeverity s, const char * fmt, ...) {
 
 }
 }
-
@@ -22,6 +22,11 @@
 #ifndef _HDFS_LIBHDFS3_COMMON_LOGGER_H_
 #define _HDFS_LIBHDFS3_COMMON_LOGGER_H_
 
+#include <cstdarg>
+#include <stdint.h>
+
+#include "Atomic.h"
+
 #define DEFAULT_LOG_LEVEL INFO
 
 namespace Hdfs {
@@ -45,11 +50,57 @@ public:
 
     void setLogSeverity(LogSeverity l);
 
+    /**
+     * Hand messages to a background flusher thread through per-thread
+     * lock-free ring buffers instead of writing them on the calling thread.
+     * Messages are dropped and counted when a ring is full.
+     * @param a true to enable asynchronous logging.
+     */
+    void setAsync(bool a);
+
+    /**
+     * Limit the number of INFO and DEBUG messages each thread may emit per second.
+     * Messages over the limit are dropped and counted.
+     * @param perSecond message budget per thread, 0 means unlimited.
+     */
+    void setRateLimit(int32_t perSecond);
+
+    /**
+     * Apply the process wide asynchronous logging and rate limit settings.
+     * Only the first call has an effect, so a filesystem connected later
+     * cannot switch the mode under the ones already logging.
+     * @param a true to enable asynchronous logging.
+     * @param perSecond message budget per thread, 0 means unlimited.
+     */
+    void configure(bool a, int32_t perSecond);
+
+    /**
+     * Write out everything queued by asynchronous logging.
+     */
+    void flush();
+
+    /**
+     * @return the number of messages dropped because a ring buffer was full.
+     */
+    int64_t getDropped() const;
+
+    /**
+     * @return the number of messages dropped by the rate limit.
+     */
+    int64_t getThrottled() const;
+
     void printf(LogSeverity s, const char * fmt, ...) __attribute__((format(printf, 3, 4)));
 
+private:
+    bool throttle(LogSeverity s);
+    bool append(LogSeverity s, const char * fmt, va_list ap);
+    void output(LogSeverity s, const char * fmt, va_list ap);
+
 private:
     int fd;
-    LogSeverity severity;
+    atomic<LogSeverity> severity;
+    atomic<bool> async;
+    atomic<int32_t> rateLimit;
 };
 
 extern Logger RootLogger;
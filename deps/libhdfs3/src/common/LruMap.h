@@ -94,6 +94,25 @@ public:
         }
     }
 
+    /**
+     * Erase all items whose key matches pred.
+     */
+    template <typename Pred>
+    void eraseIf(const Pred& pred) {
+        lock_guard<mutex> lock(mut);
+        typename ListType::iterator it = list.begin();
+
+        while (it != list.end()) {
+            if (pred(it->first)) {
+                map.erase(it->first);
+                it = list.erase(it);
+                --count;
+            } else {
+                ++it;
+            }
+        }
+    }
+
     bool find(const KeyType& key, ValueType* value) {
         lock_guard<mutex> lock(mut);
         return findAndEraseInternal(key, value, false);
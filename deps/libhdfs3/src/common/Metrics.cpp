@@ -0,0 +1,233 @@
+/********************************************************************
+ * 2014 -
+ * open source under Apache License Version 2.0
+ ********************************************************************/
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "Metrics.h"
+#include "Thread.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <pthread.h>
+#include <time.h>
+#include <vector>
+
+namespace Hdfs {
+namespace Internal {
+
+static const char * CounterNames[] = {
+    "bytesReadShortCircuit", "bytesReadLocal", "bytesReadRemote",
+    "bytesWritten", "peerCacheHits", "peerCacheMisses", "rpcCalls",
+    "rpcRetries", "namenodeFailovers", "checksumFailures", "readRetries",
+    "pipelineRecoveries", "dekCacheHits", "dekCacheMisses",
+    "fileStatusCacheHits", "fileStatusCacheMisses", "observerReads",
+    "observerFallbacks", "blockReadersPrefetched", "uringSockets"
+};
+
+static const char * HistogramNames[] = {
+    "rpcLatency", "datanodeConnectLatency", "blockReadLatency",
+    "pipelineAckLatency"
+};
+
+THREAD_LOCAL MetricsBlock * Metrics::Local = NULL;
+
+/*
+ * Never destroyed, threads may exit after static destructors have run.
+ */
+struct MetricsRegistry {
+    MetricsRegistry() {
+        memset(&retired, 0, sizeof(retired));
+        pthread_key_create(&key, &MetricsRegistry::Retire);
+    }
+
+    static MetricsRegistry & Instance() {
+        static MetricsRegistry * registry = new MetricsRegistry;
+        return *registry;
+    }
+
+    static void Retire(void * p) {
+        MetricsBlock * block = static_cast<MetricsBlock *>(p);
+        MetricsRegistry & registry = Instance();
+        Metrics::Local = NULL;
+        {
+            lock_guard<mutex> lock(registry.mut);
+            Merge(*block, &registry.retired);
+            registry.blocks.erase(std::find(registry.blocks.begin(),
+                                            registry.blocks.end(), block));
+        }
+        delete block;
+    }
+
+    static void Merge(const MetricsBlock & from, MetricsBlock * to) {
+        for (int i = 0; i < METRIC_COUNTER_COUNT; ++i) {
+            to->counters[i] += __atomic_load_n(&from.counters[i], __ATOMIC_RELAXED);
+        }
+
+        for (int i = 0; i < METRIC_HISTOGRAM_COUNT; ++i) {
+            const MetricsBlock::Histogram & h = from.histograms[i];
+            MetricsBlock::Histogram & t = to->histograms[i];
+            t.count += __atomic_load_n(&h.count, __ATOMIC_RELAXED);
+            t.sum += __atomic_load_n(&h.sum, __ATOMIC_RELAXED);
+            t.max = std::max(t.max, __atomic_load_n(&h.max, __ATOMIC_RELAXED));
+
+            for (int j = 0; j < METRICS_BUCKETS; ++j) {
+                t.buckets[j] += __atomic_load_n(&h.buckets[j], __ATOMIC_RELAXED);
+            }
+        }
+    }
+
+    mutex mut;
+    pthread_key_t key;
+    MetricsBlock retired;
+    std::vector<MetricsBlock *> blocks;
+};
+
+static int BucketIndex(int64_t value) {
+    if (value < METRICS_SUB_BUCKETS) {
+        return value < 0 ? 0 : static_cast<int>(value);
+    }
+
+    value = std::min<int64_t>(value, (2LL << METRICS_MAX_EXPONENT) - 1);
+    int exponent = 63 - __builtin_clzll(value);
+    int shift = exponent - METRICS_SUB_BUCKET_BITS;
+    return METRICS_SUB_BUCKETS * (shift + 1)
+           + static_cast<int>((value >> shift) & (METRICS_SUB_BUCKETS - 1));
+}
+
+/*
+ * The highest value which falls in the bucket.
+ */
+static int64_t BucketLimit(int index) {
+    if (index < METRICS_SUB_BUCKETS) {
+        return index;
+    }
+
+    int shift = index / METRICS_SUB_BUCKETS - 1;
+    int64_t sub = index % METRICS_SUB_BUCKETS + METRICS_SUB_BUCKETS;
+    return ((sub + 1) << shift) - 1;
+}
+
+static int64_t Percentile(const MetricsBlock::Histogram & h, double p) {
+    int64_t rank = static_cast<int64_t>(h.count * p + 0.5);
+    rank = std::max<int64_t>(rank, 1);
+    int64_t seen = 0;
+
+    for (int i = 0; i < METRICS_BUCKETS; ++i) {
+        seen += h.buckets[i];
+
+        if (seen >= rank) {
+            return std::min(BucketLimit(i), h.max);
+        }
+    }
+
+    return h.max;
+}
+
+MetricsBlock * Metrics::Register() {
+    MetricsRegistry & registry = MetricsRegistry::Instance();
+    MetricsBlock * block = new MetricsBlock;
+    memset(block, 0, sizeof(MetricsBlock));
+    {
+        lock_guard<mutex> lock(registry.mut);
+        registry.blocks.push_back(block);
+    }
+    pthread_setspecific(registry.key, block);
+    Local = block;
+    return block;
+}
+
+void Metrics::Record(MetricHistogram histogram, int64_t micros) {
+    MetricsBlock * block = Local ? Local : Register();
+    MetricsBlock::Histogram & h = block->histograms[histogram];
+    int index = BucketIndex(micros);
+    Set(&h.buckets[index], h.buckets[index] + 1);
+    Set(&h.sum, h.sum + micros);
+
+    if (micros > h.max) {
+        Set(&h.max, micros);
+    }
+
+    /*
+     * count is written last so a snapshot rarely sees it ahead of the buckets.
+     */
+    Set(&h.count, h.count + 1);
+}
+
+int64_t Metrics::Now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+void Metrics::Snapshot(MetricsSnapshot * snapshot) {
+    assert(NULL != snapshot);
+    MetricsRegistry & registry = MetricsRegistry::Instance();
+    std::vector<MetricsBlock> merged(1);
+    MetricsBlock & total = merged[0];
+    {
+        lock_guard<mutex> lock(registry.mut);
+        total = registry.retired;
+
+        for (size_t i = 0; i < registry.blocks.size(); ++i) {
+            MetricsRegistry::Merge(*registry.blocks[i], &total);
+        }
+    }
+
+    memcpy(snapshot->counters, total.counters, sizeof(snapshot->counters));
+
+    for (int i = 0; i < METRIC_HISTOGRAM_COUNT; ++i) {
+        MetricsBlock::Histogram & h = total.histograms[i];
+        HistogramSnapshot & s = snapshot->histograms[i];
+        /*
+         * the buckets are the source of truth, count may lag behind them.
+         */
+        h.count = 0;
+        s.min = 0;
+
+        for (int j = 0; j < METRICS_BUCKETS; ++j) {
+            if (h.buckets[j] && !h.count) {
+                s.min = j < METRICS_SUB_BUCKETS ? j : BucketLimit(j - 1) + 1;
+            }
+
+            h.count += h.buckets[j];
+        }
+
+        s.count = h.count;
+        s.sum = h.sum;
+        s.max = h.max;
+        s.p50 = h.count ? Percentile(h, 0.5) : 0;
+        s.p90 = h.count ? Percentile(h, 0.9) : 0;
+        s.p99 = h.count ? Percentile(h, 0.99) : 0;
+        s.p999 = h.count ? Percentile(h, 0.999) : 0;
+    }
+}
+
+const char * Metrics::CounterName(MetricCounter counter) {
+    assert(counter >= 0 && counter < METRIC_COUNTER_COUNT);
+    return CounterNames[counter];
+}
+
+const char * Metrics::HistogramName(MetricHistogram histogram) {
+    assert(histogram >= 0 && histogram < METRIC_HISTOGRAM_COUNT);
+    return HistogramNames[histogram];
+}
+
+}
+}
@@ -0,0 +1,176 @@
+/********************************************************************
+ * 2014 -
+ * open source under Apache License Version 2.0
+ ********************************************************************/
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _HDFS_LIBHDFS3_COMMON_METRICS_H_
+#define _HDFS_LIBHDFS3_COMMON_METRICS_H_
+
+#include "platform.h"
+
+#include <cstddef>
+#include <stdint.h>
+
+/*
+ * Histogram buckets: values below 8 have a bucket each, above that every
+ * power of two is split in 8 sub buckets, so a bucket is at most 12.5% wide.
+ * Values are clamped below 2^41 microseconds.
+ */
+#define METRICS_SUB_BUCKET_BITS 3
+#define METRICS_SUB_BUCKETS (1 << METRICS_SUB_BUCKET_BITS)
+#define METRICS_MAX_EXPONENT 40
+#define METRICS_BUCKETS \
+    (METRICS_SUB_BUCKETS * (METRICS_MAX_EXPONENT - METRICS_SUB_BUCKET_BITS + 2))
+
+namespace Hdfs {
+namespace Internal {
+
+struct MetricsRegistry;
+
+enum MetricCounter {
+    METRIC_BYTES_READ_SHORT_CIRCUIT = 0,
+    METRIC_BYTES_READ_LOCAL, //from a datanode on this host over TCP.
+    METRIC_BYTES_READ_REMOTE,
+    METRIC_BYTES_WRITTEN,
+    METRIC_PEER_CACHE_HITS,
+    METRIC_PEER_CACHE_MISSES,
+    METRIC_RPC_CALLS,
+    METRIC_RPC_RETRIES,
+    METRIC_NAMENODE_FAILOVERS,
+    METRIC_CHECKSUM_FAILURES,
+    METRIC_READ_RETRIES,
+    METRIC_PIPELINE_RECOVERIES,
+    METRIC_DEK_CACHE_HITS,
+    METRIC_DEK_CACHE_MISSES,
+    METRIC_FILE_STATUS_CACHE_HITS,
+    METRIC_FILE_STATUS_CACHE_MISSES,
+    METRIC_OBSERVER_READS,
+    METRIC_OBSERVER_FALLBACKS,
+    METRIC_BLOCK_READERS_PREFETCHED,
+    METRIC_URING_SOCKETS, //datanode connections doing their io with io_uring.
+    METRIC_COUNTER_COUNT
+};
+
+enum MetricHistogram {
+    METRIC_RPC_LATENCY = 0,
+    METRIC_DATANODE_CONNECT_LATENCY,
+    METRIC_BLOCK_READ_LATENCY,
+    METRIC_PIPELINE_ACK_LATENCY,
+    METRIC_HISTOGRAM_COUNT
+};
+
+struct HistogramSnapshot {
+    int64_t count;
+    int64_t sum;
+    int64_t min;
+    int64_t max;
+    int64_t p50;
+    int64_t p90;
+    int64_t p99;
+    int64_t p999;
+};
+
+struct MetricsSnapshot {
+    int64_t counters[METRIC_COUNTER_COUNT];
+    HistogramSnapshot histograms[METRIC_HISTOGRAM_COUNT];
+};
+
+/**
+ * The metrics of one thread, only written by the owning thread.
+ */
+struct MetricsBlock {
+    struct Histogram {
+        int64_t count;
+        int64_t sum;
+        int64_t max;
+        int64_t buckets[METRICS_BUCKETS];
+    };
+
+    int64_t counters[METRIC_COUNTER_COUNT];
+    Histogram histograms[METRIC_HISTOGRAM_COUNT];
+};
+
+/**
+ * Process wide client metrics.
+ *
+ * Every thread updates its own block with relaxed atomic stores, so the
+ * instrumentation takes no lock and shares no cache line. A snapshot
+ * merges the blocks of all live threads with the totals of the exited ones.
+ * Latencies are recorded in microseconds.
+ */
+class Metrics {
+public:
+    static void Add(MetricCounter counter, int64_t value = 1) {
+        MetricsBlock * block = Local ? Local : Register();
+        Set(&block->counters[counter], block->counters[counter] + value);
+    }
+
+    static void Record(MetricHistogram histogram, int64_t micros);
+
+    /**
+     * Get the monotonic time in microseconds.
+     */
+    static int64_t Now();
+
+    /**
+     * Merge the metrics of all threads.
+     */
+    static void Snapshot(MetricsSnapshot * snapshot);
+
+    static const char * CounterName(MetricCounter counter);
+
+    static const char * HistogramName(MetricHistogram histogram);
+
+private:
+    static void Set(int64_t * target, int64_t value) {
+        __atomic_store_n(target, value, __ATOMIC_RELAXED);
+    }
+
+    static MetricsBlock * Register();
+
+    friend struct MetricsRegistry;
+
+    static THREAD_LOCAL MetricsBlock * Local;
+};
+
+/**
+ * Record the time spent in the enclosing scope.
+ */
+class MetricsTimer {
+public:
+    explicit MetricsTimer(MetricHistogram histogram) :
+        histogram(histogram), start(Metrics::Now()) {
+    }
+
+    ~MetricsTimer() {
+        Metrics::Record(histogram, Metrics::Now() - start);
+    }
+
+private:
+    MetricsTimer(const MetricsTimer & other);
+    MetricsTimer & operator =(const MetricsTimer & other);
+
+    MetricHistogram histogram;
+    int64_t start;
+};
+
+}
+}
+
+#endif /* _HDFS_LIBHDFS3_COMMON_METRICS_H_ */
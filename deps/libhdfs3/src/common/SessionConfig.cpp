@@ -49,6 +49,19 @@ static void CheckMultipleOf(const char * key, const T & value, int unit) {
     }
 }
 
+/*
+ * an unset boolean hint, -1 if the key is not configured.
+ */
+static int32_t GetOptionalBool(const Config & conf, const char * key) {
+    const char * value = conf.getString(key, "");
+
+    if (value == NULL || *value == 0) {
+        return -1;
+    }
+
+    return conf.getBool(key, false) ? 1 : 0;
+}
+
 SessionConfig::SessionConfig(const Config & conf) {
     ConfigDefault<bool> boolValues [] = {
         {
@@ -63,6 +76,10 @@ SessionConfig::SessionConfig(const Config & conf) {
             &useMappedFile, "input.localread.mappedfile", false
         }, {
             &legacyLocalBlockReader, "dfs.client.use.legacy.blockreader.local", false
+        }, {
+            &logAsync, "dfs.client.log.async", false
+        }, {
+            &useIoUring, "dfs.client.socket.io_uring", false
         }
     };
     ConfigDefault<int32_t> i32Values[] = {
@@ -82,6 +99,12 @@ SessionConfig::SessionConfig(const Config & conf) {
             &rpcMaxRetryOnConnect, "rpc.client.connect.retry", 10, bind(CheckRangeGE<int32_t>, _1, _2, 1)
         }, {
             &rpcTimeout, "rpc.client.timeout", 3600 * 1000
+        }, {
+            &rpcMaxInflight, "rpc.client.max.inflight", 256, bind(CheckRangeGE<int32_t>, _1, _2, 1)
+        }, {
+            &rpcConnections, "rpc.client.connections.per.server", 1, bind(CheckRangeGE<int32_t>, _1, _2, 1)
+        }, {
+            &rpcBulkConnections, "rpc.client.bulk.connections.per.server", 0, bind(CheckRangeGE<int32_t>, _1, _2, 0)
         }, {
             &defaultReplica, "dfs.default.replica", 3, bind(CheckRangeGE<int32_t>, _1, _2, 1)
         }, {
@@ -100,6 +123,8 @@ SessionConfig::SessionConfig(const Config & conf) {
             &maxLocalBlockInfoCacheSize, "input.localread.blockinfo.cachesize", 1000, bind(CheckRangeGE<int32_t>, _1, _2, 1)
         }, {
             &maxReadBlockRetry, "input.read.max.retry", 60, bind(CheckRangeGE<int32_t>, _1, _2, 1)
+        }, {
+            &nextBlockPrefetch, "input.read.prefetch.next.block", 8 * 1024 * 1024, bind(CheckRangeGE<int32_t>, _1, _2, 0)
         }, {
             &chunkSize, "output.default.chunksize", 512, bind(CheckMultipleOf<int32_t>, _1, _2, 512)
         }, {
@@ -120,6 +145,8 @@ SessionConfig::SessionConfig(const Config & conf) {
             &heartBeatInterval, "output.heeartbeat.interval", 10 * 1000
         }, {
             &rpcMaxHARetry, "dfs.client.failover.max.attempts", 15, bind(CheckRangeGE<int32_t>, _1, _2, 0)
+        }, {
+            &failoverProbeTimeout, "dfs.client.failover.probe.timeout", 5000, bind(CheckRangeGE<int32_t>, _1, _2, 0)
         }, {
             &maxFileDescriptorCacheSize, "dfs.client.read.shortcircuit.streams.cache.size", 256, bind(CheckRangeGE<int32_t>, _1, _2, 0)
         }, {
@@ -128,8 +155,30 @@ SessionConfig::SessionConfig(const Config & conf) {
             &socketCacheCapacity, "dfs.client.socketcache.capacity", 16, bind(CheckRangeGE<int32_t>, _1, _2, 0)
         }, {
             &cryptoBufferSize, "hadoop.security.crypto.buffer.size", 8192
+        }, {
+            &cryptoThreads, "dfs.client.crypto.parallel.threads", 4, bind(CheckRangeGE<int32_t>, _1, _2, 1)
+        }, {
+            &cryptoParallelMinSize, "dfs.client.crypto.parallel.min.size", 256 * 1024, bind(CheckRangeGE<int32_t>, _1, _2, 0)
         }, {
             &httpRequestRetryTimes, "kms.send.request.retry.times", 0
+        }, {
+            &dekCacheSize, "dfs.client.kms.dek.cache.size", 1024, bind(CheckRangeGE<int32_t>, _1, _2, 0)
+        }, {
+            &dekCacheExpiry, "dfs.client.kms.dek.cache.expiryMsec", 10 * 60 * 1000, bind(CheckRangeGE<int32_t>, _1, _2, 0)
+        }, {
+            &fileStatusCacheSize, "dfs.client.file.status.cache.size", 0, bind(CheckRangeGE<int32_t>, _1, _2, 0)
+        }, {
+            &fileStatusCacheExpiry, "dfs.client.file.status.cache.expiryMsec", 1000, bind(CheckRangeGE<int32_t>, _1, _2, 0)
+        }, {
+            &fileStatusCacheNegativeExpiry, "dfs.client.file.status.cache.negative.expiryMsec", 1000, bind(CheckRangeGE<int32_t>, _1, _2, 0)
+        }, {
+            &observerReadTimeout, "dfs.client.observer.read.timeout", 2000, bind(CheckRangeGE<int32_t>, _1, _2, 0)
+        }, {
+            &observerBackoff, "dfs.client.observer.backoff", 10 * 1000, bind(CheckRangeGE<int32_t>, _1, _2, 0)
+        }, {
+            &observerMsyncPeriod, "dfs.client.observer.auto.msync.period", -1, bind(CheckRangeGE<int32_t>, _1, _2, -1)
+        }, {
+            &logRateLimit, "dfs.client.log.ratelimit", 0, bind(CheckRangeGE<int32_t>, _1, _2, 0)
         }
     };
     ConfigDefault<int64_t> i64Values [] = {
@@ -138,6 +187,9 @@ SessionConfig::SessionConfig(const Config & conf) {
         },
         {
             &curlTimeout, "kms.send.request.timeout", 20L
+        },
+        {
+            &cacheReadahead, "dfs.client.cache.readahead", -1, bind(CheckRangeGE<int64_t>, _1, _2, -1)
         }
     };
 
@@ -145,6 +197,7 @@ SessionConfig::SessionConfig(const Config & conf) {
         {&defaultUri, "dfs.default.uri", "hdfs://localhost:8020" },
         {&rpcAuthMethod, "hadoop.security.authentication", "simple" },
         {&kerberosCachePath, "hadoop.security.kerberos.ticket.cache.path", "" },
+        {&failoverHintDir, "dfs.client.failover.hint.dir", "/tmp" },
         {&logSeverity, "dfs.client.log.severity", "INFO" },
         {&domainSocketPath, "dfs.domain.socket.path", ""},
         {&kmsUrl, "dfs.encryption.key.provider.uri", "" },
@@ -186,6 +239,9 @@ SessionConfig::SessionConfig(const Config & conf) {
             strValues[i].check(strValues[i].key, *strValues[i].variable);
         }
     }
+
+    dropBehindReads = GetOptionalBool(conf, "dfs.client.cache.drop.behind.reads");
+    dropBehindWrites = GetOptionalBool(conf, "dfs.client.cache.drop.behind.writes");
 }
 
 }
@@ -125,6 +125,29 @@ public:
         return readFromLocal;
     }
 
+    /*
+     * the bytes left in the current block when a sequential stream
+     * starts setting up the reader of the next block, 0 disables it.
+     */
+    int32_t getNextBlockPrefetch() const {
+        return nextBlockPrefetch;
+    }
+
+    /*
+     * the page cache hints for the datanodes, -1 if not configured.
+     */
+    int32_t getDropBehindReads() const {
+        return dropBehindReads;
+    }
+
+    int32_t getDropBehindWrites() const {
+        return dropBehindWrites;
+    }
+
+    int64_t getCacheReadahead() const {
+        return cacheReadahead;
+    }
+
     int32_t getMaxGetBlockInfoRetry() const {
         return maxGetBlockInfoRetry;
     }
@@ -174,6 +197,18 @@ public:
         return heartBeatInterval;
     }
 
+    int32_t getRpcMaxInflight() const {
+        return rpcMaxInflight;
+    }
+
+    int32_t getRpcConnections() const {
+        return rpcConnections;
+    }
+
+    int32_t getRpcBulkConnections() const {
+        return rpcBulkConnections;
+    }
+
     int32_t getRpcMaxHaRetry() const {
         return rpcMaxHARetry;
     }
@@ -182,6 +217,14 @@ public:
         rpcMaxHARetry = rpcMaxHaRetry;
     }
 
+    int32_t getFailoverProbeTimeout() const {
+        return failoverProbeTimeout;
+    }
+
+    const std::string & getFailoverHintDir() const {
+        return failoverHintDir;
+    }
+
     const std::string & getRpcAuthMethod() const {
         return rpcAuthMethod;
     }
@@ -221,6 +264,14 @@ public:
         this->logSeverity = logSeverityLevel;
     }
 
+    bool isLogAsync() const {
+        return logAsync;
+    }
+
+    int32_t getLogRateLimit() const {
+        return logRateLimit;
+    }
+
     int32_t getPacketPoolSize() const {
         return packetPoolSize;
     }
@@ -277,6 +328,14 @@ public:
         this->legacyLocalBlockReader = legacyLocalBlockReader;
     }
 
+    bool isUseIoUring() const {
+        return useIoUring;
+    }
+
+    void setUseIoUring(bool useIoUring) {
+        this->useIoUring = useIoUring;
+    }
+
     const std::string& getDomainSocketPath() const {
         return domainSocketPath;
     }
@@ -313,6 +372,14 @@ public:
         return cryptoBufferSize;
     }
 
+    int32_t getCryptoThreads() const {
+        return cryptoThreads;
+    }
+
+    int32_t getCryptoParallelMinSize() const {
+        return cryptoParallelMinSize;
+    }
+
     int32_t getHttpRequestRetryTimes() const {
         return httpRequestRetryTimes;
     }
@@ -321,6 +388,38 @@ public:
         return curlTimeout;
     }
 
+    int32_t getDekCacheSize() const {
+        return dekCacheSize;
+    }
+
+    int32_t getDekCacheExpiry() const {
+        return dekCacheExpiry;
+    }
+
+    int32_t getFileStatusCacheSize() const {
+        return fileStatusCacheSize;
+    }
+
+    int32_t getFileStatusCacheExpiry() const {
+        return fileStatusCacheExpiry;
+    }
+
+    int32_t getFileStatusCacheNegativeExpiry() const {
+        return fileStatusCacheNegativeExpiry;
+    }
+
+    int32_t getObserverReadTimeout() const {
+        return observerReadTimeout;
+    }
+
+    int32_t getObserverBackoff() const {
+        return observerBackoff;
+    }
+
+    int32_t getObserverMsyncPeriod() const {
+        return observerMsyncPeriod;
+    }
+
 public:
     /*
      * rpc configure
@@ -332,6 +431,11 @@ public:
     int32_t rpcWriteTimeout;
     int32_t rpcMaxRetryOnConnect;
     int32_t rpcMaxHARetry;
+    int32_t failoverProbeTimeout; //milliseconds, 0 to fail over to the next namenode without probing.
+    std::string failoverHintDir; //empty to not remember the active namenode.
+    int32_t rpcMaxInflight;
+    int32_t rpcConnections;
+    int32_t rpcBulkConnections;
     int32_t rpcSocketLingerTimeout;
     int32_t rpcTimeout;
     bool rpcTcpNoDelay;
@@ -343,6 +447,8 @@ public:
     std::string defaultUri;
     std::string kerberosCachePath;
     std::string logSeverity;
+    bool logAsync;
+    int32_t logRateLimit;
     int32_t defaultReplica;
     int64_t defaultBlockSize;
 
@@ -353,6 +459,8 @@ public:
     bool readFromLocal;
     bool notRetryAnotherNode;
     bool legacyLocalBlockReader;
+    bool useIoUring;
+    int32_t dropBehindReads;
     int32_t inputConnTimeout;
     int32_t inputReadTimeout;
     int32_t inputWriteTimeout;
@@ -361,9 +469,11 @@ public:
     int32_t maxGetBlockInfoRetry;
     int32_t maxLocalBlockInfoCacheSize;
     int32_t maxReadBlockRetry;
+    int32_t nextBlockPrefetch;
     int32_t prefetchSize;
     int32_t socketCacheCapacity;
     int32_t socketCacheExpiry;
+    int64_t cacheReadahead;
     std::string domainSocketPath;
 
     /*
@@ -371,6 +481,7 @@ public:
      */
     bool addDatanode;
     int32_t chunkSize;
+    int32_t dropBehindWrites;
     int32_t packetSize;
     int32_t blockWriteRetry; //retry on block not replicated yet.
     int32_t outputConnTimeout;
@@ -382,8 +493,18 @@ public:
     std::string kmsUrl;
     std::string kmsAuthMethod;
     int32_t cryptoBufferSize;
+    int32_t cryptoThreads;
+    int32_t cryptoParallelMinSize;
     int32_t httpRequestRetryTimes;
     int64_t curlTimeout;
+    int32_t dekCacheSize;
+    int32_t dekCacheExpiry; //milliseconds.
+    int32_t fileStatusCacheSize;
+    int32_t fileStatusCacheExpiry; //milliseconds.
+    int32_t fileStatusCacheNegativeExpiry; //milliseconds.
+    int32_t observerReadTimeout; //milliseconds.
+    int32_t observerBackoff; //milliseconds.
+    int32_t observerMsyncPeriod; //milliseconds, -1 means only before the first observer read.
 
 };
 
@@ -0,0 +1,140 @@
+/********************************************************************
+ * 2014 -
+ * open source under Apache License Version 2.0
+ ********************************************************************/
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "Atomic.h"
+#include "Thread.h"
+#include "Trace.h"
+
+#include <cassert>
+#include <cstring>
+#include <time.h>
+#include <vector>
+
+#define TRACE_RING_SIZE 256
+
+namespace Hdfs {
+namespace Internal {
+
+static const char * PhaseNames[] = {
+    "rpc", "rpcConnect", "sasl", "getBlockLocations", "getFileInfo",
+    "datanodeConnect", "readBlockResponse", "firstPacket", "checksum",
+    "pipelineSetup", "pipelineAck"
+};
+
+THREAD_LOCAL TraceRecord * Tracer::Current = NULL;
+
+static atomic<int32_t> SampleRate(0);
+static atomic<int64_t> Finished(0);
+static mutex RingMutex;
+static std::vector<TraceRecord> Ring;
+static size_t RingHead = 0;
+
+void Tracer::Begin(TraceRecord * record, const char * operation) {
+    assert(NULL != record);
+    strncpy(record->operation, operation, sizeof(record->operation) - 1);
+    record->operation[sizeof(record->operation) - 1] = 0;
+    record->start = Now();
+    record->duration = 0;
+    record->numSpans = 0;
+    Current = record;
+}
+
+void Tracer::End() {
+    TraceRecord * record = Current;
+
+    if (!record) {
+        return;
+    }
+
+    Current = NULL;
+    record->duration = Now() - record->start;
+    int32_t rate = SampleRate;
+
+    if (rate <= 0 || Finished++ % rate != 0) {
+        return;
+    }
+
+    lock_guard<mutex> lock(RingMutex);
+
+    if (Ring.size() < TRACE_RING_SIZE) {
+        Ring.push_back(*record);
+    } else {
+        Ring[RingHead] = *record;
+        RingHead = (RingHead + 1) % TRACE_RING_SIZE;
+    }
+}
+
+void Tracer::Record(TracePhase phase, int64_t start, int64_t end) {
+    TraceRecord * record = Current;
+
+    if (!record) {
+        return;
+    }
+
+    for (int32_t i = 0; i < record->numSpans; ++i) {
+        TraceSpan & span = record->spans[i];
+
+        if (span.phase == phase) {
+            ++span.count;
+            span.duration += end - start;
+            return;
+        }
+    }
+
+    if (record->numSpans < TRACE_MAX_SPANS) {
+        TraceSpan & span = record->spans[record->numSpans++];
+        span.phase = phase;
+        span.count = 1;
+        span.start = start - record->start;
+        span.duration = end - start;
+    }
+}
+
+int64_t Tracer::Now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+const char * Tracer::PhaseName(TracePhase phase) {
+    assert(phase >= 0 && phase < TRACE_PHASE_COUNT);
+    return PhaseNames[phase];
+}
+
+void Tracer::SetSampleRate(int32_t n) {
+    SampleRate = n < 0 ? 0 : n;
+}
+
+int32_t Tracer::TakeSamples(TraceRecord * records, int32_t max) {
+    lock_guard<mutex> lock(RingMutex);
+    int32_t count = 0;
+
+    for (size_t i = 0; i < Ring.size() && count < max; ++i) {
+        records[count++] = Ring[(RingHead + i) % Ring.size()];
+    }
+
+    Ring.clear();
+    RingHead = 0;
+    return count;
+}
+
+}
+}
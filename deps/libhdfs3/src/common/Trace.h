@@ -0,0 +1,155 @@
+/********************************************************************
+ * 2014 -
+ * open source under Apache License Version 2.0
+ ********************************************************************/
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _HDFS_LIBHDFS3_COMMON_TRACE_H_
+#define _HDFS_LIBHDFS3_COMMON_TRACE_H_
+
+#include "platform.h"
+
+#include <cstddef>
+#include <stdint.h>
+
+#define TRACE_MAX_SPANS 16
+#define TRACE_MAX_OPERATION 32
+
+namespace Hdfs {
+namespace Internal {
+
+/**
+ * The phases of a client operation which are timed.
+ */
+enum TracePhase {
+    TRACE_RPC_CALL = 0,
+    TRACE_RPC_CONNECT,
+    TRACE_SASL,
+    TRACE_GET_BLOCK_LOCATIONS,
+    TRACE_GET_FILE_INFO,
+    TRACE_DATANODE_CONNECT,
+    TRACE_READ_BLOCK_RESPONSE,
+    TRACE_FIRST_PACKET,
+    TRACE_CHECKSUM,
+    TRACE_PIPELINE_SETUP,
+    TRACE_PIPELINE_ACK,
+    TRACE_PHASE_COUNT
+};
+
+/**
+ * The time spent in one phase of an operation.
+ * A phase entered several times is merged into one span.
+ */
+struct TraceSpan {
+    TracePhase phase;
+    int32_t count; //how many times the phase is entered.
+    int64_t start; //first entry in nanoseconds since the operation started.
+    int64_t duration; //total time in nanoseconds.
+};
+
+/**
+ * The timings of one operation.
+ */
+struct TraceRecord {
+    char operation[TRACE_MAX_OPERATION];
+    int64_t start; //monotonic time in nanoseconds.
+    int64_t duration;
+    int32_t numSpans;
+    TraceSpan spans[TRACE_MAX_SPANS];
+};
+
+/**
+ * Per thread operation tracing.
+ *
+ * A record is active on a thread between Begin and End, TraceScope adds
+ * the time spent in a phase to it. Nothing is recorded on a thread without
+ * an active record, so the instrumentation costs one thread local load.
+ * Finished records are sampled into a process wide ring.
+ */
+class Tracer {
+public:
+    /**
+     * Start recording the operation on this thread.
+     * @param record The record to fill, it must outlive End.
+     * @param operation The name of the operation, truncated if too long.
+     */
+    static void Begin(TraceRecord * record, const char * operation);
+
+    /**
+     * Stop recording on this thread and sample the record.
+     */
+    static void End();
+
+    static bool Active() {
+        return Current != NULL;
+    }
+
+    /**
+     * Add the time spent in a phase to the active record.
+     */
+    static void Record(TracePhase phase, int64_t start, int64_t end);
+
+    /**
+     * Get the monotonic time in nanoseconds.
+     */
+    static int64_t Now();
+
+    static const char * PhaseName(TracePhase phase);
+
+    /**
+     * Keep one of every n finished records in the ring, 0 to disable.
+     */
+    static void SetSampleRate(int32_t n);
+
+    /**
+     * Copy the sampled records, oldest first, and empty the ring.
+     * @return The number of records copied.
+     */
+    static int32_t TakeSamples(TraceRecord * records, int32_t max);
+
+private:
+    static THREAD_LOCAL TraceRecord * Current;
+};
+
+/**
+ * Time the enclosing scope as a phase of the active operation.
+ */
+class TraceScope {
+public:
+    explicit TraceScope(TracePhase phase) :
+        phase(phase), start(Tracer::Active() ? Tracer::Now() : 0) {
+    }
+
+    ~TraceScope() {
+        if (start) {
+            Tracer::Record(phase, start, Tracer::Now());
+        }
+    }
+
+private:
+    TraceScope(const TraceScope & other);
+    TraceScope & operator =(const TraceScope & other);
+
+    TracePhase phase;
+    int64_t start;
+};
+
+}
+}
+
+#endif /* _HDFS_LIBHDFS3_COMMON_TRACE_H_ */
@@ -67,6 +67,20 @@ void BufferedSocketReaderImpl::readFully(char * b, int32_t s, int timeout) {
     }
 }
 
+int32_t BufferedSocketReaderImpl::readAvailable(char * b, int32_t s) {
+    assert(s > 0 && NULL != b);
+    int32_t done = s < size - cursor ? s : size - cursor;
+
+    if (done > 0) {
+        memcpy(b, &buffer[cursor], done);
+        cursor += done;
+        return done;
+    }
+
+    size = cursor = 0;
+    return sock.readAvailable(b, s);
+}
+
 int32_t BufferedSocketReaderImpl::readBigEndianInt32(int timeout) {
     char buf[sizeof(int32_t)];
     readFully(buf, sizeof(buf), timeout);
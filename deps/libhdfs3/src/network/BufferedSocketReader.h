@@ -62,6 +62,15 @@ public:
      */
     virtual void readFully(char * b, int32_t s, int timeout) = 0;
 
+    /**
+     * Read the data which is buffered or already arrived without blocking.
+     * @param b The buffer used to receive data.
+     * @param s The maximum size of bytes to read.
+     * @return The size of data read, 0 if nothing can be read now.
+     * @throw HdfsNetworkException
+     */
+    virtual int32_t readAvailable(char * b, int32_t s) = 0;
+
     /**
      * Read a 32 bit big endian integer from socket.
      * If there is not enough data can be read, the caller will be blocked.
@@ -108,6 +117,8 @@ public:
 
     void readFully(char * b, int32_t s, int timeout);
 
+    int32_t readAvailable(char * b, int32_t s);
+
     int32_t readBigEndianInt32(int timeout);
 
     int32_t readVarint32(int timeout);
@@ -58,6 +58,16 @@ public:
      */
     virtual void readFully(char * buffer, int32_t size, int timeout) = 0;
 
+    /**
+     * Read the data which already arrived without blocking.
+     * @param buffer The buffer to store the data.
+     * @param size The maximum size of bytes to be read.
+     * @return The size of data read, 0 if nothing can be read now or the
+     * stream is closed, the next blocking read reports it.
+     * @throw HdfsNetworkException
+     */
+    virtual int32_t readAvailable(char * buffer, int32_t size) = 0;
+
     /**
      * Send data to socket.
      * The caller will be blocked until send operation finished,
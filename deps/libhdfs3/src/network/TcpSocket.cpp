@@ -76,6 +76,27 @@ int32_t TcpSocketImpl::read(char * buffer, int32_t size) {
     return rc;
 }
 
+int32_t TcpSocketImpl::readAvailable(char * buffer, int32_t size) {
+    assert(-1 != sock);
+    assert(NULL != buffer && size > 0);
+    int32_t rc;
+
+    do {
+        rc = HdfsSystem::recv(sock, buffer, size, MSG_DONTWAIT);
+    } while (-1 == rc && EINTR == errno && !CheckOperationCanceled());
+
+    if (-1 == rc) {
+        if (EAGAIN == errno || EWOULDBLOCK == errno) {
+            return 0;
+        }
+
+        THROW(HdfsNetworkException, "Read %d bytes failed from %s: %s",
+              size, remoteAddr.c_str(), GetSystemErrorInfo(errno));
+    }
+
+    return rc;
+}
+
 void TcpSocketImpl::readFully(char * buffer, int32_t size, int timeout) {
     assert(-1 != sock);
     assert(NULL != buffer && size > 0);
@@ -66,6 +66,16 @@ public:
      */
     void readFully(char * buffer, int32_t size, int timeout);
 
+    /**
+     * Read the data which already arrived without blocking.
+     * @param buffer The buffer to store the data.
+     * @param size The maximum size of bytes to be read.
+     * @return The size of data read, 0 if nothing can be read now or the
+     * stream is closed.
+     * @throw HdfsNetworkException
+     */
+    int32_t readAvailable(char * buffer, int32_t size);
+
     /**
      * Send data to socket.
      * The caller will be blocked until send operation finished,
@@ -0,0 +1,425 @@
+/********************************************************************
+ * 2014 -
+ * open source under Apache License Version 2.0
+ ********************************************************************/
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "platform.h"
+
+#include <cassert>
+#include <cstring>
+#include <errno.h>
+#include <stdint.h>
+#include <sys/socket.h>
+#include <vector>
+
+#include "DateTime.h"
+#include "Exception.h"
+#include "ExceptionInternal.h"
+#include "Logger.h"
+#include "Metrics.h"
+#include "Thread.h"
+#include "UringSocket.h"
+
+#ifdef HAVE_IO_URING
+
+#include <linux/io_uring.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#define URING_ENTRIES 8
+#define URING_IO_REQUEST 1
+#define URING_TIMEOUT_REQUEST 2
+
+namespace Hdfs {
+namespace Internal {
+
+/**
+ * A minimal io_uring used synchronously by one thread.
+ * Every request is waited for before run() returns, so the ring never has
+ * requests in flight between calls.
+ */
+class IoUring {
+public:
+    IoUring() :
+        fd(-1), sqMap(MAP_FAILED), cqMap(MAP_FAILED), sqes(NULL),
+        sqMapSize(0), cqMapSize(0), sqesSize(0) {
+        struct io_uring_params p;
+        memset(&p, 0, sizeof(p));
+        fd = syscall(__NR_io_uring_setup, URING_ENTRIES, &p);
+
+        if (fd < 0) {
+            return;
+        }
+
+        sqMapSize = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+        cqMapSize = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+
+        if (p.features & IORING_FEAT_SINGLE_MMAP) {
+            sqMapSize = cqMapSize = sqMapSize > cqMapSize ? sqMapSize : cqMapSize;
+        }
+
+        sqMap = mmap(NULL, sqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                     fd, IORING_OFF_SQ_RING);
+
+        if (sqMap == MAP_FAILED) {
+            release();
+            return;
+        }
+
+        if (p.features & IORING_FEAT_SINGLE_MMAP) {
+            cqMap = sqMap;
+        } else {
+            cqMap = mmap(NULL, cqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                         fd, IORING_OFF_CQ_RING);
+
+            if (cqMap == MAP_FAILED) {
+                release();
+                return;
+            }
+        }
+
+        sqesSize = p.sq_entries * sizeof(struct io_uring_sqe);
+        void * map = mmap(NULL, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                          fd, IORING_OFF_SQES);
+
+        if (map == MAP_FAILED) {
+            release();
+            return;
+        }
+
+        sqes = static_cast<struct io_uring_sqe *>(map);
+        char * sq = static_cast<char *>(sqMap);
+        char * cq = static_cast<char *>(cqMap);
+        sqTail = reinterpret_cast<unsigned *>(sq + p.sq_off.tail);
+        sqMask = *reinterpret_cast<unsigned *>(sq + p.sq_off.ring_mask);
+        sqArray = reinterpret_cast<unsigned *>(sq + p.sq_off.array);
+        cqHead = reinterpret_cast<unsigned *>(cq + p.cq_off.head);
+        cqTail = reinterpret_cast<unsigned *>(cq + p.cq_off.tail);
+        cqMask = *reinterpret_cast<unsigned *>(cq + p.cq_off.ring_mask);
+        cqes = reinterpret_cast<struct io_uring_cqe *>(cq + p.cq_off.cqes);
+    }
+
+    ~IoUring() {
+        release();
+    }
+
+    bool valid() const {
+        return sqes != NULL;
+    }
+
+    /**
+     * Test if the kernel supports all opcodes used by UringSocketImpl.
+     */
+    bool probe() {
+        size_t size = sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op);
+        std::vector<char> buffer(size, 0);
+        struct io_uring_probe * p = reinterpret_cast<struct io_uring_probe *>(&buffer[0]);
+
+        if (syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, p, 256) < 0) {
+            return false;
+        }
+
+        return supports(p, IORING_OP_RECV) && supports(p, IORING_OP_SEND)
+               && supports(p, IORING_OP_LINK_TIMEOUT);
+    }
+
+    /**
+     * Run one socket request and wait for it.
+     * @param opcode IORING_OP_RECV or IORING_OP_SEND.
+     * @param timeout The timeout in millisecond, negative means infinite.
+     * @return The result of the request, -ECANCELED if it timed out.
+     */
+    int run(int opcode, int sock, const char * buffer, int32_t size, int flags,
+            int timeout) {
+        struct __kernel_timespec ts;
+        unsigned tail = *sqTail;
+        unsigned count = 1;
+        struct io_uring_sqe * sqe = &sqes[tail & sqMask];
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = opcode;
+        sqe->fd = sock;
+        sqe->addr = reinterpret_cast<uint64_t>(buffer);
+        sqe->len = size;
+        sqe->msg_flags = flags;
+        sqe->user_data = URING_IO_REQUEST;
+        sqArray[tail & sqMask] = tail & sqMask;
+
+        if (timeout >= 0) {
+            sqe->flags |= IOSQE_IO_LINK;
+            ts.tv_sec = timeout / 1000;
+            ts.tv_nsec = (timeout % 1000) * 1000000LL;
+            ++tail;
+            ++count;
+            sqe = &sqes[tail & sqMask];
+            memset(sqe, 0, sizeof(*sqe));
+            sqe->opcode = IORING_OP_LINK_TIMEOUT;
+            sqe->fd = -1;
+            sqe->addr = reinterpret_cast<uint64_t>(&ts);
+            sqe->len = 1;
+            sqe->user_data = URING_TIMEOUT_REQUEST;
+            sqArray[tail & sqMask] = tail & sqMask;
+        }
+
+        __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+        unsigned toSubmit = count, pending = count;
+        int result = -ECANCELED;
+
+        while (pending > 0) {
+            int rc = syscall(__NR_io_uring_enter, fd, toSubmit, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+
+            if (rc < 0) {
+                if (EINTR == errno || EAGAIN == errno || EBUSY == errno) {
+                    continue;
+                }
+
+                THROW(HdfsNetworkException, "io_uring_enter failed: %s", GetSystemErrorInfo(errno));
+            }
+
+            toSubmit -= rc < static_cast<int>(toSubmit) ? rc : toSubmit;
+            unsigned head = *cqHead;
+
+            while (head != __atomic_load_n(cqTail, __ATOMIC_ACQUIRE)) {
+                struct io_uring_cqe * cqe = &cqes[head & cqMask];
+
+                if (cqe->user_data == URING_IO_REQUEST) {
+                    result = cqe->res;
+                }
+
+                --pending;
+                ++head;
+            }
+
+            __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+        }
+
+        return result;
+    }
+
+private:
+    static bool supports(struct io_uring_probe * p, int op) {
+        return op <= p->last_op && (p->ops[op].flags & IO_URING_OP_SUPPORTED);
+    }
+
+    void release() {
+        if (sqes) {
+            munmap(sqes, sqesSize);
+            sqes = NULL;
+        }
+
+        if (cqMap != MAP_FAILED && cqMap != sqMap) {
+            munmap(cqMap, cqMapSize);
+        }
+
+        if (sqMap != MAP_FAILED) {
+            munmap(sqMap, sqMapSize);
+        }
+
+        cqMap = sqMap = MAP_FAILED;
+
+        if (fd >= 0) {
+            ::close(fd);
+            fd = -1;
+        }
+    }
+
+private:
+    int fd;
+    void * sqMap;
+    void * cqMap;
+    struct io_uring_sqe * sqes;
+    struct io_uring_cqe * cqes;
+    size_t sqMapSize;
+    size_t cqMapSize;
+    size_t sqesSize;
+    unsigned * sqTail;
+    unsigned * sqArray;
+    unsigned * cqHead;
+    unsigned * cqTail;
+    unsigned sqMask;
+    unsigned cqMask;
+};
+
+static once_flag ProbeOnce;
+static bool UringAvailable = false;
+static pthread_key_t RingKey;
+static THREAD_LOCAL IoUring * LocalRing;
+
+static void DeleteRing(void * ring) {
+    delete static_cast<IoUring *>(ring);
+}
+
+static void ProbeUring() {
+    IoUring ring;
+    UringAvailable = ring.valid() && ring.probe();
+
+    if (UringAvailable) {
+        pthread_key_create(&RingKey, DeleteRing);
+    } else {
+        LOG(INFO, "io_uring is not available, use poll based socket io.");
+    }
+}
+
+/**
+ * Get the ring of the calling thread, NULL if io_uring cannot be used.
+ */
+static IoUring * GetRing() {
+    if (!UringSocketImpl::Available()) {
+        return NULL;
+    }
+
+    if (!LocalRing) {
+        IoUring * ring = new IoUring;
+
+        if (!ring->valid()) {
+            /*
+             * probably run out of locked memory, fall back for this call.
+             */
+            delete ring;
+            return NULL;
+        }
+
+        pthread_setspecific(RingKey, ring);
+        LocalRing = ring;
+    }
+
+    return LocalRing;
+}
+
+bool UringSocketImpl::Available() {
+    call_once(ProbeOnce, ProbeUring);
+    return UringAvailable;
+}
+
+Socket * UringSocketImpl::Create(bool useUring) {
+    if (useUring && Available()) {
+        Metrics::Add(METRIC_URING_SOCKETS);
+        return new UringSocketImpl;
+    }
+
+    return new TcpSocketImpl;
+}
+
+void UringSocketImpl::readFully(char * buffer, int32_t size, int timeout) {
+    assert(-1 != sock);
+    assert(NULL != buffer && size > 0);
+    IoUring * ring = GetRing();
+
+    if (!ring) {
+        TcpSocketImpl::readFully(buffer, size, timeout);
+        return;
+    }
+
+    int32_t todo = size;
+    int deadline = timeout;
+
+    while (todo > 0) {
+        steady_clock::time_point s = steady_clock::now();
+        CheckOperationCanceled();
+        int rc = ring->run(IORING_OP_RECV, sock, buffer + (size - todo), todo,
+                           MSG_WAITALL, deadline);
+
+        if (rc > 0) {
+            todo -= rc;
+        } else if (0 == rc) {
+            THROW(HdfsEndOfStream, "Read %d bytes failed from %s: End of the stream", size, remoteAddr.c_str());
+        } else if (-ECANCELED != rc && -EINTR != rc && -EAGAIN != rc) {
+            THROW(HdfsNetworkException, "Read %d bytes failed from %s: %s",
+                  size, remoteAddr.c_str(), GetSystemErrorInfo(-rc));
+        }
+
+        steady_clock::time_point e = steady_clock::now();
+
+        if (timeout > 0) {
+            deadline -= ToMilliSeconds(s, e);
+        }
+
+        if (todo > 0 && timeout >= 0 && (deadline <= 0 || -ECANCELED == rc)) {
+            THROW(HdfsTimeoutException, "Read %d bytes timeout from %s", size, remoteAddr.c_str());
+        }
+    }
+}
+
+void UringSocketImpl::writeFully(const char * buffer, int32_t size, int timeout) {
+    assert(-1 != sock);
+    assert(NULL != buffer && size > 0);
+    IoUring * ring = GetRing();
+
+    if (!ring) {
+        TcpSocketImpl::writeFully(buffer, size, timeout);
+        return;
+    }
+
+    int32_t todo = size;
+    int deadline = timeout;
+
+    while (todo > 0) {
+        steady_clock::time_point s = steady_clock::now();
+        CheckOperationCanceled();
+        int rc = ring->run(IORING_OP_SEND, sock, buffer + (size - todo), todo,
+                           MSG_NOSIGNAL | MSG_WAITALL, deadline);
+
+        if (rc > 0) {
+            todo -= rc;
+        } else if (-ECANCELED != rc && -EINTR != rc && -EAGAIN != rc) {
+            THROW(HdfsNetworkException, "Write %d bytes failed to %s: %s",
+                  size, remoteAddr.c_str(), GetSystemErrorInfo(-rc));
+        }
+
+        steady_clock::time_point e = steady_clock::now();
+
+        if (timeout > 0) {
+            deadline -= ToMilliSeconds(s, e);
+        }
+
+        if (todo > 0 && timeout >= 0 && (deadline <= 0 || -ECANCELED == rc)) {
+            THROW(HdfsTimeoutException, "Write %d bytes timeout to %s", size, remoteAddr.c_str());
+        }
+    }
+}
+
+}
+}
+
+#else
+
+namespace Hdfs {
+namespace Internal {
+
+bool UringSocketImpl::Available() {
+    return false;
+}
+
+Socket * UringSocketImpl::Create(bool useUring) {
+    return new TcpSocketImpl;
+}
+
+void UringSocketImpl::readFully(char * buffer, int32_t size, int timeout) {
+    TcpSocketImpl::readFully(buffer, size, timeout);
+}
+
+void UringSocketImpl::writeFully(const char * buffer, int32_t size, int timeout) {
+    TcpSocketImpl::writeFully(buffer, size, timeout);
+}
+
+}
+}
+
+#endif
@@ -0,0 +1,79 @@
+/********************************************************************
+ * 2014 -
+ * open source under Apache License Version 2.0
+ ********************************************************************/
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _HDFS_LIBHDFS3_NETWORK_URINGSOCKET_H_
+#define _HDFS_LIBHDFS3_NETWORK_URINGSOCKET_H_
+
+#include "TcpSocket.h"
+
+namespace Hdfs {
+namespace Internal {
+
+/**
+ * A tcp socket client which performs readFully and writeFully with io_uring.
+ *
+ * Each call is submitted as a single MSG_WAITALL request linked with a
+ * timeout, so it costs one io_uring_enter instead of a poll and a
+ * recv/send per chunk. Rings are created per thread on demand.
+ */
+class UringSocketImpl: public TcpSocketImpl {
+public:
+    /**
+     * Test if io_uring can be used in this process.
+     * The kernel is probed once, io_uring may be missing or forbidden by seccomp.
+     * @return Return true if io_uring supports the operations we need.
+     */
+    static bool Available();
+
+    /**
+     * Create a socket with io_uring if it is available, else a TcpSocketImpl.
+     * @param useUring false to always create a TcpSocketImpl.
+     */
+    static Socket * Create(bool useUring);
+
+    /**
+     * Read data from socket until get enough data.
+     * If there is not enough data can be read, the caller will be blocked.
+     * @param buffer The buffer to store the data.
+     * @param size The size of bytes to be read.
+     * @param timeout The timeout interval of this read operation, negative means infinite.
+     * @throw HdfsNetworkException
+     * @throw HdfsEndOfStream
+     * @throw HdfsTimeout
+     */
+    void readFully(char * buffer, int32_t size, int timeout);
+
+    /**
+     * Send all data to socket.
+     * The caller will be blocked until all data has been sent.
+     * @param buffer The data to be sent.
+     * @param size The size of bytes to be sent.
+     * @param timeout The timeout interval of this write operation, negative means infinite.
+     * @throw HdfsNetworkException
+     * @throw HdfsTimeout
+     */
+    void writeFully(const char * buffer, int32_t size, int timeout);
+};
+
+}
+}
+
+#endif /* _HDFS_LIBHDFS3_NETWORK_URINGSOCKET_H_ */
@@ -0,0 +1,68 @@
+/********************************************************************
+ * 2014 -
+ * open source under Apache License Version 2.0
+ ********************************************************************/
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _HDFS_LIBHDFS3_RPC_ALIGNMENTCONTEXT_H_
+#define _HDFS_LIBHDFS3_RPC_ALIGNMENTCONTEXT_H_
+
+#include "Atomic.h"
+
+#include <stdint.h>
+
+namespace Hdfs {
+namespace Internal {
+
+/**
+ * Track the highest namespace state id the client has seen.
+ *
+ * The state id is sent with every request so that an observer
+ * namenode can hold a read until it has caught up with the writes
+ * this client already saw on the active namenode.
+ */
+class AlignmentContext {
+public:
+    AlignmentContext() :
+        lastSeenStateId(0) {
+    }
+
+    int64_t getLastSeenStateId() const {
+        return lastSeenStateId.load();
+    }
+
+    /**
+     * Record the state id of a response, the state id never moves backwards.
+     * @param stateId the state id returned by the server.
+     */
+    void updateStateId(int64_t stateId) {
+        int64_t current = lastSeenStateId.load();
+
+        while (stateId > current
+                && !lastSeenStateId.compare_exchange_weak(current, stateId)) {
+        }
+    }
+
+private:
+    atomic<int64_t> lastSeenStateId;
+};
+
+}
+}
+
+#endif /* _HDFS_LIBHDFS3_RPC_ALIGNMENTCONTEXT_H_ */
@@ -22,6 +22,8 @@
 #ifndef _HDFS_LIBHDFS3_RPC_RPCCALL_H_
 #define _HDFS_LIBHDFS3_RPC_RPCCALL_H_
 
+#include "AlignmentContext.h"
+#include "Memory.h"
 #include "google/protobuf/message.h"
 
 namespace Hdfs {
@@ -66,11 +68,20 @@ public:
         this->response = response;
     }
 
+    const shared_ptr<AlignmentContext> & getAlignmentContext() const {
+        return alignment;
+    }
+
+    void setAlignmentContext(shared_ptr<AlignmentContext> alignment) {
+        this->alignment = alignment;
+    }
+
 private:
     bool idempotent;
     std::string name;
     google::protobuf::Message * request;
     google::protobuf::Message * response;
+    shared_ptr<AlignmentContext> alignment;
 };
 
 }
@@ -23,6 +23,7 @@
 #include "ExceptionInternal.h"
 #include "IpcConnectionContext.pb.h"
 #include "Logger.h"
+#include "Metrics.h"
 #include "RpcChannel.h"
 #include "RpcClient.h"
 #include "RpcContentWrapper.h"
@@ -30,6 +31,7 @@
 #include "RpcHeader.pb.h"
 #include "server/RpcHelper.h"
 #include "Thread.h"
+#include "Trace.h"
 #include "WriteBuffer.h"
 
 #include <google/protobuf/io/coded_stream.h>
@@ -46,7 +48,7 @@ namespace Hdfs {
 namespace Internal {
 
 RpcChannelImpl::RpcChannelImpl(const RpcChannelKey & k, RpcClient & c) :
-    refs(0), available(false), key(k), client(c) {
+    refs(0), available(false), reading(false), stopping(false), key(k), client(c) {
     sock = shared_ptr<Socket>(new TcpSocketImpl);
     sock->setLingerTimeout(k.getConf().getLingerTimeout());
     in = shared_ptr<BufferedSocketReader>(
@@ -57,7 +59,7 @@ RpcChannelImpl::RpcChannelImpl(const RpcChannelKey & k, RpcClient & c) :
 
 RpcChannelImpl::RpcChannelImpl(const RpcChannelKey & k, Socket * s,
                                BufferedSocketReader * in, RpcClient & c) :
-    refs(0), available(false), key(k), client(c) {
+    refs(0), available(false), reading(false), stopping(false), key(k), client(c) {
     sock = shared_ptr<Socket>(s);
     this->in = shared_ptr<BufferedSocketReader>(in);
     lastActivity = lastIdle = steady_clock::now();
@@ -66,10 +68,19 @@ RpcChannelImpl::RpcChannelImpl(const RpcChannelKey & k, Socket * s,
 RpcChannelImpl::~RpcChannelImpl() {
     assert(pendingCalls.empty());
     assert(refs == 0);
+    {
+        lock_guard<mutex> lock(writeMut);
+        stopping = true;
 
-    if (available) {
-        sock->close();
+        available = false;
+        readerCond.notify_all();
+    }
+
+    if (reader.joinable()) {
+        reader.join();
     }
+
+    sock->close();
 }
 
 void RpcChannelImpl::close(bool immediate) {
@@ -79,8 +90,7 @@ void RpcChannelImpl::close(bool immediate) {
 
     if (immediate && !refs) {
         assert(pendingCalls.empty());
-        available = false;
-        sock->close();
+        closeSocket();
     }
 }
 
@@ -169,6 +179,7 @@ std::string RpcChannelImpl::saslEvaluateToken(RpcSaslProto & response, bool serv
 }
 
 RpcAuth RpcChannelImpl::setupSaslConnection() {
+    TraceScope trace(TRACE_SASL);
     RpcAuth retval;
     RpcSaslProto negotiateRequest, response, msg;
     negotiateRequest.set_state(RpcSaslProto_SaslState_NEGOTIATE);
@@ -247,6 +258,7 @@ RpcAuth RpcChannelImpl::setupSaslConnection() {
 }
 
 void RpcChannelImpl::connect() {
+    TraceScope trace(TRACE_RPC_CONNECT);
     int sleep = 1;
     exception_ptr lastError;
     const RpcConfig & conf = key.getConf();
@@ -313,177 +325,173 @@ void RpcChannelImpl::connect() {
                 server.getHost().c_str(), server.getPort().c_str(), GetExceptionDetail(e, buffer));
         }
 
+        sock->close();
+        CheckOperationCanceled();
+
+        /*
+         * do not sleep after the last attempt, a failover or a probe
+         * of a Namenode which is down must not wait for nothing.
+         */
         if (i + 1 < conf.getMaxRetryOnConnect()) {
             LOG(INFO,
                 "Retrying connect to server: \"%s:%s\". Already tried %d time(s)",
                 server.getHost().c_str(), server.getPort().c_str(), i + 1);
+            sleep_for(seconds(sleep));
         }
-
-        sock->close();
-        CheckOperationCanceled();
-        sleep_for(seconds(sleep));
     }
 
     rethrow_exception(lastError);
 }
 
-exception_ptr RpcChannelImpl::invokeInternal(RpcRemoteCallPtr remote) {
-    const RpcCall & call = remote->getCall();
-    exception_ptr lastError;
+exception_ptr RpcChannelImpl::wrapError(exception_ptr error, const std::string & what) {
+    exception_ptr retval;
 
     try {
-        if (client.isRunning()) {
-            lock_guard<mutex> lock(writeMut);
-
-            if (!available) {
-                connect();
-            }
-
-            sendRequest(remote);
-        }
-
-        /*
-         * We use one call thread to check response,
-         * other thread will wait on RPC call complete.
-         */
-        while (client.isRunning()) {
-            if (remote->finished()) {
-                /*
-                 * Current RPC call has finished.
-                 * Wake up another thread to check response.
-                 */
-                wakeupOneCaller(remote->getIdentity());
-                break;
-            }
-
-            unique_lock<mutex> lock(readMut, defer_lock_t());
-
-            if (lock.try_lock()) {
-                /*
-                 * Current thread will check response.
-                 */
-                checkOneResponse();
-            } else {
-                /*
-                 * Another thread checks response, just wait.
-                 */
-                remote->wait();
-            }
-        }
+        rethrow_exception(error);
     } catch (const HdfsNetworkConnectException & e) {
         try {
-            NESTED_THROW(HdfsFailoverException,
-                         "Failed to invoke RPC call \"%s\" on server \"%s:%s\"",
-                         call.getName(), key.getServer().getHost().c_str(),
-                         key.getServer().getPort().c_str());
+            NESTED_THROW(HdfsFailoverException, "%s on server \"%s:%s\"", what.c_str(),
+                         key.getServer().getHost().c_str(), key.getServer().getPort().c_str());
         } catch (const HdfsFailoverException & e) {
-            lastError = current_exception();
+            retval = current_exception();
         }
     } catch (const HdfsNetworkException & e) {
         try {
-            NESTED_THROW(HdfsRpcException,
-                         "Failed to invoke RPC call \"%s\" on server \"%s:%s\"",
-                         call.getName(), key.getServer().getHost().c_str(),
-                         key.getServer().getPort().c_str());
+            NESTED_THROW(HdfsRpcException, "%s on server \"%s:%s\"", what.c_str(),
+                         key.getServer().getHost().c_str(), key.getServer().getPort().c_str());
         } catch (const HdfsRpcException & e) {
-            lastError = current_exception();
+            retval = current_exception();
         }
     } catch (const HdfsTimeoutException & e) {
         try {
-            NESTED_THROW(HdfsFailoverException,
-                         "Failed to invoke RPC call \"%s\" on server \"%s:%s\"",
-                         call.getName(), key.getServer().getHost().c_str(),
-                         key.getServer().getPort().c_str());
+            NESTED_THROW(HdfsFailoverException, "%s on server \"%s:%s\"", what.c_str(),
+                         key.getServer().getHost().c_str(), key.getServer().getPort().c_str());
         } catch (const HdfsFailoverException & e) {
-            lastError = current_exception();
+            retval = current_exception();
         }
+    } catch (const HdfsRpcServerException & e) {
+        /*
+         * fatal error reported by the server, the caller will unwrap it.
+         */
     } catch (const HdfsRpcException & e) {
-        lastError = current_exception();
+        retval = current_exception();
     } catch (const HdfsIOException & e) {
         try {
-            NESTED_THROW(HdfsRpcException,
-                         "Failed to invoke RPC call \"%s\" on server \"%s:%s\"",
-                         call.getName(), key.getServer().getHost().c_str(),
-                         key.getServer().getPort().c_str());
+            NESTED_THROW(HdfsRpcException, "%s on server \"%s:%s\"", what.c_str(),
+                         key.getServer().getHost().c_str(), key.getServer().getPort().c_str());
         } catch (const HdfsRpcException & e) {
-            lastError = current_exception();
+            retval = current_exception();
         }
+    } catch (...) {
     }
 
-    return lastError;
+    return retval;
 }
 
-void RpcChannelImpl::invoke(const RpcCall & call) {
-    assert(refs > 0);
-    RpcRemoteCallPtr remote;
+RpcRemoteCallPtr RpcChannelImpl::send(const RpcCall & call) {
+    int32_t id = client.getCallId();
+    Metrics::Add(METRIC_RPC_CALLS);
+    RpcRemoteCallPtr remote(new RpcRemoteCall(call, id, client.getClientId()));
     exception_ptr lastError;
 
     try {
-        bool retry = false;
+        unique_lock<mutex> lock(writeMut);
 
-        do {
-            int32_t id = client.getCallId();
-            remote = RpcRemoteCallPtr(new RpcRemoteCall(call, id, client.getClientId()));
-            lastError = exception_ptr();
-            lastError = invokeInternal(remote);
+        if (!client.isRunning()) {
+            /*
+             * wait will fail the call.
+             */
+            return remote;
+        }
 
-            if (lastError) {
-                lock_guard<mutex> lock(writeMut);
-                shutdown(lastError);
-
-                if (!retry && call.isIdempotent()) {
-                    retry = true;
-                    std::string buffer;
-                    LOG(LOG_ERROR,
-                        "Failed to invoke RPC call \"%s\" on server \"%s:%s\": \n%s",
-                        call.getName(), key.getServer().getHost().c_str(),
-                        key.getServer().getPort().c_str(),
-                        GetExceptionDetail(lastError, buffer));
-                    LOG(INFO,
-                        "Retry idempotent RPC call \"%s\" on server \"%s:%s\"",
-                        call.getName(), key.getServer().getHost().c_str(),
-                        key.getServer().getPort().c_str());
-                } else {
-                    rethrow_exception(lastError);
-                }
-            } else {
-                break;
-            }
-        } while (retry);
-    } catch (const HdfsRpcServerException & e) {
-        if (!remote->finished()) {
+        if (!available) {
             /*
-             * a fatal error happened, the caller will unwrap it.
+             * the reader thread leaves the socket alone once the channel
+             * is shut down, wait for it before reusing the socket.
              */
-            lock_guard<mutex> lock(writeMut);
-            lastError = current_exception();
-            shutdown(lastError);
+            while (reading) {
+                readerCond.wait(lock);
+            }
+
+            connect();
+
+            if (!reader.joinable()) {
+                CREATE_THREAD(reader, bind(&RpcChannelImpl::readResponses, this));
+            }
+
+            readerCond.notify_all();
         }
 
-        /*
-         * else not a fatal error, check again at the end of this function.
-         */
+        sendRequest(remote);
+        return remote;
     } catch (const HdfsException & e) {
-        lock_guard<mutex> lock(writeMut);
         lastError = current_exception();
+    }
+
+    std::stringstream ss;
+    ss.imbue(std::locale::classic());
+    ss << "Failed to invoke RPC call \"" << call.getName() << "\"";
+    exception_ptr wrapped = wrapError(lastError, ss.str());
+    lock_guard<mutex> lock(writeMut);
+
+    if (wrapped) {
+        shutdown(wrapped, true);
+        remote->abort(wrapped);
+    } else {
         shutdown(lastError);
+        remote->cancel(lastError);
+    }
+
+    return remote;
+}
+
+RpcRemoteCallPtr RpcChannelImpl::invokeAsync(const RpcCall & call) {
+    assert(refs > 0);
+    return send(call);
+}
+
+void RpcChannelImpl::wait(RpcRemoteCallPtr remote) {
+    assert(refs > 0);
+    RpcCall call = remote->getCall();
+    bool retry = false;
+
+    while (true) {
+        while (client.isRunning() && !remote->finished()) {
+            remote->wait();
+        }
+
+        if (!remote->isAborted() || retry || !call.isIdempotent()) {
+            break;
+        }
+
+        retry = true;
+        Metrics::Add(METRIC_RPC_RETRIES);
+        std::string buffer;
+        LOG(LOG_ERROR,
+            "Failed to invoke RPC call \"%s\" on server \"%s:%s\": \n%s",
+            call.getName(), key.getServer().getHost().c_str(),
+            key.getServer().getPort().c_str(),
+            GetExceptionDetail(remote->getError(), buffer));
+        LOG(INFO,
+            "Retry idempotent RPC call \"%s\" on server \"%s:%s\"",
+            call.getName(), key.getServer().getHost().c_str(),
+            key.getServer().getPort().c_str());
+        remote = send(call);
     }
 
     /*
-     * if the call is not finished, either failed to setup connection,
-     * or client is closing.
+     * if the call is not finished, the client is closing.
      */
-    if (!remote->finished() || !client.isRunning()) {
+    if (!remote->finished()) {
         lock_guard<mutex> lock(writeMut);
+        exception_ptr lastError;
 
-        if (lastError == exception_ptr()) {
-            try {
-                THROW(Hdfs::HdfsRpcException,
-                      "Failed to invoke RPC call \"%s\", RPC channel to \"%s:%s\" is to be closed since RpcClient is closing",
-                      call.getName(), key.getServer().getHost().c_str(), key.getServer().getPort().c_str());
-            } catch (...) {
-                lastError = current_exception();
-            }
+        try {
+            THROW(Hdfs::HdfsRpcException,
+                  "Failed to invoke RPC call \"%s\", RPC channel to \"%s:%s\" is to be closed since RpcClient is closing",
+                  call.getName(), key.getServer().getHost().c_str(), key.getServer().getPort().c_str());
+        } catch (...) {
+            lastError = current_exception();
         }
 
         /*
@@ -496,23 +504,26 @@ void RpcChannelImpl::invoke(const RpcCall & call) {
     remote->check();
 }
 
-void RpcChannelImpl::shutdown(exception_ptr reason) {
+void RpcChannelImpl::invoke(const RpcCall & call) {
+    TraceScope trace(TRACE_RPC_CALL);
+    MetricsTimer timer(METRIC_RPC_LATENCY);
+    wait(invokeAsync(call));
+}
+
+void RpcChannelImpl::shutdown(exception_ptr reason, bool aborted) {
     assert(reason != exception_ptr());
-    available = false;
-    cleanupPendingCalls(reason);
-    sock->close();
+    cleanupPendingCalls(reason, aborted);
+    closeSocket();
 }
 
-void RpcChannelImpl::wakeupOneCaller(int32_t id) {
-    lock_guard<mutex> lock(writeMut);
-    unordered_map<int32_t, RpcRemoteCallPtr>::iterator s, e;
-    e = pendingCalls.end();
+void RpcChannelImpl::closeSocket() {
+    available = false;
 
-    for (s = pendingCalls.begin(); s != e; ++s) {
-        if (s->first != id) {
-            s->second->wakeup();
-            return;
-        }
+    /*
+     * the reader thread closes the socket when it is done with it.
+     */
+    if (!reading) {
+        sock->close();
     }
 }
 
@@ -523,47 +534,100 @@ void RpcChannelImpl::sendRequest(RpcRemoteCallPtr remote) {
     sock->writeFully(buffer.getBuffer(0), buffer.getDataSize(0),
                      key.getConf().getWriteTimeout());
     uint32_t id = remote->getIdentity();
+
+    if (pendingCalls.empty()) {
+        lastResponse = steady_clock::now();
+    }
+
     pendingCalls[id] = remote;
     lastActivity = lastIdle = steady_clock::now();
 }
 
-void RpcChannelImpl::cleanupPendingCalls(exception_ptr reason) {
+void RpcChannelImpl::cleanupPendingCalls(exception_ptr reason, bool aborted) {
     assert(!writeMut.try_lock());
     unordered_map<int32_t, RpcRemoteCallPtr>::iterator s, e;
     e = pendingCalls.end();
 
     for (s = pendingCalls.begin(); s != e; ++s) {
-        s->second->cancel(reason);
+        if (aborted) {
+            s->second->abort(reason);
+        } else {
+            s->second->cancel(reason);
+        }
     }
 
     pendingCalls.clear();
 }
 
-void RpcChannelImpl::checkOneResponse() {
-    int ping = key.getConf().getPingTimeout();
-    int timeout = key.getConf().getRpcTimeout();
-    steady_clock::time_point start = steady_clock::now();
+void RpcChannelImpl::readResponses() {
+    unique_lock<mutex> lock(writeMut);
 
-    while (client.isRunning()) {
-        if (getResponse()) {
-            readOneResponse(true);
-            return;
-        } else {
-            if (ping > 0 && ToMilliSeconds(lastActivity, steady_clock::now()) >= ping) {
-                lock_guard<mutex> lock(writeMut);
-                sendPing();
+    while (!stopping) {
+        if (!available) {
+            readerCond.wait(lock);
+            continue;
+        }
+
+        reading = true;
+        lock.unlock();
+        exception_ptr error;
+
+        try {
+            if (in->poll(500)) {
+                readOneResponse(true);
+            } else {
+                checkTimeout();
             }
+        } catch (...) {
+            error = current_exception();
         }
 
-        if (timeout > 0 && ToMilliSeconds(start, steady_clock::now()) >= timeout) {
-            try {
-                THROW(Hdfs::HdfsTimeoutException, "Timeout when wait for response from RPC channel \"%s:%s\"",
-                      key.getServer().getHost().c_str(), key.getServer().getPort().c_str());
-            } catch (...) {
-                NESTED_THROW(Hdfs::HdfsRpcException, "Timeout when wait for response from RPC channel \"%s:%s\"",
-                             key.getServer().getHost().c_str(), key.getServer().getPort().c_str());
+        lock.lock();
+        reading = false;
+
+        if (!available) {
+            sock->close();
+        }
+
+        /*
+         * the channel may have been shut down by a caller meanwhile.
+         */
+        if (error && available) {
+            exception_ptr wrapped = wrapError(error, "Failed to read RPC response");
+
+            if (wrapped) {
+                shutdown(wrapped, true);
+            } else {
+                shutdown(error);
             }
         }
+
+        readerCond.notify_all();
+    }
+}
+
+void RpcChannelImpl::checkTimeout() {
+    int ping = key.getConf().getPingTimeout();
+    int timeout = key.getConf().getRpcTimeout();
+    lock_guard<mutex> lock(writeMut);
+    steady_clock::time_point now = steady_clock::now();
+
+    if (pendingCalls.empty() || !available) {
+        return;
+    }
+
+    if (ping > 0 && ToMilliSeconds(lastActivity, now) >= ping) {
+        sendPing();
+    }
+
+    if (timeout > 0 && ToMilliSeconds(lastResponse, now) >= timeout) {
+        try {
+            THROW(Hdfs::HdfsTimeoutException, "Timeout when wait for response from RPC channel \"%s:%s\"",
+                  key.getServer().getHost().c_str(), key.getServer().getPort().c_str());
+        } catch (...) {
+            NESTED_THROW(Hdfs::HdfsRpcException, "Timeout when wait for response from RPC channel \"%s:%s\"",
+                         key.getServer().getHost().c_str(), key.getServer().getPort().c_str());
+        }
     }
 }
 
@@ -594,7 +658,7 @@ bool RpcChannelImpl::checkIdle() {
         try {
             //close the connection if idle timeout
             if (ToMilliSeconds(lastIdle, steady_clock::now()) >= idle) {
-                sock->close();
+                closeSocket();
                 return true;
             }
 
@@ -610,7 +674,7 @@ bool RpcChannelImpl::checkIdle() {
                 key.getServer().getHost().c_str(),
                 key.getServer().getPort().c_str(),
                 GetExceptionDetail(current_exception(), buffer));
-            sock->close();
+            closeSocket();
             return true;
         }
     }
@@ -699,29 +763,20 @@ RpcRemoteCallPtr RpcChannelImpl::getPendingCall(int32_t id) {
 
     RpcRemoteCallPtr rc = it->second;
     pendingCalls.erase(it);
+    lastResponse = steady_clock::now();
     return rc;
 }
 
-bool RpcChannelImpl::getResponse() {
-    int idleTimeout = key.getConf().getMaxIdleTime();
-    int pingTimeout = key.getConf().getPingTimeout();
-    int timeout = key.getConf().getRpcTimeout();
-    int interval = pingTimeout < idleTimeout ? pingTimeout : idleTimeout;
-    interval /= 2;
-    interval = interval < timeout ? interval : timeout;
-    steady_clock::time_point s = steady_clock::now();
-
-    while (client.isRunning()) {
-        if (in->poll(500)) {
-            return true;
-        }
+/*
+ * let the alignment context of the call see the state id of the server,
+ * failed calls carry it as well.
+ */
+static void UpdateStateId(const RpcRemoteCallPtr & rc, const RpcResponseHeaderProto & header) {
+    const shared_ptr<AlignmentContext> & alignment = rc->getCall().getAlignmentContext();
 
-        if (ToMilliSeconds(s, steady_clock::now()) >= interval) {
-            return false;
-        }
+    if (alignment && header.has_stateid()) {
+        alignment->updateStateId(header.stateid());
     }
-
-    return false;
 }
 
 static exception_ptr HandlerRpcResponseException(exception_ptr e) {
@@ -730,13 +785,16 @@ static exception_ptr HandlerRpcResponseException(exception_ptr e) {
     try {
         rethrow_exception(e);
     } catch (const HdfsRpcServerException & e) {
-        UnWrapper < NameNodeStandbyException, RpcNoSuchMethodException, UnsupportedOperationException,
-                  AccessControlException, SafeModeException, SaslException > unwrapper(e);
+        UnWrapper < ObserverRetryOnActiveException, NameNodeStandbyException, NameNodeRetriableException,
+                  RpcNoSuchMethodException, UnsupportedOperationException, AccessControlException,
+                  SafeModeException, SaslException > unwrapper(e);
 
         try {
             unwrapper.unwrap(__FILE__, __LINE__);
         } catch (const NameNodeStandbyException & e) {
             retval = current_exception();
+        } catch (const NameNodeRetriableException & e) {
+            retval = current_exception();
         } catch (const UnsupportedOperationException & e) {
             retval = current_exception();
         } catch (const AccessControlException & e) {
@@ -797,14 +855,13 @@ void RpcChannelImpl::readOneResponse(bool writeLock) {
             in->readFully(&buffer[0], bodySize, readTimeout);
         }
 
-        Message * response = rc->getCall().getResponse();
-
-        if (!response->ParseFromArray(&buffer[0], bodySize)) {
+        if (!rc->parseResponse(&buffer[0], bodySize)) {
             THROW(HdfsRpcException,
                   "RPC channel to \"%s:%s\" got protocol mismatch: rpc channel cannot parse response.",
                   key.getServer().getHost().c_str(), key.getServer().getPort().c_str())
         }
 
+        UpdateStateId(rc, curRespHeader);
         rc->done();
     } else {
         /*
@@ -816,11 +873,16 @@ void RpcChannelImpl::readOneResponse(bool writeLock) {
 
         if (RpcResponseHeaderProto_RpcStatusProto_ERROR == status) {
             RpcRemoteCallPtr rc;
-            {
+
+            if (writeLock) {
                 lock_guard<mutex> lock(writeMut);
                 rc = getPendingCall(curRespHeader.callid());
+            } else {
+                rc = getPendingCall(curRespHeader.callid());
             }
 
+            UpdateStateId(rc, curRespHeader);
+
             try {
                 THROW(HdfsRpcServerException, "%s: %s",
                       errClass.c_str(), errMessage.c_str());
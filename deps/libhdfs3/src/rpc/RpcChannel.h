@@ -66,6 +66,22 @@ public:
      */
     virtual void invoke(const RpcCall & call) = 0;
 
+    /**
+     * Send a rpc call without waiting for its response.
+     * The request and response of the call must stay valid until
+     * wait returned or the remote call was discarded.
+     * @param call The call is to be invoked.
+     * @return The remote call object to be passed to wait.
+     */
+    virtual RpcRemoteCallPtr invokeAsync(const RpcCall & call) = 0;
+
+    /**
+     * Wait for a call sent by invokeAsync to finish.
+     * Retries and errors are the same as of invoke.
+     * @param remote The remote call returned by invokeAsync.
+     */
+    virtual void wait(RpcRemoteCallPtr remote) = 0;
+
     /**
      * Close the channel if it idle expired.
      * @return true if the channel idle expired.
@@ -83,6 +99,13 @@ public:
      * Add reference count to this channel.
      */
     virtual void addRef() = 0;
+
+    /**
+     * Get the reference count of this channel,
+     * that is the number of calls using it.
+     * @return The reference count.
+     */
+    virtual int getRefCount() = 0;
 };
 
 /**
@@ -115,6 +138,22 @@ public:
      */
     void invoke(const RpcCall & call);
 
+    /**
+     * Send a rpc call without waiting for its response.
+     * The request and response of the call must stay valid until
+     * wait returned or the remote call was discarded.
+     * @param call The call is to be invoked.
+     * @return The remote call object to be passed to wait.
+     */
+    RpcRemoteCallPtr invokeAsync(const RpcCall & call);
+
+    /**
+     * Wait for a call sent by invokeAsync to finish.
+     * Retries and errors are the same as of invoke.
+     * @param remote The remote call returned by invokeAsync.
+     */
+    void wait(RpcRemoteCallPtr remote);
+
     /**
      * Close the channel if it idle expired.
      * @return true if the channel idle expired.
@@ -135,6 +174,15 @@ public:
         ++refs;
     }
 
+    /**
+     * Get the reference count of this channel,
+     * that is the number of calls using it.
+     * @return The reference count.
+     */
+    int getRefCount() {
+        return refs;
+    }
+
 private:
     /**
      * Setup the RPC connection.
@@ -145,9 +193,10 @@ private:
     /**
      * Cleanup all pending calls.
      * @param reason The reason to cancel the call.
+     * @param aborted The connection failed and idempotent calls may be retried.
      * @pre Already hold write lock.
      */
-    void cleanupPendingCalls(exception_ptr reason);
+    void cleanupPendingCalls(exception_ptr reason, bool aborted);
 
     /**
      * Send rpc connect protocol header.
@@ -182,22 +231,38 @@ private:
     void sendRequest(RpcRemoteCallPtr remote);
 
     /**
-     * Issue a rpc call and check response.
-     * Catch all recoverable error in this function
-     *
-     * @param remote The remote call
+     * Connect if necessary and send a new remote call.
+     * Recoverable errors abort the returned call instead of being thrown.
+     * @param call The call is to be invoked.
+     * @return The remote call.
+     */
+    RpcRemoteCallPtr send(const RpcCall & call);
+
+    /**
+     * Wrap a connection failure the way the callers expect it:
+     * connect failures and timeouts fail over, others are rpc errors.
+     * @param error The failure.
+     * @param what The failed operation, used as message.
+     * @return The wrapped failure, or null if error is not a connection failure.
+     */
+    exception_ptr wrapError(exception_ptr error, const std::string & what);
+
+    /**
+     * Body of the reader thread, read responses and hand them to the
+     * pending calls while the channel is connected.
      */
-    exception_ptr invokeInternal(RpcRemoteCallPtr remote);
+    void readResponses();
 
     /**
-     * Check response, block until get one response.
-     * @pre Channel already hold read lock.
+     * Send ping if there was no activity and fail the pending calls
+     * if there was no response within rpc timeout.
      */
-    void checkOneResponse();
+    void checkTimeout();
 
     /**
      * read and handle one response.
-     * @pre Channel already hold read lock.
+     * @param writeLock Take the write lock to find the call, false if the caller holds it.
+     * @pre No other thread reads from the socket.
      */
     void readOneResponse(bool writeLock);
 
@@ -211,23 +276,19 @@ private:
     RpcRemoteCallPtr getPendingCall(int32_t id);
 
     /**
-     * Check if there is data available for reading on socket.
-     * @return true if response is available.
-     */
-    bool getResponse();
-
-    /**
-     * wake up one caller to check response.
-     * @param id The call id which current caller handled.
+     * shutdown the RPC connection since error.
+     * @param reason The reason to cancel the call
+     * @param aborted The connection failed and idempotent calls may be retried.
+     * @pre Already hold write lock.
      */
-    void wakeupOneCaller(int32_t id);
+    void shutdown(exception_ptr reason, bool aborted = false);
 
     /**
-     * shutdown the RPC connection since error.
-     * @param reason The reason to cancel the call
+     * Mark the channel unavailable and close the socket
+     * unless the reader thread still uses it.
      * @pre Already hold write lock.
      */
-    void shutdown(exception_ptr reason);
+    void closeSocket();
 
     const RpcSaslProto_SaslAuth * createSaslClient(
         const ::google::protobuf::RepeatedPtrField<RpcSaslProto_SaslAuth> * auths);
@@ -252,7 +313,9 @@ private:
 private:
     atomic<int> refs;
     bool available;
-    mutex readMut;
+    bool reading; // the reader thread uses the socket
+    bool stopping;
+    condition_variable readerCond;
     mutex writeMut;
     RpcChannelKey key;
     RpcClient & client;
@@ -261,6 +324,8 @@ private:
     shared_ptr<Socket> sock;
     steady_clock::time_point lastActivity; // ping is a kind of activity, lastActivity will be updated after ping
     steady_clock::time_point lastIdle; // ping cannot change idle state. If there is still pending calls, lastIdle is always "NOW".
+    steady_clock::time_point lastResponse; // last response, or when the first pending call was sent
+    thread reader;
     unordered_map<int32_t, RpcRemoteCallPtr> pendingCalls;
 };
 
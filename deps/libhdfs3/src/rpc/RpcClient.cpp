@@ -66,6 +66,29 @@ RpcClientImpl::~RpcClientImpl() {
     close();
 }
 
+void RpcClientImpl::cleanIdle(ChannelPools & pools) {
+    ChannelPools::iterator s, e;
+    e = pools.end();
+
+    for (s = pools.begin(); s != e;) {
+        ChannelPool & pool = s->second;
+
+        for (size_t i = 0; i < pool.size();) {
+            if (pool[i]->checkIdle()) {
+                pool.erase(pool.begin() + i);
+            } else {
+                ++i;
+            }
+        }
+
+        if (pool.empty()) {
+            s = pools.erase(s);
+        } else {
+            ++s;
+        }
+    }
+}
+
 void RpcClientImpl::clean() {
     assert(cleaning);
 
@@ -75,21 +98,12 @@ void RpcClientImpl::clean() {
                 unique_lock<mutex> lock(mut);
                 cond.wait_for(lock, seconds(1));
 
-                if (!running || allChannels.empty()) {
+                if (!running || (allChannels.empty() && bulkChannels.empty())) {
                     break;
                 }
 
-                unordered_map<RpcChannelKey, shared_ptr<RpcChannel> >::iterator s, e;
-                e = allChannels.end();
-
-                for (s = allChannels.begin(); s != e;) {
-                    if (s->second->checkIdle()) {
-                        s->second.reset();
-                        s = allChannels.erase(s);
-                    } else {
-                        ++s;
-                    }
-                }
+                cleanIdle(allChannels);
+                cleanIdle(bulkChannels);
             } catch (const HdfsCanceled & e) {
                 /*
                  * ignore cancel signal here.
@@ -107,26 +121,60 @@ void RpcClientImpl::clean() {
     cleaning = false;
 }
 
-void RpcClientImpl::close() {
-    lock_guard<mutex> lock(mut);
-    running = false;
-    unordered_map<RpcChannelKey, shared_ptr<RpcChannel> >::iterator s, e;
-    e = allChannels.end();
+void RpcClientImpl::waitForExit(ChannelPools & pools) {
+    ChannelPools::iterator s, e;
+    e = pools.end();
 
-    for (s = allChannels.begin(); s != e; ++s) {
-        s->second->waitForExit();
+    for (s = pools.begin(); s != e; ++s) {
+        for (size_t i = 0; i < s->second.size(); ++i) {
+            s->second[i]->waitForExit();
+        }
     }
 
-    allChannels.clear();
+    pools.clear();
+}
+
+void RpcClientImpl::close() {
+    lock_guard<mutex> lock(mut);
+    running = false;
+    waitForExit(allChannels);
+    waitForExit(bulkChannels);
 }
 
 bool RpcClientImpl::isRunning() {
     return running;
 }
 
+shared_ptr<RpcChannel> RpcClientImpl::selectChannel(ChannelPools & pools,
+        const RpcChannelKey & key, int size) {
+    ChannelPool & pool = pools[key];
+    shared_ptr<RpcChannel> rc;
+    int least = 0;
+
+    for (size_t i = 0; i < pool.size(); ++i) {
+        int refs = pool[i]->getRefCount();
+
+        if (!rc || refs < least) {
+            rc = pool[i];
+            least = refs;
+        }
+    }
+
+    /*
+     * a call queued behind a large response on a busy connection
+     * waits for it, open one more connection while the pool is not full.
+     */
+    if (!rc || (least > 0 && pool.size() < static_cast<size_t>(size))) {
+        rc = createChannelInternal(key);
+        pool.push_back(rc);
+    }
+
+    return rc;
+}
+
 RpcChannel & RpcClientImpl::getChannel(const RpcAuth & auth,
                                        const RpcProtocolInfo & protocol, const RpcServerInfo & server,
-                                       const RpcConfig & conf) {
+                                       const RpcConfig & conf, bool bulk) {
     shared_ptr<RpcChannel> rc;
     RpcChannelKey key(auth, protocol, server, conf);
 
@@ -139,14 +187,10 @@ RpcChannel & RpcClientImpl::getChannel(const RpcAuth & auth,
                   key.getServer().getHost().c_str(), key.getServer().getPort().c_str());
         }
 
-        unordered_map<RpcChannelKey, shared_ptr<RpcChannel> >::iterator it;
-        it = allChannels.find(key);
-
-        if (it != allChannels.end()) {
-            rc = it->second;
+        if (bulk && conf.getBulkConnections() > 0) {
+            rc = selectChannel(bulkChannels, key, conf.getBulkConnections());
         } else {
-            rc = createChannelInternal(key);
-            allChannels[key] = rc;
+            rc = selectChannel(allChannels, key, conf.getConnections());
         }
 
         if (!cleaning) {
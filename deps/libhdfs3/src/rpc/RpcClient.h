@@ -51,16 +51,16 @@ public:
     }
 
     /**
-     * Get a RPC channel, create a new one if necessary.
+     * Get the least used RPC channel of the server, create a new one if necessary.
      * @param auth Authentication information used to setup RPC connection.
      * @param protocol The RPC protocol used in this call.
      * @param server Remote server information.
      * @param conf RPC connection configuration.
-     * @param once If true, the RPC channel will not be reused.
+     * @param bulk The call may get a large response, use the bulk channels if configured.
      */
     virtual RpcChannel & getChannel(const RpcAuth & auth,
                                     const RpcProtocolInfo & protocol, const RpcServerInfo & server,
-                                    const RpcConfig & conf) = 0;
+                                    const RpcConfig & conf, bool bulk) = 0;
 
     /**
      * Check the RpcClient is still running.
@@ -94,16 +94,16 @@ public:
     ~RpcClientImpl();
 
     /**
-     * Get a RPC channel, create a new one if necessary.
+     * Get the least used RPC channel of the server, create a new one if necessary.
      * @param auth Authentication information used to setup RPC connection.
      * @param protocol The RPC protocol used in this call.
      * @param server Remote server information.
      * @param conf RPC connection configuration.
-     * @param once If true, the RPC channel will not be reused.
+     * @param bulk The call may get a large response, use the bulk channels if configured.
      */
     RpcChannel & getChannel(const RpcAuth & auth,
                             const RpcProtocolInfo & protocol, const RpcServerInfo & server,
-                            const RpcConfig & conf);
+                            const RpcConfig & conf, bool bulk);
 
     /**
      * Close the RPC channel.
@@ -129,9 +129,28 @@ public:
     }
 
 private:
+    typedef std::vector<shared_ptr<RpcChannel> > ChannelPool;
+    typedef unordered_map<RpcChannelKey, ChannelPool> ChannelPools;
+
     shared_ptr<RpcChannel> createChannelInternal(
         const RpcChannelKey & key);
 
+    /**
+     * Pick the channel with the fewest calls in the pool of key,
+     * open a new one if all are in use and the pool is not full.
+     * @pre Already hold the lock.
+     */
+    shared_ptr<RpcChannel> selectChannel(ChannelPools & pools,
+                                         const RpcChannelKey & key, int size);
+
+    /**
+     * Close and remove the idle expired channels.
+     * @pre Already hold the lock.
+     */
+    static void cleanIdle(ChannelPools & pools);
+
+    static void waitForExit(ChannelPools & pools);
+
     void clean();
 
 private:
@@ -142,7 +161,8 @@ private:
     mutex mut;
     std::string clientId;
     thread cleaner;
-    unordered_map<RpcChannelKey, shared_ptr<RpcChannel> > allChannels;
+    ChannelPools allChannels;
+    ChannelPools bulkChannels; // for large responses, separate from allChannels
 
 #ifdef MOCK
 private:
@@ -41,6 +41,8 @@ public:
         tcpNoDelay = conf.isRpcTcpNoDelay();
         lingerTimeout = conf.getRpcSocketLingerTimeout();
         rpcTimeout = conf.getRpcTimeout();
+        connections = conf.getRpcConnections();
+        bulkConnections = conf.getRpcBulkConnections();
     }
 
     size_t hash_value() const;
@@ -117,6 +119,22 @@ public:
         this->rpcTimeout = rpcTimeout;
     }
 
+    int getConnections() const {
+        return connections;
+    }
+
+    void setConnections(int connections) {
+        this->connections = connections;
+    }
+
+    int getBulkConnections() const {
+        return bulkConnections;
+    }
+
+    void setBulkConnections(int bulkConnections) {
+        this->bulkConnections = bulkConnections;
+    }
+
     bool operator ==(const RpcConfig & other) const {
         return this->maxIdleTime == other.maxIdleTime
                && this->pingTimeout == other.pingTimeout
@@ -126,7 +144,9 @@ public:
                && this->maxRetryOnConnect == other.maxRetryOnConnect
                && this->tcpNoDelay == other.tcpNoDelay
                && this->lingerTimeout == other.lingerTimeout
-               && this->rpcTimeout == other.rpcTimeout;
+               && this->rpcTimeout == other.rpcTimeout
+               && this->connections == other.connections
+               && this->bulkConnections == other.bulkConnections;
     }
 
 private:
@@ -138,6 +158,8 @@ private:
     int maxRetryOnConnect;
     int lingerTimeout;
     int rpcTimeout;
+    int connections;
+    int bulkConnections;
     bool tcpNoDelay;
 };
 
@@ -44,6 +44,11 @@ void RpcRemoteCall::serialize(const RpcProtocolInfo & protocol,
     rpcHeader.set_retrycount(-1);
     rpcHeader.set_rpckind(RPC_PROTOCOL_BUFFER);
     rpcHeader.set_rpcop(RpcRequestHeaderProto_OperationProto_RPC_FINAL_PACKET);
+
+    if (call.getAlignmentContext()) {
+        rpcHeader.set_stateid(call.getAlignmentContext()->getLastSeenStateId());
+    }
+
     RequestHeaderProto requestHeader;
     requestHeader.set_methodname(call.getName());
     requestHeader.set_declaringclassprotocolname(protocol.getProtocol());
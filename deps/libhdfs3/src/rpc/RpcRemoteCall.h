@@ -41,7 +41,7 @@ typedef shared_ptr<RpcRemoteCall> RpcRemoteCallPtr;
 class RpcRemoteCall {
 public:
     RpcRemoteCall(const RpcCall & c, int32_t id, const std::string & clientId) :
-        complete(false), identity(id), call(c), clientId(clientId) {
+        aborted(false), complete(false), discarded(false), identity(id), call(c), clientId(clientId) {
     }
     virtual ~RpcRemoteCall() {
     }
@@ -53,6 +53,35 @@ public:
         cond.notify_all();
     }
 
+    /**
+     * Fail the call because the connection failed, the caller may retry it.
+     */
+    void abort(exception_ptr reason) {
+        unique_lock<mutex> lock(mut);
+        aborted = true;
+        complete = true;
+        error = reason;
+        cond.notify_all();
+    }
+
+    /**
+     * The caller gave up waiting, drop the response when it arrives
+     * since the response object may be gone.
+     */
+    void discard() {
+        unique_lock<mutex> lock(mut);
+        discarded = true;
+    }
+
+    /**
+     * Parse the response body into the response of the call.
+     * @return false if the body cannot be parsed.
+     */
+    bool parseResponse(const char * data, int size) {
+        unique_lock<mutex> lock(mut);
+        return discarded || call.getResponse()->ParseFromArray(data, size);
+    }
+
     virtual void serialize(const RpcProtocolInfo & protocol,
                            WriteBuffer & buffer);
 
@@ -68,6 +97,16 @@ public:
         }
     }
 
+    bool isAborted() {
+        unique_lock<mutex> lock(mut);
+        return aborted;
+    }
+
+    exception_ptr getError() {
+        unique_lock<mutex> lock(mut);
+        return error;
+    }
+
     void check() {
         if (error != exception_ptr()) {
             rethrow_exception(error);
@@ -97,7 +136,9 @@ public:
     static std::vector<char> GetPingRequest(const std::string & clientid);
 
 private:
+    bool aborted;
     bool complete;
+    bool discarded;
     condition_variable cond;
     const int32_t identity;
     exception_ptr error;
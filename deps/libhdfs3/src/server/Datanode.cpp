@@ -41,8 +41,15 @@ DatanodeImpl::DatanodeImpl(const std::string & host, uint32_t port,
     server.setTokenService("");
 }
 
+DatanodeImpl::DatanodeImpl(const std::string & host, uint32_t port,
+                           const RpcConfig & c, const RpcAuth & a) :
+    auth(a), client(RpcClient::getClient()), conf(c), protocol(
+        DATANODE_VERSION, DATANODE_PROTOCOL, BLOCK_TOKEN_KIND), server(host, port) {
+    server.setTokenService("");
+}
+
 void DatanodeImpl::invoke(const RpcCall & call, bool reuse) {
-    RpcChannel & channel = client.getChannel(auth, protocol, server, conf);
+    RpcChannel & channel = client.getChannel(auth, protocol, server, conf, false);
 
     try {
         channel.invoke(call);
@@ -82,6 +82,9 @@ public:
     DatanodeImpl(const std::string & host, uint32_t port, const SessionConfig & c,
                  const RpcAuth & a);
 
+    DatanodeImpl(const std::string & host, uint32_t port, const RpcConfig & c,
+                 const RpcAuth & a);
+
     virtual int64_t getReplicaVisibleLength(const ExtendedBlock & b);
 
     virtual void getBlockLocalPathInfo(const ExtendedBlock & block,
@@ -30,6 +30,7 @@
 #include "ExtendedBlock.h"
 #include "LocatedBlock.h"
 #include "LocatedBlocks.h"
+#include "Memory.h"
 #include "rpc/RpcAuth.h"
 #include "rpc/RpcCall.h"
 #include "rpc/RpcClient.h"
@@ -43,6 +44,36 @@
 namespace Hdfs {
 namespace Internal {
 
+/**
+ * A getFileInfo call in flight, see Namenode::getFileInfoAsync.
+ * Destroying it before get returned abandons the call.
+ */
+class FileInfoFuture {
+public:
+    virtual ~FileInfoFuture() {
+    }
+
+    /**
+     * Wait for the result, see Namenode::getFileInfo.
+     */
+    virtual FileStatus get(bool *exist) = 0;
+};
+
+/**
+ * A getListing call in flight, see Namenode::getListingAsync.
+ * Destroying it before get returned abandons the call.
+ */
+class ListingFuture {
+public:
+    virtual ~ListingFuture() {
+    }
+
+    /**
+     * Wait for the result, see Namenode::getListing.
+     */
+    virtual bool get(std::vector<FileStatus> & dl) = 0;
+};
+
 class Namenode {
 public:
     /**
@@ -258,6 +289,8 @@ public:
      * @param previous  previous block
      * @param excludeNodes a list of nodes that should not be
      * allocated for the current block
+     * @param favoredNodes host:port of the datanodes the replicas
+     * should be placed on if possible
      *
      * @param LocatedBlock allocated block information.
      * @param lb output the returned block.
@@ -273,7 +306,8 @@ public:
      */
     virtual shared_ptr<LocatedBlock> addBlock(const std::string & src,
             const std::string & clientName, const ExtendedBlock * previous,
-            const std::vector<DatanodeInfo> & excludeNodes)
+            const std::vector<DatanodeInfo> & excludeNodes,
+            const std::vector<std::string> & favoredNodes)
     /* throw (AccessControlException, FileNotFoundException,
      NotReplicatedYetException, SafeModeException,
      UnresolvedLinkException, HdfsIOException) */ = 0;
@@ -364,9 +398,9 @@ public:
      * @throw UnresolvedLinkException if <code>trg</code> or <code>srcs</code>
      *           contains a symlink
      */
-    /*    virtual void concat(const std::string & trg,
-                            const std::vector<std::string> & srcs)  throw (HdfsIOException,
-                 UnresolvedLinkException)  = 0;*/
+    virtual void concat(const std::string & trg,
+                        const std::vector<std::string> & srcs)
+    /* throw (HdfsIOException, UnresolvedLinkException) */ = 0;
 
     /**
      * Truncate a file to the indicated length
@@ -526,6 +560,15 @@ public:
              FileNotFoundException, UnresolvedLinkException,
              HdfsIOException) */ = 0;
 
+    /**
+     * Send a getListing call without waiting for the response,
+     * many calls can be in flight on one connection.
+     * The errors are thrown by ListingFuture::get.
+     */
+    //Idempotent
+    virtual shared_ptr<ListingFuture> getListingAsync(const std::string & src,
+            const std::string & startAfter, bool needLocation) = 0;
+
     /**
      * Client programs can cause stateful changes in the NameNode
      * that affect other clients.  A client may obtain a file and
@@ -607,6 +650,14 @@ public:
     /* throw (AccessControlException, FileNotFoundException,
      UnresolvedLinkException, HdfsIOException) */ = 0;
 
+    /**
+     * Send a getFileInfo call without waiting for the response,
+     * many calls can be in flight on one connection.
+     * The errors are thrown by FileInfoFuture::get.
+     */
+    //Idempotent
+    virtual shared_ptr<FileInfoFuture> getFileInfoAsync(const std::string & src) = 0;
+
     /**
      * Get the file info for a specific file or directory. If the path
      * refers to a symlink then the FileStatus of the symlink is returned.
@@ -843,6 +894,16 @@ public:
     virtual bool listEncryptionZones(const int64_t id, std::vector<EncryptionZoneInfo> & ezl) 
               /* throw (AccessControlException, UnresolvedLinkException, HdfsIOException) */ = 0;
 
+    /**
+     * Wait until the namenode has applied every transaction which was
+     * committed before the call, and learn its state id.
+     * Observer reads after msync see all writes the client saw before.
+     *
+     * @throw RpcNoSuchMethodException the namenode does not support msync.
+     * @throw HdfsIOException If an I/O error occurred
+     */
+    virtual void msync() /* throw (HdfsIOException) */ = 0;
+
 };
 }
 }
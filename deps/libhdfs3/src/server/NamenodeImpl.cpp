@@ -22,6 +22,7 @@
 #include "ClientNamenodeProtocol.pb.h"
 #include "Exception.h"
 #include "ExceptionInternal.h"
+#include "Metrics.h"
 #include "Namenode.h"
 #include "NamenodeImpl.h"
 #include "rpc/RpcCall.h"
@@ -38,7 +39,7 @@ namespace Hdfs {
 namespace Internal {
 
 NamenodeImpl::NamenodeImpl(const char * host, const char * port, const std::string & tokenService,
-                           const SessionConfig & c, const RpcAuth & a) :
+                           const RpcConfig & c, const RpcAuth & a) :
     auth(a), client(RpcClient::getClient()), conf(c), protocol(
         NAMENODE_VERSION, NAMENODE_PROTOCOL, DELEGATION_TOKEN_KIND), server(tokenService, host, port) {
 }
@@ -46,11 +47,17 @@ NamenodeImpl::NamenodeImpl(const char * host, const char * port, const std::stri
 NamenodeImpl::~NamenodeImpl() {
 }
 
-void NamenodeImpl::invoke(const RpcCall & call) {
-    RpcChannel & channel = client.getChannel(auth, protocol, server, conf);
+void NamenodeImpl::invoke(const RpcCall & call, bool bulk) {
+    RpcChannel & channel = client.getChannel(auth, protocol, server, conf, bulk);
 
     try {
-        channel.invoke(call);
+        if (alignment) {
+            RpcCall aligned(call);
+            aligned.setAlignmentContext(alignment);
+            channel.invoke(aligned);
+        } else {
+            channel.invoke(call);
+        }
     } catch (...) {
         channel.close(false);
         throw;
@@ -59,6 +66,170 @@ void NamenodeImpl::invoke(const RpcCall & call) {
     channel.close(false);
 }
 
+/*
+ * A call sent without waiting for the response, holds a reference
+ * to the channel until the caller waited for it or gave up.
+ */
+class PendingCall {
+public:
+    PendingCall(RpcChannel & channel, shared_ptr<AlignmentContext> alignment) :
+        channel(&channel), alignment(alignment), start(Metrics::Now()) {
+    }
+
+    ~PendingCall() {
+        if (channel) {
+            if (remote) {
+                remote->discard();
+            }
+
+            channel->close(false);
+        }
+    }
+
+    void send(const RpcCall & call) {
+        RpcCall aligned(call);
+        aligned.setAlignmentContext(alignment);
+        remote = channel->invokeAsync(aligned);
+    }
+
+    void wait() {
+        if (channel) {
+            RpcChannel * c = channel;
+            channel = NULL;
+
+            try {
+                c->wait(remote);
+            } catch (...) {
+                error = current_exception();
+            }
+
+            c->close(false);
+            Metrics::Record(METRIC_RPC_LATENCY, Metrics::Now() - start);
+        }
+
+        if (error) {
+            rethrow_exception(error);
+        }
+    }
+
+private:
+    PendingCall(const PendingCall & other);
+    PendingCall & operator =(const PendingCall & other);
+
+    RpcChannel * channel;
+    shared_ptr<AlignmentContext> alignment;
+    RpcRemoteCallPtr remote;
+    exception_ptr error;
+    int64_t start;
+};
+
+static void BuildListingRequest(GetListingRequestProto & request, const std::string & src,
+                                const std::string & startAfter, bool needLocation) {
+    request.set_src(src);
+    size_t pos = startAfter.find_last_of("/");
+
+    if (pos != startAfter.npos && pos != startAfter.length() - 1) {
+        request.set_startafter(startAfter.c_str() + pos + 1);
+    } else {
+        request.set_startafter(startAfter);
+    }
+
+    request.set_needlocation(needLocation);
+}
+
+static bool ConvertListing(const std::string & src, const GetListingResponseProto & response,
+                           std::vector<FileStatus> & dl) {
+    if (response.has_dirlist()) {
+        const DirectoryListingProto & lists = response.dirlist();
+        Convert(src, dl, lists);
+        return lists.remainingentries() > 0;
+    }
+
+    THROW(FileNotFoundException, "%s not found.", src.c_str());
+}
+
+static FileStatus ConvertFileInfo(const std::string & src, const GetFileInfoResponseProto & response,
+                                  bool * exist) {
+    FileStatus retval;
+
+    if (response.has_fs()) {
+        Convert(src, retval, response.fs());
+        retval.setPath(src.c_str());
+
+        if (exist) {
+            *exist = true;
+        }
+
+        return retval;
+    }
+
+    if (!exist) {
+        THROW(FileNotFoundException, "Path %s does not exist.", src.c_str());
+    }
+
+    *exist = false;
+    return retval;
+}
+
+class ListingCall: public ListingFuture {
+public:
+    ListingCall(RpcChannel & channel, shared_ptr<AlignmentContext> alignment, const std::string & src,
+                const std::string & startAfter, bool needLocation) :
+        src(src), pending(channel, alignment) {
+        BuildListingRequest(request, src, startAfter, needLocation);
+        pending.send(RpcCall(true, "getListing", &request, &response));
+    }
+
+    bool get(std::vector<FileStatus> & dl) {
+        try {
+            pending.wait();
+            return ConvertListing(src, response, dl);
+        } catch (const HdfsRpcServerException & e) {
+            UnWrapper < FileNotFoundException,
+                      UnresolvedLinkException, HdfsIOException > unwrapper(e);
+            unwrapper.unwrap(__FILE__, __LINE__);
+        }
+
+        return false;
+    }
+
+private:
+    GetListingRequestProto request;
+    GetListingResponseProto response;
+    std::string src;
+    // last, the call must be abandoned before the response is destroyed
+    PendingCall pending;
+};
+
+class FileInfoCall: public FileInfoFuture {
+public:
+    FileInfoCall(RpcChannel & channel, shared_ptr<AlignmentContext> alignment, const std::string & src) :
+        src(src), pending(channel, alignment) {
+        request.set_src(src);
+        pending.send(RpcCall(true, "getFileInfo", &request, &response));
+    }
+
+    FileStatus get(bool *exist) {
+        try {
+            pending.wait();
+            return ConvertFileInfo(src, response, exist);
+        } catch (const HdfsRpcServerException & e) {
+            UnWrapper < FileNotFoundException,
+                      UnresolvedLinkException, HdfsIOException > unwrapper(e);
+            unwrapper.unwrap(__FILE__, __LINE__);
+        }
+
+        return FileStatus();
+    }
+
+private:
+    GetFileInfoRequestProto request;
+    GetFileInfoResponseProto response;
+    std::string src;
+    // last, the call must be abandoned before the response is destroyed
+    PendingCall pending;
+};
+
 //Idempotent
 void NamenodeImpl::getBlockLocations(const std::string & src, int64_t offset,
                                      int64_t length, LocatedBlocks & lbs) /* throw (AccessControlException,
@@ -69,7 +240,7 @@ void NamenodeImpl::getBlockLocations(const std::string & src, int64_t offset,
         request.set_length(length);
         request.set_offset(offset);
         request.set_src(src);
-        invoke(RpcCall(true, "getBlockLocations", &request, &response));
+        invoke(RpcCall(true, "getBlockLocations", &request, &response), true);
         Convert(lbs, response.locations());
     } catch (const HdfsRpcServerException & e) {
         UnWrapper < FileNotFoundException,
@@ -226,7 +397,8 @@ void NamenodeImpl::abandonBlock(const ExtendedBlock & b,
 
 shared_ptr<LocatedBlock> NamenodeImpl::addBlock(const std::string & src,
         const std::string & clientName, const ExtendedBlock * previous,
-        const std::vector<DatanodeInfo> & excludeNodes)
+        const std::vector<DatanodeInfo> & excludeNodes,
+        const std::vector<std::string> & favoredNodes)
 /* throw (FileNotFoundException,
  NotReplicatedYetException,
  UnresolvedLinkException, HdfsIOException) */{
@@ -244,6 +416,10 @@ shared_ptr<LocatedBlock> NamenodeImpl::addBlock(const std::string & src,
             Build(excludeNodes, request.mutable_excludenodes());
         }
 
+        for (size_t i = 0; i < favoredNodes.size(); ++i) {
+            request.add_favorednodes(favoredNodes[i]);
+        }
+
         invoke(RpcCall(true, "addBlock", &request, &response));
         return Convert(response.block());
     } catch (const HdfsRpcServerException & e) {
@@ -337,20 +513,24 @@ bool NamenodeImpl::rename(const std::string & src, const std::string & dst)
     }
 }
 
-/*void NamenodeImpl::concat(const std::string & trg,
-                          const std::vector<std::string> & srcs)  throw (UnresolvedLinkException,
-         HdfsIOException) {
+void NamenodeImpl::concat(const std::string & trg,
+                          const std::vector<std::string> & srcs)
+/* throw (HdfsIOException, UnresolvedLinkException) */{
     try {
         ConcatRequestProto request;
         ConcatResponseProto response;
         request.set_trg(trg);
-        Build(srcs, request.mutable_srcs());
+
+        for (size_t i = 0; i < srcs.size(); ++i) {
+            request.add_srcs(srcs[i]);
+        }
+
         invoke(RpcCall(false, "concat", &request, &response));
     } catch (const HdfsRpcServerException & e) {
         UnWrapper<UnresolvedLinkException, HdfsIOException> unwrapper(e);
         unwrapper.unwrap(__FILE__, __LINE__);
     }
-}*/
+}
 
 bool NamenodeImpl::truncate(const std::string & src, int64_t size,
                             const std::string & clientName)
@@ -451,25 +631,9 @@ bool NamenodeImpl::getListing(const std::string & src,
     try {
         GetListingRequestProto request;
         GetListingResponseProto response;
-        request.set_src(src);
-        size_t pos = startAfter.find_last_of("/");
-
-        if (pos != startAfter.npos && pos != startAfter.length() - 1) {
-            request.set_startafter(startAfter.c_str() + pos + 1);
-        } else {
-            request.set_startafter(startAfter);
-        }
-
-        request.set_needlocation(needLocation);
-        invoke(RpcCall(true, "getListing", &request, &response));
-
-        if (response.has_dirlist()) {
-            const DirectoryListingProto & lists = response.dirlist();
-            Convert(src, dl, lists);
-            return lists.remainingentries() > 0;
-        }
-
-        THROW(FileNotFoundException, "%s not found.", src.c_str());
+        BuildListingRequest(request, src, startAfter, needLocation);
+        invoke(RpcCall(true, "getListing", &request, &response), true);
+        return ConvertListing(src, response, dl);
     } catch (const HdfsRpcServerException & e) {
         UnWrapper < FileNotFoundException,
                   UnresolvedLinkException, HdfsIOException > unwrapper(e);
@@ -477,6 +641,14 @@ bool NamenodeImpl::getListing(const std::string & src,
     }
 }
 
+//Idempotent
+shared_ptr<ListingFuture> NamenodeImpl::getListingAsync(const std::string & src,
+        const std::string & startAfter, bool needLocation) {
+    return shared_ptr<ListingFuture>(new ListingCall(
+        client.getChannel(auth, protocol, server, conf, true), alignment, src, startAfter,
+        needLocation));
+}
+
 //Idempotent
 void NamenodeImpl::renewLease(const std::string & clientName)
 /* throw (HdfsIOException) */{
@@ -551,37 +723,25 @@ std::vector<int64_t> NamenodeImpl::getFsStats() { /* throw (HdfsIOException) */
 FileStatus NamenodeImpl::getFileInfo(const std::string & src, bool *exist)
 /* throw (FileNotFoundException,
  UnresolvedLinkException, HdfsIOException) */{
-    FileStatus retval;
-
     try {
         GetFileInfoRequestProto request;
         GetFileInfoResponseProto response;
         request.set_src(src);
         invoke(RpcCall(true, "getFileInfo", &request, &response));
-
-        if (response.has_fs()) {
-            Convert(src, retval, response.fs());
-            retval.setPath(src.c_str());
-
-            if (exist) {
-                *exist = true;
-            }
-
-            return retval;
-        }
-
-        if (!exist) {
-            THROW(FileNotFoundException, "Path %s does not exist.", src.c_str());
-        }
-
-        *exist = false;
+        return ConvertFileInfo(src, response, exist);
     } catch (const HdfsRpcServerException & e) {
         UnWrapper < FileNotFoundException,
                   UnresolvedLinkException, HdfsIOException > unwrapper(e);
         unwrapper.unwrap(__FILE__, __LINE__);
     }
 
-    return retval;
+    return FileStatus();
+}
+
+//Idempotent
+shared_ptr<FileInfoFuture> NamenodeImpl::getFileInfoAsync(const std::string & src) {
+    return shared_ptr<FileInfoFuture>(new FileInfoCall(
+        client.getChannel(auth, protocol, server, conf, false), alignment, src));
 }
 
 //Idempotent
@@ -851,7 +1011,7 @@ bool NamenodeImpl::listEncryptionZones(const int64_t id, std::vector<EncryptionZ
         ListEncryptionZonesRequestProto request;
         ListEncryptionZonesResponseProto response;
         request.set_id(id);
-        invoke(RpcCall(true, "listEncryptionZones", &request, &response));
+        invoke(RpcCall(true, "listEncryptionZones", &request, &response), true);
 
         if (response.zones_size() != 0) {
             Convert(ezl, response);
@@ -865,5 +1025,16 @@ bool NamenodeImpl::listEncryptionZones(const int64_t id, std::vector<EncryptionZ
     }
 }
 
+void NamenodeImpl::msync() /* throw (HdfsIOException) */{
+    try {
+        MsyncRequestProto request;
+        MsyncResponseProto response;
+        invoke(RpcCall(true, "msync", &request, &response));
+    } catch (const HdfsRpcServerException & e) {
+        UnWrapper<HdfsIOException> unwrapper(e);
+        unwrapper.unwrap(__FILE__, __LINE__);
+    }
+}
+
 }
 }
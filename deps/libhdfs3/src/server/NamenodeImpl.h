@@ -23,13 +23,14 @@
 #define _HDFS_LIBHDFS3_SERVER_NAMENODEIMPL_H_
 
 #include "Namenode.h"
+#include "rpc/AlignmentContext.h"
 
 namespace Hdfs {
 namespace Internal {
 
 class NamenodeImpl: public Namenode {
 public:
-    NamenodeImpl(const char * host, const char * port, const std::string & tokenService, const SessionConfig & c,
+    NamenodeImpl(const char * host, const char * port, const std::string & tokenService, const RpcConfig & c,
                  const RpcAuth & a);
 
     ~NamenodeImpl();
@@ -78,7 +79,8 @@ public:
 
     shared_ptr<LocatedBlock> addBlock(const std::string & src, const std::string & clientName,
                                       const ExtendedBlock * previous,
-                                      const std::vector<DatanodeInfo> & excludeNodes)
+                                      const std::vector<DatanodeInfo> & excludeNodes,
+                                      const std::vector<std::string> & favoredNodes)
     /* throw (AccessControlException, FileNotFoundException,
      NotReplicatedYetException, SafeModeException,
      UnresolvedLinkException, HdfsIOException) */;
@@ -141,6 +143,10 @@ public:
     /* throw (AccessControlException, FileNotFoundException,
      UnresolvedLinkException, HdfsIOException) */;
 
+    //Idempotent
+    shared_ptr<ListingFuture> getListingAsync(const std::string & src,
+            const std::string & startAfter, bool needLocation);
+
     //Idempotent
     void renewLease(const std::string & clientName)
     /* throw (AccessControlException, HdfsIOException) */;
@@ -159,6 +165,9 @@ public:
     /* throw (AccessControlException, FileNotFoundException,
      UnresolvedLinkException, HdfsIOException) */;
 
+    //Idempotent
+    shared_ptr<FileInfoFuture> getFileInfoAsync(const std::string & src);
+
     //Idempotent
     FileStatus getFileLinkInfo(const std::string & src)
     /* throw (AccessControlException, UnresolvedLinkException,
@@ -226,9 +235,24 @@ public:
     bool listEncryptionZones(const int64_t id, std::vector<EncryptionZoneInfo> & ezl);
     /* throw (AccessControlException, UnresolvedLinkException, HdfsIOException) */ 
 
+    void msync() /* throw (HdfsIOException) */;
+
+    /**
+     * Send the last seen state id with every call and track the state id
+     * of the responses, used when reads may go to observer namenodes.
+     * @param alignment the context shared by all namenodes of the cluster.
+     */
+    void setAlignmentContext(shared_ptr<AlignmentContext> alignment) {
+        this->alignment = alignment;
+    }
 
 private:
-    void invoke(const RpcCall & call);
+    /**
+     * Invoke a call on a channel to the namenode.
+     * @param call The call to invoke.
+     * @param bulk The response may be large, use the bulk channels if configured.
+     */
+    void invoke(const RpcCall & call, bool bulk = false);
 
 private:
     RpcAuth auth;
@@ -236,6 +260,7 @@ private:
     RpcConfig conf;
     RpcProtocolInfo protocol;
     RpcServerInfo server;
+    shared_ptr<AlignmentContext> alignment;
 
 };
 
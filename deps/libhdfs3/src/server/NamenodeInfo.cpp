@@ -37,6 +37,7 @@ const char * DFS_NAMESERVICES = "dfs.nameservices";
 const char * DFS_NAMENODE_HA = "dfs.ha.namenodes";
 const char * DFS_NAMENODE_RPC_ADDRESS_KEY = "dfs.namenode.rpc-address";
 const char * DFS_NAMENODE_HTTP_ADDRESS_KEY = "dfs.namenode.http-address";
+const char * DFS_CLIENT_OBSERVER_NAMENODES = "dfs.client.observer.namenodes";
 
 std::vector<NamenodeInfo> NamenodeInfo::GetHANamenodeInfo(
     const std::string & service, const Config & conf) {
@@ -59,4 +60,29 @@ std::vector<NamenodeInfo> NamenodeInfo::GetHANamenodeInfo(
 
     return retval;
 }
+
+std::vector<NamenodeInfo> NamenodeInfo::GetObserverNamenodeInfo(
+    const std::string & service, const Config & conf) {
+    std::vector<NamenodeInfo> retval;
+    std::string strObservers = StringTrim(
+                                   conf.getString(std::string(DFS_CLIENT_OBSERVER_NAMENODES) + "." + service, ""));
+
+    if (strObservers.empty()) {
+        return retval;
+    }
+
+    std::vector<std::string> nns = StringSplit(strObservers, ",");
+    retval.resize(nns.size());
+
+    for (size_t i = 0; i < nns.size(); ++i) {
+        std::string dfsRpcAddress = std::string(DFS_NAMENODE_RPC_ADDRESS_KEY) + "." + service + "."
+                                    + StringTrim(nns[i]);
+        std::string dfsHttpAddress = std::string(DFS_NAMENODE_HTTP_ADDRESS_KEY) + "." + service + "."
+                                     + StringTrim(nns[i]);
+        retval[i].setRpcAddr(StringTrim(conf.getString(dfsRpcAddress, "")));
+        retval[i].setHttpAddr(StringTrim(conf.getString(dfsHttpAddress, "")));
+    }
+
+    return retval;
+}
 }
@@ -51,6 +51,12 @@ public:
 
     static std::vector<NamenodeInfo> GetHANamenodeInfo(const std::string & service, const Config & conf);
 
+    /**
+     * Get the observer namenodes of a name service, listed by id in
+     * dfs.client.observer.namenodes.<service>.
+     */
+    static std::vector<NamenodeInfo> GetObserverNamenodeInfo(const std::string & service, const Config & conf);
+
 private:
     std::string rpc_addr;
     std::string http_addr;
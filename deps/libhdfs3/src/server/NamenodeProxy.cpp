@@ -22,129 +22,220 @@
 #include "Exception.h"
 #include "ExceptionInternal.h"
 #include "Logger.h"
+#include "Metrics.h"
 #include "NamenodeImpl.h"
 #include "NamenodeProxy.h"
 #include "StringUtil.h"
 
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
 #include <string>
+#include <vector>
 
 #include <sys/fcntl.h>
 #include <sys/stat.h>
 #include <sys/types.h>
-#include <sys/file.h>
+#include <unistd.h>
 
 namespace Hdfs {
 namespace Internal {
 
-static uint32_t GetInitNamenodeIndex(const std::string id) {
-    std::string path = "/tmp/";
-    path += id;
-    int fd;
-    uint32_t index = 0;
-    /*
-     * try create the file
-     */
-    fd = open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0666);
+/*
+ * The address of the last active Namenode of a cluster is kept in a small file
+ * shared by the processes of the user on the host, so a new client starts with
+ * the active Namenode instead of failing over again. The files live in a
+ * directory of the user, which nobody else can write, so a shared hint dir
+ * such as /tmp cannot be used to plant hints or links.
+ */
+static std::string GetHintPath(const std::string & dir, const std::string & id) {
+    if (dir.empty()) {
+        return "";
+    }
 
-    if (fd < 0) {
-        if (errno == EEXIST) {
-            /*
-             * the file already exist, try to open it
-             */
-            fd = open(path.c_str(), O_RDONLY);
-        } else {
-            /*
-             * failed to create, do not care why
-             */
-            return 0;
-        }
-    } else {
-        if (0 != flock(fd, LOCK_EX)) {
-            /*
-             * failed to lock
-             */
-            close(fd);
-            return index;
+    std::string name = id;
+
+    for (size_t i = 0; i < name.size(); ++i) {
+        if (!isalnum(name[i]) && name[i] != '.' && name[i] != '-' && name[i] != '_') {
+            name[i] = '_';
         }
+    }
+
+    std::stringstream ss;
+    ss.imbue(std::locale::classic());
+    ss << dir << "/libhdfs3-" << geteuid() << "/active-" << name;
+    return ss.str();
+}
+
+static std::string GetHintDir(const std::string & path) {
+    return path.substr(0, path.rfind('/'));
+}
 
+/*
+ * Only use a directory owned by the user which is not writable by others.
+ */
+static bool CheckHintDir(const std::string & dir) {
+    struct stat st;
+
+    if (lstat(dir.c_str(), &st) < 0) {
+        return false;
+    }
+
+    return S_ISDIR(st.st_mode) && st.st_uid == geteuid() && (st.st_mode & (S_IWGRP | S_IWOTH)) == 0;
+}
+
+static std::string GetActiveNamenodeHint(const std::string & path) {
+    char buffer[256];
+
+    if (path.empty() || !CheckHintDir(GetHintDir(path))) {
+        return "";
+    }
+
+    int fd = open(path.c_str(), O_RDONLY | O_NOFOLLOW);
+
+    if (fd < 0) {
         /*
-         * created file, initialize it with 0
+         * no hint yet, do not care why
          */
-        if (write(fd, &index, sizeof(index)) < 0) {
-          LOG(WARNING,
-              "NamenodeProxy: Failed to write current Namenode index into "
-              "cache file.");
-            /*
-             * ignore the failure.
-             */
-        }
+        return "";
+    }
 
-        flock(fd, LOCK_UN);
-        close(fd);
-        return index;
+    ssize_t size = read(fd, buffer, sizeof(buffer));
+    close(fd);
+    return size > 0 ? StringTrim(std::string(buffer, size)) : "";
+}
+
+static void SetActiveNamenodeHint(const std::string & path, const std::string & addr) {
+    if (path.empty()) {
+        return;
+    }
+
+    std::string dir = GetHintDir(path);
+
+    if (mkdir(dir.c_str(), 0700) < 0 && errno != EEXIST) {
+        LOG(WARNING, "NamenodeProxy: Failed to create the hint directory %s: %s.", dir.c_str(),
+            GetSystemErrorInfo(errno));
+        return;
+    }
+
+    if (!CheckHintDir(dir)) {
+        LOG(WARNING, "NamenodeProxy: Do not remember the active Namenode, hint directory %s "
+            "is not a private directory of the user.", dir.c_str());
+        return;
     }
 
     /*
-     * the file exist, read it.
+     * write a private file and rename it over the hint,
+     * so a reader never sees a partial address.
      */
+    std::vector<char> tmp(path.begin(), path.end());
+    const char * suffix = ".XXXXXX";
+    tmp.insert(tmp.end(), suffix, suffix + strlen(suffix) + 1);
+    int fd = mkstemp(&tmp[0]);
+
     if (fd >= 0) {
-        if (0 != flock(fd, LOCK_SH)) {
-            /*
-             * failed to lock
-             */
-            close(fd);
-            return index;
-        }
+        bool written = write(fd, addr.c_str(), addr.size()) == static_cast<ssize_t>(addr.size());
+        close(fd);
 
-        if (sizeof(index) != read(fd, &index, sizeof(index))) {
-            /*
-             * failed to read, do not care why
-             */
-            index = 0;
+        if (written && 0 == rename(&tmp[0], path.c_str())) {
+            return;
         }
 
-        flock(fd, LOCK_UN);
-        close(fd);
+        unlink(&tmp[0]);
     }
 
-    return index;
-}
-
-static void SetInitNamenodeIndex(const std::string & id, uint32_t index) {
-    std::string path = "/tmp/";
-    path += id;
-    int fd;
     /*
-     * try open the file for write
+     * ignore the failure.
      */
-    fd = open(path.c_str(), O_WRONLY);
-
-    if (fd > 0) {
-        if (0 != flock(fd, LOCK_EX)) {
-            /*
-             * failed to lock
-             */
-            close(fd);
-            return;
-        }
+    LOG(WARNING, "NamenodeProxy: Failed to write the active Namenode into hint file %s.", path.c_str());
+}
 
-        if (write(fd, &index, sizeof(index)) < 0) {
-            LOG(WARNING,
-                "NamenodeProxy: Failed to write current Namenode index into "
-                "cache file.");
-            /*
-             * ignore the failure.
-             */
+/*
+ * One round of probes, shared with the probe threads which may outlive it.
+ */
+struct NamenodeProbe {
+    NamenodeProbe() :
+        pending(0), active(-1) {
+    }
+
+    mutex mut;
+    condition_variable cond;
+    int pending;
+    int active;
+};
+
+static void ProbeNamenode(shared_ptr<NamenodeProbe> probe, shared_ptr<Namenode> namenode, int index) {
+    bool active = false;
+
+    try {
+        /*
+         * a standby Namenode rejects it.
+         */
+        namenode->getFsStats();
+        active = true;
+    } catch (...) {
+    }
+
+    lock_guard<mutex> lock(probe->mut);
+    --probe->pending;
+
+    if (active && probe->active < 0) {
+        probe->active = index;
+    }
+
+    probe->cond.notify_all();
+}
+
+static shared_ptr<NamenodeImpl> CreateNamenode(const NamenodeInfo & info, const std::string & clusterid,
+        const RpcConfig & conf, const RpcAuth & auth, shared_ptr<AlignmentContext> alignment) {
+    std::vector<std::string> nninfo = StringSplit(info.getRpcAddr(), ":");
+
+    if (nninfo.size() != 2) {
+        THROW(InvalidParameter, "Cannot create namenode proxy, %s does not contain host or port",
+              info.getRpcAddr().c_str());
+    }
+
+    shared_ptr<NamenodeImpl> retval(new NamenodeImpl(nninfo[0].c_str(), nninfo[1].c_str(), clusterid, conf, auth));
+    retval->setAlignmentContext(alignment);
+    return retval;
+}
+
+static bool IsObserver(const NamenodeInfo & info, const std::vector<NamenodeInfo> & observerInfos) {
+    for (size_t i = 0; i < observerInfos.size(); ++i) {
+        if (observerInfos[i].getRpcAddr() == info.getRpcAddr()) {
+            return true;
         }
-        flock(fd, LOCK_UN);
-        close(fd);
     }
+
+    return false;
 }
 
-NamenodeProxy::NamenodeProxy(const std::vector<NamenodeInfo> & namenodeInfos, const std::string & tokenService,
+NamenodeProxy::NamenodeProxy(const std::vector<NamenodeInfo> & namenodeInfos,
+                             const std::vector<NamenodeInfo> & observerInfos, const std::string & tokenService,
                              const SessionConfig & c, const RpcAuth & a) :
-    clusterid(tokenService), currentNamenode(0) {
-    if (namenodeInfos.size() == 1) {
+    clusterid(tokenService), currentNamenode(0), hintPath(GetHintPath(c.getFailoverHintDir(), tokenService)),
+    observerReads(!observerInfos.empty()), msynced(false),
+    observerBackoff(c.getObserverBackoff()), observerMsyncPeriod(c.getObserverMsyncPeriod()), nextObserver(0) {
+    std::vector<NamenodeInfo> activeInfos;
+
+    /*
+     * an observer rejects writes, do not fail over to it
+     * unless nothing else is configured.
+     */
+    for (size_t i = 0; i < namenodeInfos.size(); ++i) {
+        if (!IsObserver(namenodeInfos[i], observerInfos)) {
+            activeInfos.push_back(namenodeInfos[i]);
+        }
+    }
+
+    if (activeInfos.empty()) {
+        activeInfos = namenodeInfos;
+    }
+
+    if (activeInfos.size() == 1) {
         enableNamenodeHA = false;
         maxNamenodeHARetry = 0;
     } else {
@@ -152,25 +243,70 @@ NamenodeProxy::NamenodeProxy(const std::vector<NamenodeInfo> & namenodeInfos, co
         maxNamenodeHARetry = c.getRpcMaxHaRetry();
     }
 
-    for (size_t i = 0; i < namenodeInfos.size(); ++i) {
-        std::vector<std::string> nninfo = StringSplit(namenodeInfos[i].getRpcAddr(), ":");
+    if (!observerInfos.empty()) {
+        alignment = shared_ptr<AlignmentContext>(new AlignmentContext);
+    }
+
+    for (size_t i = 0; i < activeInfos.size(); ++i) {
+        namenodes.push_back(CreateNamenode(activeInfos[i], clusterid, c, a, alignment));
+        namenodeAddrs.push_back(activeInfos[i].getRpcAddr());
+    }
+
+    /*
+     * probes must not wait long for a Namenode which is down.
+     */
+    int probeTimeout = c.getFailoverProbeTimeout();
+
+    if (enableNamenodeHA && probeTimeout > 0) {
+        RpcConfig probeConf(c);
+        probeConf.setMaxRetryOnConnect(1);
+        probeConf.setRpcTimeout(probeTimeout);
+
+        if (probeConf.getConnectTimeout() > probeTimeout) {
+            probeConf.setConnectTimeout(probeTimeout);
+        }
+
+        for (size_t i = 0; i < activeInfos.size(); ++i) {
+            probes.push_back(CreateNamenode(activeInfos[i], clusterid, probeConf, a, shared_ptr<AlignmentContext>()));
+        }
+    }
+
+    /*
+     * a slow observer must not hold a read for long, the read goes to the active instead.
+     */
+    RpcConfig observerConf(c);
+    int timeout = c.getObserverReadTimeout();
+    observerConf.setMaxRetryOnConnect(1);
+
+    if (timeout > 0) {
+        observerConf.setRpcTimeout(timeout);
 
-        if (nninfo.size() != 2) {
-            THROW(InvalidParameter, "Cannot create namenode proxy, %s does not contain host or port",
-                  namenodeInfos[i].getRpcAddr().c_str());
+        if (observerConf.getConnectTimeout() > timeout) {
+            observerConf.setConnectTimeout(timeout);
         }
+    }
 
-        namenodes.push_back(
-            shared_ptr<Namenode>(
-                new NamenodeImpl(nninfo[0].c_str(), nninfo[1].c_str(), clusterid, c, a)));
+    for (size_t i = 0; i < observerInfos.size(); ++i) {
+        Observer observer;
+        observer.namenode = CreateNamenode(observerInfos[i], clusterid, observerConf, a, alignment);
+        observer.index = i;
+        observers.push_back(observer);
     }
 
     if (enableNamenodeHA) {
-        currentNamenode = GetInitNamenodeIndex(clusterid) % namenodeInfos.size();
+        std::string hint = GetActiveNamenodeHint(hintPath);
+
+        for (size_t i = 0; i < namenodeAddrs.size(); ++i) {
+            if (namenodeAddrs[i] == hint) {
+                currentNamenode = i;
+            }
+        }
     }
 }
 
 NamenodeProxy::~NamenodeProxy() {
+    lock_guard<mutex> lock(failoverMut);
+    joinProbes();
 }
 
 shared_ptr<Namenode> NamenodeProxy::getActiveNamenode(uint32_t & oldValue) {
@@ -184,17 +320,85 @@ shared_ptr<Namenode> NamenodeProxy::getActiveNamenode(uint32_t & oldValue) {
     return namenodes[currentNamenode % namenodes.size()];
 }
 
-void NamenodeProxy::failoverToNextNamenode(uint32_t oldValue) {
-    lock_guard<mutex> lock(mut);
+void NamenodeProxy::joinProbes() {
+    for (size_t i = 0; i < probeThreads.size(); ++i) {
+        probeThreads[i]->join();
+    }
 
-    if (oldValue != currentNamenode) {
-        //already failover in another thread.
-        return;
+    probeThreads.clear();
+}
+
+int NamenodeProxy::probeNamenodes(uint32_t current) {
+    if (probes.empty()) {
+        return -1;
     }
 
-    ++currentNamenode;
-    currentNamenode = currentNamenode % namenodes.size();
-    SetInitNamenodeIndex(clusterid, currentNamenode);
+    /*
+     * the threads of the last round have finished, or will
+     * finish within the probe timeout.
+     */
+    if (lastProbe) {
+        lock_guard<mutex> lock(lastProbe->mut);
+
+        if (lastProbe->pending == 0) {
+            joinProbes();
+        }
+    }
+
+    shared_ptr<NamenodeProbe> probe(new NamenodeProbe);
+    probe->pending = static_cast<int>(probes.size()) - 1;
+    lastProbe = probe;
+
+    for (size_t i = 0; i < probes.size(); ++i) {
+        if (i != current) {
+            shared_ptr<thread> prober(new thread);
+            CREATE_THREAD(*prober, bind(&ProbeNamenode, probe, probes[i], static_cast<int>(i)));
+            probeThreads.push_back(prober);
+        }
+    }
+
+    unique_lock<mutex> lock(probe->mut);
+
+    while (probe->active < 0 && probe->pending > 0) {
+        probe->cond.wait(lock);
+    }
+
+    return probe->active;
+}
+
+bool NamenodeProxy::failoverToNextNamenode(uint32_t oldValue) {
+    /*
+     * one thread probes, the others wait for its result.
+     */
+    lock_guard<mutex> failoverLock(failoverMut);
+    uint32_t next;
+
+    {
+        lock_guard<mutex> lock(mut);
+
+        if (oldValue != currentNamenode || namenodes.empty()) {
+            //already failover in another thread.
+            return false;
+        }
+
+        next = (currentNamenode + 1) % namenodes.size();
+    }
+
+    int active = probeNamenodes(oldValue);
+
+    if (active >= 0) {
+        next = active;
+        LOG(INFO, "NamenodeProxy: Namenode %s is active.", namenodeAddrs[next].c_str());
+    }
+
+    {
+        lock_guard<mutex> lock(mut);
+        currentNamenode = next;
+    }
+
+    Metrics::Add(METRIC_NAMENODE_FAILOVERS);
+    SetActiveNamenodeHint(hintPath, namenodeAddrs[next]);
+    return true;
 }
 
 static void HandleHdfsFailoverException(const HdfsFailoverException & e) {
@@ -208,6 +412,70 @@ static void HandleHdfsFailoverException(const HdfsFailoverException & e) {
     abort();
 }
 
+bool NamenodeProxy::prepareObserverRead() {
+    if (!observerReads) {
+        return false;
+    }
+
+    lock_guard<mutex> lock(msyncMut);
+
+    if (msynced && (observerMsyncPeriod < 0
+                    || ToMilliSeconds(lastMsync, steady_clock::now()) < observerMsyncPeriod)) {
+        return observerReads;
+    }
+
+    try {
+        msync();
+    } catch (const RpcNoSuchMethodException & e) {
+        LOG(WARNING, "NamenodeProxy: Namenode does not support msync, disable observer reads.");
+        observerReads = false;
+        return false;
+    }
+
+    msynced = true;
+    lastMsync = steady_clock::now();
+    return true;
+}
+
+void NamenodeProxy::getObserverNamenodes(std::vector<Observer> & candidates) {
+    lock_guard<mutex> lock(mut);
+    steady_clock::time_point now = steady_clock::now();
+    size_t start = nextObserver++;
+
+    for (size_t i = 0; i < observers.size(); ++i) {
+        const Observer & observer = observers[(start + i) % observers.size()];
+
+        if (observer.retryAfter <= now) {
+            candidates.push_back(observer);
+        }
+    }
+}
+
+void NamenodeProxy::skipObserver(size_t index, const HdfsException & e) {
+    Metrics::Add(METRIC_OBSERVER_FALLBACKS);
+
+    /*
+     * a stale observer catches up soon, try it again with the next read.
+     */
+    if (dynamic_cast<const NameNodeRetriableException *>(&e)
+            || dynamic_cast<const ObserverRetryOnActiveException *>(&e)) {
+        return;
+    }
+
+    {
+        lock_guard<mutex> lock(mut);
+
+        if (index >= observers.size()) {
+            return;
+        }
+
+        observers[index].retryAfter = steady_clock::now() + milliseconds(observerBackoff);
+    }
+
+    LOG(WARNING, "NamenodeProxy: skip observer Namenode for %d milliseconds: %s",
+        observerBackoff, e.what());
+}
+
 #define NAMENODE_HA_RETRY_BEGIN() \
     do { \
         int __count = 0; \
@@ -233,8 +501,45 @@ static void HandleHdfsFailoverException(const HdfsFailoverException & e) {
     } while (true); \
     } while (0)
 
+/*
+ * A read goes to the observers first. If an observer fails, is too slow or
+ * cannot catch up with the state id the client has seen, the read goes to
+ * the next observer and at last to the active Namenode.
+ */
+#define NAMENODE_OBSERVER_CATCH(proxy, index) \
+    catch (const NameNodeStandbyException & e) { \
+        (proxy).skipObserver(index, e); \
+    } catch (const NameNodeRetriableException & e) { \
+        (proxy).skipObserver(index, e); \
+    } catch (const HdfsFailoverException & e) { \
+        (proxy).skipObserver(index, e); \
+    } catch (const HdfsRpcException & e) { \
+        (proxy).skipObserver(index, e); \
+    }
+
+#define NAMENODE_OBSERVER_READ_BEGIN() \
+    do { \
+        std::vector<Observer> __observers; \
+        if (prepareObserverRead()) { \
+            getObserverNamenodes(__observers); \
+        } \
+        for (size_t __i = 0; __i < __observers.size(); ++__i) { \
+            shared_ptr<Namenode> namenode = __observers[__i].namenode; \
+            Metrics::Add(METRIC_OBSERVER_READS); \
+            try { \
+                (void)0
+
+#define NAMENODE_OBSERVER_READ_END() \
+            } NAMENODE_OBSERVER_CATCH(*this, __observers[__i].index) \
+        } \
+    } while (0)
+
 void NamenodeProxy::getBlockLocations(const std::string & src, int64_t offset,
                                       int64_t length, LocatedBlocks & lbs) {
+    NAMENODE_OBSERVER_READ_BEGIN();
+    namenode->getBlockLocations(src, offset, length, lbs);
+    return;
+    NAMENODE_OBSERVER_READ_END();
     NAMENODE_HA_RETRY_BEGIN();
     namenode->getBlockLocations(src, offset, length, lbs);
     NAMENODE_HA_RETRY_END();
@@ -288,9 +593,10 @@ void NamenodeProxy::abandonBlock(const ExtendedBlock & b,
 
 shared_ptr<LocatedBlock> NamenodeProxy::addBlock(const std::string & src,
         const std::string & clientName, const ExtendedBlock * previous,
-        const std::vector<DatanodeInfo> & excludeNodes) {
+        const std::vector<DatanodeInfo> & excludeNodes,
+        const std::vector<std::string> & favoredNodes) {
     NAMENODE_HA_RETRY_BEGIN();
-    return namenode->addBlock(src, clientName, previous, excludeNodes);
+    return namenode->addBlock(src, clientName, previous, excludeNodes, favoredNodes);
     NAMENODE_HA_RETRY_END();
     assert(!"should not reach here");
     return shared_ptr<LocatedBlock>();
@@ -333,14 +639,12 @@ bool NamenodeProxy::rename(const std::string & src, const std::string & dst) {
     return false;
 }
 
-/*
 void NamenodeProxy::concat(const std::string & trg,
                            const std::vector<std::string> & srcs) {
     NAMENODE_HA_RETRY_BEGIN();
     namenode->concat(trg, srcs);
     NAMENODE_HA_RETRY_END();
 }
-*/
 
 bool NamenodeProxy::truncate(const std::string & src, int64_t size,
                              const std::string & clientName) {
@@ -383,6 +687,9 @@ bool NamenodeProxy::mkdirs(const std::string & src, const Permission & masked,
 bool NamenodeProxy::getListing(const std::string & src,
                                const std::string & startAfter, bool needLocation,
                                std::vector<FileStatus> & dl) {
+    NAMENODE_OBSERVER_READ_BEGIN();
+    return namenode->getListing(src, startAfter, needLocation, dl);
+    NAMENODE_OBSERVER_READ_END();
     NAMENODE_HA_RETRY_BEGIN();
     return namenode->getListing(src, startAfter, needLocation, dl);
     NAMENODE_HA_RETRY_END();
@@ -390,6 +697,90 @@ bool NamenodeProxy::getListing(const std::string & src,
     return false;
 }
 
+/*
+ * The first attempt of an async call runs on the NameNode which was active
+ * when it was sent. If it has to fail over, the remaining attempts run
+ * synchronously with the usual retry limit. Only the call which actually
+ * switched the NameNode logs, a batch of calls fails over at once.
+ * A call sent to an observer falls back to a synchronous read.
+ */
+#define NAMENODE_HA_ASYNC_BEGIN() \
+    do { \
+        try { \
+            (void)0
+
+#define NAMENODE_HA_ASYNC_END() \
+        } catch (const NameNodeStandbyException & e) { \
+            if (!proxy.enableNamenodeHA) { \
+                throw; \
+            } \
+        } catch (const HdfsFailoverException & e) { \
+            if (!proxy.enableNamenodeHA) { \
+                HandleHdfsFailoverException(e); \
+            } \
+        } \
+        if (proxy.failoverToNextNamenode(oldValue)) { \
+            LOG(WARNING, "NamenodeProxy: Failover to another Namenode."); \
+        } \
+    } while (0)
+
+static const size_t NO_OBSERVER = static_cast<size_t>(-1);
+
+class ProxyListingFuture: public ListingFuture {
+public:
+    ProxyListingFuture(NamenodeProxy & proxy, uint32_t oldValue, size_t observer,
+                       shared_ptr<ListingFuture> future, const std::string & src,
+                       const std::string & startAfter, bool needLocation) :
+        needLocation(needLocation), proxy(proxy), oldValue(oldValue), observer(observer), future(future),
+        src(src), startAfter(startAfter) {
+    }
+
+    bool get(std::vector<FileStatus> & dl) {
+        if (observer != NO_OBSERVER) {
+            try {
+                return future->get(dl);
+            } NAMENODE_OBSERVER_CATCH(proxy, observer)
+        } else {
+            NAMENODE_HA_ASYNC_BEGIN();
+            return future->get(dl);
+            NAMENODE_HA_ASYNC_END();
+        }
+
+        return proxy.getListing(src, startAfter, needLocation, dl);
+    }
+
+private:
+    bool needLocation;
+    NamenodeProxy & proxy;
+    uint32_t oldValue;
+    size_t observer;
+    shared_ptr<ListingFuture> future;
+    std::string src;
+    std::string startAfter;
+};
+
+shared_ptr<ListingFuture> NamenodeProxy::getListingAsync(const std::string & src,
+        const std::string & startAfter, bool needLocation) {
+    std::vector<Observer> candidates;
+
+    if (prepareObserverRead()) {
+        getObserverNamenodes(candidates);
+    }
+
+    if (!candidates.empty()) {
+        Metrics::Add(METRIC_OBSERVER_READS);
+        return shared_ptr<ListingFuture>(new ProxyListingFuture(*this, 0, candidates[0].index,
+                                         candidates[0].namenode->getListingAsync(src, startAfter, needLocation),
+                                         src, startAfter, needLocation));
+    }
+
+    uint32_t oldValue = 0;
+    shared_ptr<Namenode> namenode = getActiveNamenode(oldValue);
+    return shared_ptr<ListingFuture>(new ProxyListingFuture(*this, oldValue, NO_OBSERVER,
+                                     namenode->getListingAsync(src, startAfter, needLocation),
+                                     src, startAfter, needLocation));
+}
+
 void NamenodeProxy::renewLease(const std::string & clientName) {
     NAMENODE_HA_RETRY_BEGIN();
     namenode->renewLease(clientName);
@@ -420,6 +811,9 @@ std::vector<int64_t> NamenodeProxy::getFsStats() {
 }*/
 
 FileStatus NamenodeProxy::getFileInfo(const std::string & src, bool *exist) {
+    NAMENODE_OBSERVER_READ_BEGIN();
+    return namenode->getFileInfo(src, exist);
+    NAMENODE_OBSERVER_READ_END();
     NAMENODE_HA_RETRY_BEGIN();
     return namenode->getFileInfo(src, exist);
     NAMENODE_HA_RETRY_END();
@@ -427,6 +821,54 @@ FileStatus NamenodeProxy::getFileInfo(const std::string & src, bool *exist) {
     return FileStatus();
 }
 
+class ProxyFileInfoFuture: public FileInfoFuture {
+public:
+    ProxyFileInfoFuture(NamenodeProxy & proxy, uint32_t oldValue, size_t observer,
+                        shared_ptr<FileInfoFuture> future, const std::string & src) :
+        proxy(proxy), oldValue(oldValue), observer(observer), future(future), src(src) {
+    }
+
+    FileStatus get(bool *exist) {
+        if (observer != NO_OBSERVER) {
+            try {
+                return future->get(exist);
+            } NAMENODE_OBSERVER_CATCH(proxy, observer)
+        } else {
+            NAMENODE_HA_ASYNC_BEGIN();
+            return future->get(exist);
+            NAMENODE_HA_ASYNC_END();
+        }
+
+        return proxy.getFileInfo(src, exist);
+    }
+
+private:
+    NamenodeProxy & proxy;
+    uint32_t oldValue;
+    size_t observer;
+    shared_ptr<FileInfoFuture> future;
+    std::string src;
+};
+
+shared_ptr<FileInfoFuture> NamenodeProxy::getFileInfoAsync(const std::string & src) {
+    std::vector<Observer> candidates;
+
+    if (prepareObserverRead()) {
+        getObserverNamenodes(candidates);
+    }
+
+    if (!candidates.empty()) {
+        Metrics::Add(METRIC_OBSERVER_READS);
+        return shared_ptr<FileInfoFuture>(new ProxyFileInfoFuture(*this, 0, candidates[0].index,
+                                          candidates[0].namenode->getFileInfoAsync(src), src));
+    }
+
+    uint32_t oldValue = 0;
+    shared_ptr<Namenode> namenode = getActiveNamenode(oldValue);
+    return shared_ptr<FileInfoFuture>(new ProxyFileInfoFuture(*this, oldValue, NO_OBSERVER,
+                                      namenode->getFileInfoAsync(src), src));
+}
+
 /*FileStatus NamenodeProxy::getFileLinkInfo(const std::string & src) {
     NAMENODE_HA_RETRY_BEGIN();
     return namenode->getFileLinkInfo(src);
@@ -522,6 +964,8 @@ void NamenodeProxy::cancelDelegationToken(const Token & token) {
 void NamenodeProxy::close() {
     lock_guard<mutex> lock(mut);
     namenodes.clear();
+    observers.clear();
+    probes.clear();
 }
 
 bool NamenodeProxy::createEncryptionZone(const std::string & src, const std::string & keyName) {
@@ -548,5 +992,11 @@ bool NamenodeProxy::listEncryptionZones(const int64_t id, std::vector<Encryption
     return false;
 }
 
+void NamenodeProxy::msync() {
+    NAMENODE_HA_RETRY_BEGIN();
+    namenode->msync();
+    NAMENODE_HA_RETRY_END();
+}
+
 }
 }
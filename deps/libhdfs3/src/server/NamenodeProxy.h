@@ -22,17 +22,28 @@
 #ifndef _HDFS_LIBHDFS3_SERVER_NAMENODEPROXY_H_
 #define _HDFS_LIBHDFS3_SERVER_NAMENODEPROXY_H_
 
+#include "Atomic.h"
+#include "DateTime.h"
 #include "Memory.h"
 #include "Namenode.h"
 #include "NamenodeInfo.h"
 #include "Thread.h"
+#include "rpc/AlignmentContext.h"
 
 namespace Hdfs {
 namespace Internal {
 
+struct NamenodeProbe;
+
 class NamenodeProxy: public Namenode {
 public:
-    NamenodeProxy(const std::vector<NamenodeInfo> & namenodeInfos, const std::string & tokenService,
+    /**
+     * Create a proxy of a cluster.
+     * @param namenodeInfos the active and standby namenodes.
+     * @param observerInfos the observer namenodes which serve reads, may be empty.
+     */
+    NamenodeProxy(const std::vector<NamenodeInfo> & namenodeInfos,
+                  const std::vector<NamenodeInfo> & observerInfos, const std::string & tokenService,
                   const SessionConfig & c, const RpcAuth & a);
     ~NamenodeProxy();
 
@@ -60,7 +71,8 @@ public:
 
     shared_ptr<LocatedBlock> addBlock(const std::string & src,
                                       const std::string & clientName, const ExtendedBlock * previous,
-                                      const std::vector<DatanodeInfo> & excludeNodes);
+                                      const std::vector<DatanodeInfo> & excludeNodes,
+                                      const std::vector<std::string> & favoredNodes);
 
     shared_ptr<LocatedBlock> getAdditionalDatanode(const std::string & src,
             const ExtendedBlock & blk,
@@ -99,6 +111,9 @@ public:
     bool getListing(const std::string & src, const std::string & startAfter,
                     bool needLocation, std::vector<FileStatus> & dl);
 
+    shared_ptr<ListingFuture> getListingAsync(const std::string & src,
+            const std::string & startAfter, bool needLocation);
+
     void renewLease(const std::string & clientName);
 
     bool recoverLease(const std::string & src, const std::string & clientName);
@@ -109,6 +124,8 @@ public:
 
     FileStatus getFileInfo(const std::string & src, bool *exist);
 
+    shared_ptr<FileInfoFuture> getFileInfoAsync(const std::string & src);
+
     FileStatus getFileLinkInfo(const std::string & src);
 
     void setQuota(const std::string & path, int64_t namespaceQuota,
@@ -145,10 +162,52 @@ public:
 
     bool listEncryptionZones(const int64_t id, std::vector<EncryptionZoneInfo> & ezl); 
 
+    void msync();
 
 private:
+    friend class ProxyListingFuture;
+    friend class ProxyFileInfoFuture;
+
+    struct Observer {
+        shared_ptr<Namenode> namenode;
+        steady_clock::time_point retryAfter;
+        size_t index;
+    };
+
     shared_ptr<Namenode> getActiveNamenode(uint32_t & oldValue);
-    void failoverToNextNamenode(uint32_t oldValue);
+
+    /**
+     * Switch to the active Namenode, probed on all other Namenodes at once.
+     * If none of them answers as active, switch to the next one.
+     * @param oldValue the Namenode which failed.
+     * @return false if another thread already switched.
+     */
+    bool failoverToNextNamenode(uint32_t oldValue);
+
+    /**
+     * @return the index of the first Namenode which answered as active, -1 if none.
+     */
+    int probeNamenodes(uint32_t current);
+    void joinProbes();
+
+    /**
+     * Msync with the active namenode if the configured period passed.
+     * @return false if reads must not go to observers.
+     */
+    bool prepareObserverRead();
+
+    /**
+     * Get the observers which are not backed off, starting from the next
+     * one in round robin order.
+     */
+    void getObserverNamenodes(std::vector<Observer> & candidates);
+
+    /**
+     * An observer failed a read, the caller tries the next one.
+     * @param index the observer.
+     * @param e why it failed, the observer is backed off unless it was only stale.
+     */
+    void skipObserver(size_t index, const HdfsException & e);
 
 private:
     bool enableNamenodeHA;
@@ -156,7 +215,30 @@ private:
     mutex mut;
     std::string clusterid;
     std::vector<shared_ptr<Namenode> > namenodes;
+    std::vector<std::string> namenodeAddrs;
     uint32_t currentNamenode;
+
+    /*
+     * failover probes
+     */
+    mutex failoverMut;
+    std::string hintPath;
+    shared_ptr<NamenodeProbe> lastProbe;
+    std::vector<shared_ptr<Namenode> > probes;
+    std::vector<shared_ptr<thread> > probeThreads;
+
+    /*
+     * observer reads
+     */
+    atomic<bool> observerReads;
+    bool msynced;
+    int observerBackoff;
+    int observerMsyncPeriod;
+    mutex msyncMut;
+    shared_ptr<AlignmentContext> alignment;
+    size_t nextObserver;
+    steady_clock::time_point lastMsync;
+    std::vector<Observer> observers;
 };
 
 }
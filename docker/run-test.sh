@@ -2,5 +2,5 @@
 
 /start-hadoop.sh && sleep 20
 
-npx mocha -t 0
+npx mocha -t 0 --expose-gc
 
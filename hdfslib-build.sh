@@ -12,5 +12,9 @@ if [[ "$platform" == 'Darwin' ]]; then
 fi
 ../../../deps/bootstrap --prefix=../dist $DEP || exit 1
 make && make install || exit 1
+## the fake cluster of the tests, e.g. NHDFS_BUILD_FAKE_CLUSTER=1 npm install
+if [[ -n "$NHDFS_BUILD_FAKE_CLUSTER" ]]; then
+   make hdfs-fake-cluster && mkdir -p ../dist/bin && cp fakecluster/hdfs-fake-cluster ../dist/bin/ || exit 1
+fi
 cd ../ || exit 1
 rm -fr build
\ No newline at end of file
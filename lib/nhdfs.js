@@ -19,6 +19,53 @@ const DEFAULT_SERVICE = "default";
 
 const HDFS_SITE = "hdfs-site.xml";
 
+/**
+ * Default size of a batch of records
+ */
+const DEFAULT_BATCH_BYTES = 1024 * 1024;
+
+/**
+ * Batches a split of scanParallel reads ahead of the split being delivered
+ */
+const MAX_SPLIT_BATCHES = 4;
+
+/**
+ * Attach the native timings of an operation as a non enumerable property.
+ */
+function withTimings(value, timings) {
+    if (timings && value !== null && typeof value === 'object') {
+        Object.defineProperty(value, 'timings', { value: timings, enumerable: false });
+    }
+    return value;
+}
+
+function positiveInteger(value, defaultValue) {
+    return Number.isInteger(value) && value > 0 ? value : defaultValue;
+}
+
+/**
+ * Byte value of the delimiter option of record reads, a one byte string or a number.
+ */
+function recordDelimiter(delimiter = '\n') {
+    const d = typeof delimiter === 'string' ? Buffer.from(delimiter) : [delimiter];
+    if (d.length !== 1 || !(d[0] >= 0 && d[0] < 256)) {
+        throw new Error('delimiter must be a single byte');
+    }
+    return d[0];
+}
+
+/**
+ * Pass the dropBehind and readahead options of a stream to the native reader or writer,
+ * options left out keep the hints of the FileSystem.
+ */
+function setCachingStrategy(native, options, readahead = true) {
+    const dropBehind = options.dropBehind === undefined || options.dropBehind === null ? -1 : (options.dropBehind ? 1 : 0);
+    const bytes = readahead && Number.isInteger(options.readahead) && options.readahead >= 0 ? options.readahead : -1;
+    if (dropBehind >= 0 || bytes >= 0) {
+        readahead ? native.SetCachingStrategy(dropBehind, bytes) : native.SetCachingStrategy(dropBehind);
+    }
+}
+
 function checkFile(filePath) {
     try {
         lfs.accessSync(filePath, lfs.constants.R_OK);
@@ -28,16 +75,28 @@ function checkFile(filePath) {
     }
 }
 
-function setConfPath(configurationPath, useHadoopConfEnv) {
+/**
+ * The configuration file of the native client: configurationPath, else LIBHDFS3_CONF, else
+ * hdfs-site.xml of HADOOP_CONF_DIR or HADOOP_INSTALL if useHadoopConfEnv. It is passed to the
+ * native client, which does not read the environment, so process.env is left alone.
+ */
+function confPath(configurationPath, useHadoopConfEnv) {
     if (configurationPath) {
-        process.env.LIBHDFS3_CONF = configurationPath;
-    } else if ((!process.env.LIBHDFS3_CONF) && useHadoopConfEnv) {
+        return configurationPath;
+    }
+    const env = process.env.LIBHDFS3_CONF;
+    if (env) {
+        // libhdfs3 skips a name= prefix
+        return env.substr(env.indexOf('=') + 1);
+    }
+    if (useHadoopConfEnv) {
         if (process.env.HADOOP_CONF_DIR && checkFile(`${process.env.HADOOP_CONF_DIR}/${HDFS_SITE}`)) {
-            process.env.LIBHDFS3_CONF = `${process.env.HADOOP_CONF_DIR}/${HDFS_SITE}`;
+            return `${process.env.HADOOP_CONF_DIR}/${HDFS_SITE}`;
         } else if (process.env.HADOOP_INSTALL && checkFile(`${process.env.HADOOP_INSTALL}/hadoop/conf/${HDFS_SITE}`)) {
-            process.env.LIBHDFS3_CONF = `${process.env.HADOOP_INSTALL}/hadoop/conf/${HDFS_SITE}`
+            return `${process.env.HADOOP_INSTALL}/hadoop/conf/${HDFS_SITE}`;
         }
     }
+    return '';
 }
 
 function getOptions(options, defaultOptions) {
@@ -50,6 +109,20 @@ function getOptions(options, defaultOptions) {
     return options;
 }
   
+const COPY_PRESERVE = { replication: 0x01, blockSize: 0x02, permission: 0x04, owner: 0x08, times: 0x10 };
+
+/**
+ * The hdfsCopyTree preserve flags of true, false or a list of attribute names.
+ */
+function copyPreserveFlags(preserve) {
+    if (preserve === true) return 0x1F;
+    if (!preserve) return 0;
+    return preserve.reduce((flags, name) => {
+        if (!(name in COPY_PRESERVE)) throw new TypeError(`Unknown attribute to preserve: ${name}`);
+        return flags | COPY_PRESERVE[name];
+    }, 0);
+}
+
 function copyObject(source) {
     var target = {};
     for (var key in source)
@@ -66,9 +139,42 @@ const createFS = (
         user = '',
         kerbTicketCachePath = '',
         authToken = '',
+        shared = false,
+        options = {} } = {}) => {
+    return new FileSystem({ service: service, port: port, user: user, kerbTicketCachePath: kerbTicketCachePath,
+        authToken: authToken, shared: shared, options: options, conf: confPath(configurationPath, useHadoopConfEnv) });
+}
+
+/**
+ * createFS which connects on a libuv thread instead of blocking the event loop
+ * while the configuration is parsed and the NameNode handshake runs.
+ * Takes the options of createFS.
+ * @return {Promise<FileSystem>}
+ */
+const createFSAsync = async (
+    {
+        service,
+        port,
+        configurationPath = '',
+        useHadoopConfEnv = true,
+        user = '',
+        kerbTicketCachePath = '',
+        authToken = '',
+        shared = false,
         options = {} } = {}) => {
-    setConfPath(configurationPath, useHadoopConfEnv);
-    return new FileSystem({ service: service, port: port, user: user, options: options });
+    const fs = new FileSystem({ service: service, port: port, user: user, kerbTicketCachePath: kerbTicketCachePath,
+        authToken: authToken, shared: shared, options: options, conf: confPath(configurationPath, useHadoopConfEnv),
+        deferred: true });
+    await new Promise((resolve, reject) => {
+        fs.fs.Connect((err) => {
+            if (err) {
+                reject(err);
+            } else {
+                resolve(fs);
+            }
+        });
+    });
+    return fs;
 }
 
 const createClusterInfo = (
@@ -76,14 +182,13 @@ const createClusterInfo = (
         configurationPath = '',
         useHadoopConfEnv = true,
     } = {}) => {
-    setConfPath(configurationPath, useHadoopConfEnv);
-    return new ClusterInfo();
+    return new ClusterInfo(confPath(configurationPath, useHadoopConfEnv));
 }
 
 class ClusterInfo {
 
-    constructor() {
-        this.ci = new NativeClusterInfo();
+    constructor(conf = '') {
+        this.ci = new NativeClusterInfo(conf);
     }
 
     /**
@@ -110,7 +215,16 @@ class ClusterInfo {
 
 class FileSystem {
 
-    constructor({ service, port, user, kerbTicketCachePath, authToken, options }) {
+    /**
+     * With shared true the connected handle is shared by all FileSystem objects with the same endpoint,
+     * credentials and configuration in the process which ask for it, including worker threads.
+     * The working directory belongs to the handle, so it is shared as well.
+     * conf is the path of the configuration file, empty for the defaults of libhdfs3.
+     * options.metadataCache {maxEntries, ttl, negativeTtl} (ms) caches path status lookups in the handle.
+     * options.cachingStrategy {dropBehindReads, dropBehindWrites, readahead} are the datanode page cache
+     * hints of the streams, dropBehind drops the data from the page cache once it is transferred.
+     */
+    constructor({ service, port, user, kerbTicketCachePath, authToken, shared = false, options, conf = '', deferred = false }) {
         this.maxPath = (Number.isInteger(options.maxPathLength) && options.maxPathLength > 0) ? options.maxPathLength : DEFAULT_PATH_LENGTH;
         if (!port) port = 0;
         if (!service) service = DEFAULT_SERVICE;
@@ -118,12 +232,32 @@ class FileSystem {
         if (user) params.user = user;
         if (kerbTicketCachePath) params.kerbTicketCachePath = kerbTicketCachePath;
         if (authToken) params.authToken = authToken;
-        this.fs = new NativeFs(service, port, params);
+        if (conf) params.configurationPath = conf;
+        params.shared = shared === true;
+        const settings = [];
+        if (options.metadataCache) {
+            const { maxEntries = 10000, ttl = 1000, negativeTtl = ttl } = options.metadataCache;
+            settings.push(
+                ['dfs.client.file.status.cache.size', String(maxEntries)],
+                ['dfs.client.file.status.cache.expiryMsec', String(ttl)],
+                ['dfs.client.file.status.cache.negative.expiryMsec', String(negativeTtl)]
+            );
+        }
+        if (options.cachingStrategy) {
+            const { dropBehindReads, dropBehindWrites, readahead } = options.cachingStrategy;
+            if (typeof dropBehindReads === 'boolean') settings.push(['dfs.client.cache.drop.behind.reads', String(dropBehindReads)]);
+            if (typeof dropBehindWrites === 'boolean') settings.push(['dfs.client.cache.drop.behind.writes', String(dropBehindWrites)]);
+            if (Number.isInteger(readahead) && readahead >= 0) settings.push(['dfs.client.cache.readahead', String(readahead)]);
+        }
+        if (settings.length > 0) {
+            params.settings = settings;
+        }
+        this.fs = new NativeFs(service, port, params, deferred);
     }
 
     list(path = ".") {
         return new Promise((resolve, reject) => {
-            this.fs.List(path, (err, data) => {
+            this.fs.List(path, (err, data, timings) => {
                 if (err) {
                     reject(err);
                 } else {
@@ -135,7 +269,7 @@ class FileSystem {
                         }
                         return f;
                     });
-                    resolve(d);
+                    resolve(withTimings(d, timings));
                 }
             })
         });
@@ -143,11 +277,11 @@ class FileSystem {
 
     stats(path) {
         return new Promise((resolve, reject) => {
-            this.fs.GetPathInfo(path, (err, data) => {
+            this.fs.GetPathInfo(path, (err, data, timings) => {
                 if (err) {
                     reject(err);
                 } else {
-                    resolve(data);
+                    resolve(withTimings(data, timings));
                 }
             })
         });
@@ -219,17 +353,67 @@ class FileSystem {
         });
     }
 
-    // copy(oldPath, newPath) {
-    //     return new Promise((resolve, reject) => {
-    //         this.fs.Copy(oldPath, newPath, (err) => {
-    //             if (err) {
-    //                 reject(err);
-    //             } else {
-    //                 resolve();
-    //             }
-    //         })
-    //     });
-    // }
+    /**
+     * Move the blocks of files to the end of an existing file and delete the files.
+     * @param {String} target the file to append the blocks to
+     * @param {Array<String>} sources files in the directory of target with its block size
+     * and only full blocks, but the last one of the last file
+     * @return {Promise}
+     */
+    concat(target, sources) {
+        return new Promise((resolve, reject) => {
+            this.fs.Concat(target, sources, (err) => {
+                if (err) {
+                    reject(err);
+                } else {
+                    resolve();
+                }
+            })
+        });
+    }
+
+    copy(oldPath, newPath) {
+        return new Promise((resolve, reject) => {
+            this.fs.Copy(oldPath, newPath, (err) => {
+                if (err) {
+                    reject(err);
+                } else {
+                    resolve();
+                }
+            })
+        });
+    }
+
+    /**
+     * Copy a file or mirror a directory tree natively to another FileSystem,
+     * or within this one: srcPath/x is copied to dstPath/x, existing files are
+     * replaced. Files are copied in parallel, files of more than
+     * options.blocksPerPart blocks in parts of whole blocks which are
+     * concatenated, each file through a temporary file renamed when complete.
+     * @param {String}srcPath the file or directory to copy.
+     * @param {FileSystem}dstFs the FileSystem to copy to.
+     * @param {String}dstPath the path of the copy, a file copied to an existing directory goes into it.
+     * @param {Object}options {parallelism: 8, skipIfChecksumMatches: false, preserve: ['blockSize'],
+     * blocksPerPart: 8, bufferSize: 8MB, onProgress(counters)}. preserve is true, false or a list of
+     * 'replication', 'blockSize', 'permission', 'owner' and 'times'. blocksPerPart 0 never splits.
+     * @return {files, filesCopied, filesSkipped, bytes, bytesCopied, bytesSkipped}
+     */
+    copyTree(srcPath, dstFs, dstPath, options) {
+        options = options || {};
+        let preserve = copyPreserveFlags(options.preserve === undefined ? ['blockSize'] : options.preserve);
+        let blocksPerPart = options.blocksPerPart === 0 || options.blocksPerPart === false ? -1 : (options.blocksPerPart || 0);
+        return new Promise((resolve, reject) => {
+            this.fs.CopyTree(srcPath, (dstFs || this).fs, dstPath, options.parallelism || 0,
+                !!options.skipIfChecksumMatches, preserve, blocksPerPart, options.bufferSize || 0,
+                options.onProgress || null, (err, data) => {
+                    if (err) {
+                        reject(err);
+                    } else {
+                        resolve(data);
+                    }
+                })
+        });
+    }
 
     setWorkingDirectory(path) {
         return new Promise((resolve, reject) => {
@@ -400,33 +584,231 @@ class FileSystem {
         });
     }
 
+    /**
+     * File checksum as HDFS compares it, e.g. for distcp: the MD5 of the MD5s of
+     * the CRCs of the blocks, computed by the DataNodes without moving the data.
+     * @param {String}path the path to the file.
+     * @return {algorithm, bytes, md5, bytesPerCrc, crcPerBlock}, bytes and md5 as hex.
+     */
+    checksum(path) {
+        return new Promise((resolve, reject) => {
+            this.fs.Checksum(path, (err, data) => {
+                if (err) {
+                    reject(err);
+                } else {
+                    resolve(data);
+                }
+            })
+        });
+    }
+
+    /**
+     * Snapshot of the client metrics. They are process wide and shared by
+     * all FileSystem instances, see nhdfs.metrics().
+     */
+    metrics() {
+        return bindings.Metrics();
+    }
+
+    /**
+     * @param {String} path the path of the file
+     * @param {Object} options see HReadStream, plus:
+     *   codec - decompress natively with gzip, zstd, lz4 or snappy, auto detects it
+     *   from the magic bytes and the extension (default none)
+     *   dropBehind - ask the datanodes to drop the data from their page cache once sent,
+     *   for one pass scans (default the cachingStrategy of the FileSystem)
+     *   readahead - bytes the datanodes read ahead (default the cachingStrategy of the FileSystem)
+     */
     createReadStream(path, options={}) {
         let r = new NativeReader(path, this.fs);  //TODO: make async
+        setCachingStrategy(r, options);
+        if (options.codec && options.codec !== 'none') r.SetCodec(options.codec);
         return new HReadStream(r, options);
     }
 
-    createWriteStream(path, options) {
+    /**
+     * Stream of RecordBatch objects, the records are split natively.
+     * @param {String} path the path of the file
+     * @param {Object} options Readable options plus:
+     *   delimiter - one byte string or byte value ending a record (default '\n')
+     *   maxBatchBytes - size of a batch, grows for longer records (default 1MB)
+     *   dropBehind, readahead - see createReadStream
+     */
+    createRecordStream(path, options={}) {
+        let r = new NativeReader(path, this.fs);
+        setCachingStrategy(r, options);
+        return new HRecordStream(r, options);
+    }
+
+    /**
+     * Scan a delimited file with several readers. The file is cut in splits at block
+     * boundaries, which are read concurrently from the datanodes holding them. A split
+     * returns the records starting in it, the last one is read past its end.
+     * @param {String} path the path of the file
+     * @param {Object} options
+     *   splitSize - bytes per split (default the block size of the file)
+     *   concurrency - splits read at once (default 8)
+     *   delimiter - one byte string or byte value ending a record (default '\n')
+     *   maxBatchBytes - size of a batch (default 1MB)
+     *   ordered - deliver the batches in file order (default true), else as they are read
+     *   dropBehind, readahead - see createReadStream
+     * @param {Function} onBatch called with (batch, splitIndex) for every RecordBatch,
+     * a returned promise is awaited before the split reads on
+     * @return {Promise<Object>} {splits, batches, records} once the file is scanned
+     */
+    async scanParallel(path, options, onBatch) {
+        if (typeof options === 'function') {
+            onBatch = options;
+            options = {};
+        }
+        options = options || {};
+        const info = await this.stats(path);
+        const splitSize = positiveInteger(options.splitSize, info.block_size || 128 * 1024 * 1024);
+        const concurrency = positiveInteger(options.concurrency, 8);
+        const delimiter = recordDelimiter(options.delimiter);
+        const maxBatchBytes = positiveInteger(options.maxBatchBytes, DEFAULT_BATCH_BYTES);
+        const ordered = options.ordered !== false;
+        const splits = [];
+        for (let start = 0; start < info.size; start += splitSize) {
+            splits.push({ index: splits.length, start: start, end: Math.min(start + splitSize, info.size),
+                batches: [], done: false, wake: null, resume: null });
+        }
+        const result = { splits: splits.length, batches: 0, records: 0 };
+        let next = 0;
+        let failed = null;
+        const signal = (split, what) => {
+            const f = split[what];
+            split[what] = null;
+            if (f) f();
+        };
+        const fail = (err) => {
+            failed = failed || err;
+            splits.forEach((split) => {
+                signal(split, 'wake');
+                signal(split, 'resume');
+            });
+        };
+        const deliver = async (batch, split) => {
+            result.batches++;
+            result.records += batch.length;
+            await onBatch(batch, split.index);
+        };
+        const readSplit = async (split) => {
+            const reader = new NativeReader(path, this.fs);
+            setCachingStrategy(reader, options);
+            try {
+                await new Promise((resolve, reject) => reader.Open((err) => err ? reject(err) : resolve()));
+                reader.SetRange(split.start, split.end);
+                while (!failed) {
+                    const batch = await new Promise((resolve, reject) => {
+                        reader.ReadRecords(maxBatchBytes, delimiter, (err, buf, offsets) => {
+                            err ? reject(err) : resolve(buf ? new RecordBatch(buf, offsets) : null);
+                        });
+                    });
+                    if (!batch) break;
+                    if (!ordered) {
+                        await deliver(batch, split);
+                        continue;
+                    }
+                    split.batches.push(batch);
+                    signal(split, 'wake');
+                    if (split.batches.length >= MAX_SPLIT_BATCHES) {
+                        await new Promise((resolve) => split.resume = resolve);
+                    }
+                }
+            } finally {
+                split.done = true;
+                signal(split, 'wake');
+                reader.Close(() => {});
+            }
+        };
+        const worker = async () => {
+            while (next < splits.length && !failed) {
+                await readSplit(splits[next++]);
+            }
+        };
+        const consume = async () => {
+            for (const split of splits) {
+                while (!failed) {
+                    if (split.batches.length > 0) {
+                        const batch = split.batches.shift();
+                        signal(split, 'resume');
+                        await deliver(batch, split);
+                    } else if (split.done) {
+                        break;
+                    } else {
+                        await new Promise((resolve) => split.wake = resolve);
+                    }
+                }
+            }
+        };
+        const tasks = [];
+        for (let i = 0; i < Math.min(concurrency, splits.length); i++) {
+            tasks.push(worker().catch(fail));
+        }
+        if (ordered) {
+            tasks.push(consume().catch(fail));
+        }
+        await Promise.all(tasks);
+        if (failed) {
+            throw failed;
+        }
+        return result;
+    }
+
+    /**
+     * @param {String} path the path of the file
+     * @param {Object} options Writable options plus:
+     *   replication - replication of the file (default of the cluster)
+     *   blockSize - block size of the file (default of the cluster)
+     *   bufferSize - bytes buffered by the stream before write() returns false (default 16KB)
+     *   favoredNodes - 'host:port' data transfer addresses of the datanodes to place the replicas
+     *   of the blocks on if possible, the first one gets the first replica, e.g. the local datanode
+     *   so the file can be read back with short-circuit reads (default the namenode chooses)
+     *   codec - compress natively with gzip, zstd, lz4 or snappy, auto picks it
+     *   from the extension (default none). lz4 and snappy use the Hadoop block format.
+     *   level - compression level, 0 for the default of the codec
+     *   threads - number of threads compressing blocks in parallel (default 1)
+     *   dropBehind - ask the datanodes to drop the data from their page cache once written
+     *   (default the cachingStrategy of the FileSystem)
+     */
+    createWriteStream(path, options={}) {
         let w = new NativeWriter(path, this.fs); //TODO: make async
+        setCachingStrategy(w, options, false);
+        if (Array.isArray(options.favoredNodes) && options.favoredNodes.length > 0) {
+            w.SetFavoredNodes(...options.favoredNodes);
+        }
+        if (options.codec && options.codec !== 'none') {
+            w.SetCodec(options.codec, options.level || 0, options.threads || 1);
+        }
         return new HWriteStream(w, options);
     }
 }
 
 class HReadStream extends Readable {
+    /**
+     * @param reader native reader
+     * @param {Object} options Readable options plus:
+     *   pooled - read into buffers from the native buffer pool (default true)
+     *   codec - set on the native reader, reads are decompressed into pooled buffers
+     */
     constructor(reader, options) {
         super(options);
         this.opened = false;
         this.destroyed = false;
         this.closed = false;
-        this.poolSize = 64 * 1024; //TODO: param
+        this.pooled = options.pooled !== false;
+        this.decoded = !!options.codec && options.codec !== 'none';
         this.reader = reader;
         this.on('end', () => {
             this.destroy();
         });
-        this.reader.Open((err) => {
+        this.reader.Open((err, res, timings) => {
             if (err) {
                 this.emit('error', err);
             } else {
                 this.opened = true;
+                this.timings = timings;
                 //this.read();
                 this.emit('open', 'open');
             }
@@ -440,6 +822,17 @@ class HReadStream extends Readable {
                 this._read(size);
             });
         }
+        if (this.pooled || this.decoded) {
+            const read = this.decoded ? this.reader.ReadDecoded : this.reader.ReadPooled;
+            return read.call(this.reader, size, (err, buf) => {
+                if (err) {
+                    this.destroy();
+                    this.emit('error', err);
+                } else {
+                    this.push(buf);
+                }
+            });
+        }
         const pool = Buffer.allocUnsafe(size);
         const onread = (err, bytesRead) => {
             if (err) {
@@ -457,6 +850,35 @@ class HReadStream extends Readable {
         this.reader.Read(pool, size, onread);
     }
 
+    /**
+     * Read at an absolute position without moving the stream.
+     * Reads on one stream are executed in order by the native layer.
+     * @param {Number} position offset in the file
+     * @param {Number} length number of bytes to read
+     * @return {Promise<Buffer>} the bytes read, shorter than length at the end of the file
+     */
+    readAt(position, length) {
+        if (this.decoded) {
+            return Promise.reject(new Error('readAt is not supported on compressed streams'));
+        }
+        if (!this.opened) {
+            return new Promise((resolve, reject) => {
+                this.once('open', () => this.readAt(position, length).then(resolve, reject));
+                this.once('error', reject);
+            });
+        }
+        const buf = Buffer.allocUnsafe(length);
+        return new Promise((resolve, reject) => {
+            this.reader.ReadAt(position, buf, length, (err, bytesRead, timings) => {
+                if (err) {
+                    reject(err);
+                } else {
+                    resolve(withTimings(buf.slice(0, bytesRead), timings));
+                }
+            });
+        });
+    }
+
     _destroy(err1, cb) {
         this.close((err2) => {
             cb(err1 || err2);
@@ -480,12 +902,74 @@ class HReadStream extends Readable {
     }
 }
 
+/**
+ * Complete records read by a record stream. buffer holds the records back to back,
+ * each with its delimiter, offsets has the start of every record and the end of the last one.
+ */
+class RecordBatch {
+    constructor(buffer, offsets) {
+        this.buffer = buffer;
+        this.offsets = offsets;
+    }
+
+    /**
+     * Number of records.
+     */
+    get length() {
+        return this.offsets.length - 1;
+    }
+
+    /**
+     * Record i without its delimiter, shares the memory of the batch.
+     */
+    record(i) {
+        return this.buffer.subarray(this.offsets[i], this.offsets[i + 1] - 1);
+    }
+
+    *[Symbol.iterator]() {
+        for (let i = 0; i < this.length; i++) {
+            yield this.record(i);
+        }
+    }
+}
+
+class HRecordStream extends HReadStream {
+    /**
+     * @param reader native reader
+     * @param {Object} options see FileSystem.createRecordStream
+     */
+    constructor(reader, options) {
+        super(reader, Object.assign({ highWaterMark: 2 }, options, { objectMode: true, pooled: true, codec: undefined }));
+        this.delimiter = recordDelimiter(options.delimiter);
+        this.maxBatchBytes = positiveInteger(options.maxBatchBytes, DEFAULT_BATCH_BYTES);
+    }
+
+    _read() {
+        if (this.closed) return;
+        if (!this.opened) {
+            return this.once('open', () => {
+                this._read();
+            });
+        }
+        this.reader.ReadRecords(this.maxBatchBytes, this.delimiter, (err, buf, offsets) => {
+            if (err) {
+                this.destroy();
+                this.emit('error', err);
+            } else {
+                this.push(buf ? new RecordBatch(buf, offsets) : null);
+            }
+        });
+    }
+}
+
 class HWriteStream extends Writable {
 
     constructor(writer, options) {
-        super();
+        super(Number.isInteger(options.bufferSize) && options.bufferSize > 0 ? { highWaterMark: options.bufferSize } : {});
         this.options = copyObject(options, {});
         if (this.options.replication === undefined) this.options.replication = 0;
+        const blockSize = Number.isInteger(this.options.blockSize) && this.options.blockSize > 0 ? this.options.blockSize : 0;
+        const bufferSize = Number.isInteger(this.options.bufferSize) && this.options.bufferSize > 0 ? this.options.bufferSize : 0;
         this.bytesWritten = 0;
         this.writer = writer;
         this.on('end', () => {
@@ -495,11 +979,12 @@ class HWriteStream extends Writable {
             this.close();
         });
         this.opened = false;
-        this.writer.Open(this.options.replication, (err) => {
+        this.writer.Open(this.options.replication, blockSize, bufferSize, (err, res, timings) => {
             if (err) {
                 this.emit('error', err);
             } else {
                 this.opened = true;
+                this.timings = timings;
                 this.emit('open', 'open');
             }
         })
@@ -547,6 +1032,80 @@ class HWriteStream extends Writable {
     }
 
 }
+/**
+ * Statistics of the native read buffer pool.
+ * @return {Object} slabs, pooledBytes, standaloneBytes, chunksInUse, bytesInUse, acquired, released, misses
+ */
+const bufferPoolStats = () => bindings.BufferPoolStats();
+
+/**
+ * Configure the native read buffer pool.
+ * @param {Number} retainedBytes size of fully free slabs kept for reuse
+ */
+const configureBufferPool = ({ retainedBytes } = {}) => {
+    if (Number.isInteger(retainedBytes)) bindings.BufferPoolConfigure(retainedBytes);
+}
+
+/**
+ * Release all unused slabs of the native read buffer pool.
+ */
+const trimBufferPool = () => bindings.BufferPoolTrim();
+
+/**
+ * Set the number of native threads running HDFS operations.
+ * Operations are queued on these threads instead of the libuv threadpool.
+ * The pool has 8 threads by default and only grows.
+ * @param {Number} threads number of threads
+ */
+const setAsyncThreads = (threads) => bindings.AsyncSetThreads(threads);
+
+/**
+ * Take the sampled operation timings collected since the last call.
+ * @return {Array} of {operation, start, duration, phases: [{phase, count, start, duration}]}, times in ms
+ */
+const traceSamples = () => bindings.TraceSamples();
+
+/**
+ * Configure sampling of operation timings.
+ * @param {Number} sampleRate keep one of every sampleRate operations, 0 disables sampling
+ */
+const configureTracing = ({ sampleRate } = {}) => {
+    if (Number.isInteger(sampleRate)) bindings.TraceConfigure(sampleRate);
+}
+
+/**
+ * Snapshot of the process wide libhdfs3 client metrics.
+ * Counters only grow, compare two snapshots to get rates.
+ * @return {Object} {counters: {bytesReadShortCircuit, bytesReadLocal, bytesReadRemote, bytesWritten,
+ * peerCacheHits, peerCacheMisses, rpcCalls, rpcRetries, namenodeFailovers, checksumFailures, readRetries,
+ * pipelineRecoveries, dekCacheHits, dekCacheMisses, fileStatusCacheHits, fileStatusCacheMisses, observerReads,
+ * observerFallbacks, blockReadersPrefetched, uringSockets}, histograms: {rpcLatency, datanodeConnectLatency, blockReadLatency, pipelineAckLatency}}
+ * where each histogram is {count, sum, min, max, p50, p90, p99, p999} in ms
+ */
+const metrics = () => bindings.Metrics();
+
+/**
+ * Statistics of the process wide registry of connected handles.
+ * @return {Object} handles, references, connects
+ */
+const fileSystemRegistryStats = () => bindings.FileSystemRegistryStats();
+
+/**
+ * Copy a file or mirror a directory tree natively between two FileSystems,
+ * e.g. two clusters, see FileSystem.copyTree.
+ */
+const copyTree = (srcFs, srcPath, dstFs, dstPath, options) => srcFs.copyTree(srcPath, dstFs, dstPath, options);
+
 //module.exports.FileSystem = FileSystem;
 module.exports.createFS = createFS;
-module.exports.createClusterInfo = createClusterInfo;
\ No newline at end of file
+module.exports.createFSAsync = createFSAsync;
+module.exports.fileSystemRegistryStats = fileSystemRegistryStats;
+module.exports.createClusterInfo = createClusterInfo;
+module.exports.bufferPoolStats = bufferPoolStats;
+module.exports.configureBufferPool = configureBufferPool;
+module.exports.trimBufferPool = trimBufferPool;
+module.exports.setAsyncThreads = setAsyncThreads;
+module.exports.traceSamples = traceSamples;
+module.exports.configureTracing = configureTracing;
+module.exports.metrics = metrics;
+module.exports.copyTree = copyTree;
\ No newline at end of file
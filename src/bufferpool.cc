@@ -0,0 +1,294 @@
+#include "bufferpool.h"
+#include "macros.h"
+
+#include <algorithm>
+
+namespace nhdfs
+{
+
+BufferPool &BufferPool::Instance()
+{
+    // never destroyed: finalizers of outstanding buffers may run during shutdown
+    static BufferPool *pool = new BufferPool();
+    return *pool;
+}
+
+BufferPool::BufferPool()
+{
+    size_t classes = 0;
+    for (size_t s = MIN_CHUNK; s <= MAX_CHUNK; s <<= 1)
+    {
+        ++classes;
+    }
+    this->available.resize(classes);
+}
+
+void BufferPool::Init(Napi::Env env, Napi::Object exports)
+{
+    Napi::HandleScope scope(env);
+    {
+        BufferPool &pool = Instance();
+        std::lock_guard<std::mutex> lock(pool.mut);
+        uint64_t id = ++pool.nextEnvId;
+        pool.envs[env] = id;
+        pool.owed[id] = 0;
+    }
+    napi_add_env_cleanup_hook(env, &BufferPool::OnCleanup, static_cast<napi_env>(env));
+    exports.Set(NAPISTRING(env, "BufferPoolStats"), Napi::Function::New(env, &BufferPool::PoolStats));
+    exports.Set(NAPISTRING(env, "BufferPoolTrim"), Napi::Function::New(env, &BufferPool::PoolTrim));
+    exports.Set(NAPISTRING(env, "BufferPoolConfigure"), Napi::Function::New(env, &BufferPool::PoolConfigure));
+}
+
+void BufferPool::OnCleanup(void *data)
+{
+    // what the environment was charged went away with its isolate
+    BufferPool &pool = Instance();
+    std::lock_guard<std::mutex> lock(pool.mut);
+    std::unordered_map<napi_env, uint64_t>::iterator it = pool.envs.find(static_cast<napi_env>(data));
+    if (it != pool.envs.end())
+    {
+        pool.owed.erase(it->second);
+        pool.envs.erase(it);
+    }
+}
+
+size_t BufferPool::sizeClass(size_t size)
+{
+    if (size > MAX_CHUNK)
+    {
+        return NO_CLASS;
+    }
+    size_t cls = 0;
+    for (size_t s = MIN_CHUNK; s < size; s <<= 1)
+    {
+        ++cls;
+    }
+    return cls;
+}
+
+void BufferPool::adjust(Napi::Env env, int64_t delta)
+{
+    int64_t total = 0;
+    napi_adjust_external_memory(env, delta, &total);
+}
+
+uint64_t BufferPool::idOf(Napi::Env env)
+{
+    std::unordered_map<napi_env, uint64_t>::iterator it = this->envs.find(env);
+    return it == this->envs.end() ? 0 : it->second;
+}
+
+void BufferPool::charge(Napi::Env env, uint64_t owner, int64_t delta)
+{
+    if (owner != 0 && owner == idOf(env))
+    {
+        adjust(env, delta);
+        return;
+    }
+    // napi_adjust_external_memory must run on the thread of its environment
+    std::unordered_map<uint64_t, int64_t>::iterator it = this->owed.find(owner);
+    if (it != this->owed.end())
+    {
+        it->second += delta;
+    }
+}
+
+void BufferPool::settle(Napi::Env env)
+{
+    std::unordered_map<uint64_t, int64_t>::iterator it = this->owed.find(idOf(env));
+    if (it != this->owed.end() && it->second != 0)
+    {
+        adjust(env, it->second);
+        it->second = 0;
+    }
+}
+
+BufferPool::Slab *BufferPool::newSlab(Napi::Env env, size_t cls)
+{
+    size_t chunkSize = MIN_CHUNK << cls;
+    size_t count = std::max<size_t>(1, SLAB_SIZE / chunkSize);
+    Slab *slab = new Slab;
+    slab->sizeClass = cls;
+    slab->chunkSize = chunkSize;
+    slab->count = count;
+    slab->used = 0;
+    slab->memory = new char[chunkSize * count];
+    slab->chunks = new Chunk[count];
+    slab->free = nullptr;
+    slab->owner = idOf(env);
+    for (size_t i = count; i > 0; --i)
+    {
+        Chunk *c = &slab->chunks[i - 1];
+        c->slab = slab;
+        c->data = slab->memory + (i - 1) * chunkSize;
+        c->capacity = chunkSize;
+        c->next = slab->free;
+        slab->free = c;
+    }
+    int64_t bytes = chunkSize * count;
+    this->stats.slabs++;
+    this->stats.pooledBytes += bytes;
+    this->freeSlabBytes += bytes;
+    adjust(env, bytes);
+    return slab;
+}
+
+void BufferPool::freeSlab(Napi::Env env, Slab *slab)
+{
+    int64_t bytes = slab->chunkSize * slab->count;
+    this->stats.slabs--;
+    this->stats.pooledBytes -= bytes;
+    this->freeSlabBytes -= bytes;
+    charge(env, slab->owner, -bytes);
+    delete[] slab->memory;
+    delete[] slab->chunks;
+    delete slab;
+}
+
+BufferPool::Chunk *BufferPool::Acquire(Napi::Env env, size_t size)
+{
+    std::lock_guard<std::mutex> lock(this->mut);
+    settle(env);
+    this->stats.acquired++;
+    size_t cls = sizeClass(size);
+    Chunk *c = nullptr;
+    if (cls == NO_CLASS)
+    {
+        c = new Chunk;
+        c->slab = nullptr;
+        c->data = new char[size];
+        c->capacity = size;
+        c->next = nullptr;
+        c->owner = idOf(env);
+        this->stats.misses++;
+        this->stats.standaloneBytes += size;
+        adjust(env, size);
+    }
+    else
+    {
+        std::vector<Slab *> &slabs = this->available[cls];
+        if (slabs.empty())
+        {
+            this->stats.misses++;
+            slabs.push_back(newSlab(env, cls));
+        }
+        Slab *slab = slabs.back();
+        c = slab->free;
+        slab->free = c->next;
+        c->next = nullptr;
+        if (slab->used++ == 0)
+        {
+            this->freeSlabBytes -= slab->chunkSize * slab->count;
+        }
+        if (!slab->free)
+        {
+            slabs.pop_back();
+        }
+    }
+    this->stats.chunksInUse++;
+    this->stats.bytesInUse += c->capacity;
+    return c;
+}
+
+void BufferPool::Release(Napi::Env env, Chunk *c)
+{
+    std::lock_guard<std::mutex> lock(this->mut);
+    settle(env);
+    this->stats.released++;
+    this->stats.chunksInUse--;
+    this->stats.bytesInUse -= c->capacity;
+    Slab *slab = c->slab;
+    if (!slab)
+    {
+        this->stats.standaloneBytes -= c->capacity;
+        charge(env, c->owner, -static_cast<int64_t>(c->capacity));
+        delete[] c->data;
+        delete c;
+        return;
+    }
+    std::vector<Slab *> &slabs = this->available[slab->sizeClass];
+    if (!slab->free)
+    {
+        slabs.push_back(slab);
+    }
+    c->next = slab->free;
+    slab->free = c;
+    if (--slab->used == 0)
+    {
+        this->freeSlabBytes += slab->chunkSize * slab->count;
+        if (this->freeSlabBytes > static_cast<int64_t>(this->retainedLimit))
+        {
+            slabs.erase(std::find(slabs.begin(), slabs.end(), slab));
+            freeSlab(env, slab);
+        }
+    }
+}
+
+Napi::Buffer<char> BufferPool::Wrap(Napi::Env env, Chunk *chunk, size_t length)
+{
+    return Napi::Buffer<char>::New(env, chunk->data, length,
+                                   [](Napi::Env e, char * /*data*/, Chunk *c) { BufferPool::Instance().Release(e, c); },
+                                   chunk);
+}
+
+void BufferPool::Trim(Napi::Env env)
+{
+    std::lock_guard<std::mutex> lock(this->mut);
+    settle(env);
+    for (std::vector<Slab *> &slabs : this->available)
+    {
+        std::vector<Slab *> keep;
+        for (Slab *slab : slabs)
+        {
+            if (slab->used == 0)
+                freeSlab(env, slab);
+            else
+                keep.push_back(slab);
+        }
+        slabs.swap(keep);
+    }
+}
+
+void BufferPool::SetRetainedLimit(size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(this->mut);
+    this->retainedLimit = bytes;
+}
+
+BufferPool::Stats BufferPool::GetStats()
+{
+    std::lock_guard<std::mutex> lock(this->mut);
+    return this->stats;
+}
+
+Napi::Value BufferPool::PoolStats(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    Stats s = Instance().GetStats();
+    Napi::Object res = Napi::Object::New(env);
+    res.Set(NAPISTRING(env, "slabs"), Napi::Number::New(env, s.slabs));
+    res.Set(NAPISTRING(env, "pooledBytes"), Napi::Number::New(env, s.pooledBytes));
+    res.Set(NAPISTRING(env, "standaloneBytes"), Napi::Number::New(env, s.standaloneBytes));
+    res.Set(NAPISTRING(env, "chunksInUse"), Napi::Number::New(env, s.chunksInUse));
+    res.Set(NAPISTRING(env, "bytesInUse"), Napi::Number::New(env, s.bytesInUse));
+    res.Set(NAPISTRING(env, "acquired"), Napi::Number::New(env, s.acquired));
+    res.Set(NAPISTRING(env, "released"), Napi::Number::New(env, s.released));
+    res.Set(NAPISTRING(env, "misses"), Napi::Number::New(env, s.misses));
+    return res;
+}
+
+Napi::Value BufferPool::PoolTrim(const Napi::CallbackInfo &info)
+{
+    Instance().Trim(info.Env());
+    return info.Env().Undefined();
+}
+
+Napi::Value BufferPool::PoolConfigure(const Napi::CallbackInfo &info)
+{
+    REQUIRE_ARGUMENTS(1)
+    REQUIRE_ARGUMENT_LONG(0, retained)
+    Instance().SetRetainedLimit(retained < 0 ? 0 : retained);
+    return info.Env().Undefined();
+}
+
+} //namespace nhdfs
@@ -0,0 +1,141 @@
+#ifndef NHDFS_BUFFERPOOL_H_
+#define NHDFS_BUFFERPOOL_H_
+
+#include <napi.h>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace nhdfs
+{
+
+class BufferPool;
+
+/**
+* Process wide slab pool of native read buffers.
+*
+* Buffers are handed to JS as external Napi::Buffer objects whose finalizers
+* return the memory to the pool, so high throughput readers reuse memory
+* instead of allocating a new Buffer per read. Every slab owned by the pool is
+* reported to V8 via napi_adjust_external_memory of the environment which
+* allocated it. A slab freed by another environment (worker thread) is given
+* back to its owner the next time the owner uses the pool.
+**/
+class BufferPool
+{
+  public:
+    struct Slab;
+
+    struct Chunk
+    {
+        Slab *slab;
+        char *data;
+        size_t capacity;
+        Chunk *next;
+        uint64_t owner; // standalone chunks only
+    };
+
+    struct Slab
+    {
+        size_t sizeClass;
+        size_t chunkSize;
+        size_t count;
+        size_t used;
+        char *memory;
+        Chunk *chunks;
+        Chunk *free;
+        uint64_t owner;
+    };
+
+    struct Stats
+    {
+        int64_t slabs = 0;
+        int64_t pooledBytes = 0;
+        int64_t standaloneBytes = 0;
+        int64_t chunksInUse = 0;
+        int64_t bytesInUse = 0;
+        int64_t acquired = 0;
+        int64_t released = 0;
+        int64_t misses = 0;
+    };
+
+    static const size_t MIN_CHUNK = 4 * 1024;
+    static const size_t MAX_CHUNK = 4 * 1024 * 1024;
+    static const size_t SLAB_SIZE = 1024 * 1024;
+    static const size_t DEFAULT_RETAINED = 64 * 1024 * 1024;
+    static const size_t NO_CLASS = static_cast<size_t>(-1);
+
+    static BufferPool &Instance();
+
+    static void Init(Napi::Env env, Napi::Object exports);
+
+    /**
+    * Take a chunk of at least size bytes.
+    * Sizes above MAX_CHUNK are served by a standalone allocation.
+    */
+    Chunk *Acquire(Napi::Env env, size_t size);
+
+    /**
+    * Give a chunk back to the pool. Fully free slabs are released once the
+    * retained size goes over the configured limit.
+    */
+    void Release(Napi::Env env, Chunk *chunk);
+
+    /**
+    * Expose the first length bytes of chunk as a Buffer that releases the
+    * chunk when it is garbage collected.
+    */
+    Napi::Buffer<char> Wrap(Napi::Env env, Chunk *chunk, size_t length);
+
+    /**
+    * Free all slabs which have no chunk in use.
+    */
+    void Trim(Napi::Env env);
+
+    void SetRetainedLimit(size_t bytes);
+
+    Stats GetStats();
+
+  private:
+    BufferPool();
+
+    static Napi::Value PoolStats(const Napi::CallbackInfo &info);
+    static Napi::Value PoolTrim(const Napi::CallbackInfo &info);
+    static Napi::Value PoolConfigure(const Napi::CallbackInfo &info);
+
+    static void OnCleanup(void *data);
+
+    static size_t sizeClass(size_t size);
+    static void adjust(Napi::Env env, int64_t delta);
+
+    /**
+    * Account delta bytes to the environment with id owner, directly if it
+    * is env. Ids tell apart environments created at the address of one
+    * which is gone.
+    */
+    void charge(Napi::Env env, uint64_t owner, int64_t delta);
+
+    /**
+    * Apply what other environments gave back for env since its last call.
+    */
+    void settle(Napi::Env env);
+    uint64_t idOf(Napi::Env env);
+
+    Slab *newSlab(Napi::Env env, size_t cls);
+    void freeSlab(Napi::Env env, Slab *slab);
+
+    std::mutex mut;
+    std::vector<std::vector<Slab *>> available;
+    std::unordered_map<napi_env, uint64_t> envs;
+    std::unordered_map<uint64_t, int64_t> owed;
+    uint64_t nextEnvId = 0;
+    size_t retainedLimit = DEFAULT_RETAINED;
+    int64_t freeSlabBytes = 0;
+    Stats stats;
+};
+
+} //namespace nhdfs
+
+#endif //NHDFS_BUFFERPOOL_H_
@@ -23,7 +23,7 @@ Napi::Object nameNodeToObject(Namenode *node, Napi::Env env)
 class HANameNodesWorker : public Napi::AsyncWorker
 {
   public:
-    HANameNodesWorker(const std::string s, Napi::Function cb) : AsyncWorker(cb), service(s) {}
+    HANameNodesWorker(const std::string s, const std::string c, Napi::Function cb) : AsyncWorker(cb), service(s), conf(c) {}
 
     virtual ~HANameNodesWorker()
     {
@@ -33,7 +33,8 @@ class HANameNodesWorker : public Napi::AsyncWorker
 
     void Execute() override
     {
-        this->nodes = hdfsGetHANamenodes(this->service.c_str(), &this->size);
+        this->nodes = this->conf.empty() ? hdfsGetHANamenodes(this->service.c_str(), &this->size)
+                                         : hdfsGetHANamenodesWithConfig(this->conf.c_str(), this->service.c_str(), &this->size);
         if ( ! this->nodes)
         {
             this->error = createAsyncError(errno, hdfsGetLastError());
@@ -70,6 +71,7 @@ class HANameNodesWorker : public Napi::AsyncWorker
     Namenode *nodes = nullptr;
     int size = 0;
     const std::string service;
+    const std::string conf;
 };
 
 Napi::FunctionReference ClusterInfo::constructor;
@@ -89,6 +91,10 @@ void ClusterInfo::Init(Napi::Env env, Napi::Object exports)
 
 ClusterInfo::ClusterInfo(const Napi::CallbackInfo &info) : Napi::ObjectWrap<ClusterInfo>(info)
 {
+    if (info.Length() > 0 && info[0].IsString())
+    {
+        this->conf = info[0].As<Napi::String>();
+    }
 }
 
 ClusterInfo::~ClusterInfo()
@@ -98,8 +104,8 @@ ClusterInfo::~ClusterInfo()
 /**
   * If hdfs is configured with HA namenode, return all namenode informations as an array.
   * Else return NULL.
-  * Using configure file which is given by environment parameter LIBHDFS3_CONF
-  * or "hdfs-client.xml" in working directory.
+  * Using the configuration file passed to the constructor, else the one given by
+  * environment parameter LIBHDFS3_CONF or "hdfs-client.xml" in working directory.
   * @param nameservice hdfs name service id.
   * @return return an array of all namenode information.
   */
@@ -108,7 +114,7 @@ Napi::Value ClusterInfo::GetHANamenodes(const Napi::CallbackInfo &info)
     REQUIRE_ARGUMENTS(2);
     std::string service = info[0].As<Napi::String>();
     Napi::Function cb = info[1].As<Napi::Function>();
-    HANameNodesWorker *worker = new HANameNodesWorker(service, cb);
+    HANameNodesWorker *worker = new HANameNodesWorker(service, this->conf, cb);
     worker->Queue();
     return info.Env().Null();
 }
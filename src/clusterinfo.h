@@ -23,8 +23,8 @@ class ClusterInfo : public Napi::ObjectWrap<ClusterInfo>
     /**
     * If hdfs is configured with HA namenode, return all namenode informations as an array.
     * Else return NULL.
-    * Using configure file which is given by environment parameter LIBHDFS3_CONF
-    * or "hdfs-client.xml" in working directory.
+    * Using the configuration file passed to the constructor, else the one given by
+    * environment parameter LIBHDFS3_CONF or "hdfs-client.xml" in working directory.
     * @param nameservice hdfs name service id.
     * @return return an array of all namenode information.
     */
@@ -35,6 +35,7 @@ class ClusterInfo : public Napi::ObjectWrap<ClusterInfo>
     int close();
 
     hdfsFS fs;
+    std::string conf;
     std::string path;
     hdfsFile file;
 };
@@ -0,0 +1,711 @@
+#include "codec.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <stdexcept>
+#include <thread>
+
+#include <zlib.h>
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+#ifdef HAVE_LZ4
+#include <lz4.h>
+#include <lz4hc.h>
+#include <lz4frame.h>
+#endif
+#ifdef HAVE_SNAPPY
+#include <snappy-c.h>
+#endif
+
+namespace nhdfs
+{
+
+namespace
+{
+
+/**
+* Raw size of a block written in the Hadoop BlockCompressorStream format,
+* small enough for the 256KB buffers of the Hadoop snappy and lz4
+* decompressors even if the block does not compress.
+*/
+const size_t HADOOP_BLOCK_SIZE = 256 * 1024 - (256 * 1024 / 6 + 32);
+
+/**
+* Guard against allocating for corrupt Hadoop block headers.
+*/
+const size_t MAX_HADOOP_BLOCK = 64 * 1024 * 1024;
+
+const size_t GZIP_BLOCK_SIZE = 1024 * 1024;
+
+bool endsWith(const std::string &s, const char *suffix)
+{
+    size_t l = strlen(suffix);
+    return s.size() >= l && s.compare(s.size() - l, l, suffix) == 0;
+}
+
+uint32_t readBE32(const char *p)
+{
+    const unsigned char *u = reinterpret_cast<const unsigned char *>(p);
+    return (uint32_t(u[0]) << 24) | (uint32_t(u[1]) << 16) | (uint32_t(u[2]) << 8) | uint32_t(u[3]);
+}
+
+#if defined(HAVE_LZ4) || defined(HAVE_SNAPPY)
+void appendBE32(std::string &out, uint32_t v)
+{
+    char b[4] = {char(v >> 24), char(v >> 16), char(v >> 8), char(v)};
+    out.append(b, 4);
+}
+#endif
+
+class PassDecoder : public Decoder
+{
+  public:
+    size_t Decode(const char *in, size_t inLength, size_t &consumed, char *out, size_t outLength) override
+    {
+        consumed = std::min(inLength, outLength);
+        memcpy(out, in, consumed);
+        return consumed;
+    }
+
+    bool Complete() const override
+    {
+        return true;
+    }
+};
+
+class GzipDecoder : public Decoder
+{
+  public:
+    GzipDecoder()
+    {
+        memset(&strm, 0, sizeof(strm));
+        // 32: accept gzip and zlib headers
+        if (inflateInit2(&strm, 15 + 32) != Z_OK)
+            throw std::runtime_error("gzip: cannot initialize decompressor");
+    }
+
+    ~GzipDecoder()
+    {
+        inflateEnd(&strm);
+    }
+
+    size_t Decode(const char *in, size_t inLength, size_t &consumed, char *out, size_t outLength) override
+    {
+        if (ended && inLength > 0)
+        {
+            // next member of a concatenated file
+            inflateReset(&strm);
+            ended = false;
+        }
+        started = started || inLength > 0;
+        strm.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(in));
+        strm.avail_in = inLength;
+        strm.next_out = reinterpret_cast<Bytef *>(out);
+        strm.avail_out = outLength;
+        while (strm.avail_out > 0)
+        {
+            int r = inflate(&strm, Z_NO_FLUSH);
+            if (r == Z_STREAM_END)
+            {
+                ended = true;
+                if (strm.avail_in == 0)
+                    break;
+                inflateReset(&strm);
+                ended = false;
+            }
+            else if (r == Z_BUF_ERROR)
+            {
+                break;
+            }
+            else if (r != Z_OK)
+            {
+                throw std::runtime_error(std::string("gzip: ") + (strm.msg ? strm.msg : "invalid data"));
+            }
+            else if (strm.avail_in == 0)
+            {
+                break;
+            }
+        }
+        consumed = inLength - strm.avail_in;
+        return outLength - strm.avail_out;
+    }
+
+    bool Complete() const override
+    {
+        return ended || !started;
+    }
+
+  private:
+    z_stream strm;
+    bool ended = false;
+    bool started = false;
+};
+
+#ifdef HAVE_ZSTD
+class ZstdDecoder : public Decoder
+{
+  public:
+    ZstdDecoder() : dctx(ZSTD_createDCtx())
+    {
+        if (!dctx)
+            throw std::runtime_error("zstd: cannot initialize decompressor");
+    }
+
+    ~ZstdDecoder()
+    {
+        ZSTD_freeDCtx(dctx);
+    }
+
+    size_t Decode(const char *in, size_t inLength, size_t &consumed, char *out, size_t outLength) override
+    {
+        ZSTD_inBuffer input = {in, inLength, 0};
+        ZSTD_outBuffer output = {out, outLength, 0};
+        do
+        {
+            size_t before = input.pos;
+            size_t r = ZSTD_decompressStream(dctx, &output, &input);
+            if (ZSTD_isError(r))
+                throw std::runtime_error(std::string("zstd: ") + ZSTD_getErrorName(r));
+            // without input after the end of a frame r is the size of the next frame header
+            if (r == 0)
+                ended = true;
+            else if (input.pos > before)
+                ended = false;
+            // with room left in output everything decodable was flushed
+        } while (output.pos < output.size && input.pos < input.size);
+        consumed = input.pos;
+        return output.pos;
+    }
+
+    bool Complete() const override
+    {
+        return ended;
+    }
+
+  private:
+    ZSTD_DCtx *dctx;
+    bool ended = true;
+};
+
+class ZstdEncoder : public Encoder
+{
+  public:
+    ZstdEncoder(int level, int threads) : cctx(ZSTD_createCCtx()), chunk(ZSTD_CStreamOutSize())
+    {
+        if (!cctx)
+            throw std::runtime_error("zstd: cannot initialize compressor");
+        ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel, level > 0 ? level : ZSTD_CLEVEL_DEFAULT);
+        if (threads > 1)
+        {
+            // fails if libzstd was built without multithreading, it then compresses inline
+            ZSTD_CCtx_setParameter(cctx, ZSTD_c_nbWorkers, threads);
+        }
+    }
+
+    ~ZstdEncoder()
+    {
+        ZSTD_freeCCtx(cctx);
+    }
+
+    void Encode(const char *data, size_t length, std::string &out) override
+    {
+        ZSTD_inBuffer input = {data, length, 0};
+        while (input.pos < input.size)
+            compress(input, ZSTD_e_continue, out);
+    }
+
+    void Finish(std::string &out) override
+    {
+        ZSTD_inBuffer input = {nullptr, 0, 0};
+        while (compress(input, ZSTD_e_end, out) != 0)
+            ;
+    }
+
+  private:
+    size_t compress(ZSTD_inBuffer &input, ZSTD_EndDirective mode, std::string &out)
+    {
+        ZSTD_outBuffer output = {&chunk[0], chunk.size(), 0};
+        size_t r = ZSTD_compressStream2(cctx, &output, &input, mode);
+        if (ZSTD_isError(r))
+            throw std::runtime_error(std::string("zstd: ") + ZSTD_getErrorName(r));
+        out.append(&chunk[0], output.pos);
+        return r;
+    }
+
+    ZSTD_CCtx *cctx;
+    std::vector<char> chunk;
+};
+#endif
+
+#ifdef HAVE_LZ4
+class Lz4FrameDecoder : public Decoder
+{
+  public:
+    Lz4FrameDecoder()
+    {
+        if (LZ4F_isError(LZ4F_createDecompressionContext(&dctx, LZ4F_VERSION)))
+            throw std::runtime_error("lz4: cannot initialize decompressor");
+    }
+
+    ~Lz4FrameDecoder()
+    {
+        LZ4F_freeDecompressionContext(dctx);
+    }
+
+    size_t Decode(const char *in, size_t inLength, size_t &consumed, char *out, size_t outLength) override
+    {
+        size_t read = 0, written = 0;
+        while (written < outLength)
+        {
+            size_t src = inLength - read, dst = outLength - written;
+            size_t r = LZ4F_decompress(dctx, out + written, &dst, in + read, &src, nullptr);
+            if (LZ4F_isError(r))
+                throw std::runtime_error(std::string("lz4: ") + LZ4F_getErrorName(r));
+            read += src;
+            written += dst;
+            // after the end of a frame r is the size of the next frame header
+            if (r == 0)
+                ended = true;
+            else if (src > 0)
+                ended = false;
+            if (src == 0 && dst == 0)
+                break;
+        }
+        consumed = read;
+        return written;
+    }
+
+    bool Complete() const override
+    {
+        return ended;
+    }
+
+  private:
+    LZ4F_dctx *dctx;
+    bool ended = true;
+};
+#endif
+
+/**
+* Reads the Hadoop BlockCompressorStream format: the raw size of a block
+* followed by the chunks it was compressed in, each prefixed with its
+* compressed size. All sizes are 4 byte big endian.
+**/
+class HadoopBlockDecoder : public Decoder
+{
+  public:
+    size_t Decode(const char *in, size_t inLength, size_t &consumed, char *out, size_t outLength) override
+    {
+        input.append(in, inLength);
+        consumed = inLength;
+        size_t written = 0;
+        while (written < outLength)
+        {
+            if (outPos < block.size())
+            {
+                size_t n = std::min(block.size() - outPos, outLength - written);
+                memcpy(out + written, block.data() + outPos, n);
+                outPos += n;
+                written += n;
+            }
+            else if (!nextChunk())
+            {
+                break;
+            }
+        }
+        if (inPos > 0 && inPos * 2 >= input.size())
+        {
+            input.erase(0, inPos);
+            inPos = 0;
+        }
+        return written;
+    }
+
+    bool Complete() const override
+    {
+        return remaining == 0 && inPos == input.size();
+    }
+
+  protected:
+    /**
+    * Decompress one chunk, returns its raw size.
+    */
+    virtual size_t decompress(const char *in, size_t length, char *out, size_t capacity) = 0;
+
+  private:
+    bool nextChunk()
+    {
+        size_t available = input.size() - inPos;
+        if (remaining == 0)
+        {
+            if (available < 4)
+                return false;
+            remaining = readBE32(input.data() + inPos);
+            if (remaining > MAX_HADOOP_BLOCK)
+                throw std::runtime_error("invalid block size");
+            inPos += 4;
+            available -= 4;
+            if (remaining == 0)
+                return true;
+        }
+        if (available < 4)
+            return false;
+        size_t length = readBE32(input.data() + inPos);
+        if (length > MAX_HADOOP_BLOCK)
+            throw std::runtime_error("invalid chunk size");
+        if (available < 4 + length)
+            return false;
+        block.resize(remaining);
+        size_t n = decompress(input.data() + inPos + 4, length, &block[0], remaining);
+        block.resize(n);
+        outPos = 0;
+        inPos += 4 + length;
+        remaining -= n;
+        return true;
+    }
+
+    std::string input;
+    size_t inPos = 0;
+    std::string block;
+    size_t outPos = 0;
+    size_t remaining = 0;
+};
+
+#ifdef HAVE_LZ4
+class Lz4BlockDecoder : public HadoopBlockDecoder
+{
+  protected:
+    size_t decompress(const char *in, size_t length, char *out, size_t capacity) override
+    {
+        int n = LZ4_decompress_safe(in, out, length, capacity);
+        if (n < 0)
+            throw std::runtime_error("lz4: invalid data");
+        return n;
+    }
+};
+#endif
+
+#ifdef HAVE_SNAPPY
+class SnappyBlockDecoder : public HadoopBlockDecoder
+{
+  protected:
+    size_t decompress(const char *in, size_t length, char *out, size_t capacity) override
+    {
+        size_t n = 0;
+        if (snappy_uncompressed_length(in, length, &n) != SNAPPY_OK || n > capacity ||
+            snappy_uncompress(in, length, out, &n) != SNAPPY_OK)
+            throw std::runtime_error("snappy: invalid data");
+        return n;
+    }
+};
+#endif
+
+/**
+* Cuts the input in blocks of blockSize and compresses batches of up to
+* threads blocks concurrently, the output keeps the order of the input.
+**/
+class BlockEncoder : public Encoder
+{
+  public:
+    BlockEncoder(size_t blockSize, int threads)
+        : blockSize(blockSize), blocks(std::max(threads, 1)), results(blocks.size()), errors(blocks.size()) {}
+
+    void Encode(const char *data, size_t length, std::string &out) override
+    {
+        while (length > 0)
+        {
+            if (count == 0 || blocks[count - 1].size() == blockSize)
+            {
+                if (count == blocks.size())
+                    flush(out);
+                blocks[count++].reserve(blockSize);
+            }
+            std::string &b = blocks[count - 1];
+            size_t n = std::min(length, blockSize - b.size());
+            b.append(data, n);
+            data += n;
+            length -= n;
+        }
+    }
+
+    void Finish(std::string &out) override
+    {
+        flush(out);
+    }
+
+  protected:
+    /**
+    * Append the compressed block to out, called concurrently.
+    */
+    virtual void compress(const std::string &block, std::string &out) = 0;
+
+  private:
+    void compressAt(size_t i)
+    {
+        try
+        {
+            compress(blocks[i], results[i]);
+        }
+        catch (...)
+        {
+            errors[i] = std::current_exception();
+        }
+    }
+
+    void flush(std::string &out)
+    {
+        std::vector<std::thread> workers;
+        for (size_t i = 1; i < count; ++i)
+            workers.push_back(std::thread(&BlockEncoder::compressAt, this, i));
+        if (count > 0)
+            compressAt(0);
+        for (std::thread &t : workers)
+            t.join();
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (errors[i])
+            {
+                std::exception_ptr e = errors[i];
+                errors[i] = nullptr;
+                std::rethrow_exception(e);
+            }
+            out.append(results[i]);
+            results[i].clear();
+            blocks[i].clear();
+        }
+        count = 0;
+    }
+
+    size_t blockSize;
+    std::vector<std::string> blocks;
+    std::vector<std::string> results;
+    std::vector<std::exception_ptr> errors;
+    size_t count = 0;
+};
+
+/**
+* Every block is a gzip member, readers of gzip accept concatenated members.
+**/
+class GzipEncoder : public BlockEncoder
+{
+  public:
+    GzipEncoder(int level, int threads)
+        : BlockEncoder(GZIP_BLOCK_SIZE, threads), level(level > 0 ? std::min(level, 9) : Z_DEFAULT_COMPRESSION) {}
+
+  protected:
+    void compress(const std::string &block, std::string &out) override
+    {
+        z_stream strm;
+        memset(&strm, 0, sizeof(strm));
+        // 16: write a gzip header
+        if (deflateInit2(&strm, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+            throw std::runtime_error("gzip: cannot initialize compressor");
+        out.resize(deflateBound(&strm, block.size()));
+        strm.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(block.data()));
+        strm.avail_in = block.size();
+        strm.next_out = reinterpret_cast<Bytef *>(&out[0]);
+        strm.avail_out = out.size();
+        int r = deflate(&strm, Z_FINISH);
+        out.resize(out.size() - strm.avail_out);
+        deflateEnd(&strm);
+        if (r != Z_STREAM_END)
+            throw std::runtime_error("gzip: compression failed");
+    }
+
+  private:
+    int level;
+};
+
+#ifdef HAVE_LZ4
+class Lz4BlockEncoder : public BlockEncoder
+{
+  public:
+    Lz4BlockEncoder(int level, int threads) : BlockEncoder(HADOOP_BLOCK_SIZE, threads), level(level) {}
+
+  protected:
+    void compress(const std::string &block, std::string &out) override
+    {
+        int bound = LZ4_compressBound(block.size());
+        out.resize(8 + bound);
+        int n = level > 1 ? LZ4_compress_HC(block.data(), &out[8], block.size(), bound, level)
+                          : LZ4_compress_default(block.data(), &out[8], block.size(), bound);
+        if (n <= 0)
+            throw std::runtime_error("lz4: compression failed");
+        out.resize(8 + n);
+        std::string header;
+        appendBE32(header, block.size());
+        appendBE32(header, n);
+        out.replace(0, 8, header);
+    }
+
+  private:
+    int level;
+};
+#endif
+
+#ifdef HAVE_SNAPPY
+class SnappyBlockEncoder : public BlockEncoder
+{
+  public:
+    SnappyBlockEncoder(int threads) : BlockEncoder(HADOOP_BLOCK_SIZE, threads) {}
+
+  protected:
+    void compress(const std::string &block, std::string &out) override
+    {
+        size_t n = snappy_max_compressed_length(block.size());
+        out.resize(8 + n);
+        if (snappy_compress(block.data(), block.size(), &out[8], &n) != SNAPPY_OK)
+            throw std::runtime_error("snappy: compression failed");
+        out.resize(8 + n);
+        std::string header;
+        appendBE32(header, block.size());
+        appendBE32(header, n);
+        out.replace(0, 8, header);
+    }
+};
+#endif
+
+} //namespace
+
+bool CodecFromName(const std::string &name, CodecType &type)
+{
+    if (name == "none")
+        type = CODEC_NONE;
+    else if (name == "auto")
+        type = CODEC_AUTO;
+    else if (name == "gzip" || name == "gz")
+        type = CODEC_GZIP;
+    else if (name == "zstd")
+        type = CODEC_ZSTD;
+    else if (name == "lz4")
+        type = CODEC_LZ4;
+    else if (name == "snappy")
+        type = CODEC_SNAPPY;
+    else
+        return false;
+    return true;
+}
+
+CodecType CodecFromPath(const std::string &path)
+{
+    if (endsWith(path, ".gz"))
+        return CODEC_GZIP;
+    if (endsWith(path, ".zst"))
+        return CODEC_ZSTD;
+    if (endsWith(path, ".lz4"))
+        return CODEC_LZ4;
+    if (endsWith(path, ".snappy"))
+        return CODEC_SNAPPY;
+    return CODEC_NONE;
+}
+
+CodecType CodecFromMagic(const char *data, size_t length)
+{
+    const unsigned char *u = reinterpret_cast<const unsigned char *>(data);
+    if (length >= 2 && u[0] == 0x1f && u[1] == 0x8b)
+        return CODEC_GZIP;
+    if (length >= 4 && u[0] == 0x28 && u[1] == 0xb5 && u[2] == 0x2f && u[3] == 0xfd)
+        return CODEC_ZSTD;
+    if (length >= 4 && u[0] == 0x04 && u[1] == 0x22 && u[2] == 0x4d && u[3] == 0x18)
+        return CODEC_LZ4_FRAME;
+    return CODEC_NONE;
+}
+
+bool CodecAvailable(CodecType type)
+{
+    switch (type)
+    {
+#ifndef HAVE_ZSTD
+    case CODEC_ZSTD:
+        return false;
+#endif
+#ifndef HAVE_LZ4
+    case CODEC_LZ4:
+    case CODEC_LZ4_FRAME:
+        return false;
+#endif
+#ifndef HAVE_SNAPPY
+    case CODEC_SNAPPY:
+        return false;
+#endif
+    default:
+        return true;
+    }
+}
+
+const char *CodecName(CodecType type)
+{
+    switch (type)
+    {
+    case CODEC_AUTO:
+        return "auto";
+    case CODEC_GZIP:
+        return "gzip";
+    case CODEC_ZSTD:
+        return "zstd";
+    case CODEC_LZ4:
+    case CODEC_LZ4_FRAME:
+        return "lz4";
+    case CODEC_SNAPPY:
+        return "snappy";
+    default:
+        return "none";
+    }
+}
+
+Decoder *Decoder::Create(CodecType type)
+{
+    if (!CodecAvailable(type))
+        throw std::runtime_error(std::string(CodecName(type)) + " support is not built in");
+    switch (type)
+    {
+    case CODEC_GZIP:
+        return new GzipDecoder();
+#ifdef HAVE_ZSTD
+    case CODEC_ZSTD:
+        return new ZstdDecoder();
+#endif
+#ifdef HAVE_LZ4
+    case CODEC_LZ4:
+        return new Lz4BlockDecoder();
+    case CODEC_LZ4_FRAME:
+        return new Lz4FrameDecoder();
+#endif
+#ifdef HAVE_SNAPPY
+    case CODEC_SNAPPY:
+        return new SnappyBlockDecoder();
+#endif
+    default:
+        return new PassDecoder();
+    }
+}
+
+Encoder *Encoder::Create(CodecType type, int level, int threads)
+{
+    if (!CodecAvailable(type))
+        throw std::runtime_error(std::string(CodecName(type)) + " support is not built in");
+    switch (type)
+    {
+    case CODEC_GZIP:
+        return new GzipEncoder(level, threads);
+#ifdef HAVE_ZSTD
+    case CODEC_ZSTD:
+        return new ZstdEncoder(level, threads);
+#endif
+#ifdef HAVE_LZ4
+    case CODEC_LZ4:
+        return new Lz4BlockEncoder(level, threads);
+#endif
+#ifdef HAVE_SNAPPY
+    case CODEC_SNAPPY:
+        return new SnappyBlockEncoder(threads);
+#endif
+    default:
+        throw std::runtime_error(std::string("cannot compress with ") + CodecName(type));
+    }
+}
+
+} //namespace nhdfs
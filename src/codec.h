@@ -0,0 +1,104 @@
+#ifndef NHDFS_CODEC_H_
+#define NHDFS_CODEC_H_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace nhdfs
+{
+
+enum CodecType
+{
+    CODEC_NONE,
+    CODEC_AUTO,
+    CODEC_GZIP,
+    CODEC_ZSTD,
+    CODEC_LZ4,
+    CODEC_LZ4_FRAME,
+    CODEC_SNAPPY
+};
+
+/**
+* Codec of a name passed from JS: none, auto, gzip, zstd, lz4 or snappy.
+* Returns false if the name is unknown.
+*/
+bool CodecFromName(const std::string &name, CodecType &type);
+
+/**
+* Codec of a file extension (.gz, .zst, .lz4, .snappy), CODEC_NONE otherwise.
+*/
+CodecType CodecFromPath(const std::string &path);
+
+/**
+* Codec of the magic bytes at the start of a file, CODEC_NONE if there are
+* none. Hadoop lz4 and snappy files have no magic.
+*/
+CodecType CodecFromMagic(const char *data, size_t length);
+
+/**
+* False if the addon was built without the library of the codec.
+*/
+bool CodecAvailable(CodecType type);
+
+const char *CodecName(CodecType type);
+
+/**
+* Streaming decompressor. Errors are thrown as std::runtime_error.
+*
+* gzip accepts concatenated members, lz4 and snappy read the Hadoop
+* BlockCompressorStream format, LZ4_FRAME the lz4 frame format.
+**/
+class Decoder
+{
+  public:
+    static Decoder *Create(CodecType type);
+
+    virtual ~Decoder() {}
+
+    /**
+    * Decompress from in into out.
+    * @param consumed set to the number of input bytes used
+    * @return the number of bytes written to out
+    */
+    virtual size_t Decode(const char *in, size_t inLength, size_t &consumed, char *out, size_t outLength) = 0;
+
+    /**
+    * True if the input seen so far ends with a complete frame,
+    * false at the end of the file means it was truncated.
+    */
+    virtual bool Complete() const = 0;
+};
+
+/**
+* Streaming compressor. Errors are thrown as std::runtime_error.
+*
+* gzip, lz4 and snappy cut the input in blocks and compress up to threads
+* blocks at once, gzip blocks are written as concatenated members. zstd
+* uses the workers of libzstd.
+**/
+class Encoder
+{
+  public:
+    /**
+    * @param level codec specific, 0 for the default of the codec
+    * @param threads number of blocks compressed in parallel
+    */
+    static Encoder *Create(CodecType type, int level, int threads);
+
+    virtual ~Encoder() {}
+
+    /**
+    * Compress data and append the output available so far to out.
+    */
+    virtual void Encode(const char *data, size_t length, std::string &out) = 0;
+
+    /**
+    * Append the remaining output and the end of the stream to out.
+    */
+    virtual void Finish(std::string &out) = 0;
+};
+
+} //namespace nhdfs
+
+#endif //NHDFS_CODEC_H_
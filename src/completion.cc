@@ -0,0 +1,299 @@
+#include "completion.h"
+#include "macros.h"
+
+#include <errno.h>
+
+namespace nhdfs
+{
+
+Napi::Object TraceToObject(Napi::Env env, const hdfsTrace *trace)
+{
+    Napi::Object res = Napi::Object::New(env);
+    Napi::Array phases = Napi::Array::New(env, trace->numSpans);
+    for (int i = 0; i < trace->numSpans; i++)
+    {
+        const hdfsTraceSpan &span = trace->spans[i];
+        Napi::Object p = Napi::Object::New(env);
+        p.Set(NAPISTRING(env, "phase"), NAPISTRING(env, span.phase));
+        p.Set(NAPISTRING(env, "count"), NAPIINT(env, span.count));
+        p.Set(NAPISTRING(env, "start"), Napi::Number::New(env, span.start / 1e6));
+        p.Set(NAPISTRING(env, "duration"), Napi::Number::New(env, span.duration / 1e6));
+        phases.Set(i, p);
+    }
+    res.Set(NAPISTRING(env, "operation"), NAPISTRING(env, trace->operation));
+    res.Set(NAPISTRING(env, "start"), Napi::Number::New(env, trace->start / 1e6));
+    res.Set(NAPISTRING(env, "duration"), Napi::Number::New(env, trace->duration / 1e6));
+    res.Set(NAPISTRING(env, "phases"), phases);
+    return res;
+}
+
+Completion::Completion(Napi::Function cb, bool timings) : callback(Napi::Persistent(cb)), timings(timings)
+{
+}
+
+Completion::~Completion()
+{
+}
+
+void Completion::Keep(Napi::Object object)
+{
+    this->keep.push_back(Napi::Persistent(object));
+}
+
+void Completion::Begin()
+{
+    this->queue = &CompletionQueue::Instance(this->callback.Env());
+    this->queue->Ref();
+}
+
+void Completion::Start(int res)
+{
+    if (res < 0)
+    {
+        this->res = res;
+        this->err = errno;
+        this->msg = hdfsGetLastError();
+        this->queue->Push(this);
+    }
+}
+
+void Completion::Complete()
+{
+    this->Begin();
+    this->queue->Push(this);
+}
+
+void Completion::Callback(hdfsAsyncResult *result, void *data)
+{
+    Completion *self = static_cast<Completion *>(data);
+    self->Collect(result);
+    self->queue->Push(self);
+}
+
+void Completion::Collect(hdfsAsyncResult *result)
+{
+    this->res = result->ret;
+    if (result->ret < 0)
+    {
+        this->err = result->errnum;
+        this->msg = result->error;
+    }
+    if (result->trace && (this->timings || result->ret < 0))
+    {
+        this->trace = *result->trace;
+        this->traced = true;
+    }
+}
+
+Napi::Value Completion::Error(Napi::Env env)
+{
+    if (this->res < 0)
+    {
+        Napi::Object e = Napi::Object::New(env);
+        e.Set(NAPISTRING(env, "message"), NAPISTRING(env, this->msg));
+        e.Set(NAPISTRING(env, "errno"), NAPIINT(env, this->err));
+        if (this->traced)
+        {
+            e.Set(NAPISTRING(env, "timings"), TraceToObject(env, &this->trace));
+        }
+        return e;
+    }
+    return env.Null();
+}
+
+Napi::Value Completion::Timings(Napi::Env env)
+{
+    if (this->traced)
+    {
+        return TraceToObject(env, &this->trace);
+    }
+    return env.Undefined();
+}
+
+void Completion::OnComplete(Napi::Env env)
+{
+    this->callback.MakeCallback(env.Global(), std::initializer_list<napi_value>{Error(env), Napi::Number::New(env, this->res), Timings(env)});
+}
+
+void OpenCompletion::SetCachingStrategy(hdfsFS fs, int dropBehind, int64_t readahead)
+{
+    this->fs = fs;
+    this->dropBehind = dropBehind;
+    this->readahead = readahead;
+}
+
+void OpenCompletion::SetFavoredNodes(hdfsFS fs, const std::vector<std::string> &nodes)
+{
+    this->fs = fs;
+    this->favoredNodes = nodes;
+}
+
+void OpenCompletion::Collect(hdfsAsyncResult *result)
+{
+    Completion::Collect(result);
+    this->opened = result->file;
+    if (this->opened && (this->dropBehind >= 0 || this->readahead >= 0))
+    {
+        // only hints, the stream works with the defaults of the handle
+        hdfsFileSetCachingStrategy(this->fs, this->opened, this->dropBehind, this->readahead);
+    }
+    if (this->opened && !this->favoredNodes.empty())
+    {
+        // a hint as well, the namenode places the replicas elsewhere if it has to
+        std::vector<const char *> nodes;
+        for (const std::string &node : this->favoredNodes)
+        {
+            nodes.push_back(node.c_str());
+        }
+        hdfsFileSetFavoredNodes(this->fs, this->opened, nodes.data(), nodes.size());
+    }
+}
+
+void OpenCompletion::OnComplete(Napi::Env env)
+{
+    // set on the JS thread, where the wrapper uses it
+    *this->file = this->opened;
+    Completion::OnComplete(env);
+}
+
+void CompletionQueue::Init(Napi::Env env, Napi::Object exports)
+{
+    Napi::HandleScope scope(env);
+    // never destroyed: libhdfs3 threads may complete operations during shutdown
+    CompletionQueue *queue = new CompletionQueue(env);
+    napi_set_instance_data(env, queue, nullptr, nullptr);
+    napi_add_env_cleanup_hook(env, &CompletionQueue::OnCleanup, queue);
+    exports.Set(NAPISTRING(env, "AsyncSetThreads"), Napi::Function::New(env, &CompletionQueue::SetThreads));
+    exports.Set(NAPISTRING(env, "TraceSamples"), Napi::Function::New(env, &CompletionQueue::TraceSamples));
+    exports.Set(NAPISTRING(env, "TraceConfigure"), Napi::Function::New(env, &CompletionQueue::TraceConfigure));
+}
+
+CompletionQueue &CompletionQueue::Instance(Napi::Env env)
+{
+    void *queue = nullptr;
+    napi_get_instance_data(env, &queue);
+    return *static_cast<CompletionQueue *>(queue);
+}
+
+CompletionQueue::CompletionQueue(Napi::Env env) : env(env)
+{
+    uv_loop_t *loop = nullptr;
+    napi_get_uv_event_loop(env, &loop);
+    uv_async_init(loop, &this->async, &CompletionQueue::OnAsync);
+    this->async.data = this;
+    uv_unref(reinterpret_cast<uv_handle_t *>(&this->async));
+}
+
+void CompletionQueue::Ref()
+{
+    if (this->pending++ == 0)
+    {
+        uv_ref(reinterpret_cast<uv_handle_t *>(&this->async));
+    }
+    std::lock_guard<std::mutex> lock(this->mut);
+    this->running++;
+}
+
+void CompletionQueue::Push(Completion *completion)
+{
+    std::lock_guard<std::mutex> lock(this->mut);
+    this->running--;
+    this->done.push_back(completion);
+    if (this->closed)
+    {
+        // the environment is being cleaned up, it frees the completion
+        this->idle.notify_all();
+        return;
+    }
+    uv_async_send(&this->async);
+}
+
+void CompletionQueue::OnAsync(uv_async_t *handle)
+{
+    static_cast<CompletionQueue *>(handle->data)->Drain();
+}
+
+void CompletionQueue::OnCleanup(void *data)
+{
+    CompletionQueue *self = static_cast<CompletionQueue *>(data);
+    std::vector<Completion *> batch;
+    {
+        std::unique_lock<std::mutex> lock(self->mut);
+        self->closed = true;
+        // libhdfs3 threads still write into the buffers kept by the completions
+        self->idle.wait(lock, [self] { return self->running == 0; });
+        batch.swap(self->done);
+    }
+    // the callbacks are gone with the environment, only release the references
+    for (Completion *c : batch)
+    {
+        delete c;
+    }
+    uv_close(reinterpret_cast<uv_handle_t *>(&self->async), nullptr);
+}
+
+void CompletionQueue::Drain()
+{
+    std::vector<Completion *> batch;
+    {
+        std::lock_guard<std::mutex> lock(this->mut);
+        batch.swap(this->done);
+    }
+    Napi::Env env(this->env);
+    for (Completion *c : batch)
+    {
+        if (--this->pending == 0)
+        {
+            uv_unref(reinterpret_cast<uv_handle_t *>(&this->async));
+        }
+        try
+        {
+            Napi::HandleScope scope(env);
+            c->OnComplete(env);
+        }
+        catch (const Napi::Error &e)
+        {
+            // there is no JS frame to throw into, treat it like an uncaught exception
+#if NAPI_VERSION >= 3
+            napi_fatal_exception(env, e.Value());
+#else
+            napi_fatal_error("nhdfs", NAPI_AUTO_LENGTH, e.Message().c_str(), NAPI_AUTO_LENGTH);
+#endif
+        }
+        delete c;
+    }
+}
+
+Napi::Value CompletionQueue::SetThreads(const Napi::CallbackInfo &info)
+{
+    REQUIRE_ARGUMENTS(1)
+    REQUIRE_ARGUMENT_INT(0, threads)
+    if (hdfsAsyncSetThreads(threads) < 0)
+    {
+        Napi::Error::New(info.Env(), hdfsGetLastError()).ThrowAsJavaScriptException();
+    }
+    return info.Env().Undefined();
+}
+
+Napi::Value CompletionQueue::TraceSamples(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    std::vector<hdfsTrace> traces(256);
+    int n = hdfsTraceTakeSamples(traces.data(), traces.size());
+    Napi::Array res = Napi::Array::New(env, n > 0 ? n : 0);
+    for (int i = 0; i < n; i++)
+    {
+        res.Set(i, TraceToObject(env, &traces[i]));
+    }
+    return res;
+}
+
+Napi::Value CompletionQueue::TraceConfigure(const Napi::CallbackInfo &info)
+{
+    REQUIRE_ARGUMENTS(1)
+    REQUIRE_ARGUMENT_INT(0, sampleRate)
+    hdfsTraceSetSampleRate(sampleRate);
+    return info.Env().Undefined();
+}
+
+} //namespace nhdfs
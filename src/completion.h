@@ -0,0 +1,186 @@
+#ifndef NHDFS_COMPLETION_H_
+#define NHDFS_COMPLETION_H_
+
+#include <napi.h>
+#include <uv.h>
+#include <hdfs/hdfs.h>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace nhdfs
+{
+
+class CompletionQueue;
+
+/**
+* Convert the timings of an operation to
+* {operation, duration, phases: [{phase, count, start, duration}]},
+* times are in milliseconds.
+*/
+Napi::Object TraceToObject(Napi::Env env, const hdfsTrace *trace);
+
+/**
+* An operation queued with one of the hdfsAsync* functions.
+*
+* libhdfs3 runs the blocking call on its own pool of threads and calls
+* Callback there. The completion is then handed to the JS thread by the
+* CompletionQueue, so an operation in flight does not hold a libuv
+* threadpool slot. Subclasses copy the result in Collect and build the JS
+* value in OnComplete.
+**/
+class Completion
+{
+  public:
+    /**
+    * @param timings pass the timings of the operation as third argument
+    * of the callback, errors always carry them.
+    */
+    explicit Completion(Napi::Function cb, bool timings = false);
+    virtual ~Completion();
+
+    /**
+    * Keep object alive until the operation completes, e.g. the buffer the
+    * operation reads into or the wrapper of the file.
+    */
+    void Keep(Napi::Object object);
+
+    /**
+    * Account for the operation, call it before the hdfsAsync* function:
+    * a libhdfs3 thread may call Callback before that function returns.
+    */
+    void Begin();
+
+    /**
+    * Take res, the return value of the hdfsAsync* function. If the
+    * operation was not queued the error is delivered to the callback
+    * asynchronously as well.
+    */
+    void Start(int res);
+
+    /**
+    * Deliver the result asynchronously without starting an operation,
+    * e.g. when there is nothing left to read.
+    */
+    void Complete();
+
+    /**
+    * hdfsAsyncCallback, data is the Completion.
+    */
+    static void Callback(hdfsAsyncResult *result, void *data);
+
+  protected:
+    /**
+    * Called on a libhdfs3 thread, result is only valid during the call.
+    */
+    virtual void Collect(hdfsAsyncResult *result);
+
+    /**
+    * Called on the JS thread, calls back with (err, ret) by default.
+    */
+    virtual void OnComplete(Napi::Env env);
+
+    Napi::Value Error(Napi::Env env);
+    Napi::Value Timings(Napi::Env env);
+
+    Napi::FunctionReference callback;
+    std::vector<Napi::ObjectReference> keep;
+    int res = 0;
+    int err = 0;
+    std::string msg;
+    bool timings;
+    bool traced = false;
+    hdfsTrace trace;
+    CompletionQueue *queue = nullptr;
+
+    friend class CompletionQueue;
+};
+
+/**
+* Completion of hdfsAsyncOpenFile, stores the file into the wrapper which
+* started it. The wrapper must be kept alive with Keep.
+**/
+class OpenCompletion : public Completion
+{
+  public:
+    OpenCompletion(hdfsFile *file, Napi::Function cb) : Completion(cb, true), file(file) {}
+
+    /**
+    * Set the page cache hints on the file once it is open, before any
+    * other operation can use it. -1 keeps the hint of the handle.
+    */
+    void SetCachingStrategy(hdfsFS fs, int dropBehind, int64_t readahead);
+
+    /**
+    * Set the favored datanodes of a file opened for write once it is open,
+    * before the first block is allocated.
+    */
+    void SetFavoredNodes(hdfsFS fs, const std::vector<std::string> &nodes);
+
+  protected:
+    void Collect(hdfsAsyncResult *result) override;
+    void OnComplete(Napi::Env env) override;
+
+  private:
+    hdfsFile *file;
+    hdfsFile opened = nullptr;
+    hdfsFS fs = nullptr;
+    int dropBehind = -1;
+    int64_t readahead = -1;
+    std::vector<std::string> favoredNodes;
+};
+
+/**
+* Delivers completions from libhdfs3 threads to the JS thread through a
+* uv_async_t. The handle only keeps the event loop alive while operations
+* are in flight. Every JS environment, i.e. the main thread and each
+* worker thread, has its own queue on its own event loop. When the
+* environment is cleaned up the queue waits for the operations in flight,
+* which still use the buffers they keep, and frees all completions without
+* calling back.
+**/
+class CompletionQueue
+{
+  public:
+    static void Init(Napi::Env env, Napi::Object exports);
+
+    /**
+    * The queue of the environment env.
+    */
+    static CompletionQueue &Instance(Napi::Env env);
+
+    /**
+    * Called on the JS thread when an operation is started.
+    */
+    void Ref();
+
+    /**
+    * Called on any thread when an operation is done.
+    */
+    void Push(Completion *completion);
+
+  private:
+    CompletionQueue(Napi::Env env);
+
+    static void OnAsync(uv_async_t *handle);
+    static void OnCleanup(void *data);
+    static Napi::Value SetThreads(const Napi::CallbackInfo &info);
+    static Napi::Value TraceSamples(const Napi::CallbackInfo &info);
+    static Napi::Value TraceConfigure(const Napi::CallbackInfo &info);
+
+    void Drain();
+
+    napi_env env;
+    uv_async_t async;
+    std::mutex mut;
+    std::condition_variable idle;
+    std::vector<Completion *> done;
+    int pending = 0; // not delivered yet, JS thread only
+    int running = 0; // not pushed yet
+    bool closed = false;
+};
+
+} //namespace nhdfs
+
+#endif //NHDFS_COMPLETION_H_
@@ -1,9 +1,16 @@
 
 #include "filereader.h"
 #include "filesystem.h"
+#include "bufferpool.h"
+#include "completion.h"
+#include "splitter.h"
 #include "workers.h"
 #include "macros.h"
 
+#include <algorithm>
+#include <cstring>
+#include <errno.h>
+#include <exception>
 #include <iostream>
 
 namespace nhdfs
@@ -21,6 +28,13 @@ void FileReader::Init(Napi::Env env, Napi::Object exports)
             {
                 InstanceMethod("Open", &FileReader::Open),
                 InstanceMethod("Read", &FileReader::Read),
+                InstanceMethod("ReadAt", &FileReader::ReadAt),
+                InstanceMethod("ReadPooled", &FileReader::ReadPooled),
+                InstanceMethod("SetCodec", &FileReader::SetCodec),
+                InstanceMethod("ReadDecoded", &FileReader::ReadDecoded),
+                InstanceMethod("ReadRecords", &FileReader::ReadRecords),
+                InstanceMethod("SetRange", &FileReader::SetRange),
+                InstanceMethod("SetCachingStrategy", &FileReader::SetCachingStrategy),
                 InstanceMethod("Close", &FileReader::Close)
             }
         );
@@ -54,11 +68,11 @@ Napi::Value FileReader::Open(const Napi::CallbackInfo &info)
 {
     REQUIRE_ARGUMENTS(1)
     REQUIRE_ARGUMENT_FUNCTION(0, cb)
-    std::function<int()> f = [this] {
-        file = hdfsOpenFile(fs, path.c_str(), O_RDONLY, 0 /*not used*/, 0, 0);
-        return (file) ? 0 : -1;
-    };
-    SimpleResWorker::Start(f, cb);
+    OpenCompletion *c = new OpenCompletion(&this->file, cb);
+    c->Keep(this->Value());
+    c->SetCachingStrategy(fs, this->dropBehind, this->readahead);
+    c->Begin();
+    c->Start(hdfsAsyncOpenFile(fs, path.c_str(), O_RDONLY, 0 /*not used*/, 0, 0, &Completion::Callback, c));
     return info.Env().Null();
 }
 
@@ -68,12 +82,420 @@ Napi::Value FileReader::Read(const Napi::CallbackInfo &info)
     REQUIRE_ARGUMENT_BUFFER(0, buffer)
     REQUIRE_ARGUMENT_INT(1, l)
     REQUIRE_ARGUMENT_FUNCTION(2, cb)
-    char * b = buffer.Data();
-    std::function<int()> f = [this, b, l] {
-        int r = hdfsRead(fs, file, b, l);
-        return r;
+    Completion *c = new Completion(cb);
+    c->Keep(this->Value());
+    c->Keep(buffer);
+    c->Begin();
+    c->Start(hdfsAsyncRead(fs, file, buffer.Data(), l, &Completion::Callback, c));
+    return info.Env().Null();
+}
+
+Napi::Value FileReader::ReadAt(const Napi::CallbackInfo &info)
+{
+    REQUIRE_ARGUMENTS(4);
+    REQUIRE_ARGUMENT_LONG(0, position)
+    REQUIRE_ARGUMENT_BUFFER(1, buffer)
+    REQUIRE_ARGUMENT_INT(2, l)
+    REQUIRE_ARGUMENT_FUNCTION(3, cb)
+    Completion *c = new Completion(cb, true);
+    c->Keep(this->Value());
+    c->Keep(buffer);
+    c->Begin();
+    c->Start(hdfsAsyncPread(fs, file, position, buffer.Data(), l, &Completion::Callback, c));
+    return info.Env().Null();
+}
+
+/**
+* Completion of a read into a chunk of the BufferPool.
+*/
+class PooledReadCompletion : public Completion
+{
+  public:
+    PooledReadCompletion(Napi::Env env, BufferPool::Chunk *chunk, Napi::Function cb)
+        : Completion(cb), env(env), chunk(chunk) {}
+
+    virtual ~PooledReadCompletion()
+    {
+        if (this->chunk)
+            BufferPool::Instance().Release(this->env, this->chunk);
+    }
+
+  protected:
+    void OnComplete(Napi::Env env) override
+    {
+        Napi::Value v = env.Null();
+        if (this->res > 0)
+        {
+            v = BufferPool::Instance().Wrap(env, this->chunk, this->res);
+            this->chunk = nullptr; // owned by the buffer now
+        }
+        this->callback.MakeCallback(env.Global(), std::initializer_list<napi_value>{Error(env), v});
+    }
+
+  private:
+    Napi::Env env;
+    BufferPool::Chunk *chunk;
+};
+
+Napi::Value FileReader::ReadPooled(const Napi::CallbackInfo &info)
+{
+    REQUIRE_ARGUMENTS(2);
+    REQUIRE_ARGUMENT_INT(0, l)
+    REQUIRE_ARGUMENT_FUNCTION(1, cb)
+    BufferPool::Chunk *chunk = BufferPool::Instance().Acquire(info.Env(), l);
+    PooledReadCompletion *c = new PooledReadCompletion(info.Env(), chunk, cb);
+    c->Keep(this->Value());
+    c->Begin();
+    c->Start(hdfsAsyncRead(fs, file, chunk->data, l, &Completion::Callback, c));
+    return info.Env().Null();
+}
+
+Napi::Value FileReader::SetCodec(const Napi::CallbackInfo &info)
+{
+    REQUIRE_ARGUMENTS(1)
+    REQUIRE_ARGUMENT_STRING(0, name)
+    CodecType type;
+    if (!CodecFromName(name, type))
+    {
+        Napi::TypeError::New(info.Env(), "Unknown codec " + name).ThrowAsJavaScriptException();
+        return info.Env().Null();
+    }
+    if (!CodecAvailable(type))
+    {
+        Napi::Error::New(info.Env(), std::string(CodecName(type)) + " support is not built in").ThrowAsJavaScriptException();
+        return info.Env().Null();
+    }
+    this->codec = type;
+    this->input.resize(CODEC_INPUT_SIZE);
+    return info.Env().Null();
+}
+
+/**
+* Decompression of a chunk of the BufferPool.
+*/
+class DecodeWorker : public BlockingWorker
+{
+  public:
+    DecodeWorker(FileReader *reader, std::function<int(std::string &)> f, Napi::Env env,
+                 BufferPool::Chunk *chunk, Napi::Function cb)
+        : BlockingWorker(reader->Value(), f, cb), reader(reader), env(env), chunk(chunk) {}
+
+    virtual ~DecodeWorker()
+    {
+        if (this->chunk)
+            BufferPool::Instance().Release(this->env, this->chunk);
+    }
+
+    void OnOK() override
+    {
+        // a Close waiting for the read is queued, it completes after the callback
+        this->reader->workDone();
+        BlockingWorker::OnOK();
+    }
+
+  protected:
+    Napi::Value Result(Napi::Env env) override
+    {
+        if (this->res <= 0)
+            return env.Null();
+        Napi::Value v = BufferPool::Instance().Wrap(env, this->chunk, this->res);
+        this->chunk = nullptr; // owned by the buffer now
+        return v;
+    }
+
+  private:
+    FileReader *reader;
+    Napi::Env env;
+    BufferPool::Chunk *chunk;
+};
+
+Napi::Value FileReader::ReadDecoded(const Napi::CallbackInfo &info)
+{
+    REQUIRE_ARGUMENTS(2);
+    REQUIRE_ARGUMENT_INT(0, l)
+    REQUIRE_ARGUMENT_FUNCTION(1, cb)
+    BufferPool::Chunk *chunk = BufferPool::Instance().Acquire(info.Env(), l);
+    hdfsFile file = this->file;
+    std::function<int(std::string &)> f = [this, file, chunk, l](std::string &msg) {
+        return decode(file, chunk->data, l, msg);
     };
-    SimpleResWorker::Start(f, cb);
+    DecodeWorker *worker = new DecodeWorker(this, f, info.Env(), chunk, cb);
+    this->working++;
+    worker->Queue();
+    return info.Env().Null();
+}
+
+void FileReader::workDone()
+{
+    if (--this->working == 0 && !this->closing.IsEmpty())
+    {
+        Napi::Function cb = this->closing.Value();
+        this->closing.Reset();
+        closeFile(cb);
+    }
+}
+
+int FileReader::decode(hdfsFile file, char *out, int length, std::string &msg)
+{
+    int produced = 0;
+    try
+    {
+        for (;;)
+        {
+            if (this->decoder)
+            {
+                size_t used = 0;
+                produced += this->decoder->Decode(this->input.data() + this->inPos, this->inLength - this->inPos, used,
+                                                  out + produced, length - produced);
+                this->inPos += used;
+                if (produced == length)
+                    return produced;
+                if (this->inPos < this->inLength)
+                    continue;
+                if (this->eof)
+                {
+                    if (!this->decoder->Complete())
+                    {
+                        errno = EIO;
+                        msg = this->path + ": unexpected end of compressed data";
+                        return -1;
+                    }
+                    return produced;
+                }
+            }
+            tSize n = hdfsRead(this->fs, file, this->input.data(), this->input.size());
+            if (n < 0)
+            {
+                msg = hdfsGetLastError();
+                return -1;
+            }
+            this->inPos = 0;
+            this->inLength = n;
+            this->eof = n == 0;
+            if (!this->decoder)
+            {
+                CodecType type = this->codec;
+                CodecType magic = CodecFromMagic(this->input.data(), n);
+                if (type == CODEC_AUTO)
+                    type = magic != CODEC_NONE ? magic : CodecFromPath(this->path);
+                else if (type == CODEC_LZ4 && magic == CODEC_LZ4_FRAME)
+                    type = magic;
+                this->decoder.reset(Decoder::Create(type));
+            }
+        }
+    }
+    catch (const std::exception &e)
+    {
+        errno = EIO;
+        msg = this->path + ": " + e.what();
+        return -1;
+    }
+}
+
+/**
+* Completion of a read for ReadRecords. Reads are chained into the same
+* chunk until it is nearly full, then the records are split on the
+* libhdfs3 thread and the partial record at the end is carried over.
+* With a range set only the records starting in it are returned.
+*/
+class RecordReadCompletion : public Completion
+{
+  public:
+    /**
+    * Keep reading into the chunk while more than this is free,
+    * and the size of the reads past the end of the range.
+    */
+    static const size_t MIN_READ = 64 * 1024;
+
+    RecordReadCompletion(Napi::Env env, FileReader *reader, size_t batch, char delimiter, Napi::Function cb)
+        : Completion(cb), env(env), reader(reader), batch(batch), delimiter(delimiter) {}
+
+    virtual ~RecordReadCompletion()
+    {
+        if (this->chunk)
+            BufferPool::Instance().Release(this->env, this->chunk);
+    }
+
+    /**
+    * Read into the chunk, a new one starting with the carried record if
+    * there is none.
+    */
+    void Read()
+    {
+        FileReader &r = *this->reader;
+        this->Keep(r.Value());
+        if (!this->chunk)
+        {
+            if (r.rangeDone)
+            {
+                this->Complete();
+                return;
+            }
+            // the carried record has no delimiter, leave room for as many new bytes
+            this->capacity = std::max(this->batch, r.carry.size() * 2);
+            // one more byte to terminate the last record
+            this->chunk = BufferPool::Instance().Acquire(this->env, this->capacity + 1);
+            memcpy(this->chunk->data, r.carry.data(), r.carry.size());
+            this->filled = this->scanned = r.carry.size();
+            this->chunkPos = r.position - r.carry.size();
+            r.carry.clear();
+        }
+        size_t length = this->capacity - this->filled;
+        if (r.rangeEnd >= 0 && this->chunkPos + static_cast<int64_t>(this->filled) >= r.rangeEnd)
+        {
+            // only the end of the last record is missing
+            length = std::min(length, MIN_READ);
+        }
+        char *buffer = this->chunk->data + this->filled;
+        if (r.seek)
+        {
+            r.seek = false;
+            this->Begin();
+            this->Start(hdfsAsyncReadFrom(r.fs, r.file, r.position, buffer, length, &Completion::Callback, this));
+        }
+        else
+        {
+            this->Begin();
+            this->Start(hdfsAsyncRead(r.fs, r.file, buffer, length, &Completion::Callback, this));
+        }
+    }
+
+  protected:
+    void Collect(hdfsAsyncResult *result) override
+    {
+        Completion::Collect(result);
+        if (this->res < 0)
+            return;
+        FileReader &r = *this->reader;
+        r.position += this->res;
+        this->filled += this->res;
+        this->eof = this->res == 0;
+        bool pastEnd = r.rangeEnd >= 0 && this->chunkPos + static_cast<int64_t>(this->filled) >= r.rangeEnd;
+        if (!this->eof && !pastEnd &&
+            this->capacity - this->filled >= std::max<size_t>(std::min(MIN_READ, this->capacity / 2), 1))
+        {
+            this->more = true;
+            return;
+        }
+        if (!r.skipFirst)
+            this->ends.push_back(0);
+        FindRecordEnds(this->chunk->data + this->scanned, this->filled - this->scanned, this->delimiter,
+                       this->scanned, this->ends);
+        if (this->ends.empty())
+        {
+            // still in the record which started before the range
+            this->done = this->eof || pastEnd;
+            r.rangeDone = this->done;
+            this->filled = 0;
+            return;
+        }
+        r.skipFirst = false;
+        if (this->eof && this->filled > this->ends.back())
+        {
+            // the chunk has room for one more byte
+            this->chunk->data[this->filled++] = this->delimiter;
+            this->ends.push_back(this->filled);
+        }
+        if (r.rangeEnd >= 0)
+        {
+            size_t records = this->ends.size() - 1, kept = 0;
+            while (kept < records && this->chunkPos + this->ends[kept] < r.rangeEnd)
+                ++kept;
+            if (this->chunkPos + this->ends[kept] >= r.rangeEnd)
+            {
+                // the next record belongs to the next range
+                this->ends.resize(kept + 1);
+                this->done = r.rangeDone = true;
+            }
+        }
+        size_t complete = this->ends.back();
+        if (!this->done)
+            r.carry.assign(this->chunk->data + complete, this->filled - complete);
+        this->filled = complete;
+    }
+
+    void OnComplete(Napi::Env env) override
+    {
+        size_t records = this->ends.empty() ? 0 : this->ends.size() - 1;
+        if (this->res >= 0 && this->chunk && (this->more || (records == 0 && !this->eof && !this->done)))
+        {
+            RecordReadCompletion *next =
+                new RecordReadCompletion(env, this->reader, this->batch, this->delimiter, this->callback.Value());
+            if (this->more)
+            {
+                next->chunk = this->chunk;
+                next->capacity = this->capacity;
+                next->filled = this->filled;
+                next->scanned = this->scanned;
+                next->chunkPos = this->chunkPos;
+                this->chunk = nullptr;
+            }
+            // otherwise a record longer than the chunk, or still before the range: start a new one
+            next->Read();
+            return;
+        }
+        Napi::Value buffer = env.Null();
+        Napi::Value offsets = env.Null();
+        if (this->res >= 0 && records > 0)
+        {
+            buffer = BufferPool::Instance().Wrap(env, this->chunk, this->filled);
+            this->chunk = nullptr; // owned by the buffer now
+            Napi::Uint32Array o = Napi::Uint32Array::New(env, this->ends.size());
+            memcpy(o.Data(), this->ends.data(), this->ends.size() * sizeof(uint32_t));
+            offsets = o;
+        }
+        this->callback.MakeCallback(env.Global(), std::initializer_list<napi_value>{Error(env), buffer, offsets});
+    }
+
+  private:
+    Napi::Env env;
+    FileReader *reader;
+    size_t batch;
+    char delimiter;
+    BufferPool::Chunk *chunk = nullptr;
+    size_t capacity = 0;
+    size_t filled = 0;
+    size_t scanned = 0;
+    int64_t chunkPos = 0;
+    bool eof = false;
+    bool more = false;
+    bool done = false;
+    std::vector<uint32_t> ends;
+};
+
+Napi::Value FileReader::ReadRecords(const Napi::CallbackInfo &info)
+{
+    REQUIRE_ARGUMENTS(3);
+    REQUIRE_ARGUMENT_INT(0, l)
+    REQUIRE_ARGUMENT_INT(1, delimiter)
+    REQUIRE_ARGUMENT_FUNCTION(2, cb)
+    RecordReadCompletion *c = new RecordReadCompletion(info.Env(), this, std::max(l, 1), delimiter, cb);
+    c->Read();
+    return info.Env().Null();
+}
+
+Napi::Value FileReader::SetCachingStrategy(const Napi::CallbackInfo &info)
+{
+    REQUIRE_ARGUMENTS(2);
+    REQUIRE_ARGUMENT_INT(0, dropBehind)
+    REQUIRE_ARGUMENT_LONG(1, readahead)
+    this->dropBehind = dropBehind;
+    this->readahead = readahead;
+    return info.Env().Null();
+}
+
+Napi::Value FileReader::SetRange(const Napi::CallbackInfo &info)
+{
+    REQUIRE_ARGUMENTS(2);
+    REQUIRE_ARGUMENT_LONG(0, start)
+    REQUIRE_ARGUMENT_LONG(1, end)
+    // a record starts in the range if the byte before it is a delimiter
+    this->skipFirst = start > 0;
+    this->position = start > 0 ? start - 1 : 0;
+    this->seek = true;
+    this->rangeEnd = end;
+    this->rangeDone = start >= end;
+    this->carry.clear();
     return info.Env().Null();
 }
 
@@ -81,13 +503,34 @@ Napi::Value FileReader::Close(const Napi::CallbackInfo &info)
 {
     REQUIRE_ARGUMENTS(1);
     REQUIRE_ARGUMENT_FUNCTION(0, cb)
-    std::function<int()> f = [this] {
-        return close();
-    };
-    SimpleResWorker::Start(f, cb);
+    if (this->working > 0)
+    {
+        // codec reads use the file on libuv threads, close once they are done
+        this->closing = Napi::Persistent(cb);
+        return info.Env().Null();
+    }
+    closeFile(cb);
     return info.Env().Null();
 }
 
+void FileReader::closeFile(Napi::Function cb)
+{
+    if (!this->file)
+    {
+        std::function<int()> f = [this] {
+            return close();
+        };
+        SimpleResWorker::Start(f, cb);
+        return;
+    }
+    Completion *c = new Completion(cb);
+    c->Keep(this->Value());
+    // queued behind the reads in flight on this file
+    c->Begin();
+    c->Start(hdfsAsyncCloseFile(fs, file, &Completion::Callback, c));
+    this->file = nullptr;
+}
+
 int FileReader::close()
 {
     if ( this->file ) {
@@ -1,20 +1,31 @@
 #ifndef NHDFS_FILEREADER_H_
 #define NHDFS_FILEREADER_H_
 
+#include <memory>
 #include <string>
+#include <vector>
 #include <napi.h>
 #include <hdfs/hdfs.h>
 
+#include "codec.h"
+
 namespace nhdfs
 {
 
 class FileReader;
+class RecordReadCompletion;
+class DecodeWorker;
 
 class FileReader : public Napi::ObjectWrap<FileReader>
 {
   public:
     static Napi::FunctionReference constructor;
 
+    /**
+    * Size of the compressed reads of ReadDecoded.
+    */
+    static const size_t CODEC_INPUT_SIZE = 256 * 1024;
+
     static void Init(Napi::Env env, Napi::Object exports);
 
     FileReader(const Napi::CallbackInfo &info);
@@ -24,15 +35,105 @@ class FileReader : public Napi::ObjectWrap<FileReader>
 
     Napi::Value Read(const Napi::CallbackInfo &info);
 
+    /**
+    * Read at an absolute position without moving the stream, the
+    * callback gets (err, bytesRead), less than asked only at EOF.
+    */
+    Napi::Value ReadAt(const Napi::CallbackInfo &info);
+
+    /**
+    * Read into a buffer taken from the native BufferPool.
+    * The callback gets (err, buffer), buffer is null at EOF.
+    */
+    Napi::Value ReadPooled(const Napi::CallbackInfo &info);
+
+    /**
+    * Decompress the file with the named codec. auto detects it on the first
+    * read from the magic bytes, then the extension. Throws if the codec is
+    * not available.
+    */
+    Napi::Value SetCodec(const Napi::CallbackInfo &info);
+
+    /**
+    * Read decompressed data into a buffer taken from the native BufferPool.
+    * The callback gets (err, buffer), buffer is null at EOF.
+    */
+    Napi::Value ReadDecoded(const Napi::CallbackInfo &info);
+
+    /**
+    * Read a batch of complete records into a buffer taken from the native
+    * BufferPool, takes the batch size, the delimiter and the callback.
+    * The callback gets (err, buffer, offsets), offsets is a Uint32Array
+    * with the start of every record and the end of the last one. A record
+    * not terminated at the end of the file gets the delimiter appended.
+    * buffer is null at EOF.
+    */
+    Napi::Value ReadRecords(const Napi::CallbackInfo &info);
+
+    /**
+    * Limit ReadRecords to the records starting in [start, end), the last
+    * one is read past end. Call before the first ReadRecords.
+    */
+    Napi::Value SetRange(const Napi::CallbackInfo &info);
+
+    /**
+    * Page cache hints for the datanodes, takes dropBehind (1, 0 or -1)
+    * and readahead (bytes or -1), -1 keeps the hint of the handle.
+    * Call before Open.
+    */
+    Napi::Value SetCachingStrategy(const Napi::CallbackInfo &info);
+
     Napi::Value Close(const Napi::CallbackInfo &info);
 
   private:
     
     int close();
 
+    /**
+    * Close the file behind the reads queued on it, cb gets (err).
+    */
+    void closeFile(Napi::Function cb);
+
+    /**
+    * Called on the JS thread when a codec read is done, starts a Close
+    * waiting for it.
+    */
+    void workDone();
+
+    /**
+    * Fill out with decompressed data read from file, called on a libuv
+    * thread. Returns the number of bytes, 0 at EOF or -1 with errno and
+    * msg set.
+    */
+    int decode(hdfsFile file, char *out, int length, std::string &msg);
+
+    friend class RecordReadCompletion;
+    friend class DecodeWorker;
+
     hdfsFS fs;
     std::string path;
-    hdfsFile file;
+    hdfsFile file = nullptr;
+    int dropBehind = -1;
+    int64_t readahead = -1;
+
+    CodecType codec = CODEC_NONE;
+    std::unique_ptr<Decoder> decoder;
+    std::vector<char> input;
+    size_t inPos = 0;
+    size_t inLength = 0;
+    bool eof = false;
+    // codec reads on libuv threads, JS thread only
+    int working = 0;
+    Napi::FunctionReference closing;
+
+    // partial record left by the last ReadRecords
+    std::string carry;
+    // file offset of the next byte ReadRecords reads
+    int64_t position = 0;
+    bool seek = false;
+    bool skipFirst = false;
+    int64_t rangeEnd = -1;
+    bool rangeDone = false;
 };
 
 }
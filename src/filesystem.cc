@@ -6,47 +6,30 @@
 #include <thread>
 #include <functional>
 #include <iostream>
+#include <mutex>
+#include <uv.h>
 
 #include "filesystem.h"
+#include "completion.h"
+#include "fsregistry.h"
 #include "macros.h"
 #include "workers.h"
 
+#include <stdlib.h>
 #include <string.h>
 
 namespace nhdfs
 {
 
-void setParam(std::string key, Napi::Object params, std::function<void(std::string)> f)
+void setParam(std::string key, Napi::Object params, std::string &value)
 {
     if (params.Has(key))
     {
         Napi::Value v = params[key];
-        std::string vs = v.As<Napi::String>();
-        f(vs);
+        value = v.As<Napi::String>();
     }
 }
 
-hdfsFS connect(std::string node, tPort port, Napi::Object params, Napi::Env env)
-{
-    //std::cout << "trying to connect " << node << ":" << port << std::endl;
-    struct hdfsBuilder *builder = hdfsNewBuilder();
-    hdfsBuilderSetNameNode(builder, node.c_str());
-    if (port > 0)
-    {
-        hdfsBuilderSetNameNodePort(builder, port);
-    }
-    setParam(USER, params, [builder](std::string user) { hdfsBuilderSetUserName(builder, user.c_str()); } );
-    setParam(TOKEN, params, [builder](std::string token) { hdfsBuilderSetToken(builder, token.c_str()); } );
-    setParam(TICKETPATH, params, [builder](std::string path) { hdfsBuilderSetKerbTicketCachePath(builder, path.c_str()); } );
-    hdfsFS fs = hdfsBuilderConnect(builder);
-    hdfsFreeBuilder(builder);
-    if (!fs)
-    {
-        throw Napi::Error::New(env, hdfsGetLastError());
-    }
-    return fs;
-}
-
 Napi::FunctionReference FileSystem::constructor;
 
 void FileSystem::Init(Napi::Env env, Napi::Object exports)
@@ -58,7 +41,9 @@ void FileSystem::Init(Napi::Env env, Napi::Object exports)
             "FileSystem",
             {InstanceMethod("Exists", &FileSystem::Exists),
              InstanceMethod("Rename", &FileSystem::Rename),
-             //  InstanceMethod("Copy", &FileSystem::Copy),
+             InstanceMethod("Copy", &FileSystem::Copy),
+             InstanceMethod("Concat", &FileSystem::Concat),
+             InstanceMethod("CopyTree", &FileSystem::CopyTree),
              InstanceMethod("GetWorkingDirectory", &FileSystem::GetWorkingDirectory),
              InstanceMethod("SetWorkingDirectory", &FileSystem::SetWorkingDirectory),
              InstanceMethod("CreateDirectory", &FileSystem::CreateDirectory),
@@ -72,7 +57,9 @@ void FileSystem::Init(Napi::Env env, Napi::Object exports)
              InstanceMethod("Chown", &FileSystem::Chown),
              InstanceMethod("Chmod", &FileSystem::Chmod),
              InstanceMethod("Utime", &FileSystem::Utime),
-             InstanceMethod("Truncate", &FileSystem::Truncate)
+             InstanceMethod("Truncate", &FileSystem::Truncate),
+             InstanceMethod("Checksum", &FileSystem::Checksum),
+             InstanceMethod("Connect", &FileSystem::Connect)
              });            
     constructor = Napi::Persistent(t);
     constructor.SuppressDestruct();
@@ -88,13 +75,70 @@ FileSystem::FileSystem(const Napi::CallbackInfo &info) : Napi::ObjectWrap<FileSy
 
     this->nameNode = nn;
     this->port = p;
-    this->params = params;
-    this->fs = connect(this->nameNode, this->port, this->params, info.Env());
+    this->key.nameNode = nn;
+    this->key.port = p;
+    setParam(USER, params, this->key.user);
+    setParam(TOKEN, params, this->key.token);
+    setParam(TICKETPATH, params, this->key.ticketPath);
+    setParam(CONF, params, this->key.conf);
+    if (params.Has(SETTINGS))
+    {
+        // [name, value] pairs
+        Napi::Array settings = params.Get(SETTINGS).As<Napi::Array>();
+        for (uint32_t i = 0; i < settings.Length(); ++i)
+        {
+            Napi::Array setting = settings.Get(i).As<Napi::Array>();
+            std::string name = setting.Get(0u).ToString();
+            this->key.settings[name] = setting.Get(1u).ToString();
+        }
+    }
+    if (params.Has(SHARED) && !params.Get(SHARED).ToBoolean())
+    {
+        FsRegistry::Instance().Unshare(this->key);
+    }
+    bool deferred = info.Length() > 3 && info[3].ToBoolean();
+    if (!deferred)
+    {
+        std::string error;
+        this->fs = FsRegistry::Instance().Acquire(this->key, error);
+        if (!this->fs)
+        {
+            throw Napi::Error::New(info.Env(), error);
+        }
+    }
 }
 
 FileSystem::~FileSystem()
 {
-    hdfsDisconnect(this->fs);
+    if (this->fs)
+    {
+        FsRegistry::Instance().Release(this->fs);
+    }
+}
+
+Napi::Value FileSystem::Connect(const Napi::CallbackInfo &info)
+{
+    REQUIRE_ARGUMENTS(1)
+    REQUIRE_ARGUMENT_FUNCTION(0, cb)
+    if (this->fs || this->connecting)
+    {
+        Napi::Error::New(info.Env(), "FileSystem is already connected").ThrowAsJavaScriptException();
+        return info.Env().Null();
+    }
+    this->connecting = true;
+    std::function<int(std::string &)> f = [this](std::string &msg) {
+        hdfsFS connected = FsRegistry::Instance().Acquire(this->key, msg);
+        if (!connected)
+        {
+            return -1;
+        }
+        // only read on the JS thread once the callback ran
+        this->fs = connected;
+        return 0;
+    };
+    BlockingWorker *worker = new BlockingWorker(this->Value(), f, cb);
+    worker->Queue();
+    return info.Env().Null();
 }
 
 Napi::Value FileSystem::Exists(const Napi::CallbackInfo &info)
@@ -122,18 +166,201 @@ Napi::Value FileSystem::Rename(const Napi::CallbackInfo &info)
     return info.Env().Null();
 }
 
-// Napi::Value FileSystem::Copy(const Napi::CallbackInfo &info)
-// {
-//     REQUIRE_ARGUMENTS(3)
-//     REQUIRE_ARGUMENT_STRING(0, oldPath)
-//     REQUIRE_ARGUMENT_STRING(1, newPath)
-//     REQUIRE_ARGUMENT_FUNCTION(2, cb)
-//     std::function<int()> f = [this, oldPath, newPath] {
-//         return hdfsCopy(fs, oldPath.c_str(), fs, newPath.c_str());
-//     };
-//     SimpleResWorker::Start(f, cb);
-//     return info.Env().Null();
-// }
+Napi::Value FileSystem::Concat(const Napi::CallbackInfo &info)
+{
+    REQUIRE_ARGUMENTS(3)
+    REQUIRE_ARGUMENT_STRING(0, target)
+    REQUIRE_ARGUMENT_FUNCTION(2, cb)
+    if (!info[1].IsArray())
+    {
+        Napi::TypeError::New(info.Env(), "Argument 1 must be an array").ThrowAsJavaScriptException();
+        return info.Env().Null();
+    }
+    Napi::Array array = info[1].As<Napi::Array>();
+    std::vector<std::string> srcs;
+    for (uint32_t i = 0; i < array.Length(); ++i)
+    {
+        srcs.push_back(array.Get(i).ToString());
+    }
+    std::function<int()> f = [this, target, srcs] {
+        std::vector<const char *> paths;
+        for (const std::string &src : srcs)
+        {
+            paths.push_back(src.c_str());
+        }
+        return hdfsConcat(fs, target.c_str(), paths.data(), paths.size());
+    };
+    SimpleResWorker::Start(f, cb);
+    return info.Env().Null();
+}
+
+Napi::Value FileSystem::Copy(const Napi::CallbackInfo &info)
+{
+    REQUIRE_ARGUMENTS(3)
+    REQUIRE_ARGUMENT_STRING(0, oldPath)
+    REQUIRE_ARGUMENT_STRING(1, newPath)
+    REQUIRE_ARGUMENT_FUNCTION(2, cb)
+    std::function<int()> f = [this, oldPath, newPath] {
+        return hdfsCopy(fs, oldPath.c_str(), fs, newPath.c_str());
+    };
+    SimpleResWorker::Start(f, cb);
+    return info.Env().Null();
+}
+
+static Napi::Object CopyProgressToObject(Napi::Env env, const hdfsCopyProgress &p)
+{
+    Napi::Object res = Napi::Object::New(env);
+    res.Set(NAPISTRING(env, "files"), Napi::Number::New(env, p.files));
+    res.Set(NAPISTRING(env, "filesCopied"), Napi::Number::New(env, p.filesCopied));
+    res.Set(NAPISTRING(env, "filesSkipped"), Napi::Number::New(env, p.filesSkipped));
+    res.Set(NAPISTRING(env, "bytes"), Napi::Number::New(env, p.bytes));
+    res.Set(NAPISTRING(env, "bytesCopied"), Napi::Number::New(env, p.bytesCopied));
+    res.Set(NAPISTRING(env, "bytesSkipped"), Napi::Number::New(env, p.bytesSkipped));
+    return res;
+}
+
+/**
+* Runs hdfsCopyTree on a libuv thread. The counters are handed to
+* onProgress on the JS thread through a uv_async_t as the copy advances,
+* only the latest ones while the JS thread is busy. The callback gets
+* (err, counters).
+*/
+class CopyWorker : public BlockingWorker
+{
+  public:
+    CopyWorker(Napi::Object receiver, Napi::Function cb, Napi::Function onProgress,
+               hdfsFS srcFs, const std::string &src, hdfsFS dstFs, const std::string &dst,
+               const hdfsCopyOptions &options)
+        : BlockingWorker(receiver, [this](std::string &msg) { return this->Copy(msg); }, cb),
+          srcFs(srcFs), src(src), dstFs(dstFs), dst(dst), options(options)
+    {
+        this->options.progress = nullptr;
+        this->options.data = nullptr;
+        if (!onProgress.IsEmpty())
+        {
+            uv_loop_t *loop = nullptr;
+            napi_get_uv_event_loop(this->Env(), &loop);
+            this->async = new uv_async_t;
+            uv_async_init(loop, this->async, &CopyWorker::OnAsync);
+            this->async->data = this;
+            this->onProgress = Napi::Persistent(onProgress);
+            this->options.progress = &CopyWorker::OnProgress;
+            this->options.data = this;
+        }
+    }
+
+    ~CopyWorker()
+    {
+        // no progress is reported any more, the copy is done
+        if (this->async)
+        {
+            uv_close(reinterpret_cast<uv_handle_t *>(this->async),
+                     [](uv_handle_t *handle) { delete reinterpret_cast<uv_async_t *>(handle); });
+        }
+    }
+
+  protected:
+    Napi::Value Result(Napi::Env env) override
+    {
+        return CopyProgressToObject(env, this->result);
+    }
+
+  private:
+    int Copy(std::string &msg)
+    {
+        int res = hdfsCopyTree(this->srcFs, this->src.c_str(), this->dstFs, this->dst.c_str(),
+                               &this->options, &this->result);
+        if (res < 0)
+        {
+            msg = hdfsGetLastError();
+        }
+        return res;
+    }
+
+    static void OnProgress(const hdfsCopyProgress *progress, void *data)
+    {
+        CopyWorker *self = static_cast<CopyWorker *>(data);
+        std::lock_guard<std::mutex> lock(self->mut);
+        self->latest = *progress;
+        if (!self->scheduled)
+        {
+            self->scheduled = true;
+            uv_async_send(self->async);
+        }
+    }
+
+    static void OnAsync(uv_async_t *handle)
+    {
+        CopyWorker *self = static_cast<CopyWorker *>(handle->data);
+        hdfsCopyProgress progress;
+        {
+            std::lock_guard<std::mutex> lock(self->mut);
+            progress = self->latest;
+            self->scheduled = false;
+        }
+        Napi::Env env = self->Env();
+        Napi::HandleScope scope(env);
+        try
+        {
+            self->onProgress.MakeCallback(self->Receiver().Value(),
+                                          std::initializer_list<napi_value>{CopyProgressToObject(env, progress)});
+        }
+        catch (const Napi::Error &e)
+        {
+            // there is no JS frame to throw into, treat it like an uncaught exception
+#if NAPI_VERSION >= 3
+            napi_fatal_exception(env, e.Value());
+#else
+            napi_fatal_error("nhdfs", NAPI_AUTO_LENGTH, e.Message().c_str(), NAPI_AUTO_LENGTH);
+#endif
+        }
+    }
+
+    hdfsFS srcFs;
+    std::string src;
+    hdfsFS dstFs;
+    std::string dst;
+    hdfsCopyOptions options;
+    hdfsCopyProgress result = hdfsCopyProgress();
+    Napi::FunctionReference onProgress;
+    uv_async_t *async = nullptr;
+    std::mutex mut;
+    hdfsCopyProgress latest = hdfsCopyProgress();
+    bool scheduled = false;
+};
+
+/**
+* Copy a file or mirror a tree to the FileSystem dstFs, see hdfsCopyTree.
+* Arguments: src, dstFs, dst, parallelism, skipIfChecksumMatches, preserve,
+* blocksPerPart, bufferSize, onProgress (or null), cb.
+*/
+Napi::Value FileSystem::CopyTree(const Napi::CallbackInfo &info)
+{
+    REQUIRE_ARGUMENTS(10)
+    REQUIRE_ARGUMENT_STRING(0, src)
+    REQUIRE_ARGUMENT_FS(1, dstFs)
+    REQUIRE_ARGUMENT_STRING(2, dst)
+    REQUIRE_ARGUMENT_INT(3, parallelism)
+    REQUIRE_ARGUMENT_INT(5, preserve)
+    REQUIRE_ARGUMENT_INT(6, blocksPerPart)
+    REQUIRE_ARGUMENT_LONG(7, bufferSize)
+    REQUIRE_ARGUMENT_FUNCTION(9, cb)
+    Napi::Function onProgress;
+    if (info[8].IsFunction())
+    {
+        onProgress = info[8].As<Napi::Function>();
+    }
+    hdfsCopyOptions options = hdfsCopyOptions();
+    options.parallelism = parallelism;
+    options.skipIfChecksumMatches = info[4].ToBoolean();
+    options.preserve = preserve;
+    options.blocksPerPart = blocksPerPart;
+    options.bufferSize = bufferSize;
+    CopyWorker *worker = new CopyWorker(this->Value(), cb, onProgress, this->fs, src, dstFs->fs, dst, options);
+    worker->Keep(dstFs->Value());
+    worker->Queue();
+    return info.Env().Null();
+}
 
 Napi::Value FileSystem::GetWorkingDirectory(const Napi::CallbackInfo &info)
 {
@@ -223,49 +450,58 @@ Napi::Object FileInfoToObject(hdfsFileInfo *fileStat, Napi::Env env)
     return res;
 }
 
-class ListWorker : public Napi::AsyncWorker
+/**
+* Completion of hdfsAsyncListDirectory and hdfsAsyncGetPathInfo,
+* calls back with (err, array) or (err, object) when single is set.
+*/
+class FileInfoCompletion : public Completion
 {
   public:
-    ListWorker(const std::string &p, Napi::Function cb, hdfsFS fs) : AsyncWorker(cb), fs(fs), path(p), msg("") {}
-    virtual ~ListWorker()
+    FileInfoCompletion(bool single, Napi::Function cb) : Completion(cb, true), single(single) {}
+
+    virtual ~FileInfoCompletion()
     {
         if (this->info)
             hdfsFreeFileInfo(this->info, this->num);
     }
-    void Execute() override
+
+  protected:
+    void Collect(hdfsAsyncResult *result) override
     {
-        this->info = hdfsListDirectory(this->fs, this->path.c_str(), &this->num);
-        if (!this->info)
-        {
-            this->msg = hdfsGetLastError();
-        }
+        Completion::Collect(result);
+        this->info = result->info;
+        this->num = result->numEntries;
     }
-    void OnOK() override
+
+    void OnComplete(Napi::Env env) override
     {
-        auto nv = this->Env().Null(); //either error or result list
-        if (this->info)
+        auto nv = env.Null(); //either error or result
+        if (this->res < 0)
+        {
+            auto err = Napi::String::New(env, this->msg);
+            this->callback.MakeCallback(env.Global(), std::initializer_list<napi_value>{err, nv, Timings(env)});
+        }
+        else if (this->single)
+        {
+            Napi::Object result = FileInfoToObject(this->info, env);
+            this->callback.MakeCallback(env.Global(), std::initializer_list<napi_value>{nv, result, Timings(env)});
+        }
+        else
         {
-            Napi::Array result(Napi::Array::New(this->Env(), num));
+            Napi::Array result(Napi::Array::New(env, this->num));
             for (int i = 0; i < this->num; i++)
             {
-                Napi::Object o = FileInfoToObject(&this->info[i], this->Env());
+                Napi::Object o = FileInfoToObject(&this->info[i], env);
                 (result).Set(i, o);
             }
-            this->Callback().MakeCallback(this->Receiver().Value(), std::initializer_list<napi_value>{nv, result});
-        }
-        else
-        {
-            auto err = Napi::String::New(this->Env(), this->msg);
-            this->Callback().MakeCallback(this->Receiver().Value(), std::initializer_list<napi_value>{err, nv});
+            this->callback.MakeCallback(env.Global(), std::initializer_list<napi_value>{nv, result, Timings(env)});
         }
     }
 
   private:
-    hdfsFS fs;
+    const bool single;
     hdfsFileInfo *info = nullptr;
     int num = 0;
-    const std::string path;
-    std::string msg;
 };
 
 Napi::Value FileSystem::List(const Napi::CallbackInfo &info)
@@ -273,57 +509,22 @@ Napi::Value FileSystem::List(const Napi::CallbackInfo &info)
     REQUIRE_ARGUMENTS(2);
     std::string path = info[0].As<Napi::String>();
     Napi::Function cb = info[1].As<Napi::Function>();
-    ListWorker *worker = new ListWorker(path, cb, this->fs);
-    worker->Queue();
+    FileInfoCompletion *c = new FileInfoCompletion(false, cb);
+    c->Keep(this->Value());
+    c->Begin();
+    c->Start(hdfsAsyncListDirectory(this->fs, path.c_str(), &Completion::Callback, c));
     return info.Env().Null();
 }
 
-class PathInfoWorker : public Napi::AsyncWorker
-{
-  public:
-    PathInfoWorker(const std::string &p, Napi::Function cb, hdfsFS fs) : AsyncWorker(cb), fs(fs), path(p), msg("") {}
-    virtual ~PathInfoWorker()
-    {
-        if (this->info)
-            hdfsFreeFileInfo(this->info, 1);
-    }
-    void Execute() override
-    {
-        this->info = hdfsGetPathInfo(this->fs, this->path.c_str());
-        if (!this->info)
-        {
-            this->msg = hdfsGetLastError();
-        }
-    }
-    void OnOK() override
-    {
-        auto nv = this->Env().Null(); //either error or result list
-        if (this->info)
-        {
-            Napi::Object result = FileInfoToObject(this->info, this->Env());
-            this->Callback().MakeCallback(this->Receiver().Value(), std::initializer_list<napi_value>{nv, result});
-        }
-        else
-        {
-            auto err = Napi::String::New(this->Env(), this->msg);
-            this->Callback().MakeCallback(this->Receiver().Value(), std::initializer_list<napi_value>{err, nv});
-        }
-    }
-
-  private:
-    hdfsFS fs;
-    hdfsFileInfo *info = nullptr;
-    const std::string path;
-    std::string msg;
-};
-
 Napi::Value FileSystem::GetPathInfo(const Napi::CallbackInfo &info)
 {
     REQUIRE_ARGUMENTS(2);
     std::string path = info[0].As<Napi::String>();
     Napi::Function cb = info[1].As<Napi::Function>();
-    PathInfoWorker *worker = new PathInfoWorker(path, cb, this->fs);
-    worker->Queue();
+    FileInfoCompletion *c = new FileInfoCompletion(true, cb);
+    c->Keep(this->Value());
+    c->Begin();
+    c->Start(hdfsAsyncGetPathInfo(this->fs, path.c_str(), &Completion::Callback, c));
     return info.Env().Null();
 }
 
@@ -462,4 +663,24 @@ Napi::Value FileSystem::Chmod(const Napi::CallbackInfo &info)
     return info.Env().Null();
  }
 
+/**
+ * hdfsGetFileChecksum - Get the MD5-of-MD5-of-CRC checksum of a file.
+ * @param path the path to the file.
+ * @return the checksum object, see convert<hdfsFileChecksum>.
+ */
+ Napi::Value FileSystem::Checksum(const Napi::CallbackInfo &info)
+ {
+    REQUIRE_ARGUMENTS(2)
+    REQUIRE_ARGUMENT_STRING(0, path)
+    REQUIRE_ARGUMENT_FUNCTION(1, cb)
+    std::function<res_ptr<hdfsFileChecksum>()> f = [this, path] {
+        hdfsFileChecksum checksum = hdfsFileChecksum();
+        int res = hdfsGetFileChecksum(fs, path.c_str(), &checksum);
+        AsyncResult<hdfsFileChecksum> * ar = new AsyncResult<hdfsFileChecksum>(res, checksum);
+        return res_ptr<hdfsFileChecksum>(ar);
+    };
+    ValueWorker<hdfsFileChecksum>::Start(f, cb);
+    return info.Env().Null();
+ }
+
 } // namespace nhdfs
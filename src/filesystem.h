@@ -7,6 +7,7 @@
 #include <napi.h>
 
 #include "nhdfs.h"
+#include "fsregistry.h"
 
 #include <hdfs/hdfs.h>
 #include <memory>
@@ -18,6 +19,9 @@ namespace nhdfs
 #define USER "user"
 #define TICKETPATH "kerbTicketCachePath"
 #define TOKEN "authToken"
+#define SHARED "shared"
+#define SETTINGS "settings"
+#define CONF "configurationPath"
 
 class FileSystem;
 
@@ -40,7 +44,18 @@ public:
   Napi::Value Exists(const Napi::CallbackInfo &info);
 
   Napi::Value Rename(const Napi::CallbackInfo &info);
-  // Napi::Value Copy(const Napi::CallbackInfo &info);
+  Napi::Value Copy(const Napi::CallbackInfo &info);
+
+  /**
+  * hdfsConcat, takes the target path and an array of source paths.
+  */
+  Napi::Value Concat(const Napi::CallbackInfo &info);
+
+  /**
+  * Copy a file or mirror a tree to another FileSystem, or within this one,
+  * see hdfsCopyTree. The callback gets (err, counters).
+  */
+  Napi::Value CopyTree(const Napi::CallbackInfo &info);
   Napi::Value GetWorkingDirectory(const Napi::CallbackInfo &info);
   Napi::Value SetWorkingDirectory(const Napi::CallbackInfo &info);
 
@@ -104,6 +119,17 @@ public:
  */
  Napi::Value Truncate(const Napi::CallbackInfo &info);
 
+ /**
+ * Checksum - Get the MD5-of-MD5-of-CRC checksum of a file, computed by the
+ * datanodes without reading the data. The callback gets (err, checksum).
+ */
+ Napi::Value Checksum(const Napi::CallbackInfo &info);
+
+  /**
+  * Connect on a libuv thread when the object was created deferred,
+  * the callback gets (err).
+  */
+  Napi::Value Connect(const Napi::CallbackInfo &info);
 
   FileSystem(const Napi::CallbackInfo &info);
   ~FileSystem();
@@ -117,7 +143,9 @@ public:
 private:
   std::string nameNode;
   tPort port;
-  Napi::Object params;
+  FsRegistry::Key key;
+  bool connecting = false;
+  // shared with the other FileSystem objects of the same key, see FsRegistry
   hdfsFS fs = nullptr;
 };
 
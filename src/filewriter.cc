@@ -1,9 +1,13 @@
 
 #include "filewriter.h"
 #include "filesystem.h"
+#include "completion.h"
 #include "workers.h"
 #include "macros.h"
 
+#include <algorithm>
+#include <errno.h>
+#include <exception>
 #include <iostream>
 
 namespace nhdfs
@@ -19,6 +23,9 @@ void FileWriter::Init(Napi::Env env, Napi::Object exports)
             env,
             "FileWriter",
             {InstanceMethod("Open", &FileWriter::Open),
+             InstanceMethod("SetCodec", &FileWriter::SetCodec),
+             InstanceMethod("SetCachingStrategy", &FileWriter::SetCachingStrategy),
+             InstanceMethod("SetFavoredNodes", &FileWriter::SetFavoredNodes),
              InstanceMethod("Write", &FileWriter::Write),
              InstanceMethod("Flush", &FileWriter::Flush),
              InstanceMethod("HFlush", &FileWriter::HFlush),
@@ -51,29 +58,117 @@ FileWriter::~FileWriter()
 
 Napi::Value FileWriter::Open(const Napi::CallbackInfo &info) 
 {
-    REQUIRE_ARGUMENTS(2)
+    REQUIRE_ARGUMENTS(4)
     REQUIRE_ARGUMENT_INT(0, replication)
-    REQUIRE_ARGUMENT_FUNCTION(1, cb)
-    std::function<int()> f = [replication, this] {
-        file = hdfsOpenFile(fs, path.c_str(), O_WRONLY, 0 /*not used*/, replication, 0);
-        return (file) ? 0 : -1;
-    };
-    SimpleResWorker::Start(f, cb);
+    REQUIRE_ARGUMENT_LONG(1, blockSize)
+    REQUIRE_ARGUMENT_INT(2, bufferSize)
+    REQUIRE_ARGUMENT_FUNCTION(3, cb)
+    OpenCompletion *c = new OpenCompletion(&this->file, cb);
+    c->Keep(this->Value());
+    c->SetCachingStrategy(fs, this->dropBehind, -1);
+    c->SetFavoredNodes(fs, this->favoredNodes);
+    c->Begin();
+    c->Start(hdfsAsyncOpenFile(fs, path.c_str(), O_WRONLY, bufferSize, replication, blockSize, &Completion::Callback, c));
+    return info.Env().Null();
+}
+
+Napi::Value FileWriter::SetFavoredNodes(const Napi::CallbackInfo &info)
+{
+    this->favoredNodes.clear();
+    for (size_t i = 0; i < info.Length(); ++i)
+    {
+        if (!info[i].IsString())
+        {
+            Napi::TypeError::New(info.Env(), "Favored nodes must be host:port strings").ThrowAsJavaScriptException();
+            return info.Env().Null();
+        }
+        this->favoredNodes.push_back(info[i].As<Napi::String>());
+    }
+    return info.Env().Null();
+}
+
+Napi::Value FileWriter::SetCachingStrategy(const Napi::CallbackInfo &info)
+{
+    REQUIRE_ARGUMENTS(1)
+    REQUIRE_ARGUMENT_INT(0, dropBehind)
+    this->dropBehind = dropBehind;
+    return info.Env().Null();
+}
+
+Napi::Value FileWriter::SetCodec(const Napi::CallbackInfo &info)
+{
+    REQUIRE_ARGUMENTS(3)
+    REQUIRE_ARGUMENT_STRING(0, name)
+    REQUIRE_ARGUMENT_INT(1, level)
+    REQUIRE_ARGUMENT_INT(2, threads)
+    CodecType type;
+    if (!CodecFromName(name, type))
+    {
+        Napi::TypeError::New(info.Env(), "Unknown codec " + name).ThrowAsJavaScriptException();
+        return info.Env().Null();
+    }
+    if (type == CODEC_AUTO)
+        type = CodecFromPath(this->path);
+    if (type == CODEC_NONE)
+    {
+        this->encoder.reset();
+        return info.Env().Null();
+    }
+    try
+    {
+        this->encoder.reset(Encoder::Create(type, level, threads));
+    }
+    catch (const std::exception &e)
+    {
+        Napi::Error::New(info.Env(), e.what()).ThrowAsJavaScriptException();
+    }
     return info.Env().Null();
 }
 
+/**
+* Compression and write of a buffer on a libuv thread.
+*/
+class EncodeWorker : public BlockingWorker
+{
+  public:
+    EncodeWorker(FileWriter *writer, std::function<int(std::string &)> f, Napi::Function cb)
+        : BlockingWorker(writer->Value(), f, cb), writer(writer) {}
+
+    void OnOK() override
+    {
+        // a Close waiting for the write is queued, it completes after the callback
+        this->writer->workDone();
+        BlockingWorker::OnOK();
+    }
+
+  private:
+    FileWriter *writer;
+};
+
 Napi::Value FileWriter::Write(const Napi::CallbackInfo &info)
 {
     REQUIRE_ARGUMENTS(3)
     REQUIRE_ARGUMENT_BUFFER(0, buffer)
     REQUIRE_ARGUMENT_INT(1, l)
     REQUIRE_ARGUMENT_FUNCTION(2, cb)
-    char *b = buffer.Data();
-    std::function<int()> f = [this, b, l] {
-        int res = hdfsWrite(fs, file, b, l);
-        return res;
-    };
-    SimpleResWorker::Start(f, cb);
+    if (this->encoder)
+    {
+        const char *data = buffer.Data();
+        hdfsFile file = this->file;
+        std::function<int(std::string &)> f = [this, file, data, l](std::string &msg) {
+            return encode(file, data, l, false, msg);
+        };
+        EncodeWorker *worker = new EncodeWorker(this, f, cb);
+        worker->Keep(buffer);
+        this->working++;
+        worker->Queue();
+        return info.Env().Null();
+    }
+    Completion *c = new Completion(cb);
+    c->Keep(this->Value());
+    c->Keep(buffer);
+    c->Begin();
+    c->Start(hdfsAsyncWrite(fs, file, buffer.Data(), l, &Completion::Callback, c));
     return info.Env().Null();
 }
 
@@ -81,24 +176,17 @@ Napi::Value FileWriter::Flush(const Napi::CallbackInfo &info)
 {
     REQUIRE_ARGUMENTS(1);
     REQUIRE_ARGUMENT_FUNCTION(0, cb)
-    std::function<int()> f = [this] {
-        return hdfsFlush(fs, file);
-        ;
-    };
-    SimpleResWorker::Start(f, cb);
+    Completion *c = new Completion(cb);
+    c->Keep(this->Value());
+    c->Begin();
+    c->Start(hdfsAsyncFlush(fs, file, &Completion::Callback, c));
     return info.Env().Null();
 }
 
 Napi::Value FileWriter::HFlush(const Napi::CallbackInfo &info)
 {
-    REQUIRE_ARGUMENTS(1);
-    REQUIRE_ARGUMENT_FUNCTION(0, cb)
-    std::function<int()> f = [this] {
-        return hdfsHFlush(fs, file);
-        ;
-    };
-    SimpleResWorker::Start(f, cb);
-    return info.Env().Null();
+    // hdfsFlush is hdfsHFlush in libhdfs3
+    return Flush(info);
 }
 
 Napi::Value FileWriter::Sync(const Napi::CallbackInfo &info)
@@ -116,13 +204,91 @@ Napi::Value FileWriter::Close(const Napi::CallbackInfo &info)
 {
     REQUIRE_ARGUMENTS(1);
     REQUIRE_ARGUMENT_FUNCTION(0, cb)
-    std::function<int()> f = [this] {
-        return close();
-    };
-    SimpleResWorker::Start(f, cb);
+    if (this->working > 0)
+    {
+        // codec writes use the file on libuv threads, close once they are done
+        this->closing = Napi::Persistent(cb);
+        return info.Env().Null();
+    }
+    closeFile(cb);
     return info.Env().Null();
 }
 
+void FileWriter::workDone()
+{
+    if (--this->working == 0 && !this->closing.IsEmpty())
+    {
+        Napi::Function cb = this->closing.Value();
+        this->closing.Reset();
+        closeFile(cb);
+    }
+}
+
+void FileWriter::closeFile(Napi::Function cb)
+{
+    if (this->encoder && this->file)
+    {
+        hdfsFile file = this->file;
+        std::function<int(std::string &)> f = [this, file](std::string &msg) {
+            int res = encode(file, nullptr, 0, true, msg);
+            int closed = hdfsCloseFile(this->fs, file);
+            if (res >= 0 && closed < 0)
+                msg = hdfsGetLastError();
+            return res < 0 ? res : closed;
+        };
+        BlockingWorker *worker = new BlockingWorker(this->Value(), f, cb);
+        worker->Queue();
+        this->file = nullptr;
+        return;
+    }
+    if (!this->file)
+    {
+        std::function<int()> f = [this] {
+            return close();
+        };
+        SimpleResWorker::Start(f, cb);
+        return;
+    }
+    Completion *c = new Completion(cb);
+    c->Keep(this->Value());
+    // queued behind the writes in flight on this file
+    c->Begin();
+    c->Start(hdfsAsyncCloseFile(fs, file, &Completion::Callback, c));
+    this->file = nullptr;
+}
+
+int FileWriter::encode(hdfsFile file, const char *data, int length, bool finish, std::string &msg)
+{
+    this->encoded.clear();
+    try
+    {
+        if (length > 0)
+            this->encoder->Encode(data, length, this->encoded);
+        if (finish)
+            this->encoder->Finish(this->encoded);
+    }
+    catch (const std::exception &e)
+    {
+        errno = EIO;
+        msg = this->path + ": " + e.what();
+        return -1;
+    }
+    const char *p = this->encoded.data();
+    size_t left = this->encoded.size();
+    while (left > 0)
+    {
+        tSize n = hdfsWrite(this->fs, file, p, std::min<size_t>(left, 64 * 1024 * 1024));
+        if (n < 0)
+        {
+            msg = hdfsGetLastError();
+            return -1;
+        }
+        p += n;
+        left -= n;
+    }
+    return length;
+}
+
 int FileWriter::close()
 {
     if (this->file)
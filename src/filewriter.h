@@ -1,13 +1,19 @@
 #ifndef NHDFS_FILEWRITER_H_
 #define NHDFS_FILEWRITER_H_
 
+#include <memory>
+#include <string>
+#include <vector>
 #include <napi.h>
 #include <hdfs/hdfs.h>
 
+#include "codec.h"
+
 namespace nhdfs
 {
 
 class FileWriter;
+class EncodeWorker;
 
 /**
 * Wrapper for file writer.
@@ -26,6 +32,28 @@ class FileWriter : public Napi::ObjectWrap<FileWriter>
 
     Napi::Value Open(const Napi::CallbackInfo &info);
 
+    /**
+    * Compress the file with the named codec, auto picks it from the
+    * extension. Takes the codec, the level (0 for the default of the codec)
+    * and the number of compression threads. Throws if the codec is not
+    * available.
+    */
+    Napi::Value SetCodec(const Napi::CallbackInfo &info);
+
+    /**
+    * Page cache hints for the datanodes of the pipelines, takes
+    * dropBehind (1, 0 or -1), -1 keeps the hint of the handle.
+    * Call before Open.
+    */
+    Napi::Value SetCachingStrategy(const Napi::CallbackInfo &info);
+
+    /**
+    * Datanodes to place the replicas of the new blocks on if possible,
+    * takes host:port strings of their data transfer addresses, the first
+    * one gets the first replica. Call before Open.
+    */
+    Napi::Value SetFavoredNodes(const Napi::CallbackInfo &info);
+
     Napi::Value Write(const Napi::CallbackInfo &info);
     
     Napi::Value Flush(const Napi::CallbackInfo &info);
@@ -40,9 +68,37 @@ class FileWriter : public Napi::ObjectWrap<FileWriter>
     
     int close();
 
+    /**
+    * Close the file behind the writes queued on it, cb gets (err).
+    */
+    void closeFile(Napi::Function cb);
+
+    /**
+    * Called on the JS thread when a codec write is done, starts a Close
+    * waiting for it.
+    */
+    void workDone();
+
+    /**
+    * Compress data, finish the stream if asked and write the output to
+    * file, called on a libuv thread. Returns length or -1 with errno and
+    * msg set.
+    */
+    int encode(hdfsFile file, const char *data, int length, bool finish, std::string &msg);
+
+    friend class EncodeWorker;
+
     hdfsFS fs;
     std::string path;
-    hdfsFile file;
+    hdfsFile file = nullptr;
+    int dropBehind = -1;
+    std::vector<std::string> favoredNodes;
+
+    std::unique_ptr<Encoder> encoder;
+    std::string encoded;
+    // codec writes on libuv threads, JS thread only
+    int working = 0;
+    Napi::FunctionReference closing;
 };
 
 }
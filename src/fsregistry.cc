@@ -0,0 +1,160 @@
+#include "fsregistry.h"
+#include "macros.h"
+
+#include <errno.h>
+#include <tuple>
+
+namespace nhdfs
+{
+
+bool FsRegistry::Key::operator<(const Key &other) const
+{
+    return std::tie(nameNode, port, user, ticketPath, token, conf, settings, instance) <
+           std::tie(other.nameNode, other.port, other.user, other.ticketPath, other.token, other.conf, other.settings,
+                    other.instance);
+}
+
+FsRegistry &FsRegistry::Instance()
+{
+    // never destroyed: handles may be released by finalizers during shutdown
+    static FsRegistry *registry = new FsRegistry();
+    return *registry;
+}
+
+void FsRegistry::Init(Napi::Env env, Napi::Object exports)
+{
+    Napi::HandleScope scope(env);
+    exports.Set(NAPISTRING(env, "FileSystemRegistryStats"), Napi::Function::New(env, &FsRegistry::RegistryStats));
+}
+
+void FsRegistry::Unshare(Key &key)
+{
+    std::lock_guard<std::mutex> lock(this->mut);
+    key.instance = ++this->instances;
+}
+
+hdfsFS FsRegistry::connect(const Key &key)
+{
+    // runs on any thread, getenv would race with process.env writes on the JS thread
+    struct hdfsBuilder *builder = hdfsNewBuilderWithConf(key.conf.c_str());
+    if (!builder)
+    {
+        return nullptr;
+    }
+    hdfsBuilderSetNameNode(builder, key.nameNode.c_str());
+    if (key.port > 0)
+    {
+        hdfsBuilderSetNameNodePort(builder, key.port);
+    }
+    if (!key.user.empty())
+    {
+        hdfsBuilderSetUserName(builder, key.user.c_str());
+    }
+    if (!key.token.empty())
+    {
+        hdfsBuilderSetToken(builder, key.token.c_str());
+    }
+    if (!key.ticketPath.empty())
+    {
+        hdfsBuilderSetKerbTicketCachePath(builder, key.ticketPath.c_str());
+    }
+    for (std::map<std::string, std::string>::const_iterator it = key.settings.begin(); it != key.settings.end(); ++it)
+    {
+        hdfsBuilderConfSetStr(builder, it->first.c_str(), it->second.c_str());
+    }
+    hdfsFS fs = hdfsBuilderConnect(builder);
+    hdfsFreeBuilder(builder);
+    return fs;
+}
+
+hdfsFS FsRegistry::Acquire(const Key &key, std::string &error)
+{
+    std::unique_lock<std::mutex> lock(this->mut);
+    for (;;)
+    {
+        std::map<Key, Entry>::iterator it = this->entries.find(key);
+        if (it == this->entries.end())
+        {
+            break;
+        }
+        if (it->second.fs)
+        {
+            it->second.refs++;
+            return it->second.fs;
+        }
+        // another thread connects, the entry is gone if it failed
+        this->connected.wait(lock);
+    }
+    this->entries[key];
+    this->connects++;
+    lock.unlock();
+    hdfsFS fs = connect(key);
+    int err = errno;
+    if (!fs)
+    {
+        error = hdfsGetLastError();
+    }
+    lock.lock();
+    if (fs)
+    {
+        Entry &e = this->entries[key];
+        e.fs = fs;
+        e.refs = 1;
+    }
+    else
+    {
+        this->entries.erase(key);
+    }
+    this->connected.notify_all();
+    errno = err;
+    return fs;
+}
+
+void FsRegistry::Release(hdfsFS fs)
+{
+    {
+        std::lock_guard<std::mutex> lock(this->mut);
+        for (std::map<Key, Entry>::iterator it = this->entries.begin(); it != this->entries.end(); ++it)
+        {
+            if (it->second.fs == fs)
+            {
+                if (--it->second.refs > 0)
+                {
+                    return;
+                }
+                this->entries.erase(it);
+                break;
+            }
+        }
+    }
+    hdfsDisconnect(fs);
+}
+
+FsRegistry::Stats FsRegistry::GetStats()
+{
+    std::lock_guard<std::mutex> lock(this->mut);
+    Stats s;
+    for (std::map<Key, Entry>::iterator it = this->entries.begin(); it != this->entries.end(); ++it)
+    {
+        if (it->second.fs)
+        {
+            s.handles++;
+            s.references += it->second.refs;
+        }
+    }
+    s.connects = this->connects;
+    return s;
+}
+
+Napi::Value FsRegistry::RegistryStats(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    Stats s = Instance().GetStats();
+    Napi::Object res = Napi::Object::New(env);
+    res.Set(NAPISTRING(env, "handles"), Napi::Number::New(env, s.handles));
+    res.Set(NAPISTRING(env, "references"), Napi::Number::New(env, s.references));
+    res.Set(NAPISTRING(env, "connects"), Napi::Number::New(env, s.connects));
+    return res;
+}
+
+} //namespace nhdfs
@@ -0,0 +1,94 @@
+#ifndef NHDFS_FSREGISTRY_H_
+#define NHDFS_FSREGISTRY_H_
+
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <string>
+#include <napi.h>
+#include <hdfs/hdfs.h>
+
+namespace nhdfs
+{
+
+/**
+* Process wide registry of connected hdfsFS handles.
+*
+* FileSystem objects with the same endpoint, credentials and configuration
+* share one handle, also across worker threads, and with it the RPC
+* channels, peer cache and lease renewer of libhdfs3. A handle is
+* disconnected when its last user releases it.
+**/
+class FsRegistry
+{
+  public:
+    struct Key
+    {
+        std::string nameNode;
+        tPort port = 0;
+        std::string user;
+        std::string ticketPath;
+        std::string token;
+        // configuration file, the environment is not read on connect
+        std::string conf;
+        // libhdfs3 configuration overriding conf
+        std::map<std::string, std::string> settings;
+        // unique for handles which are not shared
+        int instance = 0;
+
+        bool operator<(const Key &other) const;
+    };
+
+    struct Stats
+    {
+        int64_t handles = 0;
+        int64_t references = 0;
+        int64_t connects = 0;
+    };
+
+    static FsRegistry &Instance();
+
+    static void Init(Napi::Env env, Napi::Object exports);
+
+    /**
+    * Make key unique so the handle is not shared.
+    */
+    void Unshare(Key &key);
+
+    /**
+    * The handle of key, connects if there is none yet. Blocks, call it off
+    * the JS thread if possible. Returns nullptr with errno set and the
+    * message in error if the connect fails.
+    */
+    hdfsFS Acquire(const Key &key, std::string &error);
+
+    /**
+    * Drop a reference taken by Acquire.
+    */
+    void Release(hdfsFS fs);
+
+    Stats GetStats();
+
+  private:
+    struct Entry
+    {
+        // nullptr while connecting
+        hdfsFS fs = nullptr;
+        int64_t refs = 0;
+    };
+
+    FsRegistry() {}
+
+    static hdfsFS connect(const Key &key);
+    static Napi::Value RegistryStats(const Napi::CallbackInfo &info);
+
+    std::mutex mut;
+    std::condition_variable connected;
+    std::map<Key, Entry> entries;
+    int instances = 0;
+    int64_t connects = 0;
+};
+
+} //namespace nhdfs
+
+#endif //NHDFS_FSREGISTRY_H_
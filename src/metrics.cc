@@ -0,0 +1,51 @@
+#include "metrics.h"
+#include "macros.h"
+
+#include <hdfs/hdfs.h>
+
+namespace nhdfs
+{
+
+void Metrics::Init(Napi::Env env, Napi::Object exports)
+{
+    Napi::HandleScope scope(env);
+    exports.Set(NAPISTRING(env, "Metrics"), Napi::Function::New(env, &Metrics::Snapshot));
+}
+
+Napi::Value Metrics::Snapshot(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    hdfsMetrics metrics;
+    if (hdfsGetMetrics(&metrics) != 0)
+    {
+        Napi::Error::New(env, hdfsGetLastError()).ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    Napi::Object counters = Napi::Object::New(env);
+    for (int i = 0; i < metrics.numCounters; i++)
+    {
+        counters.Set(NAPISTRING(env, metrics.counters[i].name), Napi::Number::New(env, metrics.counters[i].value));
+    }
+    // latencies are reported in ms like the operation timings
+    Napi::Object histograms = Napi::Object::New(env);
+    for (int i = 0; i < metrics.numHistograms; i++)
+    {
+        const hdfsMetricHistogram &h = metrics.histograms[i];
+        Napi::Object o = Napi::Object::New(env);
+        o.Set(NAPISTRING(env, "count"), Napi::Number::New(env, h.count));
+        o.Set(NAPISTRING(env, "sum"), Napi::Number::New(env, h.sum / 1e3));
+        o.Set(NAPISTRING(env, "min"), Napi::Number::New(env, h.min / 1e3));
+        o.Set(NAPISTRING(env, "max"), Napi::Number::New(env, h.max / 1e3));
+        o.Set(NAPISTRING(env, "p50"), Napi::Number::New(env, h.p50 / 1e3));
+        o.Set(NAPISTRING(env, "p90"), Napi::Number::New(env, h.p90 / 1e3));
+        o.Set(NAPISTRING(env, "p99"), Napi::Number::New(env, h.p99 / 1e3));
+        o.Set(NAPISTRING(env, "p999"), Napi::Number::New(env, h.p999 / 1e3));
+        histograms.Set(NAPISTRING(env, h.name), o);
+    }
+    Napi::Object res = Napi::Object::New(env);
+    res.Set(NAPISTRING(env, "counters"), counters);
+    res.Set(NAPISTRING(env, "histograms"), histograms);
+    return res;
+}
+
+} //namespace nhdfs
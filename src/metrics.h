@@ -0,0 +1,25 @@
+#ifndef NHDFS_METRICS_H_
+#define NHDFS_METRICS_H_
+
+#include <napi.h>
+
+namespace nhdfs
+{
+
+/**
+* Process wide libhdfs3 client metrics: byte counters per read path,
+* peer cache, RPC retries, failovers, checksum failures, pipeline recoveries
+* and latency histograms.
+**/
+class Metrics
+{
+  public:
+    static void Init(Napi::Env env, Napi::Object exports);
+
+  private:
+    static Napi::Value Snapshot(const Napi::CallbackInfo &info);
+};
+
+} //namespace nhdfs
+
+#endif //NHDFS_METRICS_H_
@@ -9,10 +9,14 @@ Napi::Object RegisterModule(Napi::Env env, Napi::Object exports)
 {
   Napi::HandleScope scope(env);
 
+  CompletionQueue::Init(env, exports);
   ClusterInfo::Init(env, exports);
   FileSystem::Init(env, exports);
+  FsRegistry::Init(env, exports);
   FileReader::Init(env, exports);
   FileWriter::Init(env, exports);
+  BufferPool::Init(env, exports);
+  Metrics::Init(env, exports);
   return exports;
 }
 
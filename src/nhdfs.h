@@ -3,8 +3,12 @@
 
 #include <napi.h>
 #include "filesystem.h"
+#include "fsregistry.h"
 #include "filereader.h"
 #include "filewriter.h"
 #include "clusterinfo.h"
+#include "bufferpool.h"
+#include "completion.h"
+#include "metrics.h"
 
 #endif //NHDFS_NHDFS_H_
\ No newline at end of file
@@ -0,0 +1,127 @@
+#include "splitter.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define NHDFS_SPLITTER_X86 1
+#include <immintrin.h>
+#endif
+
+namespace nhdfs
+{
+
+namespace
+{
+
+/**
+* Input scanned per window, the kernels write the ends of a window to a
+* stack buffer with room for a delimiter at every byte.
+*/
+const size_t WINDOW = 4096;
+
+/**
+* Kernels scan whole 64 byte blocks and return the number of bytes they
+* covered, the tail is scanned with memchr. out must have room for a
+* delimiter at every byte, the end of the output is returned in end.
+*/
+typedef size_t (*Kernel)(const char *data, size_t length, char delimiter, uint32_t base, uint32_t *out, uint32_t *&end);
+
+inline uint32_t *appendMask(uint64_t mask, uint32_t offset, uint32_t *out)
+{
+    while (mask)
+    {
+        *out++ = offset + __builtin_ctzll(mask) + 1;
+        mask &= mask - 1;
+    }
+    return out;
+}
+
+size_t scanScalar(const char *, size_t, char, uint32_t, uint32_t *out, uint32_t *&end)
+{
+    end = out;
+    return 0;
+}
+
+#ifdef NHDFS_SPLITTER_X86
+__attribute__((target("sse2"))) size_t scanSse2(const char *data, size_t length, char delimiter, uint32_t base,
+                                                uint32_t *out, uint32_t *&end)
+{
+    const __m128i d = _mm_set1_epi8(delimiter);
+    size_t i = 0;
+    for (; i + 64 <= length; i += 64)
+    {
+        const __m128i *p = reinterpret_cast<const __m128i *>(data + i);
+        uint64_t m0 = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128(p), d)));
+        uint64_t m1 = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128(p + 1), d)));
+        uint64_t m2 = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128(p + 2), d)));
+        uint64_t m3 = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128(p + 3), d)));
+        out = appendMask(m0 | (m1 << 16) | (m2 << 32) | (m3 << 48), base + i, out);
+    }
+    end = out;
+    return i;
+}
+
+__attribute__((target("avx2"))) size_t scanAvx2(const char *data, size_t length, char delimiter, uint32_t base,
+                                                uint32_t *out, uint32_t *&end)
+{
+    const __m256i d = _mm256_set1_epi8(delimiter);
+    size_t i = 0;
+    for (; i + 64 <= length; i += 64)
+    {
+        const __m256i *p = reinterpret_cast<const __m256i *>(data + i);
+        uint64_t lo = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256(p), d)));
+        uint64_t hi = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256(p + 1), d)));
+        out = appendMask(lo | (hi << 32), base + i, out);
+    }
+    end = out;
+    return i;
+}
+#endif
+
+struct Dispatch
+{
+    Kernel kernel = scanScalar;
+
+    Dispatch()
+    {
+#ifdef NHDFS_SPLITTER_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+            kernel = scanAvx2;
+        else if (__builtin_cpu_supports("sse2"))
+            kernel = scanSse2;
+#endif
+    }
+};
+
+const Dispatch &dispatch()
+{
+    static Dispatch d;
+    return d;
+}
+
+} //namespace
+
+void FindRecordEnds(const char *data, size_t length, char delimiter, uint32_t base, std::vector<uint32_t> &ends)
+{
+    Kernel kernel = dispatch().kernel;
+    uint32_t window[WINDOW];
+    size_t i = 0;
+    while (kernel != scanScalar && length - i >= 64)
+    {
+        uint32_t *end = window;
+        i += kernel(data + i, std::min(length - i, WINDOW), delimiter, base + i, window, end);
+        ends.insert(ends.end(), window, end);
+    }
+    while (i < length)
+    {
+        const char *p = static_cast<const char *>(memchr(data + i, delimiter, length - i));
+        if (!p)
+            break;
+        i = p - data + 1;
+        ends.push_back(base + i);
+    }
+}
+
+} //namespace nhdfs
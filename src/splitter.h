@@ -0,0 +1,20 @@
+#ifndef NHDFS_SPLITTER_H_
+#define NHDFS_SPLITTER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace nhdfs
+{
+
+/**
+* Append base + 1 + the position of every delimiter in data to ends, i.e.
+* the end offsets of the records terminated in data. Uses AVX2 or SSE2
+* when the CPU has them.
+*/
+void FindRecordEnds(const char *data, size_t length, char delimiter, uint32_t base, std::vector<uint32_t> &ends);
+
+} //namespace nhdfs
+
+#endif //NHDFS_SPLITTER_H_
@@ -6,6 +6,8 @@
 #include <exception>
 #include <hdfs/hdfs.h>
 #include <memory>
+#include <string>
+#include <vector>
 
 #include <tuple>
 
@@ -95,6 +97,57 @@ class SimpleResWorker : public Napi::AsyncWorker
     int err = 0;
 };
 
+/**
+* Worker running blocking native code which reports its own error message,
+* e.g. a compression codec and the I/O it feeds or a connect.
+* func returns the result, or -1 with errno set and the message stored in
+* its argument. The receiver, usually the wrapper, is kept alive.
+*/
+class BlockingWorker : public Napi::AsyncWorker
+{
+  public:
+    BlockingWorker(Napi::Object receiver, std::function<int(std::string &)> f, Napi::Function cb)
+        : AsyncWorker(receiver, cb), func(f) {}
+
+    /**
+    * Keep object alive until the worker completes, e.g. the buffer it reads.
+    */
+    void Keep(Napi::Object object)
+    {
+        this->keep.push_back(Napi::Persistent(object));
+    }
+
+    void Execute() override
+    {
+        this->res = func(this->msg);
+        if (this->res < 0)
+        {
+            this->error = std::make_shared<AsyncError>(errno, this->msg);
+        }
+    }
+
+    void OnOK() override
+    {
+        auto err = converError(this->error, this);
+        auto v = Result(this->Env());
+        this->Callback().MakeCallback(this->Receiver().Value(), std::initializer_list<napi_value>{err, v});
+    }
+
+  protected:
+    virtual Napi::Value Result(Napi::Env env)
+    {
+        return Napi::Number::New(env, this->res);
+    }
+
+    int res = 0;
+
+  private:
+    std::function<int(std::string &)> func;
+    std::string msg;
+    std::shared_ptr<AsyncError> error;
+    std::vector<Napi::ObjectReference> keep;
+};
+
 /**
 *  Result of native function call
 */
@@ -130,6 +183,32 @@ inline Napi::Value convert<tOffset>(Napi::Env env, tOffset v)
     return Napi::Number::New(env, v);
 }
 
+/**
+*  Convert native file checksum to JS object, the bytes as hex string
+*/
+template <>
+inline Napi::Value convert<hdfsFileChecksum>(Napi::Env env, hdfsFileChecksum v)
+{
+    static const char digits[] = "0123456789abcdef";
+    std::string bytes, md5;
+    for (int i = 0; i < v.length; ++i)
+    {
+        bytes.push_back(digits[v.bytes[i] >> 4]);
+        bytes.push_back(digits[v.bytes[i] & 0xf]);
+    }
+    if (v.length >= 16)
+    {
+        md5 = bytes.substr(2 * (v.length - 16));
+    }
+    Napi::Object res = Napi::Object::New(env);
+    res.Set(NAPISTRING(env, "algorithm"), NAPISTRING(env, v.algorithm));
+    res.Set(NAPISTRING(env, "bytes"), NAPISTRING(env, bytes));
+    res.Set(NAPISTRING(env, "md5"), NAPISTRING(env, md5));
+    res.Set(NAPISTRING(env, "bytesPerCrc"), Napi::Number::New(env, v.bytesPerCrc));
+    res.Set(NAPISTRING(env, "crcPerBlock"), Napi::Number::New(env, v.crcPerBlock));
+    return res;
+}
+
 /**
 * Asynchronious Worker to call native functon
 */
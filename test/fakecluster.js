@@ -0,0 +1,921 @@
+'use strict';
+
+const lfs = require('fs');
+const crypto = require('crypto');
+const http = require('http');
+const os = require('os');
+const path = require('path');
+const chai = require('chai');
+const assert = chai.assert;
+const nhdfs = require('../lib/nhdfs');
+const testutil = require("./testutil");
+const timeout = testutil.timeout;
+const writeFile = testutil.writeFile;
+
+/**
+ * Settle all promises, resolves to [{value} or {error}].
+ */
+function settle(promises) {
+    return Promise.all(promises.map(p => p.then(value => ({ value }), error => ({ error }))));
+}
+
+describe('Fake cluster', function () {
+    let cluster = null;
+
+    before(async function () {
+        cluster = await testutil.startFakeCluster();
+        if (!cluster) this.skip();
+    });
+
+    after(() => {
+        if (cluster) cluster.stop();
+    });
+
+    describe('RPC channel', () => {
+        const dir = '/rpc';
+        const files = 40;
+        let fs = null;
+
+        before(async () => {
+            // every call of the FileSystem goes through one channel
+            fs = cluster.createFS({ 'rpc.client.connections.per.server': 1, 'rpc.client.timeout': 300 });
+            await fs.mkdir(dir);
+            for (let i = 0; i < files; i++) {
+                await writeFile(fs, `${dir}/f${i}`, Buffer.alloc(i));
+            }
+        });
+
+        afterEach(async () => {
+            await cluster.command('nn 0 latency=0 drop=0');
+        });
+
+        /**
+         * Stat file i and check that the answer is the one of file i.
+         */
+        async function stat(i) {
+            const info = await fs.stats(`${dir}/f${i}`);
+            assert.equal(info.size, i, `size of f${i}`);
+            assert.match(info.path, new RegExp(`/f${i}$`), `path of f${i}`);
+            return info;
+        }
+
+        it('should answer concurrent calls on one channel', async () => {
+            await cluster.command('nn 0 latency=5');
+            const calls = [];
+            for (let i = 0; i < 200; i++) {
+                const k = (i * 7) % (files + 5);
+                calls.push(k < files ? stat(k) : fs.exists(`${dir}/missing${k}`).then(r => assert.isNotOk(r)));
+            }
+            await Promise.all(calls);
+        });
+
+        it('should discard a response which arrives after the call timed out', async () => {
+            const before = nhdfs.metrics().counters.rpcRetries;
+            await cluster.command('nn 0 latency=2000');
+            let error = null;
+            try {
+                await fs.stats(`${dir}/f1`);
+            } catch (err) {
+                error = err;
+            }
+            assert.isOk(error, 'the call should time out');
+            assert.match(error.message, /[Tt]imeout/);
+            assert.isAbove(nhdfs.metrics().counters.rpcRetries, before, 'the idempotent call should be resent once');
+            await cluster.command('nn 0 latency=0');
+            // the late responses arrive meanwhile and must not complete other calls
+            const end = Date.now() + 3000;
+            for (let n = 0; Date.now() < end; n++) {
+                await Promise.all([stat(n % files), stat((n + 11) % files)]);
+            }
+        });
+
+        it('should fail the calls in flight when the channel fails', async () => {
+            await cluster.command('nn 0 latency=200');
+            const calls = [];
+            for (let i = 0; i < 16; i++) calls.push(stat(i));
+            await timeout(300);
+            await cluster.command('nn 0 drop=1');
+            const results = await settle(calls);
+            const failed = results.filter(r => r.error);
+            assert.isAbove(failed.length, 0, 'calls in flight should fail');
+            failed.forEach(r => assert.notInstanceOf(r.error, chai.AssertionError, 'no call should get another answer'));
+            await cluster.command('nn 0 latency=0 drop=0');
+            for (let i = 0; i < files; i++) await stat(i);
+        });
+    });
+
+    describe('RPC connection pool', () => {
+        const dir = '/pool';
+        let pool = null;
+
+        /**
+         * The namenode connections opened since the stats before were taken.
+         */
+        async function opened(before) {
+            const stats = await pool.stats();
+            return stats.namenodes[0].connections.slice(before ? before.namenodes[0].connections.length : 0);
+        }
+
+        before(async () => {
+            // a cluster of its own, only the clients of these tests connect to it
+            pool = await testutil.startFakeCluster({ datanodes: 1 });
+        });
+
+        after(() => {
+            if (pool) pool.stop();
+        });
+
+        afterEach(async () => {
+            await pool.command('nn 0 latency=0');
+        });
+
+        it('should open another connection only while all are busy', async () => {
+            const fs = pool.createFS({ 'rpc.client.connections.per.server': 3 });
+            const before = await pool.stats();
+            for (let i = 0; i < 20; i++) {
+                await fs.stats('/');
+            }
+            assert.lengthOf(await opened(before), 1, 'one call at a time uses one connection');
+            await pool.command('nn 0 latency=300');
+            await Promise.all([0, 1, 2, 3, 4, 5].map(() => fs.stats('/')));
+            assert.lengthOf(await opened(before), 3, 'concurrent slow calls fill the pool, no more');
+            await pool.command('nn 0 latency=0');
+            for (let i = 0; i < 20; i++) {
+                await fs.stats('/');
+            }
+            assert.lengthOf(await opened(before), 3, 'idle connections of the pool are used again');
+        });
+
+        it('should send listings and block locations to the bulk connections', async () => {
+            const fs = pool.createFS({ 'rpc.client.connections.per.server': 1,
+                'rpc.client.bulk.connections.per.server': 1 });
+            const before = await pool.stats();
+            await fs.mkdir(dir);
+            await writeFile(fs, `${dir}/f`, Buffer.from('bulk'));
+            await fs.list(dir);
+            assert.deepEqual(await testutil.readFile(fs, `${dir}/f`), Buffer.from('bulk'));
+            await fs.stats(`${dir}/f`);
+            const connections = await opened(before);
+            assert.lengthOf(connections, 2, 'one connection of each pool');
+            const bulk = connections.find(c => c.methods.includes('getListing'));
+            const small = connections.find(c => c !== bulk);
+            assert.sameMembers(bulk.methods, ['getBlockLocations', 'getListing']);
+            assert.include(small.methods, 'getFileInfo');
+            assert.notInclude(small.methods, 'getListing');
+            assert.notInclude(small.methods, 'getBlockLocations');
+        });
+
+        it('should use one pool for all calls without bulk connections', async () => {
+            const fs = pool.createFS({ 'rpc.client.connections.per.server': 1 });
+            const before = await pool.stats();
+            await fs.list('/');
+            await fs.stats('/');
+            const connections = await opened(before);
+            assert.lengthOf(connections, 1);
+            assert.includeMembers(connections[0].methods, ['getFileInfo', 'getListing']);
+        });
+
+        it('should close idle connections', async () => {
+            const fs = pool.createFS({ 'rpc.client.connections.per.server': 2, 'rpc.client.max.idle': 500 });
+            const before = await pool.stats();
+            await fs.stats('/');
+            let connections = await opened(before);
+            assert.lengthOf(connections, 1);
+            assert.isOk(connections[0].open);
+            // the idle connections are cleaned once a second
+            await timeout(2500);
+            connections = await opened(before);
+            assert.isNotOk(connections[0].open, 'the idle connection should be closed');
+            await fs.stats('/');
+            connections = await opened(before);
+            assert.lengthOf(connections, 2, 'a closed connection is not used again');
+            assert.isOk(connections[1].open);
+        });
+    });
+
+    describe('Status cache', () => {
+        const dir = '/statuscache';
+        const blockSize = 1024 * 1024;
+        let fs = null;
+        let other = null;
+
+        before(async () => {
+            fs = cluster.createFS({}, { options: { metadataCache: { ttl: 60000, negativeTtl: 60000 } } });
+            other = cluster.createFS();
+            await fs.mkdir(dir);
+        });
+
+        it('should serve repeated lookups from the cache', async () => {
+            await writeFile(fs, `${dir}/cached`, Buffer.alloc(10));
+            await fs.stats(`${dir}/cached`);
+            const hits = nhdfs.metrics().counters.fileStatusCacheHits;
+            await other.delete(`${dir}/cached`);
+            assert.equal((await fs.stats(`${dir}/cached`)).size, 10, 'changes of other clients are seen after the ttl');
+            assert.isAbove(nhdfs.metrics().counters.fileStatusCacheHits, hits);
+        });
+
+        it('should drop entries of created and deleted paths', async () => {
+            assert.isNotOk(await fs.exists(`${dir}/d`));
+            await fs.mkdir(`${dir}/d`);
+            assert.isOk(await fs.isDirectory(`${dir}/d`), 'mkdir');
+            assert.isNotOk(await fs.exists(`${dir}/d/f`));
+            await writeFile(fs, `${dir}/d/f`, Buffer.alloc(5));
+            assert.equal((await fs.stats(`${dir}/d/f`)).size, 5, 'create');
+            await fs.delete(`${dir}/d`, true);
+            assert.isNotOk(await fs.exists(`${dir}/d/f`), 'recursive delete drops the entries below');
+            assert.isNotOk(await fs.exists(`${dir}/d`), 'delete');
+        });
+
+        it('should drop entries below a renamed directory', async () => {
+            await fs.mkdir(`${dir}/r1`);
+            await writeFile(fs, `${dir}/r1/f`, Buffer.alloc(3));
+            assert.isOk(await fs.exists(`${dir}/r1/f`));
+            assert.isNotOk(await fs.exists(`${dir}/r2/f`));
+            await fs.rename(`${dir}/r1`, `${dir}/r2`);
+            assert.isNotOk(await fs.exists(`${dir}/r1/f`), 'source subtree');
+            assert.equal((await fs.stats(`${dir}/r2/f`)).size, 3, 'target subtree');
+        });
+
+        it('should drop entries of changed attributes', async () => {
+            const path = `${dir}/attrs`;
+            await writeFile(fs, path, Buffer.alloc(100));
+            const before = await fs.stats(path);
+            await fs.chmod(path, 0o600);
+            assert.equal((await fs.stats(path)).permissions, 0o600, 'setPermission');
+            await fs.chown(path, 'someone', 'somegroup');
+            const owned = await fs.stats(path);
+            assert.equal(owned.owner, 'someone', 'setOwner');
+            assert.equal(owned.group, 'somegroup', 'setOwner');
+            await fs.setReplication(path, before.replication + 1);
+            assert.equal((await fs.stats(path)).replication, before.replication + 1, 'setReplication');
+            await fs.utime(path, 1500000000000, -1);
+            assert.equal((await fs.stats(path)).last_mod, 1500000000000, 'setTimes');
+        });
+
+        it('should drop entries of concatenated files', async () => {
+            const target = `${dir}/target`;
+            await writeFile(fs, target, Buffer.alloc(blockSize), { blockSize: blockSize });
+            await writeFile(fs, `${dir}/s1`, Buffer.alloc(blockSize), { blockSize: blockSize });
+            await writeFile(fs, `${dir}/s2`, Buffer.alloc(10), { blockSize: blockSize });
+            for (const path of [target, `${dir}/s1`, `${dir}/s2`]) await fs.stats(path);
+            await fs.concat(target, [`${dir}/s1`, `${dir}/s2`]);
+            assert.equal((await fs.stats(target)).size, 2 * blockSize + 10, 'target');
+            assert.isNotOk(await fs.exists(`${dir}/s1`), 'sources');
+            assert.isNotOk(await fs.exists(`${dir}/s2`), 'sources');
+        });
+
+        it('should drop entries of the sources of a failed concat', async () => {
+            const target = `${dir}/target2`;
+            await writeFile(fs, target, Buffer.alloc(blockSize), { blockSize: blockSize });
+            await writeFile(fs, `${dir}/s3`, Buffer.alloc(10), { blockSize: blockSize });
+            await writeFile(fs, `${dir}/s4`, Buffer.alloc(10), { blockSize: blockSize });
+            assert.isOk(await fs.exists(`${dir}/s3`));
+            await other.delete(`${dir}/s3`);
+            let error = null;
+            try {
+                await fs.concat(target, [`${dir}/s3`, `${dir}/s4`]);
+            } catch (err) {
+                error = err;
+            }
+            assert.isOk(error, 'concat of a missing source should fail');
+            assert.isNotOk(await fs.exists(`${dir}/s3`), 'the failed concat should drop the sources');
+        });
+    });
+
+    describe('Next block prefetch', () => {
+        const blockSize = 1024 * 1024;
+        const blocks = 6;
+        const path = '/prefetch/file';
+        const data = testutil.textData(blocks * blockSize).slice(0, blocks * blockSize);
+        let fs = null;
+
+        /**
+         * Read the file sequentially, resolves to the readers prefetched meanwhile.
+         */
+        async function readPrefetched() {
+            const before = nhdfs.metrics().counters.blockReadersPrefetched;
+            assert.isOk((await testutil.readFile(fs, path)).equals(data), 'the data read');
+            return nhdfs.metrics().counters.blockReadersPrefetched - before;
+        }
+
+        before(async () => {
+            fs = cluster.createFS({ 'input.read.prefetch.next.block': blockSize / 2, 'dfs.prefetchsize': 2 });
+            await fs.mkdir('/prefetch');
+            await writeFile(fs, path, data, { blockSize: blockSize, replication: 3 });
+        });
+
+        beforeEach(async () => {
+            // a block drains in about 250ms, time enough to set up the next reader
+            for (let i = 0; i < 3; i++) await cluster.command(`dn ${i} latency=20 bandwidth=${4 * blockSize}`);
+        });
+
+        afterEach(async () => {
+            for (let i = 0; i < 3; i++) await cluster.command(`dn ${i} latency=0 bandwidth=0 failReads=0`);
+        });
+
+        it('should set up the reader of the next block in the background', async () => {
+            assert.equal(await readPrefetched(), blocks - 1);
+        });
+
+        it('should not prefetch from a datanode the stream failed to read from', async () => {
+            await cluster.command('dn 0 latency=1000 failReads=1');
+            const before = (await cluster.stats()).datanodes[0].bytesRead;
+            assert.equal(await readPrefetched(), blocks - 1, 'no prefetch waits for the failed datanode');
+            assert.equal((await cluster.stats()).datanodes[0].bytesRead, before);
+        });
+
+        it('should not wait for a prefetch which is not done', async () => {
+            // connecting takes longer than draining a block
+            for (let i = 0; i < 3; i++) await cluster.command(`dn ${i} latency=300 bandwidth=0`);
+            assert.equal(await readPrefetched(), 0, 'the stream sets up the readers itself');
+        });
+    });
+
+    describe('Caching strategy', () => {
+        const dir = '/caching';
+        const blockSize = 1024 * 1024;
+        const data = testutil.textData(100000);
+        let fs = null;
+        let hinted = null;
+
+        /**
+         * The drop behind operations of all datanodes and the readahead hints they got.
+         */
+        async function hints() {
+            const datanodes = (await cluster.stats()).datanodes;
+            return {
+                dropBehindOps: datanodes.reduce((sum, dn) => sum + dn.dropBehindOps, 0),
+                readaheads: datanodes.map(dn => dn.lastReadahead)
+            };
+        }
+
+        before(async () => {
+            fs = cluster.createFS();
+            hinted = cluster.createFS({ 'input.read.prefetch.next.block': blockSize / 2, 'dfs.prefetchsize': 2 },
+                { options: { cachingStrategy: { dropBehindReads: true, dropBehindWrites: true, readahead: 65536 } } });
+            await fs.mkdir(dir);
+            await writeFile(fs, `${dir}/plain`, data);
+        });
+
+        afterEach(async () => {
+            for (let i = 0; i < 3; i++) await cluster.command(`dn ${i} latency=0 bandwidth=0`);
+        });
+
+        it('should send no hints by default', async () => {
+            const before = await hints();
+            await writeFile(fs, `${dir}/nohints`, data);
+            await testutil.readFile(fs, `${dir}/nohints`);
+            assert.deepEqual(await hints(), before);
+        });
+
+        it('should send the hints of a read stream', async () => {
+            const before = await hints();
+            const read = await testutil.readFile(fs, `${dir}/plain`, { dropBehind: true, readahead: 4096 });
+            assert.isOk(read.equals(data));
+            const after = await hints();
+            assert.equal(after.dropBehindOps, before.dropBehindOps + 1);
+            assert.include(after.readaheads, 4096);
+        });
+
+        it('should send the hints of a write stream', async () => {
+            const before = await hints();
+            await writeFile(fs, `${dir}/dropped`, data, { dropBehind: true });
+            assert.isAbove((await hints()).dropBehindOps, before.dropBehindOps, 'the write pipeline');
+            const unhinted = await hints();
+            await writeFile(fs, `${dir}/kept`, data, { dropBehind: false });
+            assert.equal((await hints()).dropBehindOps, unhinted.dropBehindOps);
+        });
+
+        it('should send the hints of the FileSystem unless the stream overrides them', async () => {
+            let before = await hints();
+            await testutil.readFile(hinted, `${dir}/plain`);
+            let after = await hints();
+            assert.equal(after.dropBehindOps, before.dropBehindOps + 1, 'dropBehindReads');
+            assert.include(after.readaheads, 65536, 'readahead');
+            before = after;
+            await writeFile(hinted, `${dir}/hinted`, data);
+            after = await hints();
+            assert.isAbove(after.dropBehindOps, before.dropBehindOps, 'dropBehindWrites');
+            before = after;
+            await testutil.readFile(hinted, `${dir}/plain`, { dropBehind: false });
+            assert.equal((await hints()).dropBehindOps, before.dropBehindOps, 'the stream option wins');
+        });
+
+        it('should send the hints with the readers of prefetched blocks', async () => {
+            const blocks = 4;
+            const big = testutil.textData(blocks * blockSize).slice(0, blocks * blockSize);
+            await writeFile(fs, `${dir}/blocks`, big, { blockSize: blockSize, replication: 1 });
+            // slow enough for the next block reader to be set up while a block drains
+            for (let i = 0; i < 3; i++) await cluster.command(`dn ${i} latency=20 bandwidth=${4 * blockSize}`);
+            const prefetched = nhdfs.metrics().counters.blockReadersPrefetched;
+            const before = await hints();
+            const read = await testutil.readFile(hinted, `${dir}/blocks`, { readahead: 8192 });
+            assert.isOk(read.equals(big));
+            assert.equal(nhdfs.metrics().counters.blockReadersPrefetched - prefetched, blocks - 1);
+            const after = await hints();
+            assert.equal(after.dropBehindOps, before.dropBehindOps + blocks, 'every block reader drops behind');
+            assert.include(after.readaheads, 8192);
+        });
+    });
+
+    describe('Write placement', () => {
+        const dir = '/placement';
+        const blockSize = 1024 * 1024;
+        const data = testutil.textData(3 * blockSize).slice(0, 3 * blockSize);
+        let fs = null;
+
+        /**
+         * Write data with options, resolves to the bytes each datanode got and the blocks added.
+         */
+        async function place(path, options) {
+            const before = await cluster.stats();
+            await writeFile(fs, path, data, options);
+            const after = await cluster.stats();
+            return {
+                written: after.datanodes.map((dn, i) => dn.bytesWritten - before.datanodes[i].bytesWritten),
+                blocks: after.blocks - before.blocks
+            };
+        }
+
+        before(async () => {
+            fs = cluster.createFS();
+            await fs.mkdir(dir);
+        });
+
+        it('should place the blocks on the favored datanode', async () => {
+            for (let target = 0; target < cluster.ports.datanodes.length; target++) {
+                const path = `${dir}/favored${target}`;
+                const placed = await place(path, { blockSize: blockSize, replication: 1,
+                    favoredNodes: [`127.0.0.1:${cluster.ports.datanodes[target]}`] });
+                placed.written.forEach((n, i) => i === target ?
+                    assert.isAtLeast(n, data.length, `datanode ${i}`) : assert.equal(n, 0, `datanode ${i}`));
+                assert.equal(placed.blocks, 3, 'one block per blockSize bytes');
+                const info = await fs.stats(path);
+                assert.equal(info.block_size, blockSize);
+                assert.equal(info.size, data.length);
+                assert.isOk((await testutil.readFile(fs, path)).equals(data));
+            }
+        });
+
+        it('should place the replicas on all favored datanodes', async () => {
+            const ports = cluster.ports.datanodes;
+            const placed = await place(`${dir}/replicas`, { blockSize: blockSize, replication: 2,
+                favoredNodes: [`localhost:${ports[2]}`, `127.0.0.1:${ports[0]}`] });
+            assert.isAtLeast(placed.written[0], data.length);
+            assert.equal(placed.written[1], 0);
+            assert.isAtLeast(placed.written[2], data.length);
+            assert.equal((await fs.stats(`${dir}/replicas`)).replication, 2);
+        });
+
+        it('should let the namenode place the blocks of unknown favored datanodes', async () => {
+            const placed = await place(`${dir}/unknown`, { blockSize: blockSize, replication: 1,
+                favoredNodes: ['10.255.0.1:1'] });
+            assert.isAtLeast(placed.written.reduce((sum, n) => sum + n, 0), data.length);
+            assert.isOk((await testutil.readFile(fs, `${dir}/unknown`)).equals(data));
+        });
+
+        it('should buffer bufferSize bytes in the stream', async () => {
+            const out = fs.createWriteStream(`${dir}/buffered`, { bufferSize: 65536, blockSize: 2 * blockSize });
+            assert.equal(out.writableHighWaterMark, 65536);
+            await new Promise((resolve, reject) => {
+                out.on('error', reject);
+                out.on('close', resolve);
+                out.end(data);
+            });
+            const info = await fs.stats(`${dir}/buffered`);
+            assert.equal(info.block_size, 2 * blockSize);
+            assert.equal(info.size, data.length);
+        });
+    });
+
+    // the datanode transfers run again with io_uring, skipped where the kernel refuses io_uring_setup
+    for (const uring of [false, true]) {
+        const suffix = uring ? ' with io_uring' : '';
+        const settings = uring ? { 'dfs.client.socket.io_uring': true } : {};
+
+        describe(`Data transfer${suffix}`, () => {
+            const dir = `/transfer${uring ? '-uring' : ''}`;
+            const blockSize = 1024 * 1024;
+            const size = 2 * blockSize + 300001;
+            const data = testutil.textData(size).slice(0, size);
+            let fs = null;
+
+            before(async function () {
+                const sockets = nhdfs.metrics().counters.uringSockets;
+                fs = cluster.createFS(settings);
+                await fs.mkdir(dir);
+                await writeFile(fs, `${dir}/file`, data, { blockSize: blockSize, replication: 3 });
+                if (uring && nhdfs.metrics().counters.uringSockets === sockets) this.skip();
+            });
+
+            afterEach(async () => {
+                for (let i = 0; i < 3; i++) await cluster.command(`dn ${i} splitHeaders=0 corruptReads=0`);
+            });
+
+            it('should read back what it wrote through the pipeline', async () => {
+                assert.isOk((await testutil.readFile(fs, `${dir}/file`)).equals(data));
+            });
+
+            it('should read packets whose next header arrives in parts', async () => {
+                // the reader takes the start of the next header along with a packet
+                for (let i = 0; i < 3; i++) await cluster.command(`dn ${i} splitHeaders=1`);
+                assert.isOk((await testutil.readFile(fs, `${dir}/file`)).equals(data));
+                const ins = fs.createReadStream(`${dir}/file`);
+                const part = await ins.readAt(blockSize - 70000, 140001);
+                await new Promise(resolve => ins.close(resolve));
+                assert.isOk(part.equals(data.slice(blockSize - 70000, blockSize + 70001)), 'a read across blocks');
+            });
+
+            it('should fail reads of corrupt packets', async () => {
+                for (let i = 0; i < 3; i++) await cluster.command(`dn ${i} corruptReads=1`);
+                let error = null;
+                try {
+                    await testutil.readFile(fs, `${dir}/file`);
+                } catch (err) {
+                    error = err;
+                }
+                assert.isOk(error, 'the checksums should not match');
+            });
+        });
+
+        describe(`Checksum${suffix}`, () => {
+            const dir = `/checksum${uring ? '-uring' : ''}`;
+            const blockSize = 1024 * 1024;
+            const size = 2 * blockSize + 600000;
+            let fs = null;
+
+            before(async function () {
+                const sockets = nhdfs.metrics().counters.uringSockets;
+                fs = cluster.createFS(settings);
+                await fs.mkdir(dir);
+                await writeFile(fs, `${dir}/three`, testutil.textData(size).slice(0, size),
+                    { blockSize: blockSize, replication: 3 });
+                if (uring && nhdfs.metrics().counters.uringSockets === sockets) this.skip();
+            });
+
+            afterEach(async () => {
+                for (let i = 0; i < 3; i++) await cluster.command(`dn ${i} rejectTokens=0`);
+            });
+
+            it('should match HDFS', async () => {
+                const checksum = await fs.checksum(`${dir}/three`);
+                assert.equal(checksum.algorithm, 'MD5-of-2048MD5-of-512CRC32C');
+                assert.equal(checksum.bytes, '00000200' + '0000000000000800' + '179200a9f28f15fea94ee5c480b078e7');
+            });
+
+            it('should refetch the block tokens once when they are invalid', async () => {
+                // every replica of every block rejects its first token
+                for (let i = 0; i < 3; i++) await cluster.command(`dn ${i} rejectTokens=3`);
+                const checksum = await fs.checksum(`${dir}/three`);
+                assert.equal(checksum.md5, '179200a9f28f15fea94ee5c480b078e7');
+            });
+
+            it('should fail when the refetched tokens are invalid too', async () => {
+                for (let i = 0; i < 3; i++) await cluster.command(`dn ${i} rejectTokens=100`);
+                let error = null;
+                try {
+                    await fs.checksum(`${dir}/three`);
+                } catch (err) {
+                    error = err;
+                }
+                assert.isOk(error, 'the checksum should fail');
+            });
+        });
+    }
+
+    describe('Observer reads', () => {
+        const dir = '/observer';
+        let observers = null;
+        let fs = null;
+
+        /**
+         * Counters of observer reads and fallbacks to the active namenode.
+         */
+        function observerCounters() {
+            const counters = nhdfs.metrics().counters;
+            return { reads: counters.observerReads, fallbacks: counters.observerFallbacks };
+        }
+
+        before(async () => {
+            // nn1 is the active namenode, nn2 and nn3 are observers
+            observers = await testutil.startFakeCluster({ namenodes: 3, datanodes: 1 });
+            const settings = {
+                'dfs.nameservices': 'fakeobserver',
+                'dfs.ha.namenodes.fakeobserver': 'nn1,nn2,nn3',
+                'dfs.client.observer.namenodes.fakeobserver': 'nn2,nn3',
+                'dfs.client.observer.read.timeout': 500,
+                'dfs.client.observer.backoff': 1000
+            };
+            observers.ports.namenodes.forEach((port, i) => {
+                settings[`dfs.namenode.rpc-address.fakeobserver.nn${i + 1}`] = `localhost:${port}`;
+            });
+            await observers.command('nn 1 observer=1');
+            await observers.command('nn 2 observer=1');
+            fs = observers.createFS(settings, { service: 'fakeobserver', port: 0 });
+            await fs.mkdir(dir);
+        });
+
+        after(() => {
+            if (observers) observers.stop();
+        });
+
+        afterEach(async () => {
+            await observers.command('nn 1 stale=0');
+            await observers.command('nn 2 stale=0');
+        });
+
+        it('should route reads to the observers', async () => {
+            const data = Buffer.from('hello');
+            await writeFile(fs, `${dir}/routed`, data);
+            const before = observerCounters();
+            assert.equal((await fs.stats(`${dir}/routed`)).size, data.length);
+            assert.deepEqual(await testutil.readFile(fs, `${dir}/routed`), data);
+            assert.include((await fs.list(dir)).map(f => f.path.split('/').pop()), 'routed');
+            const after = observerCounters();
+            assert.isAtLeast(after.reads - before.reads, 3, 'stats, block locations and listing');
+            assert.equal(after.fallbacks, before.fallbacks, 'the observers are up to date');
+        });
+
+        it('should see its own writes on the observers', async () => {
+            const before = observerCounters();
+            for (let i = 0; i < 20; i++) {
+                const path = `${dir}/aligned${i}`;
+                await writeFile(fs, path, Buffer.alloc(i));
+                assert.equal((await fs.stats(path)).size, i, 'a read after a write sees the write');
+                await fs.rename(path, `${path}.renamed`);
+                assert.isNotOk(await fs.exists(path), 'a read after a rename sees the rename');
+            }
+            const after = observerCounters();
+            assert.isAtLeast(after.reads - before.reads, 40);
+            assert.equal(after.fallbacks, before.fallbacks);
+        });
+
+        it('should fall back to the active namenode when the observers are stale', async () => {
+            await observers.command('nn 1 stale=1');
+            await observers.command('nn 2 stale=1');
+            const data = Buffer.from('world');
+            await writeFile(fs, `${dir}/stale`, data);
+            const before = observerCounters();
+            assert.equal((await fs.stats(`${dir}/stale`)).size, data.length, 'the write is seen on the active');
+            assert.deepEqual(await testutil.readFile(fs, `${dir}/stale`), data);
+            const stale = observerCounters();
+            assert.isAtLeast(stale.fallbacks - before.fallbacks, 2);
+            // stale observers are not backed off, they serve again once they caught up
+            await observers.command('nn 1 stale=0');
+            await observers.command('nn 2 stale=0');
+            assert.equal((await fs.stats(`${dir}/stale`)).size, data.length);
+            const caughtUp = observerCounters();
+            assert.equal(caughtUp.fallbacks, stale.fallbacks);
+            assert.equal(caughtUp.reads, stale.reads + 1);
+        });
+    });
+
+    describe('Namenode failover', () => {
+        let ha = null;
+        let hintDir = null;
+
+        /**
+         * A FileSystem on the three namenodes, it starts on nn1 unless a hint says otherwise.
+         */
+        function createHAFS(probeTimeout = 1000) {
+            const settings = {
+                'dfs.nameservices': 'fakeha',
+                'dfs.ha.namenodes.fakeha': 'nn1,nn2,nn3',
+                'dfs.client.failover.hint.dir': hintDir,
+                'dfs.client.failover.probe.timeout': probeTimeout,
+                'rpc.client.connect.retry': 1,
+                'rpc.client.timeout': 1000
+            };
+            ha.ports.namenodes.forEach((port, i) => {
+                settings[`dfs.namenode.rpc-address.fakeha.nn${i + 1}`] = `localhost:${port}`;
+            });
+            return ha.createFS(settings, { service: 'fakeha', port: 0 });
+        }
+
+        function failovers() {
+            return nhdfs.metrics().counters.namenodeFailovers;
+        }
+
+        /**
+         * The directory of the hint files of this user.
+         */
+        function userHintDir() {
+            return path.join(hintDir, `libhdfs3-${process.geteuid()}`);
+        }
+
+        before(async () => {
+            ha = await testutil.startFakeCluster({ namenodes: 3, datanodes: 1 });
+            hintDir = lfs.mkdtempSync(path.join(os.tmpdir(), 'nhdfs-hint-'));
+        });
+
+        after(() => {
+            if (ha) ha.stop();
+            if (hintDir) lfs.rmSync(hintDir, { recursive: true, force: true });
+        });
+
+        beforeEach(async () => {
+            for (const i of [0, 1, 2]) {
+                await ha.command(`nn ${i} down=0 standby=0 latency=0`);
+            }
+            lfs.rmSync(userHintDir(), { recursive: true, force: true });
+        });
+
+        /**
+         * Start a FileSystem on nn1, then fail nn1, let nn2 hang as a standby and
+         * resolve to the failovers and the milliseconds the next call took.
+         */
+        async function failOver(fs, fault) {
+            await fs.stats('/');
+            await ha.command(`nn 0 ${fault}`);
+            await ha.command('nn 1 standby=1 latency=3000');
+            const before = failovers();
+            const start = Date.now();
+            await fs.stats('/');
+            return { failovers: failovers() - before, elapsed: Date.now() - start };
+        }
+
+        it('should probe past a standby namenode to the active one', async () => {
+            const res = await failOver(createHAFS(), 'standby=1');
+            assert.equal(res.failovers, 1, 'the probes find nn3 without trying nn2');
+            assert.isBelow(res.elapsed, 1000, 'the hanging nn2 does not hold the failover');
+        });
+
+        it('should probe past a namenode which is down to the active one', async () => {
+            const res = await failOver(createHAFS(), 'down=1');
+            assert.equal(res.failovers, 1);
+            assert.isBelow(res.elapsed, 1000);
+        });
+
+        it('should start a new FileSystem on the remembered active namenode', async () => {
+            await failOver(createHAFS(), 'standby=1');
+            const hint = lfs.readFileSync(path.join(userHintDir(), 'active-ha-hdfs_fakeha'), 'utf8');
+            assert.equal(hint, `localhost:${ha.ports.namenodes[2]}`);
+            const before = failovers();
+            await createHAFS().stats('/');
+            assert.equal(failovers(), before, 'the new FileSystem starts on nn3');
+        });
+
+        it('should ignore hints in a directory others can write', async () => {
+            await failOver(createHAFS(), 'standby=1');
+            lfs.chmodSync(userHintDir(), 0o777);
+            const before = failovers();
+            await createHAFS().stats('/');
+            assert.equal(failovers(), before + 1, 'the new FileSystem starts on nn1');
+        });
+
+        it('should ignore hints in a directory of another user', async function () {
+            if (process.geteuid() !== 0) this.skip();
+            await failOver(createHAFS(), 'standby=1');
+            lfs.chownSync(userHintDir(), 65534, 65534);
+            const before = failovers();
+            await createHAFS().stats('/');
+            assert.equal(failovers(), before + 1, 'the new FileSystem starts on nn1');
+        });
+
+        it('should fail over to one namenode after the other without probes', async () => {
+            const fs = createHAFS(0);
+            await fs.stats('/');
+            await ha.command('nn 0 standby=1');
+            await ha.command('nn 1 standby=1');
+            const before = failovers();
+            await fs.stats('/');
+            assert.equal(failovers() - before, 2, 'nn2 is tried before nn3');
+        });
+    });
+
+    describe('Encryption zones', () => {
+        const dir = '/encrypted';
+        const data = Buffer.from('encrypted with the key of the file');
+        let kms = null;
+        let requests = [];
+
+        /**
+         * A FileSystem of the user which asks the stub KMS for the keys.
+         */
+        function createEncryptedFS(user, ttl = 600000, settings = {}) {
+            return cluster.createFS(Object.assign({
+                'dfs.encryption.key.provider.uri': `kms://http@localhost:${kms.address().port}/kms`,
+                'dfs.client.kms.dek.cache.expiryMsec': ttl }, settings), { user: user });
+        }
+
+        async function readBack(fs, file) {
+            assert.deepEqual(await testutil.readFile(fs, file), data);
+        }
+
+        function counters() {
+            return nhdfs.metrics().counters;
+        }
+
+        before(async () => {
+            /*
+             * The decrypted key is the encrypted one, twice for key256 to get
+             * an AES-256 key. The cookie names the user it was issued for.
+             */
+            kms = http.createServer((req, res) => {
+                let body = '';
+                req.on('data', chunk => body += chunk);
+                req.on('end', () => {
+                    const user = new URL(req.url, 'http://localhost').searchParams.get('user.name');
+                    const eek = JSON.parse(body);
+                    let key = Buffer.from(eek.material, 'base64');
+                    if (eek.name === 'key256') key = Buffer.concat([key, key]);
+                    requests.push({ user: user, cookie: req.headers.cookie || '', key: key,
+                        iv: Buffer.from(eek.iv, 'base64') });
+                    res.setHeader('Set-Cookie', `hadoop.auth=u=${user}; Path=/`);
+                    res.setHeader('Content-Type', 'application/json');
+                    res.end(JSON.stringify({ material: key.toString('base64') }));
+                });
+            });
+            await new Promise(resolve => kms.listen(0, 'localhost', resolve));
+            const fs = createEncryptedFS('alice');
+            await fs.mkdir(dir);
+            await cluster.command(`ez ${dir} key1`);
+            await writeFile(fs, `${dir}/f`, data);
+        });
+
+        after(() => {
+            if (kms) kms.close();
+        });
+
+        beforeEach(() => {
+            requests = [];
+        });
+
+        it('should decrypt the key of a file once', async () => {
+            const fs = createEncryptedFS('alice');
+            await readBack(fs, `${dir}/f`);
+            assert.lengthOf(requests, 1);
+            const before = counters();
+            await readBack(fs, `${dir}/f`);
+            assert.lengthOf(requests, 1, 'the second open should not ask the KMS');
+            assert.equal(counters().dekCacheHits, before.dekCacheHits + 1);
+            assert.equal(counters().dekCacheMisses, before.dekCacheMisses);
+        });
+
+        it('should decrypt the key again once it expired', async () => {
+            const fs = createEncryptedFS('alice', 300);
+            await readBack(fs, `${dir}/f`);
+            await timeout(600);
+            const before = counters();
+            await readBack(fs, `${dir}/f`);
+            assert.lengthOf(requests, 2, 'the expired key should be decrypted by the KMS');
+            assert.equal(counters().dekCacheMisses, before.dekCacheMisses + 1);
+            assert.equal(counters().dekCacheHits, before.dekCacheHits);
+        });
+
+        it('should not send the cookie of one user for another', async () => {
+            // without a cache every open asks the KMS, on the handles the other user released
+            const alice = createEncryptedFS('alice', 0);
+            const bob = createEncryptedFS('bob', 0);
+            for (let i = 0; i < 4; i++) {
+                await Promise.all([readBack(alice, `${dir}/f`), readBack(bob, `${dir}/f`)]);
+            }
+            assert.sameMembers(requests.map(r => r.user).filter((u, i, all) => all.indexOf(u) === i), ['alice', 'bob']);
+            for (const r of requests) {
+                assert.match(r.cookie, new RegExp(`^(|hadoop\\.auth=u=${r.user})$`), `cookie sent for ${r.user}`);
+            }
+        });
+
+        for (const bits of [128, 256]) {
+            it(`should encrypt in parallel as one pass of AES-${bits}-CTR`, async () => {
+                const zone = `${dir}${bits}`;
+                const minSize = 200000;
+                // one batch unaligned and just below the parallel size, then above it
+                const sizes = [5, minSize - 1, minSize + 1, 3 * minSize + 7];
+                const plain = crypto.randomBytes(sizes.reduce((a, b) => a + b));
+                // the segments are only encrypted in parallel on more than one processor
+                const parallel = createEncryptedFS('alice', 600000, {
+                    'dfs.client.crypto.parallel.threads': 4, 'dfs.client.crypto.parallel.min.size': minSize });
+                const serial = createEncryptedFS('alice', 600000, { 'dfs.client.crypto.parallel.threads': 1 });
+                await parallel.mkdir(zone);
+                await cluster.command(`ez ${zone} key${bits}`);
+                await new Promise((resolve, reject) => {
+                    const out = parallel.createWriteStream(`${zone}/f`, { replication: 1 });
+                    out.on('error', reject);
+                    out.on('close', resolve);
+                    let offset = 0;
+                    for (const size of sizes) {
+                        out.write(plain.slice(offset, offset += size));
+                    }
+                    out.end();
+                });
+                const { key, iv } = requests[requests.length - 1];
+                assert.lengthOf(key, bits / 8);
+                const cipher = crypto.createCipheriv(`aes-${bits}-ctr`, key, iv);
+                const expected = Buffer.concat([cipher.update(plain), cipher.final()]);
+                const raw = await testutil.readFile(parallel, `/.reserved/raw${zone}/f`);
+                assert.isOk(raw.equals(expected), 'the file should hold the one pass ciphertext');
+                for (const fs of [parallel, serial]) {
+                    for (const offset of [3, 17, 65541]) {
+                        for (const length of [minSize - 1, minSize + 1, 3 * minSize + 7]) {
+                            const ins = fs.createReadStream(`${zone}/f`);
+                            const part = await ins.readAt(offset, length);
+                            await new Promise(resolve => ins.close(resolve));
+                            assert.isOk(part.equals(plain.slice(offset, offset + length)), `${length} bytes at ${offset}`);
+                        }
+                    }
+                }
+            });
+        }
+    });
+});
@@ -3,7 +3,9 @@
 const chai = require('chai');
 const assert = chai.assert;
 const expect = chai.expect;
-const createFS = require('../lib/nhdfs').createFS;
+const nhdfs = require('../lib/nhdfs');
+const createFS = nhdfs.createFS;
+const testutil = require('./testutil');
 
 describe('HDFS operations', () => {
     const fs = createFS({service:"localhost", port:9000});
@@ -57,4 +59,163 @@ describe('HDFS operations', () => {
             assert.isNotOk(r, `${d} does not exist`);
         });
     });
+    describe('tracing', () => {
+        it('should report timings of operations', async () => {
+            nhdfs.configureTracing({sampleRate: 1});
+            nhdfs.traceSamples();
+            const s = await fs.stats('/');
+            assert.equal(s.timings.operation, 'getPathInfo');
+            assert.isAtLeast(s.timings.duration, 0);
+            assert.isOk(s.timings.phases.find(p => p.phase === 'rpc'), 'stat should call the namenode');
+            assert.notProperty(Object.assign({}, s), 'timings', 'timings should not be enumerable');
+            const samples = nhdfs.traceSamples();
+            assert.isOk(samples.find(t => t.operation === 'getPathInfo'), 'stat should be sampled');
+            nhdfs.configureTracing({sampleRate: 0});
+        });
+    });
+    describe('checksum', () => {
+        const dir = '/checksums';
+        const blockSize = 1024 * 1024;
+
+        before(async () => {
+            await fs.mkdir(dir);
+        });
+
+        after(async () => {
+            await fs.delete(dir, true);
+        });
+
+        // the values hadoop fs -checksum prints for the same content
+        it('should match HDFS for an empty file', async () => {
+            await testutil.writeFile(fs, `${dir}/empty`, Buffer.alloc(0));
+            const checksum = await fs.checksum(`${dir}/empty`);
+            assert.equal(checksum.algorithm, 'MD5-of-0MD5-of-0CRC32');
+            assert.equal(checksum.bytes, '000000000000000000000000' + '70bc8f4b72a86921468bf8e8441dce51');
+        });
+
+        it('should match HDFS for a file of one block', async () => {
+            await testutil.writeFile(fs, `${dir}/one`, testutil.textData(100000).slice(0, 100000));
+            const checksum = await fs.checksum(`${dir}/one`);
+            assert.equal(checksum.algorithm, 'MD5-of-0MD5-of-512CRC32C');
+            assert.equal(checksum.crcPerBlock, 0, 'crcPerBlock is only set for files of more than one block');
+            assert.equal(checksum.bytesPerCrc, 512);
+            assert.equal(checksum.bytes, '00000200' + '0000000000000000' + '76f88564de4def2d169a848dfc4d356c');
+            assert.equal(checksum.md5, '76f88564de4def2d169a848dfc4d356c');
+        });
+
+        it('should match HDFS for a file of several blocks', async () => {
+            const size = 2 * blockSize + 600000;
+            await testutil.writeFile(fs, `${dir}/three`, testutil.textData(size).slice(0, size), { blockSize: blockSize });
+            const checksum = await fs.checksum(`${dir}/three`);
+            assert.equal(checksum.algorithm, 'MD5-of-2048MD5-of-512CRC32C');
+            assert.equal(checksum.crcPerBlock, 2048);
+            assert.equal(checksum.bytes, '00000200' + '0000000000000800' + '179200a9f28f15fea94ee5c480b078e7');
+        });
+    });
+    describe('copyTree', () => {
+        const dir = '/copies';
+        const blockSize = 1024 * 1024;
+        const size = 3 * blockSize + 1000;
+        const data = testutil.textData(size).slice(0, size);
+
+        // the files copyTree writes before the copy is in place
+        const temporaries = async (path) => {
+            const found = [];
+            for (const f of await fs.list(path)) {
+                if (/\._COPYING_|\.part\d+|\._REPLACED_/.test(f.path)) {
+                    found.push(f.path);
+                }
+                if (f.type === 'directory') {
+                    found.push(...await temporaries(f.path));
+                }
+            }
+            return found;
+        };
+
+        before(async () => {
+            await fs.mkdir(`${dir}/src/sub`);
+            await testutil.writeFile(fs, `${dir}/src/big`, data, { blockSize: blockSize });
+            await testutil.writeFile(fs, `${dir}/src/sub/small`, Buffer.from('small file'));
+        });
+
+        after(async () => {
+            await fs.delete(dir, true);
+        });
+
+        it('should copy a file in parts of whole blocks', async () => {
+            const res = await fs.copyTree(`${dir}/src/big`, fs, `${dir}/parts`, { blocksPerPart: 1, parallelism: 4 });
+            assert.equal(res.filesCopied, 1);
+            assert.equal(res.bytesCopied, size);
+            assert.isOk(data.equals(await testutil.readFile(fs, `${dir}/parts`)), 'the parts should be concatenated in order');
+            assert.equal((await fs.stats(`${dir}/parts`)).block_size, blockSize);
+            assert.deepEqual(await temporaries(dir), []);
+        });
+
+        it('should skip files with the same checksum', async () => {
+            let res = await fs.copyTree(`${dir}/src`, fs, `${dir}/tree`, { blocksPerPart: 1 });
+            assert.equal(res.files, 2);
+            assert.equal(res.filesCopied, 2);
+            res = await fs.copyTree(`${dir}/src`, fs, `${dir}/tree`, { skipIfChecksumMatches: true });
+            assert.equal(res.filesSkipped, 2);
+            assert.equal(res.filesCopied, 0);
+            assert.equal(res.bytesSkipped, size + 'small file'.length);
+            assert.equal(res.bytesCopied, 0);
+        });
+
+        it('should replace an existing file', async () => {
+            await testutil.writeFile(fs, `${dir}/replaced`, Buffer.from('old content'));
+            await fs.copyTree(`${dir}/src/big`, fs, `${dir}/replaced`, { blocksPerPart: 1 });
+            assert.isOk(data.equals(await testutil.readFile(fs, `${dir}/replaced`)));
+            assert.deepEqual(await temporaries(dir), []);
+        });
+
+        it('should leave no temporaries when it fails', async () => {
+            // a directory where the file goes, found once the parts are copied
+            await fs.mkdir(`${dir}/failed/big`);
+            let errMsg = '';
+            try {
+                await fs.copyTree(`${dir}/src`, fs, `${dir}/failed`, { blocksPerPart: 1 });
+            } catch (err) {
+                errMsg = err.message;
+            }
+            assert.include(errMsg, 'is a directory');
+            assert.deepEqual(await temporaries(`${dir}/failed`), []);
+        });
+
+        it('should not copy a tree into itself through another handle', async () => {
+            const other = createFS({service:"localhost", port:9000});
+            let errMsg = '';
+            try {
+                await fs.copyTree(`${dir}/src`, other, `${dir}/src/sub/again`);
+            } catch (err) {
+                errMsg = err.message;
+            }
+            assert.include(errMsg, 'into itself');
+            assert.isNotOk(await fs.exists(`${dir}/src/sub/again`));
+        });
+
+        it('should report progress on the JS thread', async () => {
+            const seen = [];
+            const res = await fs.copyTree(`${dir}/src`, fs, `${dir}/progress`, {
+                blocksPerPart: 1, bufferSize: 65536, onProgress: (p) => seen.push(p)
+            });
+            assert.isAbove(seen.length, 0, 'onProgress should be called');
+            for (let i = 1; i < seen.length; ++i) {
+                assert.isAtLeast(seen[i].bytesCopied, seen[i - 1].bytesCopied);
+            }
+            assert.isAtMost(seen[seen.length - 1].bytesCopied, res.bytesCopied);
+            assert.equal(res.bytesCopied, size + 'small file'.length);
+        });
+    });
+    describe('metrics', () => {
+        it('should count namenode calls', async () => {
+            const before = nhdfs.metrics();
+            await fs.stats('/');
+            const after = fs.metrics();
+            assert.isAbove(after.counters.rpcCalls, before.counters.rpcCalls);
+            assert.isAbove(after.histograms.rpcLatency.count, before.histograms.rpcLatency.count);
+            assert.isAtLeast(after.histograms.rpcLatency.p99, after.histograms.rpcLatency.p50);
+            assert.property(after.counters, 'bytesReadShortCircuit');
+        });
+    });
   });
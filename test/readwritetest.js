@@ -3,9 +3,15 @@
 const chai = require('chai');
 const assert = chai.assert;
 const expect = chai.expect;
-const timeout = require("./testutil").timeout
+const zlib = require('zlib');
+const testutil = require("./testutil");
+const timeout = testutil.timeout;
+const textData = testutil.textData;
+const writeFile = testutil.writeFile;
+const readFile = testutil.readFile;
 
-const createFS = require('../lib/nhdfs').createFS;
+const nhdfs = require('../lib/nhdfs');
+const createFS = nhdfs.createFS;
 const fs = createFS({service:"localhost", port:9000});
 const name = "/readwritetest";
 
@@ -28,9 +34,9 @@ function write() {
     });
 }
 
-async function read() {
+async function read(options = {}) {
     console.log("starting reading");
-    const ins = fs.createReadStream(name);
+    const ins = fs.createReadStream(name, options);
     let str = "";
     return new Promise((resolve, reject) => {
         ins.on('error', (err) => {
@@ -48,6 +54,17 @@ async function read() {
     });
 }
 
+/**
+ * Collect garbage until the finalizers of the read buffers gave their chunks
+ * back to the pool, the finalizers run after the collection.
+ */
+async function releaseBuffers(chunksInUse) {
+    for (let i = 0; i < 20 && nhdfs.bufferPoolStats().chunksInUse > chunksInUse; i++) {
+        global.gc();
+        await new Promise(resolve => setImmediate(resolve));
+    }
+}
+
 describe('Write Read Test', () => {
 
     it(`should write file ${name} to `, async () => {        
@@ -71,4 +88,359 @@ describe('Write Read Test', () => {
             i += 1;
         });
     });
+
+    it(`should read ${name} with and without the native buffer pool`, async function () {
+        // run mocha with --expose-gc
+        if (!global.gc) this.skip();
+        await releaseBuffers(0);
+        const before = nhdfs.bufferPoolStats();
+        const pooled = await read();
+        const plain = await read({pooled: false});
+        assert.equal(pooled, plain, "pooled and plain reads should match");
+        let after = nhdfs.bufferPoolStats();
+        assert.isAbove(after.acquired, before.acquired, "pooled read should use the buffer pool");
+        await releaseBuffers(before.chunksInUse);
+        after = nhdfs.bufferPoolStats();
+        assert.equal(after.chunksInUse, before.chunksInUse, "the buffers of the read should be released");
+        assert.equal(after.released - before.released, after.acquired - before.acquired);
+
+        assert.equal(await read(), pooled);
+        const again = nhdfs.bufferPoolStats();
+        assert.isAbove(again.acquired, after.acquired);
+        assert.equal(again.slabs, after.slabs, "a second read should reuse the slabs of the first");
+        assert.equal(again.misses, after.misses, "a second read should reuse the chunks of the first");
+        await releaseBuffers(before.chunksInUse);
+
+        // the slabs are accounted to V8 as external memory until they are freed
+        const external = process.memoryUsage().external;
+        const pooledBytes = nhdfs.bufferPoolStats().pooledBytes;
+        nhdfs.trimBufferPool();
+        const freed = pooledBytes - nhdfs.bufferPoolStats().pooledBytes;
+        assert.isAbove(freed, 0, "trim should free the idle slabs");
+        assert.isAtMost(process.memoryUsage().external, external - freed + 64 * 1024, "the external memory should drop");
+    });
+
+    it(`should read ${name} at positions`, async () => {
+        const all = await read({pooled: false});
+        const ins = fs.createReadStream(name);
+        const reads = [0, 100, 5000, all.length - 10].map(p => ins.readAt(p, 64));
+        const bufs = await Promise.all(reads);
+        assert.equal(bufs[0].toString('utf8'), all.substr(0, 64));
+        assert.equal(bufs[1].toString('utf8'), all.substr(100, 64));
+        assert.equal(bufs[2].toString('utf8'), all.substr(5000, 64));
+        assert.equal(bufs[3].toString('utf8'), all.substr(all.length - 10), "short read at the end");
+        await new Promise(resolve => ins.close(resolve));
+    });
+
+    it(`should read at positions while streaming`, async () => {
+        const blockSize = 1024 * 1024;
+        const size = 2 * blockSize + 300000;
+        const data = textData(size).slice(0, size);
+        const path = `${name}-blocks`;
+        await writeFile(fs, path, data, {blockSize: blockSize});
+        const ins = fs.createReadStream(path);
+        const parts = [];
+        const reads = [];
+        // the stream closes itself at its end, read before
+        const tail = ins.readAt(2 * blockSize - 10, blockSize);
+        ins.on('data', (chunk) => {
+            parts.push(Buffer.from(chunk));
+            // across the first block boundary, between the reads of the stream
+            reads.push(ins.readAt(blockSize - 1000, 5000));
+        });
+        await new Promise((resolve, reject) => {
+            ins.on('error', reject);
+            ins.on('end', resolve);
+        });
+        assert.isOk(Buffer.concat(parts).equals(data), "readAt should not move the stream");
+        assert.isAbove(reads.length, 1);
+        for (const buf of await Promise.all(reads)) {
+            assert.isOk(buf.equals(data.slice(blockSize - 1000, blockSize + 4000)), "readAt should read across blocks");
+        }
+        assert.isOk((await tail).equals(data.slice(2 * blockSize - 10)), "short read only at the end");
+        await fs.delete(path);
+    });
+});
+
+/**
+ * A valid lz4 block holding data as literals only, the way a file written
+ * by Hadoop looks to the decoder without an lz4 library in the test.
+ */
+function lz4Literals(data) {
+    const head = [Math.min(data.length, 15) << 4];
+    if (data.length >= 15) {
+        let rest = data.length - 15;
+        for (; rest >= 255; rest -= 255) head.push(255);
+        head.push(rest);
+    }
+    return Buffer.concat([Buffer.from(head), data]);
+}
+
+/**
+ * A valid snappy block holding data as literals only.
+ */
+function snappyLiterals(data) {
+    const parts = [];
+    const length = [];
+    for (let v = data.length; ; v >>>= 7) {
+        if (v < 0x80) {
+            length.push(v);
+            break;
+        }
+        length.push((v & 0x7f) | 0x80);
+    }
+    parts.push(Buffer.from(length));
+    for (let p = 0; p < data.length; p += 65536) {
+        const literal = data.slice(p, p + 65536);
+        const n = literal.length - 1;
+        parts.push(n < 60 ? Buffer.from([n << 2]) : Buffer.from([61 << 2, n & 0xff, n >> 8]));
+        parts.push(literal);
+    }
+    return Buffer.concat(parts);
+}
+
+function be32(v) {
+    const b = Buffer.alloc(4);
+    b.writeUInt32BE(v, 0);
+    return b;
+}
+
+/**
+ * Hadoop BlockCompressorStream: the raw size of each block followed by the
+ * chunks it was compressed in, Hadoop splits a block in several chunks.
+ */
+function hadoopBlocks(data, blockSize, compress) {
+    const parts = [];
+    for (let p = 0; p < data.length; p += blockSize) {
+        const block = data.slice(p, p + blockSize);
+        const half = block.length >> 1;
+        parts.push(be32(block.length));
+        for (const chunk of [block.slice(0, half), block.slice(half)]) {
+            const compressed = compress(chunk);
+            parts.push(be32(compressed.length), compressed);
+        }
+    }
+    return Buffer.concat(parts);
+}
+
+/**
+ * Raw sizes of the blocks of a file written in the Hadoop block format by
+ * the encoder, which compresses every block in one chunk.
+ */
+function hadoopBlockSizes(raw) {
+    const sizes = [];
+    for (let p = 0; p < raw.length;) {
+        sizes.push(raw.readUInt32BE(p));
+        p += 8 + raw.readUInt32BE(p + 4);
+        assert.isAtMost(p, raw.length, 'chunk should end in the file');
+    }
+    return sizes;
+}
+
+describe('Codec round trips', () => {
+    const dir = '/codectest';
+    const data = textData(1500000);
+    const extensions = { gzip: '.gz', zstd: '.zst', lz4: '.lz4', snappy: '.snappy' };
+
+    before(async () => {
+        if (!(await fs.exists(dir))) await fs.mkdir(dir);
+    });
+
+    after(async () => {
+        await fs.delete(dir, true);
+    });
+
+    Object.keys(extensions).forEach((codec) => {
+        it(`should write and read back ${codec}`, async function () {
+            for (const threads of [1, 4]) {
+                const path = `${dir}/data${threads}${extensions[codec]}`;
+                try {
+                    await writeFile(fs, path, data, { codec: codec, threads: threads });
+                } catch (err) {
+                    if (/not built in/.test(err.message)) return this.skip();
+                    throw err;
+                }
+                const raw = await readFile(fs, path);
+                assert.isBelow(raw.length, data.length, `${codec} should compress`);
+                assert.isOk((await readFile(fs, path, { codec: codec })).equals(data), `${codec} with ${threads} threads`);
+                assert.isOk((await readFile(fs, path, { codec: 'auto' })).equals(data), `${codec} detected`);
+                if (codec === 'gzip') {
+                    assert.isOk(zlib.gunzipSync(raw).equals(data), 'gzip members should be readable by zlib');
+                } else if (codec === 'lz4' || codec === 'snappy') {
+                    const sizes = hadoopBlockSizes(raw);
+                    assert.equal(sizes.reduce((a, b) => a + b, 0), data.length, 'blocks should hold all data');
+                    sizes.forEach(s => assert.isAtMost(s, 256 * 1024, 'blocks should fit the Hadoop decompressor'));
+                }
+            }
+        });
+    });
+
+    it('should read concatenated gzip members', async () => {
+        const path = `${dir}/members.gz`;
+        const cut = 700001;
+        await writeFile(fs, path, Buffer.concat([zlib.gzipSync(data.slice(0, cut)), zlib.gzipSync(data.slice(cut))]));
+        assert.isOk((await readFile(fs, path, { codec: 'gzip' })).equals(data), 'all members');
+        assert.isOk((await readFile(fs, path, { codec: 'auto' })).equals(data), 'gzip detected from the magic');
+    });
+
+    [['lz4', lz4Literals], ['snappy', snappyLiterals]].forEach(([codec, compress]) => {
+        it(`should read ${codec} files in the Hadoop block format`, async function () {
+            const path = `${dir}/hadoop${extensions[codec]}`;
+            await writeFile(fs, path, hadoopBlocks(data, 256 * 1024, compress));
+            try {
+                assert.isOk((await readFile(fs, path, { codec: codec })).equals(data), `${codec} blocks of two chunks`);
+            } catch (err) {
+                if (/not built in/.test(err.message)) return this.skip();
+                throw err;
+            }
+        });
+    });
+
+    it('should close codec streams destroyed in the middle', async () => {
+        const path = `${dir}/destroyed.gz`;
+        await writeFile(fs, path, zlib.gzipSync(data));
+        for (let i = 0; i < 5; ++i) {
+            const ins = fs.createReadStream(path, { codec: 'gzip', highWaterMark: 16384 });
+            await new Promise((resolve, reject) => {
+                ins.on('error', reject);
+                // the next decode is in flight on a libuv thread
+                ins.once('data', () => ins.destroy());
+                ins.on('close', resolve);
+            });
+            const out = fs.createWriteStream(`${dir}/destroyed${i}.gz`, { codec: 'gzip', replication: 1 });
+            await new Promise((resolve) => out.once('open', resolve));
+            await new Promise((resolve) => {
+                out.on('close', resolve);
+                out.on('error', () => {});
+                // the write is in flight on a libuv thread
+                out.write(data);
+                out.destroy();
+            });
+        }
+        assert.isOk((await readFile(fs, path, { codec: 'gzip' })).equals(data), 'the file should still be readable');
+    });
+
+    it('should fail on a truncated file', async function () {
+        const path = `${dir}/truncated.gz`;
+        const gz = zlib.gzipSync(data);
+        await writeFile(fs, path, gz.slice(0, gz.length - 100));
+        let error = null;
+        try {
+            await readFile(fs, path, { codec: 'gzip' });
+        } catch (err) {
+            error = err;
+        }
+        assert.isOk(error, 'truncated gzip should fail');
+    });
+});
+
+/**
+ * All records of path as strings, and the batches they came in.
+ */
+async function readRecords(path, options) {
+    const records = [];
+    const batches = [];
+    for await (const batch of fs.createRecordStream(path, options)) {
+        assert.equal(batch.offsets[0], 0, 'a batch should start with a record');
+        assert.equal(batch.offsets[batch.length], batch.buffer.length, 'a batch should end with a record');
+        batches.push(batch);
+        for (const record of batch) records.push(record.toString('utf8'));
+    }
+    return { records, batches };
+}
+
+describe('Record batches', () => {
+    const dir = '/recordtest';
+
+    before(async () => {
+        if (!(await fs.exists(dir))) await fs.mkdir(dir);
+    });
+
+    after(async () => {
+        await fs.delete(dir, true);
+    });
+
+    it('should keep records spanning reads whole', async () => {
+        const path = `${dir}/lines`;
+        const data = textData(300000);
+        await writeFile(fs, path, data);
+        const lines = data.toString('utf8').split('\n').slice(0, -1);
+        const { records, batches } = await readRecords(path, { maxBatchBytes: 1000 });
+        assert.deepEqual(records, lines, 'records should match the lines');
+        assert.isAbove(batches.length, 100, 'small batches');
+        batches.forEach(b => assert.isAtMost(b.buffer.length, 1000, 'batches should not grow for short records'));
+        assert.deepEqual((await readRecords(path, {})).records, lines, 'default batch size');
+    });
+
+    it('should return the last record with or without a delimiter', async () => {
+        await writeFile(fs, `${dir}/ended`, Buffer.from('a\nbb\nccc\n'));
+        await writeFile(fs, `${dir}/open`, Buffer.from('a\nbb\nccc'));
+        await writeFile(fs, `${dir}/empty`, Buffer.alloc(0));
+        await writeFile(fs, `${dir}/blank`, Buffer.from('\n\nx\n'));
+        assert.deepEqual((await readRecords(`${dir}/ended`, {})).records, ['a', 'bb', 'ccc']);
+        assert.deepEqual((await readRecords(`${dir}/open`, {})).records, ['a', 'bb', 'ccc']);
+        assert.deepEqual((await readRecords(`${dir}/open`, { maxBatchBytes: 4 })).records, ['a', 'bb', 'ccc']);
+        assert.deepEqual((await readRecords(`${dir}/empty`, {})).records, []);
+        assert.deepEqual((await readRecords(`${dir}/blank`, {})).records, ['', '', 'x'], 'empty records');
+    });
+
+    it('should grow the batch for records longer than it', async () => {
+        const path = `${dir}/long`;
+        const long = 'x'.repeat(50000);
+        const expected = ['short', long, 'after', long + 'y'];
+        await writeFile(fs, path, Buffer.from(expected.join('\n')));
+        const { records, batches } = await readRecords(path, { maxBatchBytes: 1024 });
+        assert.deepEqual(records.map(r => r.length), expected.map(r => r.length));
+        assert.deepEqual(records, expected);
+        assert.isAbove(Math.max(...batches.map(b => b.buffer.length)), 50000, 'the batch should have doubled');
+    });
+
+    it('should scan splits in order', async () => {
+        const path = `${dir}/scan`;
+        const data = textData(400000);
+        await writeFile(fs, path, data);
+        const lines = data.toString('utf8').split('\n').slice(0, -1);
+        for (const splitSize of [7777, 65536, 1 << 20]) {
+            const records = [];
+            const splits = [];
+            const result = await fs.scanParallel(path, { splitSize: splitSize, concurrency: 4, maxBatchBytes: 4096 },
+                async (batch, split) => {
+                    if (records.length % 7 === 0) await timeout(1);
+                    splits.push(split);
+                    for (const record of batch) records.push(record.toString('utf8'));
+                });
+            assert.equal(result.splits, Math.ceil(data.length / splitSize));
+            assert.equal(result.records, lines.length);
+            assert.deepEqual(records, lines, `records with splits of ${splitSize} bytes`);
+            assert.deepEqual(splits, splits.slice().sort((a, b) => a - b), 'batches in split order');
+        }
+    });
+
+    it('should scan splits unordered', async () => {
+        const path = `${dir}/scan`;
+        const lines = (await readRecords(path, {})).records;
+        const records = [];
+        const result = await fs.scanParallel(path, { splitSize: 10000, concurrency: 8, ordered: false }, (batch) => {
+            for (const record of batch) records.push(record.toString('utf8'));
+        });
+        assert.equal(result.records, lines.length);
+        assert.deepEqual(records.sort(), lines.sort(), 'every record once');
+    });
+
+    it('should fail a scan of a missing file', async () => {
+        let error = null;
+        try {
+            await fs.scanParallel(`${dir}/missing`, {}, () => {});
+        } catch (err) {
+            error = err;
+        }
+        assert.isOk(error, 'missing file should fail');
+    });
+
+    it('should split at other delimiters', async () => {
+        const path = `${dir}/fields`;
+        await writeFile(fs, path, Buffer.from('a,b\n,c,,d'));
+        assert.deepEqual((await readRecords(path, { delimiter: ',' })).records, ['a', 'b\n', 'c', '', 'd']);
+        assert.deepEqual((await readRecords(path, { delimiter: 44, maxBatchBytes: 2 })).records, ['a', 'b\n', 'c', '', 'd']);
+    });
 });
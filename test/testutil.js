@@ -1 +1,134 @@
-module.exports.timeout = ms => new Promise(res => setTimeout(res, ms))
\ No newline at end of file
+'use strict';
+
+const childProcess = require('child_process');
+const lfs = require('fs');
+const os = require('os');
+const path = require('path');
+const readline = require('readline');
+const nhdfs = require('../lib/nhdfs');
+
+module.exports.timeout = ms => new Promise(res => setTimeout(res, ms))
+
+/**
+ * Deterministic text of about size bytes, one numbered line after the other.
+ */
+module.exports.textData = (size) => {
+    const lines = [];
+    let length = 0;
+    for (let i = 0; length < size; ++i) {
+        const line = `line ${i} ${'abcdefghijklmnopqrstuvwxyz'.substr(i % 26)} ${i * 7919 % 10007}\n`;
+        lines.push(line);
+        length += line.length;
+    }
+    return Buffer.from(lines.join(''), 'utf8');
+}
+
+/**
+ * Write data to path and resolve once the file is closed.
+ */
+module.exports.writeFile = (fs, path, data, options = {}) => new Promise((resolve, reject) => {
+    const out = fs.createWriteStream(path, Object.assign({ replication: 1 }, options));
+    out.on('error', reject);
+    out.on('close', resolve);
+    for (let p = 0; p < data.length; p += 65536) {
+        out.write(data.slice(p, p + 65536));
+    }
+    out.end();
+})
+
+/**
+ * Read the whole file at path into one Buffer.
+ */
+module.exports.readFile = (fs, path, options = {}) => new Promise((resolve, reject) => {
+    const ins = fs.createReadStream(path, options);
+    const parts = [];
+    ins.on('error', reject);
+    ins.on('data', (data) => parts.push(Buffer.from(data)));
+    ins.on('end', () => {
+        ins.close();
+        resolve(Buffer.concat(parts));
+    });
+})
+
+/**
+ * The hdfs-fake-cluster binary: NHDFS_FAKE_CLUSTER, else the one hdfslib-build.sh installs
+ * with NHDFS_BUILD_FAKE_CLUSTER=1, null if there is none.
+ */
+function fakeClusterBinary() {
+    const candidates = [process.env.NHDFS_FAKE_CLUSTER,
+        path.join(__dirname, '..', 'build_deps', 'libhdfs3', 'dist', 'bin', 'hdfs-fake-cluster')];
+    return candidates.find(f => f && lfs.existsSync(f)) || null;
+}
+
+/**
+ * A fake NameNode/DataNode cluster in its own process, faults are set with the commands
+ * described in deps/libhdfs3/fakecluster/FakeClusterMain.cpp.
+ */
+class FakeCluster {
+    constructor(proc, lines, ports) {
+        this.proc = proc;
+        this.ports = ports;
+        this.answers = [];
+        this.confFiles = [];
+        lines.on('line', (line) => {
+            const answer = this.answers.shift();
+            if (answer) answer(line);
+        });
+    }
+
+    /**
+     * Run a command, e.g. 'nn 0 latency=100', resolves to its answer.
+     */
+    command(line) {
+        return new Promise((resolve, reject) => {
+            this.answers.push((answer) => answer.startsWith('error') ? reject(new Error(answer)) : resolve(answer));
+            this.proc.stdin.write(line + '\n');
+        });
+    }
+
+    /**
+     * The stats command, {blocks, datanodes: [{bytesRead, bytesWritten, dropBehindOps, lastReadahead}],
+     * namenodes: [{connections: [{id, open, methods}]}]}, lastReadahead is -1 until a stream sent a
+     * readahead hint, connections are in the order they were accepted with the methods called on them.
+     */
+    async stats() {
+        return JSON.parse(await this.command('stats'));
+    }
+
+    /**
+     * A FileSystem of its own on the cluster.
+     * @param {Object} settings libhdfs3 configuration, written to a configuration file
+     * @param {Object} options createFS options, by default the first namenode
+     */
+    createFS(settings = {}, options = {}) {
+        const file = path.join(os.tmpdir(), `nhdfs-fake-${process.pid}-${this.confFiles.length}.xml`);
+        // the datanodes are local but do not serve short circuit reads
+        const all = Object.assign({ 'dfs.client.read.shortcircuit': 'false' }, settings);
+        lfs.writeFileSync(file, '<configuration>' + Object.keys(all).map(name =>
+            `<property><name>${name}</name><value>${all[name]}</value></property>`).join('') + '</configuration>');
+        this.confFiles.push(file);
+        return nhdfs.createFS(Object.assign({ service: 'localhost', port: this.ports.namenodes[0],
+            configurationPath: file, useHadoopConfEnv: false }, options));
+    }
+
+    stop() {
+        this.proc.kill();
+        this.confFiles.forEach(file => lfs.unlinkSync(file));
+        this.confFiles = [];
+    }
+}
+
+/**
+ * Start a fake cluster, resolves to null if the binary was not built.
+ * @param {Object} options {namenodes, datanodes}
+ * @return {Promise<FakeCluster>}
+ */
+module.exports.startFakeCluster = (options = {}) => new Promise((resolve, reject) => {
+    const binary = fakeClusterBinary();
+    if (!binary) return resolve(null);
+    const proc = childProcess.spawn(binary, ['--namenodes', String(options.namenodes || 1),
+        '--datanodes', String(options.datanodes || 3)], { stdio: ['pipe', 'pipe', 'inherit'] });
+    proc.on('error', reject);
+    const lines = readline.createInterface({ input: proc.stdout });
+    lines.once('line', (line) => resolve(new FakeCluster(proc, lines, JSON.parse(line))));
+})
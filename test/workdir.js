@@ -3,7 +3,8 @@
 const chai = require('chai');
 const assert = chai.assert;
 const expect = chai.expect;
-const createFS = require('../lib/nhdfs').createFS;
+const nhdfs = require('../lib/nhdfs');
+const createFS = nhdfs.createFS;
 
 const userName = require("os").userInfo().username;
 const fs = createFS({service:"localhost", port:9000});
@@ -31,4 +32,19 @@ describe('Working dir operations', () => {
         assert.equal(nwd, curDir, `current user working dir must be ${curDir}`);  
         await fs.delete(tmpWorkDir);
     });
+
+    it('should keep the working directory per FileSystem unless shared', async () => {
+        const curDir = await fs.getWorkingDirectory();
+        const other = createFS({service:"localhost", port:9000});
+        await other.setWorkingDirectory('/tmp');
+        assert.equal(await fs.getWorkingDirectory(), curDir, 'a FileSystem should not see the working dir of another');
+        const before = nhdfs.fileSystemRegistryStats();
+        const a = await nhdfs.createFSAsync({service:"localhost", port:9000, shared: true});
+        const b = await nhdfs.createFSAsync({service:"localhost", port:9000, shared: true});
+        const after = nhdfs.fileSystemRegistryStats();
+        assert.equal(after.handles, before.handles + 1, 'shared FileSystems should use one handle');
+        await a.setWorkingDirectory('/tmp');
+        assert.equal(await b.getWorkingDirectory(), '/tmp', 'shared FileSystems share the working dir');
+        assert.equal(await fs.getWorkingDirectory(), curDir);
+    });
 });